@@ -0,0 +1,92 @@
+#include <asio_cares/arena.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace asio_cares {
+
+arena::arena (memory_resource & upstream) noexcept
+	:	arena(nullptr, 0, upstream)
+{}
+
+arena::arena (void * buffer, std::size_t size, memory_resource & upstream) noexcept
+	:	upstream_   (upstream),
+		buffer_     (static_cast<unsigned char *>(buffer)),
+		buffer_size_(size),
+		chunks_     (nullptr),
+		ptr_        (buffer_),
+		avail_      (size),
+		next_size_  (std::max(size * 2, std::size_t(1024)))
+{}
+
+arena::~arena () noexcept {
+	release(chunks_);
+}
+
+void arena::release (chunk * c) noexcept {
+	while (c) {
+		auto next = c->next;
+		upstream_.deallocate(c, sizeof(chunk) + c->size);
+		c = next;
+	}
+}
+
+void arena::reset () noexcept {
+	if (!chunks_) {
+		ptr_ = buffer_;
+		avail_ = buffer_size_;
+		return;
+	}
+	//	Chunks grow geometrically so the most
+	//	recent is the largest
+	release(chunks_->next);
+	chunks_->next = nullptr;
+	if (chunks_->size < buffer_size_) {
+		release(chunks_);
+		chunks_ = nullptr;
+		ptr_ = buffer_;
+		avail_ = buffer_size_;
+		return;
+	}
+	ptr_ = reinterpret_cast<unsigned char *>(chunks_ + 1);
+	avail_ = chunks_->size;
+}
+
+memory_resource & arena::upstream () const noexcept {
+	return upstream_;
+}
+
+void * arena::do_allocate (std::size_t bytes, std::size_t alignment) {
+	auto padding = [&] () noexcept {
+		auto address = reinterpret_cast<std::uintptr_t>(ptr_);
+		return std::size_t((alignment - (address % alignment)) % alignment);
+	};
+	if (!ptr_ || ((padding() + bytes) > avail_)) {
+		//	Chunk memory is maximally aligned, this
+		//	covers any extended alignment
+		auto size = std::max(next_size_, bytes + alignment);
+		auto c = new (upstream_.allocate(sizeof(chunk) + size)) chunk;
+		c->next = chunks_;
+		c->size = size;
+		chunks_ = c;
+		ptr_ = reinterpret_cast<unsigned char *>(c + 1);
+		avail_ = size;
+		next_size_ = size * 2;
+	}
+	auto p = padding();
+	auto retr = ptr_ + p;
+	ptr_ += p + bytes;
+	avail_ -= p + bytes;
+	return retr;
+}
+
+void arena::do_deallocate (void *, std::size_t, std::size_t) noexcept {}
+
+bool arena::do_is_equal (const memory_resource & other) const noexcept {
+	return this == &other;
+}
+
+}
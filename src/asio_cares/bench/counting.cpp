@@ -0,0 +1,73 @@
+#include "counting.hpp"
+
+#include <ares.h>
+#include <asio_cares/error.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace asio_cares {
+namespace bench {
+
+namespace {
+
+std::atomic<std::size_t> count(0);
+std::atomic<std::size_t> bytes(0);
+thread_local bool enabled = false;
+
+void record (std::size_t size) noexcept {
+	if (!enabled) return;
+	count.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void * counted_malloc (std::size_t size) {
+	record(size);
+	return std::malloc(size);
+}
+
+void * counted_realloc (void * ptr, std::size_t size) {
+	record(size);
+	return std::realloc(ptr, size);
+}
+
+void counted_free (void * ptr) {
+	std::free(ptr);
+}
+
+}
+
+void count_allocations (bool enable) noexcept {
+	enabled = enable;
+}
+
+void install () {
+	int result = ares_library_init_mem(ARES_LIB_INIT_ALL, counted_malloc, counted_free, counted_realloc);
+	raise(result);
+}
+
+std::size_t allocations () noexcept {
+	return count.load();
+}
+
+std::size_t allocated () noexcept {
+	return bytes.load();
+}
+
+}
+}
+
+void * operator new (std::size_t size) {
+	asio_cares::bench::record(size);
+	if (auto ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete (void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete (void * ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
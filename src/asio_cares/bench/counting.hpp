@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace asio_cares {
+namespace bench {
+
+/**
+ *	Global operator new and the allocation functions
+ *	installed in libcares (see \ref install) count
+ *	allocations made by threads on which counting
+ *	has been enabled so that the stub server and
+ *	the bookkeeping of the benchmark are excluded.
+ *
+ *	\param [in] enable
+ *		\em true to count allocations made by the
+ *		calling thread, \em false otherwise.
+ */
+void count_allocations (bool enable) noexcept;
+/**
+ *	Initializes libcares (as `ares_library_init`
+ *	does) such that its allocations are counted.
+ */
+void install ();
+/**
+ *	Retrieves the number of allocations counted.
+ *
+ *	\return
+ *		The number of allocations.
+ */
+std::size_t allocations () noexcept;
+/**
+ *	Retrieves the number of bytes allocated by
+ *	the allocations counted.
+ *
+ *	\return
+ *		The number of bytes.
+ */
+std::size_t allocated () noexcept;
+
+}
+}
@@ -0,0 +1,479 @@
+//	End to end benchmark of async_send and async_process
+//	against an in-process stub server on the loopback
+//	interface.
+//
+//	Usage: asio_cares_bench [--name=value ...]
+//
+//	--queries=N      Measured queries (default 100000)
+//	--warmup=N       Unmeasured queries sent first (default 1000)
+//	--rate=N         Queries per second across all threads, zero
+//	                 sends closed loop (default 0)
+//	--concurrency=N  Maximum queries in flight per thread
+//	                 (default 100)
+//	--threads=N      Threads, each with its own io_service and
+//	                 channel (default 1)
+//	--mix=T=W,...    Query types and weights from a, aaaa, mx,
+//	                 txt (default a=1)
+//	--names=N        Distinct names queried (default 1000)
+//	--tcp=0|1        Send every query over TCP (default 0)
+//	--cache=0|1      Place a cache in front of each channel
+//	                 (default 0)
+//	--coalesce=0|1   Coalesce identical questions (default 0)
+//	--batch=0|1      Batch UDP datagrams with recvmmsg and
+//	                 sendmmsg (default 0)
+//	--pool=N         UDP sockets kept open for reuse per
+//	                 address family (default 0)
+//	--max_queries=N  Queries libcares sends on a UDP socket
+//	                 before closing it, zero for no limit
+//	                 (libcares 1.20.0 and later, default 0)
+//	--io_uring=0|1   Hand UDP datagrams to the kernel through
+//	                 io_uring rather than waiting for readiness
+//	                 with the reactor (requires ASIO_CARES_IO_URING,
+//	                 the JSON reports whether it was used,
+//	                 default 0)
+//
+//	Open loop latency is measured from the time at which
+//	each query was scheduled to be sent rather than the
+//	time at which it was sent so that queueing behind a
+//	stalled channel is not omitted. Closed loop latency
+//	is measured from the time each query was sent.
+//
+//	Results are written to standard output as a single
+//	JSON object.
+
+#include "counting.hpp"
+#include "stub_server.hpp"
+
+#include <ares.h>
+#include <asio_cares/cache.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <nameser.h>
+#include <Windows.h>
+#else
+#include <arpa/nameser.h>
+#include <time.h>
+#endif
+
+namespace asio_cares {
+namespace bench {
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+class options {
+public:
+	options ()
+		:	queries    (100000),
+			warmup     (1000),
+			rate       (0),
+			concurrency(100),
+			threads    (1),
+			mix        ("a=1"),
+			names      (1000),
+			tcp        (false),
+			cache      (false),
+			coalesce   (false),
+			batch      (false),
+			pool       (0),
+			max_queries(0),
+			io_uring   (false)
+	{}
+	std::size_t queries;
+	std::size_t warmup;
+	double      rate;
+	std::size_t concurrency;
+	std::size_t threads;
+	std::string mix;
+	std::size_t names;
+	bool        tcp;
+	bool        cache;
+	bool        coalesce;
+	bool        batch;
+	std::size_t pool;
+	std::size_t max_queries;
+	bool        io_uring;
+};
+
+options parse (int argc, char ** argv) {
+	options retr;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		auto eq = arg.find('=');
+		if ((arg.compare(0, 2, "--") != 0) || (eq == std::string::npos)) throw std::invalid_argument("Expected --name=value: " + arg);
+		auto name = arg.substr(2, eq - 2);
+		auto value = arg.substr(eq + 1);
+		if (name == "queries") retr.queries = std::stoul(value);
+		else if (name == "warmup") retr.warmup = std::stoul(value);
+		else if (name == "rate") retr.rate = std::stod(value);
+		else if (name == "concurrency") retr.concurrency = std::max<std::size_t>(std::stoul(value), 1);
+		else if (name == "threads") retr.threads = std::max<std::size_t>(std::stoul(value), 1);
+		else if (name == "mix") retr.mix = value;
+		else if (name == "names") retr.names = std::max<std::size_t>(std::stoul(value), 1);
+		else if (name == "tcp") retr.tcp = value != "0";
+		else if (name == "cache") retr.cache = value != "0";
+		else if (name == "coalesce") retr.coalesce = value != "0";
+		else if (name == "batch") retr.batch = value != "0";
+		else if (name == "pool") retr.pool = std::stoul(value);
+		else if (name == "max_queries") retr.max_queries = std::stoul(value);
+		else if (name == "io_uring") retr.io_uring = value != "0";
+		else throw std::invalid_argument("Unknown option: " + name);
+	}
+	return retr;
+}
+
+int query_type (const std::string & name) {
+	if (name == "a") return ns_t_a;
+	if (name == "aaaa") return ns_t_aaaa;
+	if (name == "mx") return ns_t_mx;
+	if (name == "txt") return ns_t_txt;
+	throw std::invalid_argument("Unknown query type: " + name);
+}
+
+//	Every query which may be sent, built up front
+//	so that building them is not measured
+class workload {
+public:
+	workload (const options & o) {
+		std::vector<std::pair<int, double>> types;
+		std::istringstream ss(o.mix);
+		std::string item;
+		while (std::getline(ss, item, ',')) {
+			auto eq = item.find('=');
+			auto type = query_type(item.substr(0, eq));
+			double weight = (eq == std::string::npos) ? 1 : std::stod(item.substr(eq + 1));
+			types.emplace_back(type, weight);
+		}
+		if (types.empty()) throw std::invalid_argument("Empty mix");
+		for (std::size_t i = 0; i < o.names; ++i) {
+			auto name = "host" + std::to_string(i) + ".example.com";
+			for (auto && t : types) {
+				unsigned char * ptr;
+				int len;
+				int result = ares_create_query(name.c_str(), ns_c_in, t.first, 0, 1, &ptr, &len, 0);
+				raise(result);
+				queries.emplace_back(ptr, ptr + len);
+				weights.push_back(t.second);
+				ares_free_string(ptr);
+			}
+		}
+	}
+	std::vector<std::vector<unsigned char>> queries;
+	std::vector<double>                     weights;
+};
+
+std::chrono::nanoseconds thread_cpu_time () noexcept {
+	#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+	auto ticks = [] (const FILETIME & t) noexcept {
+		return (std::uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+	};
+	return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+	#else
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+	#endif
+}
+
+//	libcares 1.23.0 and later has a query cache of
+//	its own which would answer all but the first of
+//	each distinct query, it is disabled so that the
+//	library is what is measured
+ares_options make_options (const options & o) noexcept {
+	ares_options retr;
+	std::memset(&retr, 0, sizeof(retr));
+	if (o.tcp) retr.flags = ARES_FLAG_USEVC;
+	#if ARES_VERSION >= 0x011400
+	retr.udp_max_queries = int(o.max_queries);
+	#endif
+	return retr;
+}
+
+int optmask () noexcept {
+	#if ARES_VERSION >= 0x011700
+	return ARES_OPT_FLAGS | ARES_OPT_QUERY_CACHE | ARES_OPT_UDP_MAX_QUERIES;
+	#elif ARES_VERSION >= 0x011400
+	return ARES_OPT_FLAGS | ARES_OPT_UDP_MAX_QUERIES;
+	#else
+	return ARES_OPT_FLAGS;
+	#endif
+}
+
+//	Drives one channel on one thread
+class worker {
+public:
+	worker (const options & o, const workload & w, const stub_server & s, std::size_t seed)
+		:	o_          (o),
+			w_          (w),
+			c_          (make_options(o), optmask(), ios_),
+			timer_      (ios_),
+			dist_       (w.weights.begin(), w.weights.end()),
+			rng_        (std::uint_fast32_t(seed)),
+			processing_ (false),
+			errors_     (0),
+			record_     (false),
+			total_      (0),
+			sent_       (0),
+			completed_  (0),
+			outstanding_(0)
+	{
+		s.apply(c_);
+		if (o.cache) c_.set_cache(&cache_);
+		c_.set_coalescing(o.coalesce);
+		c_.set_batching(o.batch);
+		c_.set_socket_pool_size(o.pool);
+		c_.set_io_uring(o.io_uring);
+		samples_.reserve(o.queries);
+	}
+	void run (std::size_t n, bool record) {
+		record_ = record;
+		total_ = n;
+		sent_ = 0;
+		completed_ = 0;
+		outstanding_ = 0;
+		start_ = clock::now();
+		if (o_.rate > 0) {
+			interval_ = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(double(o_.threads) / o_.rate));
+			tick();
+		} else {
+			while ((sent_ < total_) && (outstanding_ < o_.concurrency)) send(clock::now());
+			pump();
+		}
+		ios_.run();
+		ios_.reset();
+		if (processing_) throw std::logic_error("Processing did not complete");
+		if (error_) throw boost::system::system_error(error_);
+	}
+	std::vector<std::chrono::nanoseconds> & samples () noexcept {
+		return samples_;
+	}
+	std::size_t errors () const noexcept {
+		return errors_;
+	}
+	const asio_cares::metrics & metrics () const noexcept {
+		return c_.get_metrics();
+	}
+	bool io_uring () const noexcept {
+		return c_.get_io_uring();
+	}
+private:
+	clock::time_point intended (std::size_t i) const noexcept {
+		return start_ + (interval_ * std::int64_t(i));
+	}
+	void send (clock::time_point from) {
+		auto && q = w_.queries[dist_(rng_)];
+		++sent_;
+		++outstanding_;
+		async_send(c_, q.data(), int(q.size()), [this, from] (auto ec, auto, auto, auto) {
+			auto now = clock::now();
+			--outstanding_;
+			++completed_;
+			if (ec) ++errors_;
+			if (record_) samples_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - from));
+			if (o_.rate > 0) {
+				issue(now);
+			} else if (sent_ < total_) {
+				send(now);
+				pump();
+			}
+		});
+	}
+	//	Sends every query which is due, those which
+	//	cannot be sent because too many are in flight
+	//	are sent as soon as others complete
+	void issue (clock::time_point now) {
+		while ((sent_ < total_) && (outstanding_ < o_.concurrency) && (intended(sent_) <= now)) send(intended(sent_));
+		pump();
+	}
+	void tick () {
+		issue(clock::now());
+		if (sent_ == total_) return;
+		timer_.expires_at(std::max(intended(sent_), clock::now()));
+		timer_.async_wait([this] (auto ec) {
+			if (!ec) this->tick();
+		});
+	}
+	void pump () {
+		if (processing_ || done(c_)) return;
+		processing_ = true;
+		async_process(c_, [this] (auto ec) {
+			processing_ = false;
+			if (ec && !error_) error_ = ec;
+			if (!ec) pump();
+		});
+	}
+	const options &                           o_;
+	const workload &                          w_;
+	boost::asio::io_service                   ios_;
+	asio_cares::cache                         cache_;
+	channel                                   c_;
+	boost::asio::steady_timer                 timer_;
+	std::discrete_distribution<std::size_t>   dist_;
+	std::minstd_rand                          rng_;
+	bool                                      processing_;
+	boost::system::error_code                 error_;
+	std::size_t                               errors_;
+	bool                                      record_;
+	std::size_t                               total_;
+	std::size_t                               sent_;
+	std::size_t                               completed_;
+	std::size_t                               outstanding_;
+	clock::time_point                         start_;
+	clock::duration                           interval_;
+	std::vector<std::chrono::nanoseconds>     samples_;
+};
+
+std::chrono::nanoseconds percentile (std::vector<std::chrono::nanoseconds> & samples, double p) {
+	if (samples.empty()) return std::chrono::nanoseconds::zero();
+	auto rank = std::size_t(p * double(samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+	return samples[rank];
+}
+
+double microseconds (std::chrono::nanoseconds ns) noexcept {
+	return double(ns.count()) / 1000;
+}
+
+int run (int argc, char ** argv) {
+	auto o = parse(argc, argv);
+	install();
+	library l;
+	stub_server server;
+	workload w(o);
+	std::vector<std::unique_ptr<worker>> workers;
+	for (std::size_t i = 0; i < o.threads; ++i) {
+		workers.push_back(std::make_unique<worker>(o, w, server, i + 1));
+	}
+	std::vector<clock::time_point> starts(o.threads);
+	std::vector<clock::time_point> ends(o.threads);
+	std::vector<std::chrono::nanoseconds> cpu(o.threads);
+	std::vector<std::exception_ptr> errors(o.threads);
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < o.threads; ++i) {
+		std::size_t share = (o.queries / o.threads) + ((i < (o.queries % o.threads)) ? 1 : 0);
+		threads.emplace_back([&, i, share] () {
+			try {
+				auto && wkr = *workers[i];
+				wkr.run(o.warmup / o.threads, false);
+				count_allocations(true);
+				auto before = thread_cpu_time();
+				starts[i] = clock::now();
+				wkr.run(share, true);
+				ends[i] = clock::now();
+				cpu[i] = thread_cpu_time() - before;
+				count_allocations(false);
+			} catch (...) {
+				count_allocations(false);
+				errors[i] = std::current_exception();
+			}
+		});
+	}
+	for (auto && t : threads) t.join();
+	for (auto && ex : errors) if (ex) std::rethrow_exception(ex);
+	std::vector<std::chrono::nanoseconds> samples;
+	samples.reserve(o.queries);
+	std::size_t failed = 0;
+	//	Channel metrics include the warmup
+	std::uint64_t wakeups = 0;
+	std::uint64_t answers = 0;
+	std::uint64_t retries = 0;
+	std::uint64_t syscalls = 0;
+	std::uint64_t reused = 0;
+	for (auto && wkr : workers) {
+		samples.insert(samples.end(), wkr->samples().begin(), wkr->samples().end());
+		failed += wkr->errors();
+		wakeups += wkr->metrics().wakeups();
+		answers += wkr->metrics().completed();
+		retries += wkr->metrics().retries();
+		syscalls += wkr->metrics().syscalls();
+		reused += wkr->metrics().reused();
+	}
+	auto elapsed = *std::max_element(ends.begin(), ends.end()) - *std::min_element(starts.begin(), starts.end());
+	double seconds = std::chrono::duration<double>(elapsed).count();
+	std::chrono::nanoseconds total_cpu(0);
+	for (auto && c : cpu) total_cpu += c;
+	std::chrono::nanoseconds sum(0);
+	for (auto && s : samples) sum += s;
+	double n = double(std::max(samples.size(), std::size_t(1)));
+	auto max = samples.empty() ? std::chrono::nanoseconds::zero() : *std::max_element(samples.begin(), samples.end());
+	std::ostringstream out;
+	out << "{"
+	    << "\"mode\":\"" << ((o.rate > 0) ? "open" : "closed") << "\","
+	    << "\"transport\":\"" << (o.tcp ? "tcp" : "udp") << "\","
+	    << "\"queries\":" << samples.size() << ","
+	    << "\"errors\":" << failed << ","
+	    << "\"threads\":" << o.threads << ","
+	    << "\"concurrency\":" << o.concurrency << ","
+	    << "\"rate\":" << o.rate << ","
+	    << "\"mix\":\"" << o.mix << "\","
+	    << "\"names\":" << o.names << ","
+	    << "\"cache\":" << (o.cache ? "true" : "false") << ","
+	    << "\"coalesce\":" << (o.coalesce ? "true" : "false") << ","
+	    << "\"batch\":" << (o.batch ? "true" : "false") << ","
+	    << "\"pool\":" << o.pool << ","
+	    << "\"max_queries\":" << o.max_queries << ","
+	    << "\"io_uring\":" << (workers.front()->io_uring() ? "true" : "false") << ","
+	    << "\"elapsed_s\":" << seconds << ","
+	    << "\"qps\":" << ((seconds > 0) ? (double(samples.size()) / seconds) : 0) << ","
+	    << "\"latency_us\":{"
+	    << "\"mean\":" << (microseconds(sum) / n) << ","
+	    << "\"p50\":" << microseconds(percentile(samples, 0.5)) << ","
+	    << "\"p99\":" << microseconds(percentile(samples, 0.99)) << ","
+	    << "\"p999\":" << microseconds(percentile(samples, 0.999)) << ","
+	    << "\"max\":" << microseconds(max)
+	    << "},"
+	    << "\"cpu_us_per_query\":" << (microseconds(total_cpu) / n) << ","
+	    << "\"allocations_per_query\":" << (double(allocations()) / n) << ","
+	    << "\"bytes_allocated_per_query\":" << (double(allocated()) / n) << ","
+	    << "\"wakeups_per_answer\":" << ((answers > 0) ? (double(wakeups) / double(answers)) : 0) << ","
+	    << "\"syscalls_per_answer\":" << ((answers > 0) ? (double(syscalls) / double(answers)) : 0) << ","
+	    << "\"retries\":" << retries << ","
+	    << "\"sockets_reused\":" << reused << ","
+	    << "\"server_received\":" << server.received()
+	    << "}";
+	std::cout << out.str() << std::endl;
+	return 0;
+}
+
+}
+}
+}
+
+int main (int argc, char ** argv) {
+	try {
+		return asio_cares::bench::run(argc, argv);
+	} catch (const std::exception & ex) {
+		std::cerr << ex.what() << std::endl;
+	}
+	return 1;
+}
@@ -0,0 +1,88 @@
+#include "stub_server.hpp"
+
+#include <ares.h>
+#include <asio_cares/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/system/error_code.hpp>
+#include "dns_stub.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace asio_cares {
+namespace bench {
+
+stub_server::stub_server ()
+	:	work_    (new boost::asio::io_service::work(ios_)),
+		socket_  (ios_, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+		acceptor_(ios_),
+		pending_ (ios_),
+		received_(0)
+{
+	boost::asio::ip::tcp::endpoint ep(boost::asio::ip::address_v4::loopback(), socket_.local_endpoint().port());
+	acceptor_.open(ep.protocol());
+	acceptor_.bind(ep);
+	acceptor_.listen();
+	receive();
+	accept();
+	thread_ = std::thread([this] () {	ios_.run();	});
+}
+
+stub_server::~stub_server () noexcept {
+	work_.reset();
+	ios_.stop();
+	thread_.join();
+}
+
+void stub_server::apply (channel & c) const {
+	ares_addr_port_node node;
+	std::memset(&node, 0, sizeof(node));
+	node.family = AF_INET;
+	auto endpoint = socket_.local_endpoint();
+	auto bytes = endpoint.address().to_v4().to_bytes();
+	std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+	node.udp_port = endpoint.port();
+	node.tcp_port = endpoint.port();
+	int result = ares_set_servers_ports(c, &node);
+	raise(result);
+}
+
+std::size_t stub_server::received () const noexcept {
+	return received_.load();
+}
+
+void stub_server::receive () {
+	socket_.async_receive_from(boost::asio::buffer(buffer_), remote_, [this] (auto ec, auto len) {
+		if (ec) return;
+		++received_;
+		unsigned char out [512 + 64];
+		auto size = stub::answer(buffer_.data(), len, out);
+		boost::system::error_code ignored;
+		if (size) socket_.send_to(boost::asio::buffer(out, size), remote_, 0, ignored);
+		this->receive();
+	});
+}
+
+void stub_server::accept () {
+	acceptor_.async_accept(pending_, [this] (auto ec) {
+		if (ec) return;
+		std::make_shared<stub::connection>(ios_, std::move(pending_), [this] () {
+			++received_;
+			return std::chrono::microseconds(0);
+		})->read();
+		pending_ = boost::asio::ip::tcp::socket(ios_);
+		this->accept();
+	});
+}
+
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <asio_cares/channel.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+namespace asio_cares {
+namespace bench {
+
+/**
+ *	A minimal authoritative DNS server which listens
+ *	for both UDP and TCP on the same port on the
+ *	loopback interface and runs on its own thread.
+ *
+ *	Queries are answered by `stub::answer`.
+ */
+class stub_server {
+public:
+	stub_server (const stub_server &) = delete;
+	stub_server (stub_server &&) = delete;
+	stub_server & operator = (const stub_server &) = delete;
+	stub_server & operator = (stub_server &&) = delete;
+	/**
+	 *	Starts a server.
+	 */
+	stub_server ();
+	/**
+	 *	Stops the server.
+	 */
+	~stub_server () noexcept;
+	/**
+	 *	Configures a \ref channel to use this server
+	 *	as its only server.
+	 *
+	 *	\param [in] c
+	 *		The \ref channel.
+	 */
+	void apply (channel & c) const;
+	/**
+	 *	Retrieves the number of queries this server
+	 *	has received over either transport.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::size_t received () const noexcept;
+private:
+	void receive ();
+	void accept ();
+	boost::asio::io_service                        ios_;
+	std::unique_ptr<boost::asio::io_service::work> work_;
+	boost::asio::ip::udp::socket                   socket_;
+	boost::asio::ip::udp::endpoint                 remote_;
+	std::array<unsigned char, 512>                 buffer_;
+	boost::asio::ip::tcp::acceptor                 acceptor_;
+	boost::asio::ip::tcp::socket                   pending_;
+	std::atomic<std::size_t>                       received_;
+	std::thread                                    thread_;
+};
+
+}
+}
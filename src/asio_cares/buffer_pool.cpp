@@ -0,0 +1,202 @@
+#include <asio_cares/buffer_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace asio_cares {
+
+//	The bytes follow the block in the same
+//	allocation
+class buffer::block {
+public:
+	block (buffer_pool::state & pool, std::size_t capacity) noexcept
+		:	refs    (1),
+			pool    (&pool),
+			capacity(capacity),
+			size    (0),
+			next    (nullptr)
+	{}
+	unsigned char * data () noexcept {
+		return reinterpret_cast<unsigned char *>(this + 1);
+	}
+	std::atomic<std::size_t> refs;
+	buffer_pool::state *     pool;
+	std::size_t              capacity;
+	std::size_t              size;
+	block *                  next;
+};
+
+//	Shared by the pool and every outstanding
+//	block so that buffers may outlive the pool
+class buffer_pool::state {
+public:
+	state (memory_resource & resource, std::size_t max) noexcept
+		:	refs    (1),
+			resource(resource),
+			max     (max),
+			cached  (0),
+			head    (nullptr),
+			closed  (false)
+	{}
+	static state * create (memory_resource & resource, std::size_t max) {
+		void * ptr = resource.allocate(sizeof(state), alignof(state));
+		return new (ptr) state(resource, max);
+	}
+	~state () noexcept {
+		clear();
+	}
+	buffer::block * acquire (std::size_t size) {
+		buffer::block * retr = nullptr;
+		{
+			std::lock_guard<std::mutex> l(mutex);
+			if (head) {
+				retr = head;
+				head = retr->next;
+				--cached;
+			}
+		}
+		if (retr && (retr->capacity < size)) {
+			destroy(retr);
+			retr = nullptr;
+		}
+		if (retr) retr->refs.store(1, std::memory_order_relaxed);
+		else retr = create(size);
+		refs.fetch_add(1, std::memory_order_relaxed);
+		return retr;
+	}
+	void release (buffer::block * b) noexcept {
+		{
+			std::lock_guard<std::mutex> l(mutex);
+			if (!closed && (cached < max)) {
+				b->next = head;
+				head = b;
+				++cached;
+				b = nullptr;
+			}
+		}
+		if (b) destroy(b);
+		unref();
+	}
+	void close () noexcept {
+		{
+			std::lock_guard<std::mutex> l(mutex);
+			closed = true;
+			clear();
+		}
+		unref();
+	}
+private:
+	buffer::block * create (std::size_t size) {
+		//	Most answers fit in 512 bytes, this lets
+		//	blocks be reused for almost every answer
+		auto capacity = std::max(size, std::size_t(512));
+		void * ptr = resource.allocate(sizeof(buffer::block) + capacity);
+		return new (ptr) buffer::block(*this, capacity);
+	}
+	void destroy (buffer::block * b) noexcept {
+		auto capacity = b->capacity;
+		b->~block();
+		resource.deallocate(b, sizeof(buffer::block) + capacity);
+	}
+	void clear () noexcept {
+		while (head) {
+			auto next = head->next;
+			destroy(head);
+			head = next;
+		}
+		cached = 0;
+	}
+	void unref () noexcept {
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		auto && r = resource;
+		this->~state();
+		r.deallocate(this, sizeof(state), alignof(state));
+	}
+	std::atomic<std::size_t> refs;
+	memory_resource &        resource;
+	std::mutex               mutex;
+	std::size_t              max;
+	std::size_t              cached;
+	buffer::block *          head;
+	bool                     closed;
+};
+
+buffer::buffer () noexcept
+	:	block_(nullptr)
+{}
+
+buffer::buffer (block * b) noexcept
+	:	block_(b)
+{}
+
+buffer::buffer (const buffer & other) noexcept
+	:	block_(other.block_)
+{
+	if (block_) block_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+buffer::buffer (buffer && other) noexcept
+	:	block_(other.block_)
+{
+	other.block_ = nullptr;
+}
+
+buffer & buffer::operator = (const buffer & rhs) noexcept {
+	if (rhs.block_) rhs.block_->refs.fetch_add(1, std::memory_order_relaxed);
+	release();
+	block_ = rhs.block_;
+	return *this;
+}
+
+buffer & buffer::operator = (buffer && rhs) noexcept {
+	if (this == &rhs) return *this;
+	release();
+	block_ = rhs.block_;
+	rhs.block_ = nullptr;
+	return *this;
+}
+
+buffer::~buffer () noexcept {
+	release();
+}
+
+unsigned char * buffer::data () const noexcept {
+	return block_ ? block_->data() : nullptr;
+}
+
+std::size_t buffer::size () const noexcept {
+	return block_ ? block_->size : 0;
+}
+
+buffer::operator bool () const noexcept {
+	return block_ != nullptr;
+}
+
+void buffer::release () noexcept {
+	if (!block_) return;
+	if (block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) block_->pool->release(block_);
+	block_ = nullptr;
+}
+
+buffer_pool::buffer_pool (memory_resource & resource, std::size_t max)
+	:	state_(state::create(resource, max))
+{}
+
+buffer_pool::~buffer_pool () noexcept {
+	state_->close();
+}
+
+buffer buffer_pool::acquire (const unsigned char * data, std::size_t size) {
+	if (size == 0) return buffer();
+	auto b = state_->acquire(size);
+	std::memcpy(b->data(), data, size);
+	b->size = size;
+	return buffer(b);
+}
+
+}
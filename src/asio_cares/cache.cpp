@@ -0,0 +1,247 @@
+#include <asio_cares/cache.hpp>
+
+#include <ares.h>
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace asio_cares {
+
+namespace {
+
+void write_32 (unsigned char * ptr, unsigned long v) noexcept {
+	ptr[0] = static_cast<unsigned char>(v >> 24);
+	ptr[1] = static_cast<unsigned char>(v >> 16);
+	ptr[2] = static_cast<unsigned char>(v >> 8);
+	ptr[3] = static_cast<unsigned char>(v);
+}
+
+}
+
+class cache::entry {
+public:
+	entry () noexcept
+		:	used      (false),
+			referenced(false),
+			refreshing(false),
+			hits      (0)
+	{}
+	bool                       used;
+	bool                       referenced;
+	bool                       refreshing;
+	std::size_t                hits;
+	std::size_t                hash;
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> answer;
+	//	Offsets of the TTL of each record
+	std::vector<std::size_t>   ttls;
+	clock::time_point          stored;
+	clock::time_point          refresh;
+	clock::time_point          expires;
+};
+
+class cache::shard {
+public:
+	using index_type = std::unordered_multimap<std::size_t, std::size_t>;
+	shard () noexcept
+		:	hand(0)
+	{}
+	//	Distinct keys may have the same hash so
+	//	the key of each candidate is compared
+	index_type::iterator find (const detail::question_key & k) noexcept {
+		auto range = index.equal_range(k.hash);
+		for (auto iter = range.first; iter != range.second; ++iter) {
+			auto && e = entries[iter->second];
+			if ((e.key.size() == k.size) && (std::memcmp(e.key.data(), k.data, k.size) == 0)) return iter;
+		}
+		return index.end();
+	}
+	void erase (std::size_t hash, std::size_t slot) noexcept {
+		auto range = index.equal_range(hash);
+		for (auto iter = range.first; iter != range.second; ++iter) if (iter->second == slot) {
+			index.erase(iter);
+			return;
+		}
+	}
+	std::mutex         mutex;
+	std::vector<entry> entries;
+	index_type         index;
+	std::size_t        hand;
+};
+
+cache::prefetch_policy::prefetch_policy () noexcept
+	:	hits    (0),
+		fraction(0.9),
+		rate    (10),
+		burst   (10)
+{}
+
+cache::cache (std::size_t capacity, std::size_t shards, std::chrono::seconds max_ttl, const prefetch_policy & prefetch)
+	:	shards_        (new shard [std::max(shards, std::size_t(1))]),
+		num_shards_    (std::max(shards, std::size_t(1))),
+		shard_capacity_(std::max(capacity / num_shards_, std::size_t(1))),
+		max_ttl_       (max_ttl),
+		prefetch_      (prefetch),
+		tokens_        (double(prefetch.burst)),
+		refilled_      (clock::now())
+{}
+
+cache::~cache () noexcept {}
+
+cache::shard & cache::get_shard (std::size_t hash) noexcept {
+	return shards_[hash % num_shards_];
+}
+
+bool cache::acquire_token (clock::time_point now) {
+	std::lock_guard<std::mutex> l(tokens_mutex_);
+	if (now > refilled_) {
+		std::chrono::duration<double> elapsed(now - refilled_);
+		tokens_ = std::min(tokens_ + (elapsed.count() * prefetch_.rate), double(prefetch_.burst));
+		refilled_ = now;
+	}
+	if (tokens_ < 1) return false;
+	tokens_ -= 1;
+	return true;
+}
+
+buffer cache::lookup (const unsigned char * qbuf, std::size_t qlen, buffer_pool & pool, clock::time_point now) {
+	bool refresh;
+	return lookup(qbuf, qlen, pool, refresh, now);
+}
+
+buffer cache::lookup (const unsigned char * qbuf,
+                      std::size_t qlen,
+                      buffer_pool & pool,
+                      bool & refresh,
+                      clock::time_point now)
+{
+	refresh = false;
+	detail::question_key k;
+	if (!detail::make_question_key(qbuf, qlen, k)) return buffer();
+	auto && s = get_shard(k.hash);
+	std::lock_guard<std::mutex> l(s.mutex);
+	auto iter = s.find(k);
+	if (iter == s.index.end()) return buffer();
+	auto && e = s.entries[iter->second];
+	if (e.expires <= now) {
+		s.index.erase(iter);
+		e.used = false;
+		return buffer();
+	}
+	e.referenced = true;
+	auto retr = pool.acquire(e.answer.data(), e.answer.size());
+	++e.hits;
+	//	Tokens are only consumed by hot entries which
+	//	are due so the bucket's lock is rarely taken
+	if (prefetch_.hits && !e.refreshing && (e.hits >= prefetch_.hits) && (e.refresh <= now) && acquire_token(now)) {
+		e.refreshing = true;
+		refresh = true;
+	}
+	auto ptr = retr.data();
+	ptr[0] = qbuf[0];
+	ptr[1] = qbuf[1];
+	auto elapsed = (unsigned long)(std::chrono::duration_cast<std::chrono::seconds>(now - e.stored).count());
+	for (auto offset : e.ttls) {
+		auto ttl = detail::read_32(ptr + offset);
+		write_32(ptr + offset, (ttl > elapsed) ? (ttl - elapsed) : 0);
+	}
+	return retr;
+}
+
+void cache::insert (const unsigned char * abuf, std::size_t alen, clock::time_point now) {
+	detail::question_key k;
+	if (!detail::make_question_key(abuf, alen, k)) return;
+	//	Truncated
+	if (abuf[2] & 0x02) return;
+	int rcode = abuf[3] & 0x0F;
+	if ((rcode != 0) && (rcode != 3)) return;
+	std::size_t an = detail::read_16(abuf + 6);
+	std::size_t count = an + detail::read_16(abuf + 8) + detail::read_16(abuf + 10);
+	std::vector<std::size_t> ttls;
+	ttls.reserve(count);
+	long positive = -1;
+	long negative = -1;
+	std::size_t offset = k.end;
+	for (std::size_t i = 0; i < count; ++i) {
+		detail::resource_record rr;
+		if (detail::next_record(abuf, alen, offset, rr) != ARES_SUCCESS) return;
+		//	The TTL field of OPT is not a TTL
+		if (rr.type == 41) continue;
+		ttls.push_back(rr.rdata - 6);
+		if (i < an) {
+			if ((positive < 0) || (rr.ttl < positive)) positive = rr.ttl;
+		} else if ((i < (count - detail::read_16(abuf + 10))) && (rr.type == 6) && (rr.rdlength >= 22)) {
+			//	MINIMUM is the last field of SOA
+			long minimum = long(detail::read_32(abuf + rr.rdata + rr.rdlength - 4) & 0x7FFFFFFFUL);
+			negative = std::min(long(rr.ttl), minimum);
+		}
+	}
+	long ttl = ((rcode == 3) || (an == 0)) ? negative : positive;
+	ttl = std::min(ttl, long(max_ttl_.count()));
+	if (ttl <= 0) return;
+	auto && s = get_shard(k.hash);
+	std::lock_guard<std::mutex> l(s.mutex);
+	std::size_t slot;
+	auto iter = s.find(k);
+	if (iter != s.index.end()) {
+		slot = iter->second;
+	} else if (s.entries.size() < shard_capacity_) {
+		slot = s.entries.size();
+		s.entries.emplace_back();
+		s.index.emplace(k.hash, slot);
+	} else {
+		for (;;) {
+			auto && e = s.entries[s.hand];
+			if (!e.used || (e.expires <= now) || !e.referenced) break;
+			e.referenced = false;
+			s.hand = (s.hand + 1) % s.entries.size();
+		}
+		slot = s.hand;
+		s.hand = (s.hand + 1) % s.entries.size();
+		auto && e = s.entries[slot];
+		if (e.used) s.erase(e.hash, slot);
+		s.index.emplace(k.hash, slot);
+	}
+	auto && e = s.entries[slot];
+	e.used = true;
+	e.referenced = false;
+	e.refreshing = false;
+	e.hits = 0;
+	e.hash = k.hash;
+	e.key.assign(k.data, k.data + k.size);
+	e.answer.assign(abuf, abuf + alen);
+	e.ttls = std::move(ttls);
+	e.stored = now;
+	e.expires = now + std::chrono::seconds(ttl);
+	e.refresh = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(double(ttl) * prefetch_.fraction));
+}
+
+void cache::clear () noexcept {
+	for (std::size_t i = 0; i < num_shards_; ++i) {
+		auto && s = shards_[i];
+		std::lock_guard<std::mutex> l(s.mutex);
+		s.entries.clear();
+		s.index.clear();
+		s.hand = 0;
+	}
+}
+
+std::size_t cache::size () const noexcept {
+	std::size_t retr = 0;
+	for (std::size_t i = 0; i < num_shards_; ++i) {
+		auto && s = shards_[i];
+		std::lock_guard<std::mutex> l(s.mutex);
+		for (auto && e : s.entries) if (e.used) ++retr;
+	}
+	return retr;
+}
+
+}
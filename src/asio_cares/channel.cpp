@@ -1,16 +1,26 @@
 #include <asio_cares/channel.hpp>
 
 #include <ares.h>
+#include <asio_cares/detail/probe.hpp>
+#include <asio_cares/detail/wrap.hpp>
 #include <asio_cares/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
 #include <errno.h>
 #include <mpark/variant.hpp>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -23,25 +33,117 @@
 #include <sys/uio.h>
 #endif
 
+#ifdef __linux__
+#include <linux/sock_diag.h>
+#endif
+
 namespace asio_cares {
 
 static int connect (ares_socket_t fd, const struct sockaddr * addr, ares_socklen_t addr_len, void *) noexcept {
 	return ::connect(fd, addr, addr_len);
 }
 
-static ares_ssize_t recvfrom (ares_socket_t fd,
-                              void * buffer,
-                              std::size_t buf_size,
-                              int flags,
-                              struct sockaddr * addr,
-                              ares_socklen_t * addr_len,
-                              void *) noexcept
+#ifdef __linux__
+
+//	Errors queued because of IP_RECVERR count against
+//	the receive buffer and must therefore be discarded
+//	once libcares has seen the error reported
+static void drain_errors (ares_socket_t fd, int error) noexcept {
+	if ((error == EAGAIN) || (error == EWOULDBLOCK) || (error == EINTR)) return;
+	unsigned char buffer [256];
+	struct iovec iov;
+	iov.iov_base = buffer;
+	iov.iov_len = sizeof(buffer);
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	while (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) msg.msg_controllen = 0;
+}
+
+static void set_option (ares_socket_t fd, int level, int name, int value, boost::system::error_code & ec) noexcept {
+	if (::setsockopt(fd, level, name, &value, sizeof(value)) != 0) ec = boost::system::error_code(errno, boost::system::system_category());
+}
+
+//	The count of datagrams the kernel has dropped
+//	thereon so far (the count SO_RXQ_OVFL attaches
+//	to datagrams is the same count)
+static std::uint32_t drop_count (ares_socket_t fd) noexcept {
+	std::uint32_t meminfo [SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+	if (::getsockopt(fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) != 0) return 0;
+	if (len <= (SK_MEMINFO_DROPS * sizeof(std::uint32_t))) return 0;
+	return meminfo[SK_MEMINFO_DROPS];
+}
+
+#else
+
+static void drain_errors (ares_socket_t, int) noexcept {}
+
+static std::uint32_t drop_count (ares_socket_t) noexcept {
+	return 0;
+}
+
+#endif
+
+ares_ssize_t channel::recvfrom (ares_socket_t fd,
+                               void * buffer,
+                               std::size_t buf_size,
+                               int flags,
+                               struct sockaddr * addr,
+                               ares_socklen_t * addr_len,
+                               void * user_data) noexcept
 {
+	auto & self = *static_cast<channel *>(user_data);
+	auto && options = self.socket_options_;
+	auto state = (flags == 0) ? self.lookup(fd) : nullptr;
+	if (state && state->udp && (state->uring || self.batching_ || options.track_drops || options.receive_errors)) {
+		ares_ssize_t retr;
+		auto dropped = state->drops;
+		if (state->receiver.started()) {
+			std::size_t syscalls = 0;
+			retr = state->receiver.receive(buffer, buf_size, addr, addr_len, syscalls);
+			int error = errno;
+			self.metrics_.syscall(syscalls);
+			dropped = std::max(dropped, state->receiver.dropped());
+			//	The receive which replaces the datagram
+			//	is submitted once the handler returns
+			if (!self.post_send()) self.metrics_.syscall(self.ring_.submit());
+			errno = error;
+		} else if (self.batching_) {
+			std::size_t syscalls = 0;
+			retr = state->batch.receive(fd, buffer, buf_size, addr, addr_len, syscalls);
+			self.metrics_.syscall(syscalls);
+			dropped = std::max(dropped, state->batch.dropped());
+		} else {
+			self.metrics_.syscall();
+			retr = detail::datagram_batch::receive_one(fd, buffer, buf_size, addr, addr_len, dropped);
+		}
+		int error = errno;
+		if (dropped != state->drops) self.drop(*state, dropped);
+		if ((retr < 0) && options.receive_errors) drain_errors(fd, error);
+		errno = error;
+		return retr;
+	}
+	self.metrics_.syscall();
 	char * cbuffer = static_cast<char *>(buffer);
 	return ::recvfrom(fd, cbuffer, buf_size, flags, addr, addr_len);
 }
 
-static ares_ssize_t sendv (ares_socket_t fd, const struct iovec * data, int len, void *) noexcept {
+ares_ssize_t channel::sendv (ares_socket_t fd, const struct iovec * data, int len, void * user_data) noexcept {
+	auto & self = *static_cast<channel *>(user_data);
+	auto state = (self.batching_ || self.ring_.is_open()) ? self.lookup(fd) : nullptr;
+	if (state && state->udp) {
+		if (state->uring ? self.send_ring(fd, data, len) : (self.batching_ && self.defer(*state, data, len))) {
+			ares_ssize_t retr = 0;
+			for (int i = 0; i < len; ++i) retr += ares_ssize_t(data[i].iov_len);
+			return retr;
+		}
+		//	Datagrams which are already queued must
+		//	be sent first
+		self.send(*state);
+	}
+	self.metrics_.syscall();
 	#ifdef _WIN32
 	ares_ssize_t retr = 0;
 	for (int i = 0; i < len; ++i) {
@@ -62,26 +164,90 @@ static ares_ssize_t sendv (ares_socket_t fd, const struct iovec * data, int len,
 }
 
 channel::channel (boost::asio::io_service & ios)
-	:	strand_(ios),
-	    timer_ (ios)
+	:	channel(ios, nullptr)
 {
-	int result = ares_init(&channel_);
-	raise(result);
-	init();
+	ares_options options;
+	std::memset(&options, 0, sizeof(options));
+	init(options, 0);
 }
 
 channel::channel (const ares_options & options, int optmask, boost::asio::io_service & ios)
-	:	strand_(ios),
-		timer_ (ios)
+	:	channel(ios, nullptr)
 {
-	ares_options opts(options);
-	int result = ares_init_options(&channel_, &opts, optmask);
-	raise(result);
-	init();
+	init(options, optmask);
+}
+
+channel::channel (boost::asio::io_service & ios, memory_resource & resource)
+	:	channel(ios, &resource)
+{
+	ares_options options;
+	std::memset(&options, 0, sizeof(options));
+	init(options, 0);
+}
+
+channel::channel (const ares_options & options, int optmask, boost::asio::io_service & ios, memory_resource & resource)
+	:	channel(ios, &resource)
+{
+	init(options, optmask);
 }
 
+channel::channel (boost::asio::io_service & ios, memory_resource * resource)
+	:	resource_          (resource),
+		channel_           (nullptr),
+		strand_            (ios),
+		sockets_           (resource ? *resource : new_delete_resource()),
+		timer_             (ios),
+		next_id_           (0),
+		outstanding_       (0),
+		waiters_           (resource ? *resource : new_delete_resource()),
+		waits_             (0),
+		timer_waits_       (0),
+		timer_resets_      (0),
+		ready_             (resource ? *resource : new_delete_resource()),
+		sock_state_cb_     (nullptr),
+		sock_state_cb_data_(nullptr),
+		running_           (false),
+		stopping_          (false),
+		flushing_          (false),
+		buffers_           (resource ? *resource : new_delete_resource()),
+		cache_             (nullptr),
+		inflight_          (0,
+		                    std::hash<std::size_t>{},
+		                    std::equal_to<std::size_t>{},
+		                    resource ? *resource : new_delete_resource()),
+		coalescing_        (false),
+		deadline_timer_    (ios),
+		deadline_armed_    (false),
+		batching_          (false),
+		deferred_          (resource ? *resource : new_delete_resource()),
+		sending_           (false),
+		pool_size_         (0),
+		pool_v4_           (resource ? *resource : new_delete_resource()),
+		pool_v6_           (resource ? *resource : new_delete_resource()),
+		io_uring_          (false),
+		ring_waiting_      (false),
+		ring_              (ios, resource ? *resource : new_delete_resource())
+{}
+
 channel::~channel () noexcept {
+	//	Null if construction failed after
+	//	delegation
+	if (!channel_) return;
+	//	The sockets libcares closes while it is
+	//	destroyed are about to be closed anyway
+	pool_size_ = 0;
+	//	Submissions not yet drained are outstanding
+	//	and therefore end like every other outstanding
+	//	query (i.e. as libcares is destroyed)
+	while (auto s = submissions_.pop()) s->run();
 	ares_destroy(channel_);
+	//	The reactor may never have stopped (for
+	//	example because an exception escaped the
+	//	io_service) in which case its waiters are
+	//	aborted so that they are freed
+	auto waiters = std::move(waiters_);
+	waiters_.clear();
+	for (auto && waiter : waiters) waiter.first(waiter.second, make_error_code(boost::asio::error::operation_aborted));
 }
 
 boost::asio::io_service & channel::get_io_service () noexcept {
@@ -92,33 +258,138 @@ boost::asio::strand & channel::get_strand () noexcept {
 	return strand_;
 }
 
-boost::asio::deadline_timer & channel::get_timer () noexcept {
+boost::asio::steady_timer & channel::get_timer () noexcept {
 	return timer_;
 }
 
-channel::socket_guard::socket_guard (socket_type & socket, channel & c) noexcept
+buffer_pool & channel::get_buffer_pool () noexcept {
+	return buffers_;
+}
+
+memory_resource * channel::get_memory_resource () const noexcept {
+	return resource_;
+}
+
+void channel::set_cache (cache * c) noexcept {
+	cache_ = c;
+}
+
+cache * channel::get_cache () const noexcept {
+	return cache_;
+}
+
+void channel::set_coalescing (bool enable) noexcept {
+	coalescing_ = enable;
+}
+
+bool channel::get_coalescing () const noexcept {
+	return coalescing_;
+}
+
+void channel::set_batching (bool enable) noexcept {
+	batching_ = enable && detail::datagram_batch::supported();
+}
+
+bool channel::get_batching () const noexcept {
+	return batching_;
+}
+
+void channel::set_io_uring (bool enable) noexcept {
+	boost::system::error_code ec;
+	io_uring_ = enable && ring_.open(ec);
+}
+
+bool channel::get_io_uring () const noexcept {
+	return io_uring_;
+}
+
+void channel::set_socket_pool_size (std::size_t size) noexcept {
+	pool_size_ = size;
+	if (pool_v4_.size() > size) pool_v4_.erase(pool_v4_.begin() + size, pool_v4_.end());
+	if (pool_v6_.size() > size) pool_v6_.erase(pool_v6_.begin() + size, pool_v6_.end());
+}
+
+std::size_t channel::get_socket_pool_size () const noexcept {
+	return pool_size_;
+}
+
+void channel::set_socket_options (const socket_options & options) noexcept {
+	socket_options_ = options;
+}
+
+const socket_options & channel::get_socket_options () const noexcept {
+	return socket_options_;
+}
+
+bool channel::coalesce (const detail::question_key & key, detail::send_waiter & waiter) noexcept {
+	if (!coalescing_) return false;
+	auto range = inflight_.equal_range(key.hash);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		auto && i = iter->second;
+		if (!(i.key == key)) continue;
+		waiter.next = nullptr;
+		if (i.tail) i.tail->next = &waiter;
+		else i.head = &waiter;
+		i.tail = &waiter;
+		return true;
+	}
+	return false;
+}
+
+detail::inflight * channel::begin_inflight (const detail::question_key & key) noexcept {
+	if (!coalescing_) return nullptr;
+	try {
+		auto iter = inflight_.emplace(key.hash, detail::inflight{key, nullptr, nullptr});
+		return &iter->second;
+	} catch (...) {
+		//	The query is simply not coalesced
+		return nullptr;
+	}
+}
+
+detail::send_waiter * channel::end_inflight (detail::inflight * ptr) noexcept {
+	if (!ptr) return nullptr;
+	auto range = inflight_.equal_range(ptr->key.hash);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		if (&iter->second != ptr) continue;
+		auto retr = ptr->head;
+		inflight_.erase(iter);
+		return retr;
+	}
+	assert(false);
+	return nullptr;
+}
+
+void * channel::allocate (std::size_t size) {
+	if (resource_) return resource_->allocate(size);
+	using boost::asio::asio_handler_allocate;
+	return asio_handler_allocate(size, this);
+}
+
+void channel::deallocate (void * ptr, std::size_t size) noexcept {
+	if (resource_) {
+		resource_->deallocate(ptr, size);
+		return;
+	}
+	using boost::asio::asio_handler_deallocate;
+	asio_handler_deallocate(ptr, size, this);
+}
+
+channel::socket_guard::socket_guard (socket_type & socket, ares_socket_t fd, channel & c) noexcept
 	:	socket_ (&socket),
+		fd_     (fd),
 		channel_(&c)
 {}
 
 channel::socket_guard::socket_guard (socket_guard && other) noexcept
 	:	socket_ (other.socket_),
+		fd_     (other.fd_),
 		channel_(other.channel_)
 {
 	other.socket_ = nullptr;
 	other.channel_ = nullptr;
 }
 
-static int get_fd (int fd) noexcept {
-	return fd;
-}
-
-#ifdef _WIN32
-static int get_fd (ares_socket_t fd) noexcept {
-	return int(fd);
-}
-#endif
-
 template <typename... Args>
 static int get_fd (const mpark::variant<Args...> & v) noexcept {
 	return mpark::visit([] (const auto & socket) noexcept -> int {
@@ -130,57 +401,161 @@ static int get_fd (const mpark::variant<Args...> & v) noexcept {
 	}, v);
 }
 
-template <typename T>
-static int get_fd (const T & state) noexcept {
-	return get_fd(state.socket);
-}
-
 channel::socket_guard::~socket_guard () noexcept {
-	if (socket_ && channel_) channel_->release_socket(get_fd(*socket_));
+	if (socket_ && channel_) channel_->release_socket(fd_);
 }
 
 channel::socket_guard channel::acquire_socket (ares_socket_t socket) noexcept {
-	auto retr = find(socket);
-	assert(!retr->acquired);
-	assert(!retr->closed);
-	retr->acquired = true;
-	return socket_guard(retr->socket, *this);
+	auto && retr = find(socket);
+	assert(!retr.acquired);
+	assert(!retr.closed);
+	retr.acquired = true;
+	return socket_guard(retr.socket, socket, *this);
+}
+
+std::size_t channel::outstanding () const noexcept {
+	return outstanding_.load(std::memory_order_relaxed) + submissions_.size();
+}
+
+bool channel::active () const noexcept {
+	if (outstanding()) return true;
+	//	Queries submitted directly through libcares
+	//	are not counted
+	#if ARES_VERSION >= 0x011B00
+	return ares_queue_active_queries(channel_) != 0;
+	#else
+	struct timeval tv;
+	return ares_timeout(channel_, nullptr, &tv) != nullptr;
+	#endif
+}
+
+//	Only the thread of execution which currently
+//	owns the channel ever modifies the count so a
+//	read-modify-write operation is unnecessary
+
+metrics::timestamp channel::begin_query () noexcept {
+	outstanding_.store(outstanding_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return metrics_.begin();
+}
+
+void channel::end_query (int status, int timeouts, metrics::timestamp start) noexcept {
+	auto curr = outstanding_.load(std::memory_order_relaxed);
+	assert(curr);
+	outstanding_.store(curr - 1, std::memory_order_relaxed);
+	metrics_.end(status, timeouts, start);
+}
+
+const metrics & channel::get_metrics () const noexcept {
+	return metrics_;
 }
 
 channel::operator ares_channel () noexcept {
 	return channel_;
 }
 
-channel::socket_state::socket_state (socket_type socket)
-	:	socket  (std::move(socket)),
-		acquired(false),
-		closed  (false)
+channel::socket_state::socket_state (socket_type socket, ares_socket_t fd, std::size_t id, bool udp, memory_resource & r)
+	:	socket    (std::move(socket)),
+		fd        (fd),
+		id        (id),
+		udp       (udp),
+		acquired  (false),
+		closed    (false),
+		want_read (false),
+		want_write(false),
+		reading   (false),
+		writing   (false),
+		batch     (r),
+		drops     (0),
+		growable  (true),
+		uring     (false),
+		receiver  (r)
 {}
 
-void channel::release_socket (int fd) noexcept {
-	auto iter = find(fd);
-	assert(iter->acquired);
-	iter->acquired = false;
-	if (iter->closed) sockets_.erase(iter);
-}
-
-template <typename T>
-channel::sockets_collection_type::iterator channel::insertion_point (const T & key) noexcept {
-	return std::lower_bound(
-		sockets_.begin(),
-		sockets_.end(),
-		key,
-		[] (const auto & a, const auto & b) noexcept {
-			return get_fd(a) < get_fd(b);
-		}
-	);
+void channel::release_socket (ares_socket_t fd) noexcept {
+	auto && state = find(fd);
+	assert(state.acquired);
+	state.acquired = false;
+	if (state.closed) erase(state);
+}
+
+void channel::erase (socket_state & state) noexcept {
+	//	Receives must not outlast the socket (nor take
+	//	datagrams meant for its next use if it is pooled)
+	//	and sends must be submitted before the descriptor
+	//	can be reused
+	if (state.uring) metrics_.syscall(state.receiver.stop() + ring_.submit());
+	recycle(state);
+	sockets_.erase(socket_key(state.fd));
+}
+
+#ifdef _WIN32
+
+bool channel::recycle (socket_state &) noexcept {
+	return false;
 }
 
-template <typename T>
-channel::sockets_collection_type::iterator channel::find (const T & key) noexcept {
-	auto retr = insertion_point(key);
-	assert(retr != sockets_.end());
-	assert(get_fd(*retr) == get_fd(key));
+#else
+
+bool channel::recycle (socket_state & state) noexcept {
+	if (!pool_size_) return false;
+	auto ptr = mpark::get_if<boost::asio::ip::udp::socket>(&state.socket);
+	if (!ptr) return false;
+	auto && socket = *ptr;
+	//	Dissolving the association releases the
+	//	local port unless it was bound explicitly
+	//	so that connecting the socket anew binds it
+	//	to a fresh ephemeral port
+	struct sockaddr addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sa_family = AF_UNSPEC;
+	if (::connect(state.fd, &addr, sizeof(addr)) != 0) return false;
+	boost::system::error_code ec;
+	auto endpoint = socket.local_endpoint(ec);
+	if (ec || endpoint.port()) return false;
+	auto && pool = endpoint.address().is_v6() ? pool_v6_ : pool_v4_;
+	if (pool.size() >= pool_size_) return false;
+	//	Outstanding waits complete with the id of
+	//	this incarnation of the socket and are
+	//	therefore ignored
+	socket.cancel(ec);
+	if (ec) return false;
+	//	Errors and datagrams which arrived before
+	//	the socket was disconnected must not be seen
+	//	by the next query
+	int error;
+	socklen_t len = sizeof(error);
+	::getsockopt(state.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+	char c;
+	while (::recv(state.fd, &c, sizeof(c), MSG_DONTWAIT) >= 0);
+	try {
+		pool.push_back(std::move(socket));
+	} catch (...) {
+		return false;
+	}
+	return true;
+}
+
+#endif
+
+std::size_t channel::socket_key (ares_socket_t fd) noexcept {
+	#ifdef _WIN32
+	//	Windows socket handles are multiples of four
+	return std::size_t(fd) / 4;
+	#else
+	return std::size_t(fd);
+	#endif
+}
+
+channel::socket_state & channel::find (ares_socket_t socket) noexcept {
+	auto retr = sockets_.find(socket_key(socket));
+	assert(retr);
+	return *retr;
+}
+
+channel::socket_state * channel::lookup (ares_socket_t socket) noexcept {
+	if (socket == ARES_SOCKET_BAD) return nullptr;
+	auto retr = sockets_.find(socket_key(socket));
+	if (!retr || retr->closed) return nullptr;
 	return retr;
 }
 
@@ -195,13 +570,67 @@ boost::asio::ip::udp::socket channel::udp_socket (bool is_v6, boost::system::err
 	ec.clear();
 	boost::asio::ip::udp::socket retr(get_io_service());
 	retr.open(is_v6 ? boost::asio::ip::udp::v6() : boost::asio::ip::udp::v4(), ec);
+	if (!ec) configure(retr, is_v6, ec);
 	return retr;
 }
 
+void channel::configure (boost::asio::ip::udp::socket & socket, bool is_v6, boost::system::error_code & ec) noexcept {
+	auto && options = socket_options_;
+	if (options.receive_buffer_size) socket.set_option(boost::asio::socket_base::receive_buffer_size(options.receive_buffer_size), ec);
+	if (ec) return;
+	if (options.send_buffer_size) socket.set_option(boost::asio::socket_base::send_buffer_size(options.send_buffer_size), ec);
+	if (ec) return;
+	#ifdef __linux__
+	auto fd = socket.native_handle();
+	if (options.busy_poll) set_option(fd, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll, ec);
+	if (ec) return;
+	if (options.receive_errors) {
+		if (is_v6) set_option(fd, IPPROTO_IPV6, IPV6_RECVERR, 1, ec);
+		else set_option(fd, IPPROTO_IP, IP_RECVERR, 1, ec);
+	}
+	if (ec) return;
+	if (options.track_drops) set_option(fd, SOL_SOCKET, SO_RXQ_OVFL, 1, ec);
+	if (ec) return;
+	#endif
+	if (options.callback) options.callback(socket, ec, options.callback_data);
+}
+
+void channel::drop (socket_state & state, std::uint32_t dropped) noexcept {
+	metrics_.drop(dropped - state.drops);
+	ASIO_CARES_PROBE2(socket__drop, int(state.fd), int(dropped - state.drops));
+	state.drops = dropped;
+	auto max = socket_options_.max_receive_buffer_size;
+	if (!(max && state.growable)) return;
+	auto socket = mpark::get_if<boost::asio::ip::udp::socket>(&state.socket);
+	if (!socket) return;
+	boost::system::error_code ec;
+	boost::asio::socket_base::receive_buffer_size size;
+	socket->get_option(size, ec);
+	if (ec || (size.value() >= max)) {
+		state.growable = false;
+		return;
+	}
+	//	Boost.Asio compensates for Linux doubling
+	//	the size requested so sizes are as requested
+	int grown = (size.value() > (max / 2)) ? max : (size.value() * 2);
+	socket->set_option(boost::asio::socket_base::receive_buffer_size(grown), ec);
+	//	The kernel silently caps the size (at the
+	//	net.core.rmem_max sysctl) so growth which did
+	//	not take is not attempted again on every drop
+	boost::asio::socket_base::receive_buffer_size after;
+	if (!ec) socket->get_option(after, ec);
+	if (ec || (after.value() <= size.value())) state.growable = false;
+}
+
 channel::socket_type channel::socket (bool udp, bool is_v6, boost::system::error_code & ec) noexcept {
 	ec.clear();
-	if (udp) return socket_type(udp_socket(is_v6, ec));
-	return socket_type(tcp_socket(is_v6, ec));
+	if (!udp) return socket_type(tcp_socket(is_v6, ec));
+	auto && pool = is_v6 ? pool_v6_ : pool_v4_;
+	if (pool.empty()) return socket_type(udp_socket(is_v6, ec));
+	socket_type retr(std::move(pool.back()));
+	pool.pop_back();
+	metrics_.reuse();
+	return retr;
 }
 
 ares_socket_t channel::socket (int domain, int type, int protocol, void * user_data) noexcept {
@@ -256,28 +685,74 @@ ares_socket_t channel::socket (int domain, int type, int protocol, void * user_d
 		return -1;
 	}
 	ares_socket_t retr(get_fd(socket));
-	auto loc = self.insertion_point(socket);
+	socket_state * state;
 	try {
-		self.sockets_.insert(loc, socket_state(std::move(socket)));
+		state = &self.sockets_.emplace(socket_key(retr),
+		                               std::move(socket),
+		                               retr,
+		                               self.next_id_++,
+		                               udp,
+		                               self.resource_ ? *self.resource_ : new_delete_resource());
 	} catch (...) {
 		errno = ENOMEM;
 		return -1;
 	}
+	//	A socket taken from the pool has dropped
+	//	datagrams before
+	if (udp && self.socket_options_.track_drops) state->drops = drop_count(retr);
+	state->uring = udp && self.io_uring_;
+	self.metrics_.open();
+	ASIO_CARES_PROBE2(socket__open, int(retr), int(udp));
 	errno = 0;
 	return retr;
 }
 
 int channel::close (ares_socket_t fd, void * user_data) noexcept {
 	auto & self = *static_cast<channel *>(user_data);
-	auto iter = self.find(fd);
-	assert(!iter->closed);
-	iter->closed = true;
-	if (!iter->acquired) self.sockets_.erase(iter);
+	auto && state = self.find(fd);
+	assert(!state.closed);
+	self.send(state);
+	state.closed = true;
+	self.metrics_.close();
+	ASIO_CARES_PROBE1(socket__close, int(fd));
+	if (!state.acquired) self.erase(state);
 	errno = 0;
 	return 0;
 }
 
-void channel::init () noexcept {
+void channel::sock_state (void * data, ares_socket_t fd, int readable, int writable) noexcept {
+	auto & self = *static_cast<channel *>(data);
+	if (self.sock_state_cb_) self.sock_state_cb_(self.sock_state_cb_data_, fd, readable, writable);
+	auto state = self.lookup(fd);
+	if (!state) return;
+	state->want_read = readable != 0;
+	state->want_write = writable != 0;
+	//	New interest is acted upon immediately so that
+	//	sockets opened while the reactor is running
+	//	(for example by async_send) are waited upon
+	//	without waiting for some unrelated wakeup
+	if (!self.running_ || self.stopping_ || self.error_) return;
+	try {
+		self.rearm(*state);
+	} catch (const boost::system::system_error & ex) {
+		self.error_ = ex.code();
+	} catch (...) {
+		self.error_ = make_error_code(boost::system::errc::not_enough_memory);
+	}
+}
+
+void channel::init (const ares_options & options, int optmask) {
+	ares_options opts(options);
+	if (optmask & ARES_OPT_SOCK_STATE_CB) {
+		sock_state_cb_ = opts.sock_state_cb;
+		sock_state_cb_data_ = opts.sock_state_cb_data;
+	}
+	opts.sock_state_cb = &channel::sock_state;
+	opts.sock_state_cb_data = this;
+	ares_channel c;
+	int result = ares_init_options(&c, &opts, optmask | ARES_OPT_SOCK_STATE_CB);
+	raise(result);
+	channel_ = c;
 	std::memset(&funcs_, 0, sizeof(funcs_));
 	funcs_.asocket = &channel::socket;
 	funcs_.aclose = &channel::close;
@@ -287,4 +762,446 @@ void channel::init () noexcept {
 	ares_set_socket_functions(channel_, &funcs_, this);
 }
 
+void channel::process (process_callback callback, void * arg) {
+	waiters_.emplace_back(callback, arg);
+	if (running_) return;
+	running_ = true;
+	start();
+}
+
+void channel::wait (socket_state & state, bool write) {
+	wait_handler h(*this, state.fd, state.id, write);
+	mpark::visit([&] (auto & socket) {
+		boost::asio::null_buffers buffers;
+		if (write) socket.async_send(buffers, strand_.wrap(h));
+		else socket.async_receive(buffers, strand_.wrap(h));
+	}, state.socket);
+	++waits_;
+	ASIO_CARES_PROBE2(select__arm, int(state.fd), int(write));
+	if (write) state.writing = true;
+	else state.reading = true;
+}
+
+void channel::rearm (socket_state & state) {
+	if (state.want_read && !state.reading && !receive_ring(state)) wait(state, false);
+	if (state.want_write && !state.writing) wait(state, true);
+}
+
+void channel::update () noexcept {
+	try {
+		struct timeval tv;
+		if (!ares_timeout(channel_, nullptr, &tv)) return;
+		auto expiry = boost::asio::steady_timer::clock_type::now();
+		expiry += std::chrono::seconds(tv.tv_sec);
+		expiry += std::chrono::microseconds(tv.tv_usec);
+		//	The timer only needs to be touched if the
+		//	earliest deadline moved earlier or if there
+		//	is no wait outstanding thereupon. libcares
+		//	reports the deadline relative to its own
+		//	reading of the clock so the same deadline
+		//	arrives with a little jitter which must not
+		//	cause the timer to be rearmed, libcares
+		//	timeouts have millisecond granularity anyway
+		if (timer_waits_ && (timer_expiry_ <= (expiry + std::chrono::milliseconds(1)))) return;
+		auto cancelled = timer_.expires_at(expiry);
+		timer_expiry_ = expiry;
+		timer_waits_ -= cancelled;
+		timer_resets_ += cancelled;
+		timer_.async_wait(strand_.wrap(wait_handler(*this, ARES_SOCKET_BAD, 0, false)));
+		++waits_;
+		++timer_waits_;
+		ASIO_CARES_PROBE1(timer__arm, std::int64_t(tv.tv_sec) * 1000000 + tv.tv_usec);
+	} catch (const boost::system::system_error & ex) {
+		error_ = ex.code();
+	} catch (...) {
+		//	We just deem all these errors to be out
+		//	of memory errors
+		error_ = make_error_code(boost::system::errc::not_enough_memory);
+	}
+}
+
+void channel::complete_wait (ares_socket_t socket,
+                             std::size_t id,
+                             bool write,
+                             boost::system::error_code ec) noexcept
+{
+	assert(waits_);
+	--waits_;
+	ASIO_CARES_PROBE3(select__wake, (socket == ARES_SOCKET_BAD) ? -1 : int(socket), int(write), ec.value());
+	//	Waits which complete because the reactor is
+	//	stopping, because the timer was moved, or
+	//	because libcares closed (and perhaps reopened)
+	//	the socket are expected and are not errors
+	bool expected = stopping_;
+	socket_state * state = nullptr;
+	if (socket == ARES_SOCKET_BAD) {
+		if ((ec == boost::asio::error::operation_aborted) && timer_resets_) {
+			--timer_resets_;
+			expected = true;
+		} else {
+			assert(timer_waits_);
+			--timer_waits_;
+		}
+	} else {
+		state = lookup(socket);
+		if (state && (state->id != id)) state = nullptr;
+		if (state) {
+			if (write) state->writing = false;
+			else state->reading = false;
+		} else {
+			expected = true;
+		}
+	}
+	if (ec) {
+		if (!expected && !error_) error_ = ec;
+	} else if (!expected) {
+		metrics_.wakeup();
+		try {
+			//	Rearming before processing ensures that
+			//	datagrams which arrive after libcares
+			//	drains the socket are not missed
+			if (state && !write && state->want_read) wait(*state, false);
+			if (socket != ARES_SOCKET_BAD) schedule(socket_events(socket, !write, write));
+			else schedule(socket_events(ARES_SOCKET_BAD, false, false));
+		} catch (const boost::system::system_error & ex) {
+			if (!error_) error_ = ex.code();
+		} catch (...) {
+			if (!error_) error_ = make_error_code(boost::system::errc::not_enough_memory);
+		}
+	}
+	//	If a flush is pending it will settle the
+	//	reactor once the whole batch is processed
+	if (error_ || !flushing_) settle();
+}
+
+void channel::schedule (socket_events events) {
+	//	The timer firing merely requires that timeouts
+	//	be processed which happens regardless
+	if (events.socket != ARES_SOCKET_BAD) ready_.push_back(events);
+	if (flushing_) return;
+	//	Posting through the io_service rather than the
+	//	strand queues the flush behind the completions
+	//	of any other waits which became ready in the
+	//	same turn of the reactor
+	get_io_service().post(strand_.wrap(flush_handler(*this)));
+	++waits_;
+	flushing_ = true;
+}
+
+void channel::flush () noexcept {
+	assert(waits_);
+	--waits_;
+	assert(flushing_);
+	flushing_ = false;
+	bool buffered = false;
+	if (!(stopping_ || error_)) {
+		process_fds(channel_, ready_.data(), ready_.size());
+		//	Interest which libcares did not change (and
+		//	therefore did not report) still needs to be
+		//	waited upon anew
+		try {
+			for (auto && events : ready_) if (auto state = lookup(events.socket)) {
+				rearm(*state);
+				if (state->batch.received() || state->receiver.received()) buffered = true;
+			}
+		} catch (const boost::system::system_error & ex) {
+			error_ = ex.code();
+		} catch (...) {
+			error_ = make_error_code(boost::system::errc::not_enough_memory);
+		}
+	}
+	ready_.clear();
+	//	libcares may stop reading before a socket
+	//	would block (recent versions read only one
+	//	datagram at a time from sockets opened through
+	//	ares_set_socket_functions) in which case datagrams
+	//	remain in the ring and since the socket may never
+	//	become readable again they must be processed anew
+	if (buffered && !(stopping_ || error_)) try {
+		for (auto && state : sockets_) {
+			if (state.closed || !(state.batch.received() || state.receiver.received())) continue;
+			schedule(socket_events(state.fd, true, false));
+		}
+	} catch (const boost::system::system_error & ex) {
+		error_ = ex.code();
+	} catch (...) {
+		error_ = make_error_code(boost::system::errc::not_enough_memory);
+	}
+	settle();
+}
+
+bool channel::defer (socket_state & state, const struct iovec * data, int len) noexcept {
+	//	The socket is tracked before anything is
+	//	queued so that nothing is ever queued without
+	//	a handler posted to send it
+	if (state.batch.queued() == 0) {
+		try {
+			deferred_.push_back(state.fd);
+		} catch (...) {
+			return false;
+		}
+		if (!post_send()) {
+			deferred_.pop_back();
+			return false;
+		}
+	}
+	return state.batch.queue(data, len);
+}
+
+void channel::send (socket_state & state) noexcept {
+	if (state.batch.queued()) metrics_.syscall(state.batch.send(state.fd));
+}
+
+void channel::send_deferred () noexcept {
+	sending_ = false;
+	for (auto fd : deferred_) if (auto state = lookup(fd)) send(*state);
+	deferred_.clear();
+	if (ring_.pending()) metrics_.syscall(ring_.submit());
+}
+
+bool channel::post_send () noexcept {
+	if (sending_) return true;
+	try {
+		strand_.post(send_handler(*this));
+	} catch (...) {
+		return false;
+	}
+	sending_ = true;
+	return true;
+}
+
+bool channel::send_ring (ares_socket_t fd, const struct iovec * data, int len) noexcept {
+	//	If the datagram cannot be queued everything
+	//	already queued is submitted first so that order
+	//	is preserved
+	if (!ring_.send(fd, data, len)) {
+		metrics_.syscall(ring_.submit());
+		if (!ring_.send(fd, data, len)) return false;
+	}
+	if (!post_send()) metrics_.syscall(ring_.submit());
+	return true;
+}
+
+bool channel::receive_ring (socket_state & state) {
+	if (!state.uring) return false;
+	if (!state.receiver.started()) {
+		std::size_t syscalls = 0;
+		bool started = state.receiver.start(ring_, state.fd, &channel::received, this, syscalls);
+		metrics_.syscall(syscalls);
+		//	The socket is waited upon by the reactor
+		//	instead
+		if (!started) return false;
+		if (!post_send()) metrics_.syscall(ring_.submit());
+	}
+	//	The ring is only waited upon while the
+	//	reactor runs
+	if (running_ && !stopping_ && !ring_waiting_) wait_ring();
+	return true;
+}
+
+void channel::wait_ring () {
+	ring_.async_wait(strand_.wrap(ring_handler(*this)));
+	++waits_;
+	ring_waiting_ = true;
+}
+
+void channel::complete_ring (boost::system::error_code ec) noexcept {
+	assert(waits_);
+	--waits_;
+	ring_waiting_ = false;
+	if (ec) {
+		if (!stopping_ && !error_) error_ = ec;
+	} else if (!(stopping_ || error_)) {
+		metrics_.wakeup();
+		try {
+			//	Waiting anew before reaping ensures that
+			//	completions posted once the completion
+			//	queue has been emptied are not missed
+			wait_ring();
+		} catch (const boost::system::system_error & ex) {
+			error_ = ex.code();
+		} catch (...) {
+			error_ = make_error_code(boost::system::errc::not_enough_memory);
+		}
+		reap();
+	}
+	if (error_ || !flushing_) settle();
+}
+
+void channel::reap () noexcept {
+	ring_.complete();
+	//	Operations which could not be submitted
+	//	before (because the kernel was short of
+	//	resources) are retried
+	if (ring_.pending()) metrics_.syscall(ring_.submit());
+}
+
+void channel::cancel_uring_wait () noexcept {
+	ring_.cancel_wait();
+}
+
+void channel::received (void * data, int fd) noexcept {
+	auto & self = *static_cast<channel *>(data);
+	//	Datagrams received while the reactor is not
+	//	running are handed to libcares once it starts
+	if (!self.running_ || self.stopping_ || self.error_) return;
+	try {
+		self.schedule(socket_events(ares_socket_t(fd), true, false));
+	} catch (const boost::system::system_error & ex) {
+		self.error_ = ex.code();
+	} catch (...) {
+		self.error_ = make_error_code(boost::system::errc::not_enough_memory);
+	}
+}
+
+void channel::submit (detail::submission & s) {
+	if (submissions_.push(s)) strand_.post(drain_handler(*this));
+}
+
+void channel::drain () noexcept {
+	for (;;) {
+		std::size_t num = 0;
+		while (auto s = submissions_.pop()) {
+			s->run();
+			++num;
+		}
+		if (!submissions_.consume(num)) break;
+		if (num != 0) continue;
+		//	A producer has counted its submission but
+		//	not yet linked it, rather than spinning
+		//	this handler yields the strand and runs
+		//	again later
+		try {
+			strand_.post(drain_handler(*this));
+			break;
+		} catch (...) {
+			std::this_thread::yield();
+		}
+	}
+	//	Submissions may have sent queries (which
+	//	need a timeout) or completed without sending
+	//	any (in which case the reactor may need to
+	//	stop)
+	if (running_) settle();
+}
+
+void channel::schedule_deadline (detail::timer_wheel_entry & entry, std::chrono::steady_clock::time_point deadline) {
+	deadlines_.insert(entry, deadline);
+	try {
+		arm_deadline(deadlines_.next_expiry());
+	} catch (...) {
+		cancel_deadline(entry);
+		throw;
+	}
+}
+
+void channel::cancel_deadline (detail::timer_wheel_entry & entry) noexcept {
+	deadlines_.remove(entry);
+	//	Otherwise the wait would keep the io_service
+	//	running with nothing to do
+	if (deadlines_.empty()) {
+		deadline_armed_ = false;
+		boost::system::error_code ec;
+		deadline_timer_.cancel(ec);
+	}
+}
+
+void channel::complete_deadline (boost::system::error_code ec) noexcept {
+	//	The wait was superseded by a wait for an
+	//	earlier deadline or there are no longer any
+	//	deadlines
+	if (ec == boost::asio::error::operation_aborted) return;
+	expire_deadlines();
+}
+
+void channel::arm_deadline (std::chrono::steady_clock::time_point expiry) {
+	if (deadline_armed_ && (deadline_expiry_ <= expiry)) return;
+	deadline_timer_.expires_at(expiry);
+	deadline_timer_.async_wait(strand_.wrap(deadline_handler(*this)));
+	deadline_armed_ = true;
+	deadline_expiry_ = expiry;
+}
+
+void channel::expire_deadlines () noexcept {
+	deadline_armed_ = false;
+	//	Expiring an entry may run a completion handler
+	//	which removes (and destroys) other entries, so
+	//	each is taken from the wheel only once those
+	//	before it have expired
+	auto now = std::chrono::steady_clock::now();
+	while (auto entry = deadlines_.pop(now)) {
+		detail::async_wrap(*this, [&] () {
+			entry->expire();
+		});
+	}
+	if (deadlines_.empty()) return;
+	//	If the timer cannot be armed the remaining
+	//	deadlines expire once the next deadline is
+	//	scheduled
+	try {
+		arm_deadline(deadlines_.next_expiry());
+	} catch (...) {}
+}
+
+void channel::start () noexcept {
+	try {
+		for (auto && state : sockets_) {
+			if (state.closed) continue;
+			rearm(state);
+			if (state.receiver.received()) schedule(socket_events(state.fd, true, false));
+		}
+		if (ring_.is_open() && !ring_waiting_) {
+			wait_ring();
+			reap();
+		}
+	} catch (const boost::system::system_error & ex) {
+		error_ = ex.code();
+	} catch (...) {
+		error_ = make_error_code(boost::system::errc::not_enough_memory);
+	}
+	settle();
+}
+
+void channel::settle () noexcept {
+	if (!stopping_) {
+		if (!error_ && active()) update();
+		if (error_ || !active()) stop();
+	}
+	if (stopping_ && !waits_) finish();
+}
+
+void channel::stop () noexcept {
+	stopping_ = true;
+	for (auto && state : sockets_) {
+		if (!(state.reading || state.writing)) continue;
+		mpark::visit([] (auto & socket) noexcept {
+			boost::system::error_code ec;
+			socket.cancel(ec);
+		}, state.socket);
+		ASIO_CARES_PROBE1(select__cancel, int(state.fd));
+	}
+	if (timer_waits_) {
+		boost::system::error_code ec;
+		timer_.cancel(ec);
+		ASIO_CARES_PROBE1(select__cancel, -1);
+	}
+	if (ring_waiting_) ring_.cancel_wait();
+}
+
+void channel::finish () noexcept {
+	stopping_ = false;
+	auto ec = error_;
+	error_.clear();
+	//	Queries may have been sent while the reactor
+	//	was stopping in which case it must keep going
+	if (!ec && active()) {
+		start();
+		return;
+	}
+	running_ = false;
+	auto waiters = std::move(waiters_);
+	waiters_.clear();
+	for (auto && waiter : waiters) waiter.first(waiter.second, ec);
+}
+
 }
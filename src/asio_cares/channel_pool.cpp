@@ -0,0 +1,98 @@
+#include <asio_cares/channel_pool.hpp>
+
+#include <ares.h>
+#include <asio_cares/cache.hpp>
+#include <asio_cares/cancel.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/done.hpp>
+#include <boost/asio/io_service.hpp>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace asio_cares {
+
+static ares_options default_options () noexcept {
+	ares_options retr;
+	std::memset(&retr, 0, sizeof(retr));
+	return retr;
+}
+
+channel_pool::channel_pool (boost::asio::io_service & ios, std::size_t size, const ares_options & options, int optmask) {
+	if (size == 0) throw std::invalid_argument("asio_cares::channel_pool must have at least one channel");
+	channels_.reserve(size);
+	for (std::size_t i = 0; i < size; ++i) channels_.push_back(std::make_unique<channel>(options, optmask, ios));
+}
+
+channel_pool::channel_pool (boost::asio::io_service & ios, std::size_t size)
+	:	channel_pool(ios, size, default_options(), 0)
+{}
+
+channel_pool::channel_pool (const std::vector<boost::asio::io_service *> & services, const ares_options & options, int optmask) {
+	if (services.empty()) throw std::invalid_argument("asio_cares::channel_pool must have at least one channel");
+	channels_.reserve(services.size());
+	for (auto ios : services) {
+		assert(ios);
+		channels_.push_back(std::make_unique<channel>(options, optmask, *ios));
+	}
+}
+
+channel_pool::channel_pool (const std::vector<boost::asio::io_service *> & services)
+	:	channel_pool(services, default_options(), 0)
+{}
+
+std::size_t channel_pool::size () const noexcept {
+	return channels_.size();
+}
+
+channel & channel_pool::operator [] (std::size_t i) noexcept {
+	assert(i < channels_.size());
+	return *channels_[i];
+}
+
+const channel & channel_pool::operator [] (std::size_t i) const noexcept {
+	assert(i < channels_.size());
+	return *channels_[i];
+}
+
+channel & channel_pool::route (const unsigned char * qbuf, int qlen) noexcept {
+	detail::question_key key;
+	if ((qlen <= 0) || !detail::make_question_key(qbuf, std::size_t(qlen), key)) return for_this_thread();
+	return *channels_[key.hash % channels_.size()];
+}
+
+channel & channel_pool::for_this_thread () noexcept {
+	auto hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+	return *channels_[hash % channels_.size()];
+}
+
+void channel_pool::set_cache (cache * c) noexcept {
+	for (auto && ptr : channels_) ptr->set_cache(c);
+}
+
+void channel_pool::set_coalescing (bool enable) noexcept {
+	for (auto && ptr : channels_) ptr->set_coalescing(enable);
+}
+
+bool done (const channel_pool & pool) noexcept {
+	//	The channels may be driven concurrently on
+	//	their own strands so libcares (which is consulted
+	//	by done(const channel &)) must not be asked
+	for (std::size_t i = 0; i < pool.size(); ++i) if (pool[i].outstanding()) return false;
+	return true;
+}
+
+void cancel (channel_pool & pool) {
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		auto && c = pool[i];
+		c.get_strand().dispatch([&c] () {	cancel(c);	});
+	}
+}
+
+}
@@ -0,0 +1,298 @@
+#include <asio_cares/detail/datagram_batch.hpp>
+
+#include <ares.h>
+#include <asio_cares/memory_resource.hpp>
+#include <errno.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#else
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+
+namespace asio_cares {
+namespace detail {
+
+constexpr std::size_t datagram_batch::size;
+constexpr std::size_t datagram_batch::receive_size;
+constexpr std::size_t datagram_batch::send_size;
+
+#ifdef __linux__
+
+class datagram_batch::receive_state {
+public:
+	receive_state () noexcept {
+		std::memset(msgs, 0, sizeof(msgs));
+		for (std::size_t i = 1; i < size; ++i) {
+			iovs[i].iov_base = data[i - 1];
+			iovs[i].iov_len = receive_size;
+			msgs[i].msg_hdr.msg_name = &names[i];
+		}
+		for (std::size_t i = 0; i < size; ++i) {
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = control[i];
+		}
+	}
+	struct mmsghdr          msgs [size];
+	struct iovec            iovs [size];
+	struct sockaddr_storage names [size];
+	alignas(struct cmsghdr)
+	unsigned char           control [size][CMSG_SPACE(sizeof(std::uint32_t))];
+	//	The first datagram is received into the
+	//	caller's buffer
+	unsigned char           data [size - 1][receive_size];
+};
+
+class datagram_batch::send_state {
+public:
+	send_state () noexcept {
+		std::memset(msgs, 0, sizeof(msgs));
+		for (std::size_t i = 0; i < size; ++i) {
+			iovs[i].iov_base = data[i];
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+	struct mmsghdr msgs [size];
+	struct iovec   iovs [size];
+	unsigned char  data [size][send_size];
+};
+
+#else
+
+class datagram_batch::receive_state {};
+class datagram_batch::send_state {};
+
+#endif
+
+template <typename T>
+static T * create (memory_resource & r) noexcept {
+	void * ptr;
+	try {
+		ptr = r.allocate(sizeof(T), alignof(T));
+	} catch (...) {
+		return nullptr;
+	}
+	return new (ptr) T();
+}
+
+template <typename T>
+static void destroy (memory_resource & r, T * ptr) noexcept {
+	if (!ptr) return;
+	ptr->~T();
+	r.deallocate(ptr, sizeof(T), alignof(T));
+}
+
+datagram_batch::datagram_batch (memory_resource & r) noexcept
+	:	r_       (&r),
+		receive_ (nullptr),
+		send_    (nullptr),
+		head_    (0),
+		received_(0),
+		queued_  (0),
+		dropped_ (0)
+{}
+
+datagram_batch::~datagram_batch () noexcept {
+	destroy(*r_, receive_);
+	destroy(*r_, send_);
+}
+
+std::size_t datagram_batch::received () const noexcept {
+	return received_ - head_;
+}
+
+std::size_t datagram_batch::queued () const noexcept {
+	return queued_;
+}
+
+std::uint32_t datagram_batch::dropped () const noexcept {
+	return dropped_;
+}
+
+void datagram_batch::truncate (void * buffer, std::size_t len) noexcept {
+	//	Too short to be anything libcares would
+	//	accept anyway
+	if (len < 3) return;
+	static_cast<unsigned char *>(buffer)[2] |= 0x02;
+}
+
+#ifdef __linux__
+
+std::uint32_t datagram_batch::drop_count (const struct msghdr & msg) noexcept {
+	for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(const_cast<struct msghdr *>(&msg), cmsg)) {
+		if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SO_RXQ_OVFL)) continue;
+		std::uint32_t retr;
+		std::memcpy(&retr, CMSG_DATA(cmsg), sizeof(retr));
+		return retr;
+	}
+	return 0;
+}
+
+ares_ssize_t datagram_batch::receive (ares_socket_t fd,
+                                      void * buffer,
+                                      std::size_t len,
+                                      struct sockaddr * addr,
+                                      ares_socklen_t * addr_len,
+                                      std::size_t & syscalls) noexcept
+{
+	if (!addr_len) addr = nullptr;
+	if (head_ != received_) {
+		auto && r = *receive_;
+		auto && hdr = r.msgs[head_].msg_hdr;
+		std::size_t retr = std::min(std::size_t(r.msgs[head_].msg_len), len);
+		std::memcpy(buffer, r.data[head_ - 1], retr);
+		if ((hdr.msg_flags & MSG_TRUNC) || (retr != r.msgs[head_].msg_len)) truncate(buffer, retr);
+		if (addr) {
+			std::memcpy(addr, hdr.msg_name, std::min(std::size_t(hdr.msg_namelen), std::size_t(*addr_len)));
+			*addr_len = ares_socklen_t(hdr.msg_namelen);
+		}
+		if (++head_ == received_) head_ = received_ = 0;
+		return ares_ssize_t(retr);
+	}
+	++syscalls;
+	if (!receive_) receive_ = create<receive_state>(*r_);
+	if (!receive_) return ::recvfrom(fd, buffer, len, 0, addr, addr_len);
+	auto && r = *receive_;
+	r.iovs[0].iov_base = buffer;
+	r.iovs[0].iov_len = len;
+	r.msgs[0].msg_hdr.msg_name = addr;
+	r.msgs[0].msg_hdr.msg_namelen = addr ? socklen_t(*addr_len) : 0;
+	for (std::size_t i = 1; i < size; ++i) r.msgs[i].msg_hdr.msg_namelen = sizeof(r.names[i]);
+	for (auto && msg : r.msgs) msg.msg_hdr.msg_controllen = sizeof(r.control[0]);
+	int result = ::recvmmsg(fd, r.msgs, size, MSG_DONTWAIT, nullptr);
+	if (result <= 0) return result;
+	for (int i = 0; i < result; ++i) dropped_ = std::max(dropped_, drop_count(r.msgs[i].msg_hdr));
+	if (addr) *addr_len = ares_socklen_t(r.msgs[0].msg_hdr.msg_namelen);
+	if (r.msgs[0].msg_hdr.msg_flags & MSG_TRUNC) truncate(buffer, r.msgs[0].msg_len);
+	if (result > 1) {
+		head_ = 1;
+		received_ = std::size_t(result);
+	}
+	return ares_ssize_t(r.msgs[0].msg_len);
+}
+
+bool datagram_batch::queue (const struct iovec * data, int len) noexcept {
+	if (queued_ == size) return false;
+	std::size_t total = 0;
+	for (int i = 0; i < len; ++i) total += data[i].iov_len;
+	if (total > send_size) return false;
+	if (!send_) send_ = create<send_state>(*r_);
+	if (!send_) return false;
+	auto && s = *send_;
+	auto ptr = s.data[queued_];
+	for (int i = 0; i < len; ++i) {
+		std::memcpy(ptr, data[i].iov_base, data[i].iov_len);
+		ptr += data[i].iov_len;
+	}
+	s.iovs[queued_].iov_len = total;
+	++queued_;
+	return true;
+}
+
+std::size_t datagram_batch::send (ares_socket_t fd) noexcept {
+	std::size_t retr = 0;
+	std::size_t sent = 0;
+	while (sent != queued_) {
+		++retr;
+		int result = ::sendmmsg(fd, send_->msgs + sent, unsigned(queued_ - sent), MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (result > 0) {
+			sent += std::size_t(result);
+			continue;
+		}
+		if (errno == EINTR) continue;
+		//	Nothing more fits in the send buffer
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) break;
+		//	Other errors (for example an ICMP error
+		//	reported against an earlier datagram) are
+		//	charged to the datagram at the head
+		++sent;
+	}
+	queued_ = 0;
+	return retr;
+}
+
+bool datagram_batch::supported () noexcept {
+	return true;
+}
+
+ares_ssize_t datagram_batch::receive_one (ares_socket_t fd,
+                                          void * buffer,
+                                          std::size_t len,
+                                          struct sockaddr * addr,
+                                          ares_socklen_t * addr_len,
+                                          std::uint32_t & dropped) noexcept
+{
+	struct iovec iov;
+	iov.iov_base = buffer;
+	iov.iov_len = len;
+	alignas(struct cmsghdr) unsigned char control [CMSG_SPACE(sizeof(std::uint32_t))];
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	if (addr_len) {
+		msg.msg_name = addr;
+		msg.msg_namelen = socklen_t(*addr_len);
+	}
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	auto retr = ::recvmsg(fd, &msg, 0);
+	if (retr < 0) return retr;
+	if (addr_len) *addr_len = ares_socklen_t(msg.msg_namelen);
+	dropped = std::max(dropped, drop_count(msg));
+	if (msg.msg_flags & MSG_TRUNC) truncate(buffer, std::size_t(retr));
+	return retr;
+}
+
+#else
+
+ares_ssize_t datagram_batch::receive (ares_socket_t fd,
+                                      void * buffer,
+                                      std::size_t len,
+                                      struct sockaddr * addr,
+                                      ares_socklen_t * addr_len,
+                                      std::size_t & syscalls) noexcept
+{
+	++syscalls;
+	return ::recvfrom(fd, static_cast<char *>(buffer), len, 0, addr, addr_len);
+}
+
+bool datagram_batch::queue (const struct iovec *, int) noexcept {
+	return false;
+}
+
+std::size_t datagram_batch::send (ares_socket_t) noexcept {
+	return 0;
+}
+
+bool datagram_batch::supported () noexcept {
+	return false;
+}
+
+ares_ssize_t datagram_batch::receive_one (ares_socket_t fd,
+                                          void * buffer,
+                                          std::size_t len,
+                                          struct sockaddr * addr,
+                                          ares_socklen_t * addr_len,
+                                          std::uint32_t &) noexcept
+{
+	return ::recvfrom(fd, static_cast<char *>(buffer), len, 0, addr, addr_len);
+}
+
+std::uint32_t datagram_batch::drop_count (const struct msghdr &) noexcept {
+	return 0;
+}
+
+#endif
+
+}
+}
@@ -1,6 +1,7 @@
 #include <asio_cares/done.hpp>
 
 #include <ares.h>
+#include <asio_cares/channel.hpp>
 
 #ifdef _WIN32
 #include <Winsock2.h>
@@ -21,4 +22,8 @@ bool done (ares_channel channel) noexcept {
 	return ares_fds(channel, &a, &b) == 0;
 }
 
+bool done (const channel & c) noexcept {
+	return !c.active();
+}
+
 }
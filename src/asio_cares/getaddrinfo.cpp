@@ -0,0 +1,51 @@
+#include <asio_cares/getaddrinfo.hpp>
+
+#if ARES_VERSION >= 0x011000
+
+#include <ares.h>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+namespace asio_cares {
+namespace detail {
+
+static bool supported (const ares_addrinfo_node & node) noexcept {
+	return (node.ai_family == AF_INET) || (node.ai_family == AF_INET6);
+}
+
+static boost::asio::ip::address to_address (const ares_addrinfo_node & node) {
+	if (node.ai_family == AF_INET) {
+		auto && addr = *reinterpret_cast<const sockaddr_in *>(node.ai_addr);
+		return boost::asio::ip::address_v4(ntohl(addr.sin_addr.s_addr));
+	}
+	auto && addr = *reinterpret_cast<const sockaddr_in6 *>(node.ai_addr);
+	boost::asio::ip::address_v6::bytes_type bytes;
+	std::memcpy(bytes.data(), &addr.sin6_addr, bytes.size());
+	return boost::asio::ip::address_v6(bytes, addr.sin6_scope_id);
+}
+
+void to_address_info (const ares_addrinfo * info, unsigned short port, address_info_collection & results) {
+	std::size_t num = 0;
+	for (auto node = info->nodes; node; node = node->ai_next) if (supported(*node)) ++num;
+	results.reserve(results.size() + num);
+	for (auto node = info->nodes; node; node = node->ai_next) {
+		if (!supported(*node)) continue;
+		results.emplace_back(boost::asio::ip::tcp::endpoint(to_address(*node), port), node->ai_ttl);
+	}
+}
+
+}
+}
+
+#endif
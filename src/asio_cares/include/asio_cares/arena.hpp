@@ -0,0 +1,98 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+
+namespace asio_cares {
+
+/**
+ *	A monotonic \ref memory_resource: allocations
+ *	bump a pointer and deallocations do nothing,
+ *	memory is only reclaimed by \ref reset or on
+ *	destruction.
+ *
+ *	An arena may begin with a caller provided buffer.
+ *	Once that buffer (or the last chunk obtained) is
+ *	exhausted chunks of geometrically increasing size
+ *	are obtained from an upstream resource. Resetting
+ *	retains the largest chunk so that an arena which
+ *	is reused for similar work stops allocating once
+ *	warm.
+ *
+ *	Instances are not thread safe.
+ */
+class arena : public memory_resource {
+public:
+	arena (const arena &) = delete;
+	arena (arena &&) = delete;
+	arena & operator = (const arena &) = delete;
+	arena & operator = (arena &&) = delete;
+	/**
+	 *	Creates an arena with no initial buffer.
+	 *
+	 *	\param [in] upstream
+	 *		The \ref memory_resource from which chunks
+	 *		shall be obtained. Defaults to \ref new_delete_resource.
+	 *		This reference must remain valid for the
+	 *		lifetime of the object.
+	 */
+	explicit arena (memory_resource & upstream = new_delete_resource()) noexcept;
+	/**
+	 *	Creates an arena which allocates from a caller
+	 *	provided buffer before obtaining chunks from
+	 *	upstream.
+	 *
+	 *	\param [in] buffer
+	 *		A pointer to the buffer. The buffer must
+	 *		remain valid for the lifetime of the object.
+	 *	\param [in] size
+	 *		The size of the buffer in bytes.
+	 *	\param [in] upstream
+	 *		The \ref memory_resource from which chunks
+	 *		shall be obtained. Defaults to \ref new_delete_resource.
+	 *		This reference must remain valid for the
+	 *		lifetime of the object.
+	 */
+	arena (void * buffer, std::size_t size, memory_resource & upstream = new_delete_resource()) noexcept;
+	/**
+	 *	Returns all chunks to the upstream resource.
+	 */
+	~arena () noexcept;
+	/**
+	 *	Makes all memory allocated from the arena
+	 *	available for reuse. The largest chunk is
+	 *	retained, all others are returned to the
+	 *	upstream resource.
+	 */
+	void reset () noexcept;
+	/**
+	 *	Retrieves the upstream resource.
+	 *
+	 *	\return
+	 *		A reference to a \ref memory_resource.
+	 */
+	memory_resource & upstream () const noexcept;
+private:
+	class chunk {
+	public:
+		chunk *     next;
+		std::size_t size;
+	};
+	void release (chunk *) noexcept;
+	virtual void * do_allocate (std::size_t, std::size_t) override;
+	virtual void do_deallocate (void *, std::size_t, std::size_t) noexcept override;
+	virtual bool do_is_equal (const memory_resource &) const noexcept override;
+	memory_resource & upstream_;
+	unsigned char *   buffer_;
+	std::size_t       buffer_size_;
+	chunk *           chunks_;
+	unsigned char *   ptr_;
+	std::size_t       avail_;
+	std::size_t       next_size_;
+};
+
+}
@@ -0,0 +1,129 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+
+namespace asio_cares {
+
+class buffer_pool;
+
+/**
+ *	A reference counted handle to an immutable
+ *	sequence of bytes obtained from a \ref buffer_pool.
+ *
+ *	Copying a buffer does not copy the bytes, the
+ *	copies merely share them. Once the last handle
+ *	to a sequence of bytes is destroyed the memory
+ *	is returned to the \ref buffer_pool from whence
+ *	it came.
+ *
+ *	Distinct buffer objects may be used (and
+ *	destroyed) concurrently even if they share
+ *	the same bytes.
+ */
+class buffer {
+public:
+	/**
+	 *	Creates an empty buffer.
+	 */
+	buffer () noexcept;
+	buffer (const buffer & other) noexcept;
+	buffer (buffer && other) noexcept;
+	buffer & operator = (const buffer & rhs) noexcept;
+	buffer & operator = (buffer && rhs) noexcept;
+	~buffer () noexcept;
+	/**
+	 *	Retrieves a pointer to the bytes.
+	 *
+	 *	\return
+	 *		A pointer to the first byte or a null
+	 *		pointer if the buffer is empty.
+	 */
+	unsigned char * data () const noexcept;
+	/**
+	 *	Retrieves the number of bytes.
+	 *
+	 *	\return
+	 *		The number of bytes.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Determines whether the buffer refers to
+	 *	any bytes.
+	 *
+	 *	\return
+	 *		\em true if the buffer is not empty,
+	 *		\em false otherwise.
+	 */
+	explicit operator bool () const noexcept;
+private:
+	friend class buffer_pool;
+	class block;
+	explicit buffer (block *) noexcept;
+	void release () noexcept;
+	block * block_;
+};
+
+/**
+ *	Recycles the memory used to hold the bytes
+ *	of \ref buffer objects.
+ *
+ *	A bounded number of blocks is retained once
+ *	released so that in steady state obtaining
+ *	a buffer does not allocate.
+ *
+ *	Buffers obtained from a pool may outlive it.
+ *	Distinct buffers from the same pool may be
+ *	released concurrently with one another and
+ *	with calls to \ref acquire.
+ */
+class buffer_pool {
+public:
+	buffer_pool (const buffer_pool &) = delete;
+	buffer_pool (buffer_pool &&) = delete;
+	buffer_pool & operator = (const buffer_pool &) = delete;
+	buffer_pool & operator = (buffer_pool &&) = delete;
+	/**
+	 *	Creates a new buffer_pool.
+	 *
+	 *	\param [in] resource
+	 *		The \ref memory_resource from which blocks
+	 *		shall be allocated. Defaults to \ref new_delete_resource.
+	 *		This reference must remain valid until the
+	 *		pool and all buffers acquired therefrom have
+	 *		been destroyed.
+	 *	\param [in] max
+	 *		The maximum number of released blocks
+	 *		to retain. Defaults to 64.
+	 */
+	explicit buffer_pool (memory_resource & resource = new_delete_resource(), std::size_t max = 64);
+	/**
+	 *	Destroys the pool and all retained blocks.
+	 *	Outstanding buffers remain valid.
+	 */
+	~buffer_pool () noexcept;
+	/**
+	 *	Obtains a buffer holding a copy of certain
+	 *	bytes.
+	 *
+	 *	\param [in] data
+	 *		A pointer to the bytes to copy.
+	 *	\param [in] size
+	 *		The number of bytes to copy. If zero
+	 *		an empty buffer is returned.
+	 *
+	 *	\return
+	 *		A \ref buffer.
+	 */
+	buffer acquire (const unsigned char * data, std::size_t size);
+private:
+	friend class buffer;
+	class state;
+	state * state_;
+};
+
+}
@@ -0,0 +1,231 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/buffer_pool.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace asio_cares {
+
+/**
+ *	A bounded, TTL aware cache of DNS responses
+ *	keyed on the question (name, type, and class)
+ *	thereof.
+ *
+ *	Only standard queries (that is those whose
+ *	OPCODE is QUERY) are answered and the RD and
+ *	CD bits of the header and the DO bit of the
+ *	OPT record (if any) are considered part of the
+ *	key, so a response is only served to queries
+ *	which agree in these respects with the query
+ *	which obtained it.
+ *
+ *	Responses with answers are retained until
+ *	the smallest TTL in the answer section expires.
+ *	NXDOMAIN and NODATA responses are retained in
+ *	accordance with RFC 2308 for the lesser of the
+ *	TTL and the MINIMUM field of the SOA record in
+ *	the authority section (if there is no such record
+ *	they are not retained). Truncated responses and
+ *	responses with other RCODEs are never retained.
+ *
+ *	When a response is served from the cache its ID
+ *	is replaced with the ID of the query and the TTL
+ *	of each record is reduced by the time elapsed
+ *	since it was retained. Its question is spelled
+ *	as in the query which obtained the response (which
+ *	may differ in case from the query being answered).
+ *
+ *	The cache is divided into shards each of which
+ *	is guarded by its own lock so the cache may be
+ *	used concurrently (including by more than one
+ *	\ref channel). When a shard is full the CLOCK
+ *	algorithm chooses the entry to evict (expired
+ *	entries are treated as though they had not been
+ *	referenced, so the hand evicts the first expired
+ *	or unreferenced entry it reaches, which need not
+ *	be the only expired entry). Entries are found by
+ *	a hash of their question but the whole question
+ *	is compared, distinct questions whose hashes
+ *	collide are retained side by side.
+ *
+ *	To place a cache in front of a \ref channel
+ *	see \ref channel::set_cache.
+ *
+ *	The cache may optionally refresh hot responses
+ *	before they expire (see \ref prefetch_policy) so
+ *	that popular names never miss.
+ */
+class cache {
+public:
+	/**
+	 *	The clock used to measure TTLs.
+	 */
+	using clock = std::chrono::steady_clock;
+	/**
+	 *	Determines which retained responses are
+	 *	refreshed before they expire.
+	 *
+	 *	A response is refreshed when it is looked up
+	 *	after a certain fraction of its TTL has elapsed
+	 *	if it has been looked up at least a certain
+	 *	number of times since it was retained. Each
+	 *	response is refreshed at most once per TTL and
+	 *	refreshes are limited by a token bucket so that
+	 *	they cannot crowd out other queries.
+	 *
+	 *	libcares 1.23.0 and later has a query cache of
+	 *	its own which would answer refreshes, it should
+	 *	be disabled (by passing `ARES_OPT_QUERY_CACHE`
+	 *	with a `qcache_max_ttl` of zero) for channels
+	 *	which refresh responses.
+	 */
+	class prefetch_policy {
+	public:
+		/**
+		 *	Creates a policy which disables refreshing.
+		 */
+		prefetch_policy () noexcept;
+		/**
+		 *	The number of lookups since a response was
+		 *	retained after which it is considered hot.
+		 *	Zero disables refreshing.
+		 */
+		std::size_t hits;
+		/**
+		 *	The fraction of the TTL of a response which
+		 *	must elapse before it is refreshed. Defaults
+		 *	to 0.9.
+		 */
+		double      fraction;
+		/**
+		 *	The number of refreshes permitted per second
+		 *	on average. Defaults to ten.
+		 */
+		double      rate;
+		/**
+		 *	The number of refreshes permitted in a burst.
+		 *	Defaults to ten.
+		 */
+		std::size_t burst;
+	};
+	cache (const cache &) = delete;
+	cache (cache &&) = delete;
+	cache & operator = (const cache &) = delete;
+	cache & operator = (cache &&) = delete;
+	/**
+	 *	Creates a cache.
+	 *
+	 *	\param [in] capacity
+	 *		The maximum number of responses to retain.
+	 *		Defaults to 4096.
+	 *	\param [in] shards
+	 *		The number of shards. Defaults to 16.
+	 *	\param [in] max_ttl
+	 *		The maximum length of time to retain any
+	 *		response. Defaults to one day.
+	 *	\param [in] prefetch
+	 *		Determines which responses are refreshed
+	 *		before they expire. Defaults to none.
+	 */
+	explicit cache (std::size_t capacity = 4096,
+	                std::size_t shards = 16,
+	                std::chrono::seconds max_ttl = std::chrono::hours(24),
+	                const prefetch_policy & prefetch = prefetch_policy());
+	~cache () noexcept;
+	/**
+	 *	Attempts to find a response to a query.
+	 *
+	 *	\param [in] qbuf
+	 *		The query.
+	 *	\param [in] qlen
+	 *		The length of the query.
+	 *	\param [in] pool
+	 *		The \ref buffer_pool from which to obtain
+	 *		the buffer into which the response shall be
+	 *		copied.
+	 *	\param [in] now
+	 *		The current time. Defaults to `clock::now()`.
+	 *
+	 *	\return
+	 *		A \ref buffer containing the response if one
+	 *		was found, an empty \ref buffer otherwise.
+	 */
+	buffer lookup (const unsigned char * qbuf, std::size_t qlen, buffer_pool & pool, clock::time_point now = clock::now());
+	/**
+	 *	Attempts to find a response to a query and
+	 *	determines whether it should be refreshed (see
+	 *	\ref prefetch_policy).
+	 *
+	 *	\param [in] qbuf
+	 *		The query.
+	 *	\param [in] qlen
+	 *		The length of the query.
+	 *	\param [in] pool
+	 *		The \ref buffer_pool from which to obtain
+	 *		the buffer into which the response shall be
+	 *		copied.
+	 *	\param [out] refresh
+	 *		Set to \em true if a response was found and
+	 *		the caller should send the query in order to
+	 *		refresh it (in which case the query is not
+	 *		reported again until a new response is
+	 *		inserted), \em false otherwise.
+	 *	\param [in] now
+	 *		The current time. Defaults to `clock::now()`.
+	 *
+	 *	\return
+	 *		A \ref buffer containing the response if one
+	 *		was found, an empty \ref buffer otherwise.
+	 */
+	buffer lookup (const unsigned char * qbuf,
+	               std::size_t qlen,
+	               buffer_pool & pool,
+	               bool & refresh,
+	               clock::time_point now = clock::now());
+	/**
+	 *	Offers a response to the cache which retains
+	 *	it if appropriate.
+	 *
+	 *	\param [in] abuf
+	 *		The response.
+	 *	\param [in] alen
+	 *		The length of the response.
+	 *	\param [in] now
+	 *		The current time. Defaults to `clock::now()`.
+	 */
+	void insert (const unsigned char * abuf, std::size_t alen, clock::time_point now = clock::now());
+	/**
+	 *	Discards all retained responses.
+	 */
+	void clear () noexcept;
+	/**
+	 *	Retrieves the number of retained responses
+	 *	(including those which have expired but have
+	 *	not yet been discarded).
+	 *
+	 *	\return
+	 *		The number of responses.
+	 */
+	std::size_t size () const noexcept;
+private:
+	class entry;
+	class shard;
+	shard & get_shard (std::size_t) noexcept;
+	bool acquire_token (clock::time_point);
+	std::unique_ptr<shard[]> shards_;
+	std::size_t              num_shards_;
+	std::size_t              shard_capacity_;
+	std::chrono::seconds     max_ttl_;
+	prefetch_policy          prefetch_;
+	std::mutex               tokens_mutex_;
+	double                   tokens_;
+	clock::time_point        refilled_;
+};
+
+}
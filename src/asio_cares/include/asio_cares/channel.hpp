@@ -5,13 +5,34 @@
 #pragma once
 
 #include <ares.h>
-#include <boost/asio/deadline_timer.hpp>
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/cache.hpp>
+#include <asio_cares/detail/datagram_batch.hpp>
+#include <asio_cares/detail/inflight.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/detail/socket_table.hpp>
+#include <asio_cares/detail/submission.hpp>
+#include <asio_cares/detail/timer_wheel.hpp>
+#include <asio_cares/detail/uring.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/process_fds.hpp>
+#include <asio_cares/socket_options.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/system/error_code.hpp>
 #include <mpark/variant.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -30,7 +51,7 @@ public:
 	channel & operator = (channel &&) = delete;
 	/**
 	 *	Creates a new channel object by calling
-	 *	`ares_init`.
+	 *	`ares_init_options` with default options.
 	 *
 	 *	\param [in] ios
 	 *		The `io_service` which shall be used for
@@ -42,6 +63,12 @@ public:
 	 *	Creates a new channel object by calling
 	 *	`ares_init_options`.
 	 *
+	 *	The channel installs its own `sock_state_cb`
+	 *	in order to track the sockets libcares is
+	 *	interested in. If \em optmask contains
+	 *	`ARES_OPT_SOCK_STATE_CB` the provided callback
+	 *	is still invoked.
+	 *
 	 *	\param [in] options
 	 *		An `ares_options` object giving the options
 	 *		to pass as the second argument to `ares_init_options`.
@@ -54,6 +81,54 @@ public:
 	 *		remain valid for the lifetime of the object.
 	 */
 	channel (const ares_options & options, int optmask, boost::asio::io_service & ios);
+	/**
+	 *	Creates a new channel object by calling
+	 *	`ares_init_options` with default options.
+	 *
+	 *	All memory allocated by the channel and by
+	 *	the operations performed thereupon is obtained
+	 *	from \em resource rather than through the
+	 *	allocation hooks of completion handlers.
+	 *
+	 *	\param [in] ios
+	 *		The `io_service` which shall be used for
+	 *		asynchronous operations. This reference must
+	 *		remain valid for the lifetime of the object.
+	 *	\param [in] resource
+	 *		The \ref memory_resource from which memory
+	 *		shall be allocated. This reference must remain
+	 *		valid until the object and all outstanding
+	 *		completion handlers for operations thereupon
+	 *		have been destroyed.
+	 */
+	channel (boost::asio::io_service & ios, memory_resource & resource);
+	/**
+	 *	Creates a new channel object by calling
+	 *	`ares_init_options`.
+	 *
+	 *	All memory allocated by the channel and by
+	 *	the operations performed thereupon is obtained
+	 *	from \em resource rather than through the
+	 *	allocation hooks of completion handlers.
+	 *
+	 *	\param [in] options
+	 *		An `ares_options` object giving the options
+	 *		to pass as the second argument to `ares_init_options`.
+	 *	\param [in] optmask
+	 *		An integer giving the mask to pass as the
+	 *		third argument to `ares_init_options`.
+	 *	\param [in] ios
+	 *		The `io_service` which shall be used for
+	 *		asynchronous operations. This reference must
+	 *		remain valid for the lifetime of the object.
+	 *	\param [in] resource
+	 *		The \ref memory_resource from which memory
+	 *		shall be allocated. This reference must remain
+	 *		valid until the object and all outstanding
+	 *		completion handlers for operations thereupon
+	 *		have been destroyed.
+	 */
+	channel (const ares_options & options, int optmask, boost::asio::io_service & ios, memory_resource & resource);
 	/**
 	 *	Cleans up a channel object.
 	 */
@@ -80,13 +155,361 @@ public:
 	boost::asio::strand & get_strand () noexcept;
 	/**
 	 *	Operations on a channel have timeouts. This
-	 *	method retrieves the `boost::asio::deadline_timer`
-	 *	used to track those timeouts.
+	 *	method retrieves the `boost::asio::steady_timer`
+	 *	used to track those timeouts. Since the timer
+	 *	is monotonic timeouts are unaffected by changes
+	 *	to the system clock.
+	 *
+	 *	\return
+	 *		A reference to a `steady_timer`.
+	 */
+	boost::asio::steady_timer & get_timer () noexcept;
+	/**
+	 *	Answers which must outlive the libcares
+	 *	callback which delivers them are copied
+	 *	into buffers obtained from a pool owned
+	 *	by the channel. This method retrieves
+	 *	that pool.
+	 *
+	 *	\return
+	 *		A reference to a \ref buffer_pool.
+	 */
+	buffer_pool & get_buffer_pool () noexcept;
+	/**
+	 *	Retrieves the \ref memory_resource provided
+	 *	when the channel was constructed.
+	 *
+	 *	\return
+	 *		A pointer to a \ref memory_resource or a
+	 *		null pointer if none was provided.
+	 */
+	memory_resource * get_memory_resource () const noexcept;
+	/**
+	 *	Places a \ref cache in front of the channel.
+	 *
+	 *	Queries sent with \ref async_send are first
+	 *	looked up in the cache and only sent if no
+	 *	response is found, responses to queries which
+	 *	are sent are offered to the cache.
+	 *
+	 *	\param [in] c
+	 *		A pointer to the \ref cache or a null pointer
+	 *		to remove the cache. The \ref cache must remain
+	 *		valid until it is removed or the object is
+	 *		destroyed. A \ref cache may be shared by
+	 *		several channels.
+	 */
+	void set_cache (cache * c) noexcept;
+	/**
+	 *	Retrieves the \ref cache placed in front of
+	 *	the channel.
+	 *
+	 *	\return
+	 *		A pointer to a \ref cache or a null pointer
+	 *		if there is none.
+	 */
+	cache * get_cache () const noexcept;
+	/**
+	 *	Enables or disables the coalescing of identical
+	 *	queries.
+	 *
+	 *	While enabled a query sent by \ref async_send
+	 *	while another identical query is in flight is
+	 *	not sent, rather it completes when the other
+	 *	query completes and with the same result. Queries
+	 *	are identical if they differ in no respect save
+	 *	their IDs and the case of the name in their
+	 *	question: Their header flags and their OPT records
+	 *	must match. Queries with records other than an
+	 *	OPT record are never coalesced. All such queries
+	 *	share a single copy of the answer.
+	 *
+	 *	Since the copy is shared it is the answer to
+	 *	the query which was actually sent: It carries
+	 *	the ID of that query and its question is spelled
+	 *	as in that query (which may differ in case). This
+	 *	differs from answers served from a \ref cache,
+	 *	each of which is a copy which carries the ID of
+	 *	the query it answers. Callers which match answers
+	 *	to queries by ID should not enable coalescing.
+	 *	Completion handlers must not modify the answer
+	 *	(for example to replace the ID) since doing so
+	 *	would alter the answer every other such handler
+	 *	receives.
+	 *
+	 *	Disabled by default.
+	 *
+	 *	\param [in] enable
+	 *		\em true to enable, \em false to disable.
+	 */
+	void set_coalescing (bool enable) noexcept;
+	/**
+	 *	Determines whether identical queries are
+	 *	coalesced.
+	 *
+	 *	\return
+	 *		\em true if queries are coalesced, \em false
+	 *		otherwise.
+	 */
+	bool get_coalescing () const noexcept;
+	/**
+	 *	Enables or disables batching the datagrams
+	 *	libcares receives and sends over UDP.
+	 *
+	 *	While enabled each time libcares reads from
+	 *	a UDP socket which has nothing buffered as
+	 *	many as `detail::datagram_batch::size`
+	 *	datagrams are received with a single call to
+	 *	`recvmmsg` and the rest are handed to libcares
+	 *	as it continues to read. Queries libcares sends
+	 *	over UDP are queued and sent with a single call
+	 *	to `sendmmsg` per socket once the handler in
+	 *	which they were sent returns. Since libcares
+	 *	believes such queries were sent immediately
+	 *	failures to send them are only noticed when
+	 *	they time out.
+	 *
+	 *	Datagrams received but not yet read by libcares
+	 *	are handed to libcares without waiting for their
+	 *	socket to become readable again by both
+	 *	\ref async_process and \ref async_process_one.
+	 *
+	 *	Disabled by default. Has no effect except on
+	 *	Linux.
+	 *
+	 *	\param [in] enable
+	 *		\em true to enable, \em false to disable.
+	 */
+	void set_batching (bool enable) noexcept;
+	/**
+	 *	Determines whether UDP datagrams are batched.
 	 *
 	 *	\return
-	 *		A reference to a `deadline_timer`.
+	 *		\em true if datagrams are batched, \em false
+	 *		otherwise.
 	 */
-	boost::asio::deadline_timer & get_timer () noexcept;
+	bool get_batching () const noexcept;
+	/**
+	 *	Enables or disables handing the datagrams
+	 *	libcares receives and sends over UDP to the
+	 *	kernel through an io_uring instance owned by
+	 *	the channel.
+	 *
+	 *	While enabled each UDP socket libcares opens
+	 *	keeps `detail::uring_receiver::depth` receives
+	 *	outstanding in the ring rather than being waited
+	 *	upon by the reactor. The reactor instead waits
+	 *	upon the ring and the datagrams it receives are
+	 *	handed to libcares as it reads. Queries libcares
+	 *	sends over UDP are copied into the ring and are
+	 *	submitted, together with the receives which replace
+	 *	the datagrams libcares consumed, with a single
+	 *	system call once the handler in which they were
+	 *	sent returns. Since libcares believes such queries
+	 *	were sent immediately failures to send them are
+	 *	only noticed when they time out.
+	 *
+	 *	Such sockets are not batched (see \ref set_batching).
+	 *	TCP sockets are unaffected, as is connecting (which
+	 *	completes immediately for UDP sockets). Sockets
+	 *	which are already open are unaffected.
+	 *
+	 *	Receives are only started by the reactor which
+	 *	drives \ref async_process. \ref async_process_one
+	 *	completes the operations of the ring each time it
+	 *	is invoked (so that the buffers of sends are
+	 *	reused and the completion queue does not overflow)
+	 *	and, if receives were started by an earlier
+	 *	invocation of \ref async_process, waits upon the
+	 *	ring in addition to the sockets.
+	 *
+	 *	Disabled by default. Has no effect unless the
+	 *	library was built with `ASIO_CARES_IO_URING` and
+	 *	the kernel supports io_uring (Linux 5.7 and later).
+	 *	The ring is created the first time this is enabled
+	 *	and if it cannot be \ref get_io_uring reports
+	 *	\em false.
+	 *
+	 *	\param [in] enable
+	 *		\em true to enable, \em false to disable.
+	 */
+	void set_io_uring (bool enable) noexcept;
+	/**
+	 *	Determines whether UDP datagrams are handed to
+	 *	the kernel through io_uring.
+	 *
+	 *	\return
+	 *		\em true if they are, \em false otherwise.
+	 */
+	bool get_io_uring () const noexcept;
+	/**
+	 *	Sets the maximum number of UDP sockets kept
+	 *	open for reuse for each address family.
+	 *
+	 *	Rather than being closed a UDP socket libcares
+	 *	closes is disconnected, drained, and placed in
+	 *	a pool (if there is room) from which the next
+	 *	UDP socket of the same address family libcares
+	 *	opens is taken. Sockets in the pool remain open
+	 *	and registered with the reactor so reusing one
+	 *	avoids opening a socket, registering it, and
+	 *	closing it. This matters where libcares closes
+	 *	sockets often, for example when
+	 *	`ARES_OPT_UDP_MAX_QUERIES` is set.
+	 *
+	 *	Disconnecting a socket must release its local
+	 *	port for it to be pooled, so that a reused socket
+	 *	is bound to a fresh ephemeral port when libcares
+	 *	connects it, sockets which keep their port (for
+	 *	example because libcares bound them to a certain
+	 *	port or because the platform does not release the
+	 *	port) are closed as usual.
+	 *
+	 *	Zero (and therefore disabled) by default. Has no
+	 *	effect on Windows.
+	 *
+	 *	\param [in] size
+	 *		The maximum number of sockets for each address
+	 *		family. Sockets in excess thereof which are
+	 *		already in the pool are closed.
+	 */
+	void set_socket_pool_size (std::size_t size) noexcept;
+	/**
+	 *	Retrieves the maximum number of UDP sockets
+	 *	kept open for reuse for each address family.
+	 *
+	 *	\return
+	 *		The maximum number of sockets.
+	 */
+	std::size_t get_socket_pool_size () const noexcept;
+	/**
+	 *	Sets the options applied to each UDP socket
+	 *	opened thereafter.
+	 *
+	 *	Sockets taken from the pool (see
+	 *	\ref set_socket_pool_size) keep the options
+	 *	they were opened with.
+	 *
+	 *	\param [in] options
+	 *		The options.
+	 */
+	void set_socket_options (const socket_options & options) noexcept;
+	/**
+	 *	Retrieves the options applied to each UDP
+	 *	socket.
+	 *
+	 *	\return
+	 *		A reference to a \ref socket_options object.
+	 */
+	const socket_options & get_socket_options () const noexcept;
+	/**
+	 *	Attaches an operation to the query in flight
+	 *	with a certain key (if any). This is a low
+	 *	level interface, see \ref async_send.
+	 *
+	 *	\param [in] key
+	 *		The key of the query (see
+	 *		`detail::make_query_key`).
+	 *	\param [in] waiter
+	 *		The operation.
+	 *
+	 *	\return
+	 *		\em true if the operation was attached,
+	 *		\em false if coalescing is disabled or no
+	 *		query with the key is in flight.
+	 */
+	bool coalesce (const detail::question_key & key, detail::send_waiter & waiter) noexcept;
+	/**
+	 *	Records that a query with a certain key
+	 *	is in flight so that later queries may be
+	 *	attached thereto. This is a low level interface,
+	 *	see \ref async_send.
+	 *
+	 *	\param [in] key
+	 *		The key of the query (see
+	 *		`detail::make_query_key`).
+	 *
+	 *	\return
+	 *		A pointer which must be passed to \ref end_inflight
+	 *		when the query completes, or a null pointer if
+	 *		coalescing is disabled or the query could not
+	 *		be recorded.
+	 */
+	detail::inflight * begin_inflight (const detail::question_key & key) noexcept;
+	/**
+	 *	Records that a query is no longer in flight.
+	 *	This is a low level interface, see \ref async_send.
+	 *
+	 *	\param [in] ptr
+	 *		The pointer returned by \ref begin_inflight.
+	 *		May be null.
+	 *
+	 *	\return
+	 *		A pointer to the first operation attached to
+	 *		the query (the remainder may be found by following
+	 *		`next`), or a null pointer if there are none.
+	 */
+	detail::send_waiter * end_inflight (detail::inflight * ptr) noexcept;
+	/**
+	 *	Hands an operation to the channel which shall
+	 *	be run on the `strand` returned by \ref get_strand.
+	 *
+	 *	Submissions are accumulated in a lock free queue
+	 *	and only the first submission made while the
+	 *	queue is idle causes a handler to be posted to
+	 *	the `strand`, that handler runs every submission
+	 *	which has accumulated by the time it runs.
+	 *	Submissions are counted by \ref outstanding until
+	 *	they are run.
+	 *
+	 *	Unlike the other members of this class this
+	 *	function may be invoked concurrently with any
+	 *	other operation on this object. This is a low
+	 *	level interface, see \ref async_submit.
+	 *
+	 *	\param [in] s
+	 *		The operation. Must remain valid until it
+	 *		is run.
+	 */
+	void submit (detail::submission & s);
+	/**
+	 *	Arranges for an operation to expire at a
+	 *	certain time.
+	 *
+	 *	Deadlines are kept in a hierarchical timer
+	 *	wheel driven by a single timer (distinct from
+	 *	the one returned by \ref get_timer) so adding
+	 *	and removing a deadline takes constant time
+	 *	regardless of how many are outstanding. The
+	 *	timer only waits while there are deadlines and
+	 *	its resolution is one millisecond.
+	 *
+	 *	When the deadline passes the operation is
+	 *	removed and its `expire` member is invoked on
+	 *	the `strand` returned by \ref get_strand.
+	 *
+	 *	This function must be invoked on the `strand`
+	 *	returned by \ref get_strand (or otherwise without
+	 *	concurrent access to this object). This is a low
+	 *	level interface, see \ref async_send.
+	 *
+	 *	\param [in] entry
+	 *		The operation. Must not already have a
+	 *		deadline and must remain valid until it
+	 *		expires or is passed to \ref cancel_deadline.
+	 *	\param [in] deadline
+	 *		The time at which the operation expires.
+	 */
+	void schedule_deadline (detail::timer_wheel_entry & entry, std::chrono::steady_clock::time_point deadline);
+	/**
+	 *	Removes the deadline of an operation which
+	 *	has not yet expired. This is a low level
+	 *	interface, see \ref async_send.
+	 *
+	 *	\param [in] entry
+	 *		The operation.
+	 */
+	void cancel_deadline (detail::timer_wheel_entry & entry) noexcept;
 private:
 	using socket_type = mpark::variant<boost::asio::ip::tcp::socket, boost::asio::ip::udp::socket>;
 	template <typename Function>
@@ -108,7 +531,7 @@ public:
 		socket_guard (const socket_guard &) = delete;
 		socket_guard & operator = (const socket_guard &) = delete;
 		socket_guard & operator = (socket_guard &&) = delete;
-		socket_guard (socket_type &, channel &) noexcept;
+		socket_guard (socket_type &, ares_socket_t, channel &) noexcept;
 		socket_guard (socket_guard &&) noexcept;
 		~socket_guard () noexcept;
 		/**
@@ -134,6 +557,7 @@ public:
 		}
 	private:
 		socket_type * socket_;
+		ares_socket_t fd_;
 		channel *     channel_;
 	};
 	/**
@@ -156,6 +580,88 @@ public:
 	 *		which the socket may be accessed.
 	 */
 	socket_guard acquire_socket (ares_socket_t socket) noexcept;
+	/**
+	 *	Retrieves the number of queries outstanding
+	 *	on this channel.
+	 *
+	 *	Only queries bracketed by calls to
+	 *	\ref begin_query and \ref end_query (as all
+	 *	queries submitted by \ref async_send are) are
+	 *	counted. Queries submitted directly through
+	 *	libcares are not. Operations handed to
+	 *	\ref submit which have not yet run are.
+	 *
+	 *	Unlike the other members of this class this
+	 *	function may be invoked concurrently with any
+	 *	other operation on this object.
+	 *
+	 *	\return
+	 *		The number of outstanding queries.
+	 */
+	std::size_t outstanding () const noexcept;
+	/**
+	 *	Determines whether there are any queries
+	 *	active on this channel.
+	 *
+	 *	Unlike \ref outstanding queries submitted
+	 *	directly through libcares (for example with
+	 *	`ares_send` or `ares_gethostbyname`) are also
+	 *	considered. If \ref outstanding is non-zero this
+	 *	requires only a single load, otherwise libcares
+	 *	is asked (which takes constant time when libcares
+	 *	has no queries active and may take time linear
+	 *	in the number of queries submitted directly
+	 *	through libcares otherwise).
+	 *
+	 *	\return
+	 *		\em true if there are active queries, \em false
+	 *		otherwise.
+	 */
+	bool active () const noexcept;
+	/**
+	 *	Informs the channel that a query is about
+	 *	to be submitted.
+	 *
+	 *	Each call to this function must be matched
+	 *	by a call to \ref end_query once the query
+	 *	completes (i.e. from within the callback
+	 *	libcares invokes upon its completion).
+	 *
+	 *	\return
+	 *		A value which may be passed to \ref end_query
+	 *		in order to record the latency of the query.
+	 */
+	metrics::timestamp begin_query () noexcept;
+	/**
+	 *	Informs the channel that a query submitted
+	 *	after a call to \ref begin_query has completed.
+	 *
+	 *	\param [in] status
+	 *		The status libcares passed to the callback.
+	 *	\param [in] timeouts
+	 *		The number of timeouts libcares passed to
+	 *		the callback.
+	 *	\param [in] start
+	 *		The value returned by \ref begin_query, or
+	 *		a value initialized `metrics::timestamp`
+	 *		if the latency of the query is not to be
+	 *		recorded. Defaults to the latter.
+	 */
+	void end_query (int status, int timeouts, metrics::timestamp start = metrics::timestamp()) noexcept;
+	/**
+	 *	Retrieves the metrics which describe the
+	 *	activity of this channel.
+	 *
+	 *	Unlike the other members of this class this
+	 *	function (and the members of the returned
+	 *	object which read metrics) may be invoked
+	 *	concurrently with any other operation on this
+	 *	object.
+	 *
+	 *	\return
+	 *		A reference to a \ref metrics object.
+	 */
+	const metrics & get_metrics () const noexcept;
 	/**
 	 *	Retrieves the managed `ares_channel` object.
 	 *
@@ -182,36 +688,374 @@ public:
 	void for_each_socket (Function && function) noexcept(is_nothrow_invocable<Function>) {
 		for (auto && state : sockets_) mpark::visit(function, state.socket);
 	}
+	/**
+	 *	Invokes a certain function object for each
+	 *	socket in which libcares has currently expressed
+	 *	an interest.
+	 *
+	 *	Interest is tracked through the `sock_state_cb`
+	 *	libcares invokes whenever it changes, accordingly
+	 *	there is no limit on the number of sockets which
+	 *	may be tracked (unlike `ares_getsock` which is
+	 *	limited to `ARES_GETSOCK_MAXNUM`).
+	 *
+	 *	\tparam Function
+	 *		The type of function object to invoke. Must
+	 *		be invocable with three arguments: An
+	 *		`ares_socket_t` followed by two `bool` values
+	 *		which are \em true if libcares is interested
+	 *		in the socket being readable or writable,
+	 *		respectively.
+	 *
+	 *	\param [in] function
+	 *		The function object to invoke.
+	 */
+	template <typename Function>
+	void for_each_interest (Function && function) {
+		for (auto && state : sockets_) {
+			if (state.closed || !(state.want_read || state.want_write)) continue;
+			function(state.fd, state.want_read, state.want_write);
+		}
+	}
+	/**
+	 *	Invokes a certain function object for each
+	 *	UDP socket currently in use by the channel
+	 *	with the number of datagrams the kernel has
+	 *	dropped thereupon because its receive buffer
+	 *	was full.
+	 *
+	 *	Counts are only available if
+	 *	`socket_options::track_drops` is set and are
+	 *	only updated as datagrams are received (the
+	 *	kernel reports the count with each datagram).
+	 *	The count of a socket taken from the pool
+	 *	includes drops before it was reused.
+	 *
+	 *	\tparam Function
+	 *		The type of function object to invoke. Must
+	 *		be invocable with two arguments: An
+	 *		`ares_socket_t` followed by a `std::uint32_t`
+	 *		which is the count.
+	 *
+	 *	\param [in] function
+	 *		The function object to invoke.
+	 */
+	template <typename Function>
+	void for_each_drop_count (Function && function) {
+		for (auto && state : sockets_) if (state.udp && !state.closed) function(state.fd, state.drops);
+	}
+	/**
+	 *	Invokes a certain function object for each
+	 *	socket in which libcares has expressed an
+	 *	interest in reading and upon which the channel
+	 *	has received datagrams libcares has not yet
+	 *	read (see \ref set_batching and \ref set_io_uring).
+	 *
+	 *	Such sockets may not become readable again and
+	 *	must therefore be processed without being waited
+	 *	upon. Operations of the io_uring instance of the
+	 *	channel which have completed are completed first.
+	 *
+	 *	This is a low level interface, see
+	 *	\ref async_process_one.
+	 *
+	 *	\tparam Function
+	 *		The type of function object to invoke. Must
+	 *		be invocable with an `ares_socket_t`.
+	 *
+	 *	\param [in] function
+	 *		The function object to invoke.
+	 */
+	template <typename Function>
+	void for_each_buffered (Function && function) {
+		reap();
+		for (auto && state : sockets_) {
+			if (state.closed || !state.want_read) continue;
+			if (state.batch.received() || state.receiver.received()) function(state.fd);
+		}
+	}
+	/**
+	 *	Waits for operations of the io_uring instance
+	 *	of the channel (see \ref set_io_uring) to complete
+	 *	if the datagrams of any socket are received
+	 *	thereby (such sockets do not become readable
+	 *	as datagrams arrive). This is a low level
+	 *	interface, see \ref async_process_one.
+	 *
+	 *	\tparam Handler
+	 *		The type of completion handler. Must be
+	 *		invocable as a handler for
+	 *		`boost::asio::posix::stream_descriptor::async_read_some`.
+	 *
+	 *	\param [in] handler
+	 *		The completion handler.
+	 *
+	 *	\return
+	 *		\em true if the wait was initiated, \em false
+	 *		if no socket receives its datagrams through
+	 *		the ring (in which case \em handler is not
+	 *		invoked).
+	 */
+	template <typename Handler>
+	bool async_wait_uring (Handler && handler) {
+		bool receiving = false;
+		for (auto && state : sockets_) if (!state.closed && state.receiver.started()) receiving = true;
+		if (!receiving) return false;
+		ring_.async_wait(std::forward<Handler>(handler));
+		return true;
+	}
+	/**
+	 *	Cancels a wait initiated by \ref async_wait_uring.
+	 */
+	void cancel_uring_wait () noexcept;
+	/**
+	 *	The type of callback which may be passed to
+	 *	\ref process.
+	 *
+	 *	The first argument is the pointer passed to
+	 *	\ref process and the second is the result of
+	 *	processing. Callbacks of this type must not
+	 *	throw.
+	 */
+	using process_callback = void (*) (void *, boost::system::error_code);
+	/**
+	 *	Processes the channel until there are no
+	 *	outstanding queries and then invokes a callback.
+	 *
+	 *	Processing is performed by a reactor which
+	 *	persists across wakeups: At most one wait is
+	 *	outstanding for each direction on each socket
+	 *	and a socket is only waited upon anew once its
+	 *	previous wait completes or libcares expresses
+	 *	a new interest therein (see \ref for_each_interest). Accordingly the work
+	 *	done per received packet does not depend on
+	 *	the number of sockets.
+	 *
+	 *	Every socket which becomes ready in the same
+	 *	turn of the reactor is gathered and the whole
+	 *	batch is handed to libcares at once (see
+	 *	\ref process_fds).
+	 *
+	 *	If the reactor is already running the callback
+	 *	is simply added to the set of callbacks which
+	 *	shall be invoked when it stops.
+	 *
+	 *	The callback may be invoked from within this
+	 *	function. This function must be invoked on
+	 *	the `strand` returned by \ref get_strand (or
+	 *	otherwise without concurrent access to this
+	 *	object). This is a low level interface, see
+	 *	\ref async_process.
+	 *
+	 *	\param [in] callback
+	 *		The callback to invoke.
+	 *	\param [in] arg
+	 *		A pointer which shall be passed through
+	 *		to \em callback.
+	 */
+	void process (process_callback callback, void * arg);
 private:
 	class socket_state {
 	public:
 		socket_state () = delete;
 		socket_state (const socket_state &) = delete;
-		socket_state (socket_state &&) = default;
+		socket_state (socket_state &&) = delete;
 		socket_state & operator = (const socket_state &) = delete;
-		socket_state & operator = (socket_state &&) = default;
-		explicit socket_state (socket_type);
-		socket_type socket;
-		bool        acquired;
-		bool        closed;
+		socket_state & operator = (socket_state &&) = delete;
+		socket_state (socket_type, ares_socket_t, std::size_t, bool, memory_resource &);
+		socket_type            socket;
+		ares_socket_t          fd;
+		std::size_t            id;
+		bool                   udp;
+		bool                   acquired;
+		bool                   closed;
+		bool                   want_read;
+		bool                   want_write;
+		bool                   reading;
+		bool                   writing;
+		detail::datagram_batch batch;
+		//	The count of datagrams the kernel dropped
+		//	as last reported
+		std::uint32_t          drops;
+		//	Whether the receive buffer may still grow
+		//	as datagrams are dropped, cleared once it
+		//	reaches the maximum or the kernel stops
+		//	growing it
+		bool                   growable;
+		//	Whether datagrams are handed to the kernel
+		//	through the ring, fixed when the socket is
+		//	opened
+		bool                   uring;
+		detail::uring_receiver receiver;
 	};
-	void release_socket (int) noexcept;
-	using sockets_collection_type = std::vector<socket_state>;
-	template <typename T>
-	sockets_collection_type::iterator insertion_point (const T &) noexcept;
-	template <typename T>
-	sockets_collection_type::iterator find (const T &) noexcept;
+	void release_socket (ares_socket_t) noexcept;
+	void erase (socket_state &) noexcept;
+	bool recycle (socket_state &) noexcept;
+	void drop (socket_state &, std::uint32_t) noexcept;
+	using sockets_collection_type = detail::socket_table<socket_state>;
+	static std::size_t socket_key (ares_socket_t) noexcept;
+	socket_state & find (ares_socket_t) noexcept;
+	socket_state * lookup (ares_socket_t) noexcept;
+	void wait (socket_state &, bool);
+	void rearm (socket_state &);
+	void update () noexcept;
+	void complete_wait (ares_socket_t, std::size_t, bool, boost::system::error_code) noexcept;
+	void schedule (socket_events);
+	void flush () noexcept;
+	void drain () noexcept;
+	bool defer (socket_state &, const struct iovec *, int) noexcept;
+	void send (socket_state &) noexcept;
+	void send_deferred () noexcept;
+	bool post_send () noexcept;
+	bool send_ring (ares_socket_t, const struct iovec *, int) noexcept;
+	bool receive_ring (socket_state &);
+	void wait_ring ();
+	void complete_ring (boost::system::error_code) noexcept;
+	void reap () noexcept;
+	static void received (void *, int) noexcept;
+	void arm_deadline (std::chrono::steady_clock::time_point);
+	void complete_deadline (boost::system::error_code) noexcept;
+	void expire_deadlines () noexcept;
+	void start () noexcept;
+	void settle () noexcept;
+	void stop () noexcept;
+	void finish () noexcept;
 	boost::asio::ip::tcp::socket tcp_socket (bool, boost::system::error_code &) noexcept;
 	boost::asio::ip::udp::socket udp_socket (bool, boost::system::error_code &) noexcept;
+	void configure (boost::asio::ip::udp::socket &, bool, boost::system::error_code &) noexcept;
 	socket_type socket (bool, bool, boost::system::error_code &) noexcept;
 	static ares_socket_t socket (int, int, int, void *) noexcept;
 	static int close (ares_socket_t, void *) noexcept;
-	void init () noexcept;
+	static ares_ssize_t recvfrom (ares_socket_t, void *, std::size_t, int, struct sockaddr *, ares_socklen_t *, void *) noexcept;
+	static ares_ssize_t sendv (ares_socket_t, const struct iovec *, int, void *) noexcept;
+	static void sock_state (void *, ares_socket_t, int, int) noexcept;
+	channel (boost::asio::io_service &, memory_resource *);
+	void init (const ares_options &, int);
+	void * allocate (std::size_t);
+	void deallocate (void *, std::size_t) noexcept;
+	using handler_storage = std::aligned_storage_t<128>;
+	//	Completion handler for the operations the
+	//	channel itself performs: Invokes Member with
+	//	the Bound arguments followed by the arguments
+	//	of the completion. If Storage is not null the
+	//	operation is allocated therefrom when it fits
+	//	(which requires that at most one such operation
+	//	be outstanding at once)
+	template <typename Signature, Signature Member, bool Continuation, handler_storage channel::* Storage, typename... Bound>
+	class handler {
+	public:
+		handler () = delete;
+		handler (const handler &) = default;
+		handler (handler &&) = default;
+		handler & operator = (const handler &) = default;
+		handler & operator = (handler &&) = default;
+		explicit handler (channel & c, Bound... bound) noexcept
+			:	channel_(&c),
+				bound_  (bound...)
+		{}
+		void operator () () noexcept {
+			invoke(std::index_sequence_for<Bound...>{});
+		}
+		void operator () (boost::system::error_code ec, std::size_t = 0) noexcept {
+			invoke(std::index_sequence_for<Bound...>{}, ec);
+		}
+		friend bool asio_handler_is_continuation (handler *) noexcept {
+			return Continuation;
+		}
+		friend void * asio_handler_allocate (std::size_t size, handler * self) {
+			return self->allocate(size);
+		}
+		friend void asio_handler_deallocate (void * ptr, std::size_t size, handler * self) noexcept {
+			self->deallocate(ptr, size);
+		}
+	private:
+		void * allocate (std::size_t size) {
+			if (Storage && (size <= sizeof(handler_storage))) return &(channel_->*Storage);
+			return channel_->allocate(size);
+		}
+		void deallocate (void * ptr, std::size_t size) noexcept {
+			if (Storage && (ptr == &(channel_->*Storage))) return;
+			channel_->deallocate(ptr, size);
+		}
+		template <std::size_t... Is, typename... Args>
+		void invoke (std::index_sequence<Is...>, Args... args) noexcept {
+			(channel_->*Member)(std::get<Is>(bound_)..., args...);
+		}
+		channel *            channel_;
+		std::tuple<Bound...> bound_;
+	};
+	using waiter_type = std::pair<process_callback, void *>;
+	using waiters_collection_type = std::vector<waiter_type, polymorphic_allocator<waiter_type>>;
+	using ready_collection_type = std::vector<socket_events, polymorphic_allocator<socket_events>>;
+	using deferred_collection_type = std::vector<ares_socket_t, polymorphic_allocator<ares_socket_t>>;
+	using pool_collection_type = std::vector<boost::asio::ip::udp::socket, polymorphic_allocator<boost::asio::ip::udp::socket>>;
+	using timer_time_point = boost::asio::steady_timer::time_point;
+	using inflight_value_type = std::pair<const std::size_t, detail::inflight>;
+	using inflight_collection_type = std::unordered_multimap<std::size_t,
+	                                                         detail::inflight,
+	                                                         std::hash<std::size_t>,
+	                                                         std::equal_to<std::size_t>,
+	                                                         polymorphic_allocator<inflight_value_type>>;
+	memory_resource *           resource_;
 	ares_socket_functions       funcs_;
 	ares_channel                channel_;
 	boost::asio::strand         strand_;
 	sockets_collection_type     sockets_;
-	boost::asio::deadline_timer timer_;
+	boost::asio::steady_timer   timer_;
+	std::size_t                 next_id_;
+	std::atomic<std::size_t>    outstanding_;
+	waiters_collection_type     waiters_;
+	std::size_t                 waits_;
+	std::size_t                 timer_waits_;
+	std::size_t                 timer_resets_;
+	//	The expiry of the outstanding wait on the
+	//	timer (if any)
+	timer_time_point            timer_expiry_;
+	ready_collection_type       ready_;
+	ares_sock_state_cb          sock_state_cb_;
+	void *                      sock_state_cb_data_;
+	boost::system::error_code   error_;
+	bool                        running_;
+	bool                        stopping_;
+	bool                        flushing_;
+	buffer_pool                 buffers_;
+	cache *                     cache_;
+	inflight_collection_type    inflight_;
+	bool                        coalescing_;
+	detail::submission_queue    submissions_;
+	handler_storage             drain_storage_;
+	detail::timer_wheel         deadlines_;
+	boost::asio::steady_timer   deadline_timer_;
+	bool                        deadline_armed_;
+	//	The expiry of the outstanding wait on the
+	//	deadline timer (if armed)
+	timer_time_point            deadline_expiry_;
+	metrics                     metrics_;
+	bool                        batching_;
+	//	Sockets with datagrams queued, a send_handler
+	//	is posted while this is not empty or the ring
+	//	has operations to submit
+	deferred_collection_type    deferred_;
+	bool                        sending_;
+	handler_storage             send_storage_;
+	std::size_t                 pool_size_;
+	//	Disconnected UDP sockets awaiting reuse by
+	//	address family
+	pool_collection_type        pool_v4_;
+	pool_collection_type        pool_v6_;
+	socket_options              socket_options_;
+	bool                        io_uring_;
+	bool                        ring_waiting_;
+	//	Destroyed first so that every operation in the
+	//	ring has completed before anything it references
+	//	is released
+	detail::uring               ring_;
+	using wait_handler = handler<decltype(&channel::complete_wait), &channel::complete_wait, true, nullptr, ares_socket_t, std::size_t, bool>;
+	using flush_handler = handler<decltype(&channel::flush), &channel::flush, true, nullptr>;
+	using drain_handler = handler<decltype(&channel::drain), &channel::drain, false, &channel::drain_storage_>;
+	using send_handler = handler<decltype(&channel::send_deferred), &channel::send_deferred, false, &channel::send_storage_>;
+	using ring_handler = handler<decltype(&channel::complete_ring), &channel::complete_ring, true, nullptr>;
+	using deadline_handler = handler<decltype(&channel::complete_deadline), &channel::complete_deadline, false, nullptr>;
 };
 
 }
@@ -0,0 +1,383 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <asio_cares/cache.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
+#include <asio_cares/submit.hpp>
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_alloc.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace asio_cares {
+
+/**
+ *	Owns several \ref channel objects each of which
+ *	has its own `strand` so that resolution may
+ *	proceed on several threads at once.
+ *
+ *	Queries are routed to a channel by the hash of
+ *	their question so that all queries for a certain
+ *	question go to the same channel (which allows
+ *	coalescing to remain effective), alternatively
+ *	the channel associated with the calling thread
+ *	may be used.
+ */
+class channel_pool {
+private:
+	using channels_type = std::vector<std::unique_ptr<channel>>;
+public:
+	channel_pool () = delete;
+	channel_pool (const channel_pool &) = delete;
+	channel_pool (channel_pool &&) = delete;
+	channel_pool & operator = (const channel_pool &) = delete;
+	channel_pool & operator = (channel_pool &&) = delete;
+	/**
+	 *	Creates a pool of channels which all use the
+	 *	same `io_service` (which would typically be run
+	 *	by several threads).
+	 *
+	 *	\param [in] ios
+	 *		The `io_service`. This reference must remain
+	 *		valid for the lifetime of the object.
+	 *	\param [in] size
+	 *		The number of channels. Must be at least one.
+	 *	\param [in] options
+	 *		See \ref channel.
+	 *	\param [in] optmask
+	 *		See \ref channel.
+	 */
+	channel_pool (boost::asio::io_service & ios, std::size_t size, const ares_options & options, int optmask);
+	/**
+	 *	Creates a pool of channels which all use the
+	 *	same `io_service` and default options.
+	 *
+	 *	\param [in] ios
+	 *		The `io_service`. This reference must remain
+	 *		valid for the lifetime of the object.
+	 *	\param [in] size
+	 *		The number of channels. Must be at least one.
+	 */
+	channel_pool (boost::asio::io_service & ios, std::size_t size);
+	/**
+	 *	Creates a pool with one channel per `io_service`
+	 *	(for example in a thread per core arrangement
+	 *	wherein each thread runs its own `io_service`).
+	 *
+	 *	\param [in] services
+	 *		The `io_service` objects, there must be at
+	 *		least one. They must remain valid for the
+	 *		lifetime of the object.
+	 *	\param [in] options
+	 *		See \ref channel.
+	 *	\param [in] optmask
+	 *		See \ref channel.
+	 */
+	channel_pool (const std::vector<boost::asio::io_service *> & services, const ares_options & options, int optmask);
+	/**
+	 *	Creates a pool with one channel per `io_service`
+	 *	and default options.
+	 *
+	 *	\param [in] services
+	 *		The `io_service` objects, there must be at
+	 *		least one. They must remain valid for the
+	 *		lifetime of the object.
+	 */
+	explicit channel_pool (const std::vector<boost::asio::io_service *> & services);
+	/**
+	 *	Retrieves the number of channels.
+	 *
+	 *	\return
+	 *		The number of channels.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Retrieves a channel.
+	 *
+	 *	\param [in] i
+	 *		The index of the channel.
+	 *
+	 *	\return
+	 *		A reference to a \ref channel.
+	 */
+	channel & operator [] (std::size_t i) noexcept;
+	/**
+	 *	\copydoc operator[]
+	 */
+	const channel & operator [] (std::size_t i) const noexcept;
+	/**
+	 *	Chooses a channel for a query by the hash
+	 *	of its question.
+	 *
+	 *	\param [in] qbuf
+	 *		The query.
+	 *	\param [in] qlen
+	 *		The length of the query.
+	 *
+	 *	\return
+	 *		A reference to a \ref channel. If the query
+	 *		is malformed \ref for_this_thread is used.
+	 */
+	channel & route (const unsigned char * qbuf, int qlen) noexcept;
+	/**
+	 *	Chooses a channel by the identity of the
+	 *	calling thread.
+	 *
+	 *	\return
+	 *		A reference to a \ref channel.
+	 */
+	channel & for_this_thread () noexcept;
+	/**
+	 *	Places a \ref cache in front of every channel.
+	 *	See \ref channel::set_cache.
+	 *
+	 *	\param [in] c
+	 *		A pointer to a \ref cache or a null pointer.
+	 */
+	void set_cache (cache * c) noexcept;
+	/**
+	 *	Enables or disables coalescing on every channel.
+	 *	See \ref channel::set_coalescing.
+	 *
+	 *	\param [in] enable
+	 *		\em true to enable, \em false to disable.
+	 */
+	void set_coalescing (bool enable) noexcept;
+private:
+	channels_type channels_;
+};
+
+/**
+ *	Determines whether any channel of a
+ *	\ref channel_pool has outstanding queries.
+ *
+ *	Only queries counted by \ref channel::outstanding
+ *	are considered, queries submitted directly through
+ *	libcares are not (contrast \ref done(const channel &)).
+ *	Accordingly this function may be invoked from any
+ *	thread, even while the channels are being driven
+ *	on their own `strand` objects.
+ *
+ *	\param [in] pool
+ *		The \ref channel_pool.
+ *
+ *	\return
+ *		\em true if no channel has outstanding
+ *		queries, \em false otherwise.
+ */
+bool done (const channel_pool & pool) noexcept;
+
+/**
+ *	Cancels all outstanding asynchronous operations
+ *	on every channel of a \ref channel_pool.
+ *
+ *	Each channel is cancelled (see \ref cancel) on
+ *	its own `strand`, accordingly cancellation may
+ *	take place after this function returns.
+ *
+ *	\param [in] pool
+ *		The \ref channel_pool. Must remain valid
+ *		until cancellation completes.
+ */
+void cancel (channel_pool & pool);
+
+namespace detail {
+
+template <typename Handler>
+class async_process_pool_state {
+private:
+	using allocator = beast::handler_alloc<async_process_pool_state, Handler>;
+	using allocator_traits = std::allocator_traits<allocator>;
+public:
+	async_process_pool_state () = delete;
+	async_process_pool_state (const async_process_pool_state &) = delete;
+	async_process_pool_state (async_process_pool_state &&) = delete;
+	async_process_pool_state & operator = (const async_process_pool_state &) = delete;
+	async_process_pool_state & operator = (async_process_pool_state &&) = delete;
+	static async_process_pool_state * create (Handler h, std::size_t pending) {
+		allocator alloc(h);
+		async_process_pool_state * retr = allocator_traits::allocate(alloc, 1);
+		try {
+			new (retr) async_process_pool_state(std::move(h), pending);
+		} catch (...) {
+			allocator_traits::deallocate(alloc, retr, 1);
+			throw;
+		}
+		return retr;
+	}
+	//	Channels complete on their own strands
+	//	which may run concurrently
+	void complete (boost::system::error_code ec) {
+		if (ec && !failed_.exchange(true, std::memory_order_relaxed)) ec_ = ec;
+		if (pending_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		auto result = ec_;
+		auto h = free();
+		h(result);
+	}
+	Handler & handler () noexcept {
+		return h_;
+	}
+private:
+	async_process_pool_state (Handler h, std::size_t pending) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_      (std::move(h)),
+			pending_(pending),
+			failed_ (false)
+	{}
+	~async_process_pool_state () = default;
+	Handler free () noexcept {
+		Handler retr(std::move(h_));
+		allocator alloc(retr);
+		this->~async_process_pool_state();
+		allocator_traits::deallocate(alloc, this, 1);
+		return retr;
+	}
+	Handler                   h_;
+	std::atomic<std::size_t>  pending_;
+	std::atomic<bool>         failed_;
+	boost::system::error_code ec_;
+};
+
+template <typename Handler>
+class async_process_pool_op {
+public:
+	async_process_pool_op () = delete;
+	async_process_pool_op (const async_process_pool_op &) = default;
+	async_process_pool_op (async_process_pool_op &&) = default;
+	async_process_pool_op & operator = (const async_process_pool_op &) = default;
+	async_process_pool_op & operator = (async_process_pool_op &&) = default;
+	explicit async_process_pool_op (async_process_pool_state<Handler> & state) noexcept
+		:	state_(&state)
+	{}
+	void operator () (boost::system::error_code ec) {
+		state_->complete(ec);
+	}
+	//	Allocation is not forwarded since the
+	//	operations for each channel may run
+	//	concurrently
+	template <typename Function>
+	friend void asio_handler_invoke (Function && function, async_process_pool_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(function, std::addressof(self->state_->handler()));
+	}
+private:
+	async_process_pool_state<Handler> * state_;
+};
+
+}
+
+/**
+ *	Processes every channel of a \ref channel_pool
+ *	(see \ref async_process) until none has outstanding
+ *	queries.
+ *
+ *	The completion handler is invoked on the `strand`
+ *	of the channel whose processing completes last
+ *	and receives the first error encountered (if any).
+ *
+ *	\tparam CompletionToken
+ *		A type which represents the action to take
+ *		upon the completion of the asynchronous
+ *		operation and which determines the return
+ *		value (if any) of this initiating function.
+ *
+ *	\param [in] pool
+ *		The \ref channel_pool. This reference must
+ *		remain valid for the lifetime of the asynchronous
+ *		operation.
+ *	\param [in] token
+ *		The token which encapsulates the action to
+ *		take upon completion of the asynchronous
+ *		operation. The completion of this asynchronous
+ *		operation generates one value of type
+ *		`boost::system::error_code` which represents
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_process (channel_pool & pool, CompletionToken && token) {
+	beast::async_completion<CompletionToken, detail::async_process_signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, detail::async_process_signature>;
+	using state_type = detail::async_process_pool_state<handler_type>;
+	using op_type = detail::async_process_pool_op<handler_type>;
+	auto state = state_type::create(std::move(init.completion_handler), pool.size());
+	//	Each channel must be driven from its own
+	//	strand
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		auto && c = pool[i];
+		c.get_strand().dispatch([&c, state] () {
+			async_process(c, op_type(*state));
+		});
+	}
+	return init.result.get();
+}
+
+/**
+ *	Sends a query (see \ref async_send) on the
+ *	channel of a \ref channel_pool chosen by
+ *	\ref channel_pool::route.
+ *
+ *	Must be invoked on the `strand` of the chosen
+ *	channel (see \ref channel_pool::route) as with
+ *	\ref async_send.
+ *
+ *	\param [in] pool
+ *		The \ref channel_pool.
+ *	\param [in] qbuf
+ *		See \ref async_send.
+ *	\param [in] qlen
+ *		See \ref async_send.
+ *	\param [in] token
+ *		See \ref async_send.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_send (channel_pool & pool, const unsigned char * qbuf, int qlen, CompletionToken && token) {
+	return async_send(pool.route(qbuf, qlen), qbuf, qlen, std::forward<CompletionToken>(token));
+}
+
+/**
+ *	Submits a query (see \ref async_submit) to the
+ *	channel of a \ref channel_pool chosen by
+ *	\ref channel_pool::route. May be invoked from
+ *	any thread.
+ *
+ *	\param [in] pool
+ *		The \ref channel_pool.
+ *	\param [in] qbuf
+ *		See \ref async_submit.
+ *	\param [in] qlen
+ *		See \ref async_submit.
+ *	\param [in] token
+ *		See \ref async_submit.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_submit (channel_pool & pool, const unsigned char * qbuf, int qlen, CompletionToken && token) {
+	return async_submit(pool.route(qbuf, qlen), qbuf, qlen, std::forward<CompletionToken>(token));
+}
+
+}
@@ -0,0 +1,50 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/channel.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <beast/core/handler_alloc.hpp>
+#include <cstddef>
+#include <memory>
+
+namespace asio_cares {
+namespace detail {
+
+//	The state of an operation is allocated from
+//	the memory resource of the channel if one was
+//	provided, otherwise allocation is customized
+//	by the completion handler. Space for a number
+//	of extra bytes may be requested, they follow
+//	the state
+
+template <typename T>
+constexpr std::size_t state_count (std::size_t extra) noexcept {
+	return 1 + ((extra + sizeof(T) - 1) / sizeof(T));
+}
+
+template <typename T, typename Handler>
+T * allocate_state (channel & c, Handler & h, std::size_t extra = 0) {
+	auto num = state_count<T>(extra);
+	if (auto r = c.get_memory_resource()) return static_cast<T *>(r->allocate(num * sizeof(T), alignof(T)));
+	using allocator = beast::handler_alloc<T, Handler>;
+	allocator alloc(h);
+	return std::allocator_traits<allocator>::allocate(alloc, num);
+}
+
+template <typename T, typename Handler>
+void deallocate_state (channel & c, Handler & h, T * ptr, std::size_t extra = 0) noexcept {
+	auto num = state_count<T>(extra);
+	if (auto r = c.get_memory_resource()) {
+		r->deallocate(ptr, num * sizeof(T), alignof(T));
+		return;
+	}
+	using allocator = beast::handler_alloc<T, Handler>;
+	allocator alloc(h);
+	std::allocator_traits<allocator>::deallocate(alloc, ptr, num);
+}
+
+}
+}
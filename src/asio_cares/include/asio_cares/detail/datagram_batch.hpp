@@ -0,0 +1,108 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../memory_resource.hpp"
+#include <ares.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace asio_cares {
+namespace detail {
+
+//	Receives and sends the datagrams of a UDP socket
+//	in batches of up to size per system call using
+//	recvmmsg and sendmmsg (where they are available,
+//	elsewhere each datagram is received or sent by
+//	itself).
+//
+//	Receiving fills a ring of buffers which is then
+//	consumed one datagram at a time, the first datagram
+//	of each batch is received directly into the caller's
+//	buffer but the others are limited to receive_size
+//	bytes and truncated beyond that. Datagrams which
+//	arrive truncated (whether by the kernel or because
+//	the caller's buffer is too small) have their TC bit
+//	set so that libcares retries over TCP.
+//
+//	Sending copies each datagram (of at most send_size
+//	bytes) into a queue which is sent all at once.
+//
+//	Storage is only allocated the first time it is
+//	needed and if it cannot be allocated datagrams are
+//	received or sent one at a time.
+//
+//	The count of dropped datagrams the kernel attaches
+//	to each datagram when SO_RXQ_OVFL is set is noted
+//	as datagrams are received.
+class datagram_batch {
+public:
+	static constexpr std::size_t size = 16;
+	static constexpr std::size_t receive_size = 4096;
+	static constexpr std::size_t send_size = 512;
+	explicit datagram_batch (memory_resource & r) noexcept;
+	datagram_batch (const datagram_batch &) = delete;
+	datagram_batch & operator = (const datagram_batch &) = delete;
+	~datagram_batch () noexcept;
+	//	Behaves as ::recvfrom with no flags (returning -1
+	//	and setting errno on failure) except that datagrams
+	//	may come from the ring, syscalls is incremented by
+	//	the number of system calls made
+	ares_ssize_t receive (ares_socket_t fd,
+	                      void * buffer,
+	                      std::size_t len,
+	                      struct sockaddr * addr,
+	                      ares_socklen_t * addr_len,
+	                      std::size_t & syscalls) noexcept;
+	//	The number of datagrams in the ring
+	std::size_t received () const noexcept;
+	//	The highest count of dropped datagrams attached
+	//	to any datagram received, zero if none was
+	std::uint32_t dropped () const noexcept;
+	//	Copies a datagram into the queue, false if it
+	//	is too large or the queue is full (in which case
+	//	the queue must be sent before the datagram is
+	//	sent by itself so that order is preserved)
+	bool queue (const struct iovec * data, int len) noexcept;
+	//	The number of datagrams in the queue
+	std::size_t queued () const noexcept;
+	//	Sends every datagram in the queue and returns
+	//	the number of system calls made, datagrams which
+	//	cannot be sent are dropped (as though they were
+	//	lost in transit)
+	std::size_t send (ares_socket_t fd) noexcept;
+	//	Whether datagrams are actually batched on this
+	//	platform
+	static bool supported () noexcept;
+	//	Receives a single datagram as ::recvfrom with
+	//	no flags except that dropped is raised to the
+	//	count of dropped datagrams attached thereto (if
+	//	any)
+	static ares_ssize_t receive_one (ares_socket_t fd,
+	                                 void * buffer,
+	                                 std::size_t len,
+	                                 struct sockaddr * addr,
+	                                 ares_socklen_t * addr_len,
+	                                 std::uint32_t & dropped) noexcept;
+	//	The count of dropped datagrams attached to a
+	//	received datagram, zero if none is
+	static std::uint32_t drop_count (const struct msghdr & msg) noexcept;
+	//	Sets the TC bit of a DNS message of which
+	//	only the first len bytes were received
+	static void truncate (void * buffer, std::size_t len) noexcept;
+private:
+	class receive_state;
+	class send_state;
+	memory_resource * r_;
+	receive_state *   receive_;
+	send_state *      send_;
+	std::size_t       head_;
+	std::size_t       received_;
+	std::size_t       queued_;
+	std::uint32_t     dropped_;
+};
+
+}
+}
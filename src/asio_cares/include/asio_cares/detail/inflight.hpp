@@ -0,0 +1,49 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/detail/parse.hpp>
+
+namespace asio_cares {
+
+class channel;
+
+namespace detail {
+
+//	An operation which joined a query already
+//	in flight with the same key rather than
+//	sending its own
+class send_waiter {
+public:
+	send_waiter () noexcept
+		:	next(nullptr)
+	{}
+	send_waiter (const send_waiter &) = delete;
+	send_waiter & operator = (const send_waiter &) = delete;
+	//	The answer is shared by every waiter and
+	//	therefore carries the ID of the query which
+	//	was sent and must not be modified (see
+	//	channel::set_coalescing)
+	virtual void complete (int status, int timeouts, const buffer & answer) = 0;
+	send_waiter * next;
+protected:
+	~send_waiter () = default;
+};
+
+class inflight {
+public:
+	question_key  key;
+	send_waiter * head;
+	send_waiter * tail;
+};
+
+//	Completes every operation attached to a query
+//	(see channel::end_inflight) which completed
+//	with one copy of the answer
+void complete_waiters (channel & c, send_waiter * waiter, int status, int timeouts, const unsigned char * abuf, int alen) noexcept;
+
+}
+}
@@ -0,0 +1,89 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/arena.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+
+namespace asio_cares {
+namespace detail {
+
+//	A minimal DNS wire format reader, every
+//	function returns a libcares status code
+
+class resource_record {
+public:
+	int         type;
+	int         dns_class;
+	int         ttl;
+	std::size_t rdata;
+	std::size_t rdlength;
+};
+
+//	Validates the header, maps the RCODE to a
+//	status in the manner of ares_query, and skips
+//	the question section leaving offset at the
+//	first answer
+int begin_answers (const unsigned char * msg, std::size_t len, std::size_t & offset, std::size_t & count) noexcept;
+
+//	Reads the fixed portion of the record at offset
+//	and advances offset past the record
+int next_record (const unsigned char * msg, std::size_t len, std::size_t & offset, resource_record & rr) noexcept;
+
+//	Reads a possibly compressed name at offset,
+//	expands it in dotted form (without a trailing
+//	dot) into the arena, and advances offset past
+//	the name
+int read_name (const unsigned char * msg, std::size_t len, std::size_t & offset, arena & a, boost::string_ref & name);
+
+int skip_name (const unsigned char * msg, std::size_t len, std::size_t & offset) noexcept;
+
+//	Encodes a standard recursive query for name in
+//	class IN, on success len is set to the length of
+//	the query
+int create_query (const char * name, int type, unsigned char * buf, std::size_t & len) noexcept;
+
+//	Large enough for any query create_query
+//	produces
+constexpr std::size_t max_query_size = 12 + 256 + 4;
+
+//	Identifies a question irrespective of the case
+//	of the name: the name in wire format (lower case)
+//	followed by the type and class and then a byte
+//	holding the RD, CD, and DO bits (which a response
+//	carries as did the query it answers)
+class question_key {
+public:
+	//	Room for the header flags and an OPT record
+	//	with 128 bytes of options (see make_query_key)
+	static constexpr std::size_t max_size = 255 + 4 + 1 + 2 + 8 + 128;
+	unsigned char data [max_size];
+	std::size_t   size;
+	std::size_t   hash;
+	//	The offset of the end of the question
+	std::size_t   end;
+	bool operator == (const question_key &) const noexcept;
+};
+
+//	Builds the key from the sole question of a
+//	message, fails if the OPCODE is not QUERY, if
+//	there is not exactly one question or it is
+//	compressed, or if any record is malformed
+bool make_question_key (const unsigned char * msg, std::size_t len, question_key & k) noexcept;
+
+//	Builds a key which identifies a query in
+//	full save for its ID and the case of the name:
+//	the key of its question followed by the flags
+//	of its header and its OPT record (if any) less
+//	the owner name, fails where make_question_key
+//	does or if the query has any other record
+bool make_query_key (const unsigned char * msg, std::size_t len, question_key & k) noexcept;
+
+unsigned short read_16 (const unsigned char *) noexcept;
+unsigned long read_32 (const unsigned char *) noexcept;
+
+}
+}
@@ -0,0 +1,86 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+//	Statically defined tracepoints (USDT) in the
+//	asio_cares provider, available to SystemTap,
+//	bpftrace, perf, et cetera when the library is
+//	built with ASIO_CARES_PROBES defined (which
+//	requires <sys/sdt.h>). Otherwise the probes
+//	expand to nothing. Even when present a probe
+//	which is not being traced is a single nop and
+//	its arguments are merely made available in
+//	registers or memory.
+//
+//	The probes and their arguments are:
+//
+//	send__submit   (op)                 async_submit queued an operation
+//	                                    for the strand
+//	send__start    (op)                 An operation began to be sent on
+//	                                    the strand (consulting the cache
+//	                                    et cetera)
+//	query__send    (op)                 ares_send is about to be invoked
+//	query__done    (op, status, timeouts)
+//	                                    libcares completed the query
+//	send__handler  (op, status)         The completion handler is about
+//	                                    to be invoked
+//	socket__open   (fd, udp)            libcares opened a socket
+//	socket__close  (fd)                 libcares closed a socket
+//	socket__drop   (fd, num)            The kernel reported that it
+//	                                    dropped datagrams destined for
+//	                                    a socket
+//	select__arm    (fd, write)          A wait for readiness began
+//	select__wake   (fd, write, error)   A wait for readiness completed,
+//	                                    fd is -1 for the timer
+//	select__cancel (fd)                 Waits on a socket were cancelled,
+//	                                    fd is -1 for the timer
+//	timer__arm     (us)                 The timer was set to expire
+//	process__entry (num)                Ready sockets are about to be
+//	                                    handed to libcares
+//	process__return(num)                libcares processed them
+//
+//	op is the address of the state of the operation
+//	and is only meaningful as a key which correlates
+//	probes for the same operation.
+#ifdef ASIO_CARES_PROBES
+
+#include <sys/sdt.h>
+
+#define ASIO_CARES_PROBE1(name, a) DTRACE_PROBE1(asio_cares, name, a)
+#define ASIO_CARES_PROBE2(name, a, b) DTRACE_PROBE2(asio_cares, name, a, b)
+#define ASIO_CARES_PROBE3(name, a, b, c) DTRACE_PROBE3(asio_cares, name, a, b, c)
+
+#else
+
+#define ASIO_CARES_PROBE1(name, a) ((void)0)
+#define ASIO_CARES_PROBE2(name, a, b) ((void)0)
+#define ASIO_CARES_PROBE3(name, a, b, c) ((void)0)
+
+#endif
+
+namespace asio_cares {
+namespace detail {
+
+//	Identifies an operation to probes which fire
+//	after its state has been destroyed, empty if
+//	there are no probes
+class probe_id {
+public:
+	#ifdef ASIO_CARES_PROBES
+	probe_id () noexcept
+		:	ptr(nullptr)
+	{}
+	explicit probe_id (const void * ptr) noexcept
+		:	ptr(ptr)
+	{}
+	const void * ptr;
+	#else
+	probe_id () = default;
+	explicit probe_id (const void *) noexcept {}
+	#endif
+};
+
+}
+}
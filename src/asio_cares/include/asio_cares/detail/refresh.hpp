@@ -0,0 +1,23 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/channel.hpp>
+
+namespace asio_cares {
+namespace detail {
+
+//	Sends a query on behalf of the cache of a
+//	channel so that the response thereto replaces
+//	the retained response before it expires, no
+//	completion handler is involved and failures are
+//	ignored (the retained response simply expires),
+//	if coalescing is enabled the refresh joins or
+//	leads an identical query as would
+//	\ref async_send
+void refresh (channel & c, const unsigned char * qbuf, int qlen) noexcept;
+
+}
+}
@@ -5,6 +5,9 @@
 #pragma once
 
 #include "../channel.hpp"
+#include "../memory_resource.hpp"
+#include "../process_fds.hpp"
+#include "probe.hpp"
 #include <ares.h>
 #include <beast/core/async_result.hpp>
 #include <beast/core/handler_ptr.hpp>
@@ -12,27 +15,33 @@
 #include <boost/asio/handler_continuation_hook.hpp>
 #include <boost/asio/handler_invoke_hook.hpp>
 #include <boost/asio/buffer.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/optional.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/system/system_error.hpp>
 #include <mpark/variant.hpp>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <new>
 #include <utility>
+#include <vector>
 
 namespace asio_cares {
 namespace detail {
 
-using async_select_signature = void (boost::system::error_code, ares_socket_t, ares_socket_t);
+using select_result_type = std::vector<socket_events, polymorphic_allocator<socket_events>>;
+using async_select_signature = void (boost::system::error_code, select_result_type);
 
 template <typename Handler>
 class async_select_op {
 private:
 	class readable_tag {};
 	class writable_tag {};
+	class buffered_tag {};
+	class ring_tag {};
 public:
 	async_select_op () = delete;
 	async_select_op (const async_select_op &) = default;
@@ -44,19 +53,38 @@ public:
 		:	ptr_(std::forward<DeducedHandler>(h), c)
 	{}
 	void operator () (boost::system::error_code ec, ares_socket_t socket, const readable_tag &) {
+		ASIO_CARES_PROBE3(select__wake, int(socket), 0, ec.value());
 		common(ec);
-		if (!ec && (ptr_->read == ARES_SOCKET_BAD)) ptr_->read = socket;
+		//	Sockets which became ready before the others
+		//	were cancelled are gathered so they may all
+		//	be processed together
+		if (!ec) ptr_->ready.emplace_back(socket, true, false);
 		upcall();
 	}
 	void operator () (boost::system::error_code ec, ares_socket_t socket, const writable_tag &) {
+		ASIO_CARES_PROBE3(select__wake, int(socket), 1, ec.value());
 		common(ec);
-		if (!ec && (ptr_->write == ARES_SOCKET_BAD)) ptr_->write = socket;
+		if (!ec) ptr_->ready.emplace_back(socket, false, true);
 		upcall();
 	}
 	void operator () (boost::system::error_code ec) {
+		ASIO_CARES_PROBE3(select__wake, -1, 0, ec.value());
 		common(ec);
 		upcall();
 	}
+	//	The sockets were gathered before anything
+	//	was waited upon
+	void operator () (boost::system::error_code ec, ares_socket_t, const buffered_tag &) {
+		common(ec);
+		upcall();
+	}
+	void operator () (boost::system::error_code ec, ares_socket_t, const ring_tag &) {
+		ASIO_CARES_PROBE3(select__wake, -1, 0, ec.value());
+		common(ec);
+		ptr_->ring = false;
+		if (!ec) gather();
+		upcall();
+	}
 	void begin () {
 		try {
 			begin_impl();
@@ -102,12 +130,43 @@ private:
 	Handler * handler_pointer () noexcept {
 		return std::addressof(ptr_.handler());
 	}
+	//	Gathers the sockets with datagrams which were
+	//	received by the channel rather than waiting
+	//	in the socket
+	void gather () noexcept {
+		try {
+			ptr_->channel.for_each_buffered([&] (ares_socket_t socket) {
+				ptr_->ready.emplace_back(socket, true, false);
+			});
+		} catch (...) {
+			set_error(make_error_code(boost::system::errc::not_enough_memory));
+		}
+	}
 	void begin_impl () {
-		for (std::size_t i = 0; i < ARES_GETSOCK_MAXNUM; ++i) {
-			bool readable = ARES_GETSOCK_READABLE(ptr_->flags, i);
-			bool writable = ARES_GETSOCK_WRITABLE(ptr_->flags, i);
-			if (!(readable || writable)) continue;
-			auto ares_socket = ptr_->sockets[i];
+		//	Reserving up front means gathering ready
+		//	sockets cannot fail
+		std::size_t num = 0;
+		std::size_t readable_num = 0;
+		ptr_->channel.for_each_interest([&] (ares_socket_t, bool readable, bool writable) noexcept {
+			if (readable) ++readable_num;
+			if (writable) ++num;
+		});
+		ptr_->ready.reserve(num + (readable_num * 2));
+		//	Datagrams the channel has already received
+		//	may never cause their sockets to become
+		//	readable so they are processed at once
+		gather();
+		if (!ptr_->ready.empty()) {
+			ptr_->channel.get_strand().post(buffered_wrapper(*this, ARES_SOCKET_BAD));
+			++ptr_->pending;
+			return;
+		}
+		if (ptr_->channel.async_wait_uring(ptr_->channel.get_strand().wrap(ring_wrapper(*this, ARES_SOCKET_BAD)))) {
+			++ptr_->pending;
+			ptr_->ring = true;
+			ASIO_CARES_PROBE2(select__arm, -1, 0);
+		}
+		ptr_->channel.for_each_interest([&] (ares_socket_t ares_socket, bool readable, bool writable) {
 			ptr_->channel.acquire_socket(ares_socket).unwrap([&] (auto & socket) {
 				boost::asio::null_buffers buffers;
 				auto && strand = ptr_->channel.get_strand();
@@ -115,23 +174,25 @@ private:
 					read_wrapper w(*this, ares_socket);
 					socket.async_receive(buffers, strand.wrap(std::move(w)));
 					++ptr_->pending;
+					ASIO_CARES_PROBE2(select__arm, int(ares_socket), 0);
 				}
 				if (writable) {
 					write_wrapper w(*this, ares_socket);
 					socket.async_send(buffers, strand.wrap(std::move(w)));
 					++ptr_->pending;
+					ASIO_CARES_PROBE2(select__arm, int(ares_socket), 1);
 				}
 			});
-		}
+		});
 		struct timeval tv;
 		if (ares_timeout(ptr_->channel, nullptr, &tv)) {
-			boost::posix_time::time_duration d;
-			d += boost::posix_time::seconds(tv.tv_sec);
-			d += boost::posix_time::microseconds(tv.tv_usec);
+			auto d = std::chrono::duration_cast<boost::asio::steady_timer::duration>(std::chrono::seconds(tv.tv_sec) +
+			                                                                         std::chrono::microseconds(tv.tv_usec));
 			auto && timer = ptr_->channel.get_timer();
 			timer.expires_from_now(d);
 			timer.async_wait(ptr_->channel.get_strand().wrap(*this));
 			++ptr_->pending;
+			ASIO_CARES_PROBE1(timer__arm, std::int64_t(tv.tv_sec) * 1000000 + tv.tv_usec);
 		}
 	}
 	void common (boost::system::error_code ec) noexcept {
@@ -150,20 +211,22 @@ private:
 		}
 		assert(ptr_->completion);
 		auto ec = *ptr_->completion;
-		auto read = ptr_->read;
-		auto write = ptr_->write;
-		ptr_.invoke(ec, read, write);
+		auto ready = std::move(ptr_->ready);
+		ptr_.invoke(ec, std::move(ready));
 	}
 	void cancel () noexcept {
 		if (ptr_->cancelled) return;
 		ptr_->channel.for_each_socket([&] (auto & socket) noexcept {
 			boost::system::error_code ec;
 			socket.cancel(ec);
+			ASIO_CARES_PROBE1(select__cancel, int(socket.native_handle()));
 			this->set_error(ec);
 		});
 		boost::system::error_code ec;
 		ptr_->channel.get_timer().cancel(ec);
+		ASIO_CARES_PROBE1(select__cancel, -1);
 		set_error(ec);
+		if (ptr_->ring) ptr_->channel.cancel_uring_wait();
 		ptr_->cancelled = true;
 	}
 	class state {
@@ -175,22 +238,20 @@ private:
 		state & operator = (state &&) = delete;
 		state (const Handler &, asio_cares::channel & c)
 			:	channel  (c),
-				read     (ARES_SOCKET_BAD),
-				write    (ARES_SOCKET_BAD),
+				ready    (c.get_memory_resource() ? *c.get_memory_resource() : new_delete_resource()),
 				pending  (0),
-				cancelled(false)
-		{
-			flags = ares_getsock(channel, sockets, ARES_GETSOCK_MAXNUM);
-		}
+				cancelled(false),
+				ring     (false)
+		{}
 		asio_cares::channel &                      channel;
-		ares_socket_t                              read;
-		ares_socket_t                              write;
+		select_result_type                         ready;
 		std::size_t                                pending;
 		boost::optional<boost::system::error_code> completion;
 		boost::system::error_code                  error_code;
-		ares_socket_t                              sockets [ARES_GETSOCK_MAXNUM];
-		int                                        flags;
 		bool                                       cancelled;
+		//	Whether the ring of the channel is waited
+		//	upon
+		bool                                       ring;
 	};
 	template <typename Tag>
 	class wrapper {
@@ -208,6 +269,9 @@ private:
 		void operator () (boost::system::error_code ec, const Args &...) {
 			inner_(ec, socket_, Tag{});
 		}
+		void operator () () {
+			inner_(boost::system::error_code(), socket_, Tag{});
+		}
 		friend void * asio_handler_allocate (std::size_t num, wrapper * self) {
 			assert(self);
 			using boost::asio::asio_handler_allocate;
@@ -235,6 +299,8 @@ private:
 	};
 	using read_wrapper = wrapper<readable_tag>;
 	using write_wrapper = wrapper<writable_tag>;
+	using buffered_wrapper = wrapper<buffered_tag>;
+	using ring_wrapper = wrapper<ring_tag>;
 	using pointer = beast::handler_ptr<state, Handler>;
 	pointer ptr_;
 };
@@ -0,0 +1,177 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../memory_resource.hpp"
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace asio_cares {
+namespace detail {
+
+//	A map from socket descriptors to values which
+//	indexes directly by descriptor (descriptors are
+//	small, dense integers) rather than searching.
+//	Values live in fixed size chunks which are never
+//	moved or freed until the table is destroyed so
+//	their addresses are stable and finding, inserting,
+//	and erasing are all O(1). The values which are
+//	present are also tracked densely so iterating
+//	does not visit empty slots (but is in no particular
+//	order and is invalidated by inserting or erasing).
+template <typename T>
+class socket_table {
+private:
+	static constexpr std::size_t chunk_size = 64;
+	static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+	class chunk {
+	public:
+		chunk () noexcept {
+			for (auto && i : index) i = npos;
+		}
+		T * get (std::size_t i) noexcept {
+			return reinterpret_cast<T *>(&storage[i]);
+		}
+		//	The position of each value in the dense
+		//	collection, npos if the slot is empty
+		std::size_t                                                 index [chunk_size];
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage [chunk_size];
+	};
+	class entry {
+	public:
+		std::size_t key;
+		T *         value;
+	};
+	using chunks_type = std::vector<chunk *, polymorphic_allocator<chunk *>>;
+	using entries_type = std::vector<entry, polymorphic_allocator<entry>>;
+public:
+	class iterator {
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = T;
+		using pointer = T *;
+		using reference = T &;
+		using iterator_category = std::forward_iterator_tag;
+		iterator () noexcept
+			:	ptr_(nullptr)
+		{}
+		explicit iterator (entry * ptr) noexcept
+			:	ptr_(ptr)
+		{}
+		T & operator * () const noexcept {
+			return *ptr_->value;
+		}
+		T * operator -> () const noexcept {
+			return ptr_->value;
+		}
+		iterator & operator ++ () noexcept {
+			++ptr_;
+			return *this;
+		}
+		iterator operator ++ (int) noexcept {
+			auto retr = *this;
+			++ptr_;
+			return retr;
+		}
+		bool operator == (const iterator & rhs) const noexcept {
+			return ptr_ == rhs.ptr_;
+		}
+		bool operator != (const iterator & rhs) const noexcept {
+			return ptr_ != rhs.ptr_;
+		}
+	private:
+		entry * ptr_;
+	};
+	explicit socket_table (memory_resource & r) noexcept
+		:	r_      (&r),
+			chunks_ (r),
+			entries_(r)
+	{}
+	socket_table (const socket_table &) = delete;
+	socket_table & operator = (const socket_table &) = delete;
+	~socket_table () noexcept {
+		for (auto && e : entries_) e.value->~T();
+		for (auto c : chunks_) if (c) {
+			c->~chunk();
+			r_->deallocate(c, sizeof(chunk), alignof(chunk));
+		}
+	}
+	//	There must not already be a value for the key,
+	//	if this throws the table is unchanged (other
+	//	than perhaps having allocated storage)
+	template <typename... Args>
+	T & emplace (std::size_t key, Args &&... args) {
+		auto && c = get_chunk(key / chunk_size);
+		auto i = key % chunk_size;
+		assert(c.index[i] == npos);
+		entries_.reserve(entries_.size() + 1);
+		auto ptr = c.get(i);
+		new (ptr) T(std::forward<Args>(args)...);
+		c.index[i] = entries_.size();
+		entries_.push_back(entry{key, ptr});
+		return *ptr;
+	}
+	T * find (std::size_t key) noexcept {
+		auto n = key / chunk_size;
+		if (n >= chunks_.size()) return nullptr;
+		auto c = chunks_[n];
+		if (!c) return nullptr;
+		auto i = key % chunk_size;
+		if (c->index[i] == npos) return nullptr;
+		return c->get(i);
+	}
+	//	There must be a value for the key
+	void erase (std::size_t key) noexcept {
+		auto && c = *chunks_[key / chunk_size];
+		auto i = key % chunk_size;
+		auto index = c.index[i];
+		assert(index != npos);
+		c.get(i)->~T();
+		c.index[i] = npos;
+		//	The last entry fills the hole
+		auto && last = entries_.back();
+		if (index != (entries_.size() - 1)) {
+			entries_[index] = last;
+			chunks_[last.key / chunk_size]->index[last.key % chunk_size] = index;
+		}
+		entries_.pop_back();
+	}
+	std::size_t size () const noexcept {
+		return entries_.size();
+	}
+	bool empty () const noexcept {
+		return entries_.empty();
+	}
+	iterator begin () noexcept {
+		return iterator(entries_.data());
+	}
+	iterator end () noexcept {
+		return iterator(entries_.data() + entries_.size());
+	}
+private:
+	chunk & get_chunk (std::size_t n) {
+		if (n >= chunks_.size()) chunks_.resize(n + 1, nullptr);
+		auto && retr = chunks_[n];
+		if (!retr) retr = new (r_->allocate(sizeof(chunk), alignof(chunk))) chunk();
+		return *retr;
+	}
+	memory_resource * r_;
+	chunks_type       chunks_;
+	entries_type      entries_;
+};
+
+template <typename T>
+constexpr std::size_t socket_table<T>::chunk_size;
+template <typename T>
+constexpr std::size_t socket_table<T>::npos;
+
+}
+}
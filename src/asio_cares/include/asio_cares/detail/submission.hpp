@@ -0,0 +1,68 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace asio_cares {
+namespace detail {
+
+//	An operation handed to a channel from an
+//	arbitrary thread which shall be run later on
+//	its strand
+class submission {
+public:
+	submission () noexcept
+		:	next(nullptr)
+	{}
+	submission (const submission &) = delete;
+	submission & operator = (const submission &) = delete;
+	virtual void run () noexcept = 0;
+	std::atomic<submission *> next;
+protected:
+	~submission () = default;
+};
+
+//	An intrusive multiple producer single consumer
+//	queue after Dmitry Vyukov. Pushing costs one
+//	exchange (to link the submission) plus one
+//	increment (which tells the producer whether the
+//	consumer must be woken) and never blocks, the
+//	consumer never contends with producers for
+//	anything but the last submission
+class submission_queue {
+public:
+	submission_queue () noexcept;
+	submission_queue (const submission_queue &) = delete;
+	submission_queue & operator = (const submission_queue &) = delete;
+	//	May be invoked from any thread, returns true
+	//	if the queue was idle in which case the caller
+	//	must arrange for it to be drained
+	bool push (submission & s) noexcept;
+	//	Consumer only, returns a null pointer if the
+	//	queue is empty or the next submission is not
+	//	yet linked
+	submission * pop () noexcept;
+	//	Consumer only, records that a number of
+	//	submissions have been popped and returns true
+	//	if more have been pushed since
+	bool consume (std::size_t num) noexcept;
+	//	The number of submissions pushed and not yet
+	//	consumed, may be invoked from any thread
+	std::size_t size () const noexcept;
+private:
+	class stub_type final : public submission {
+	public:
+		virtual void run () noexcept override {}
+	};
+	std::atomic<std::size_t>  pending_;
+	std::atomic<submission *> head_;
+	submission *              tail_;
+	stub_type                 stub_;
+};
+
+}
+}
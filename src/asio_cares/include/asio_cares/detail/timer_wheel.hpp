@@ -0,0 +1,97 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace asio_cares {
+namespace detail {
+
+//	Something with a deadline, intrusively linked
+//	into a timer_wheel
+class timer_wheel_entry {
+public:
+	timer_wheel_entry () noexcept
+		:	prev  (nullptr),
+			next  (nullptr),
+			tick  (0),
+			level (0),
+			slot  (0),
+			linked(false)
+	{}
+	timer_wheel_entry (const timer_wheel_entry &) = delete;
+	timer_wheel_entry & operator = (const timer_wheel_entry &) = delete;
+	//	Invoked once the deadline passes, by which
+	//	time the entry has been removed
+	virtual void expire () = 0;
+	timer_wheel_entry * prev;
+	timer_wheel_entry * next;
+	std::uint64_t       tick;
+	unsigned char       level;
+	unsigned char       slot;
+	bool                linked;
+protected:
+	~timer_wheel_entry () = default;
+};
+
+//	A hierarchical timer wheel: Each of four levels
+//	has 64 slots, each slot of a level spans all
+//	the slots of the level below, and entries are
+//	moved down a level each time the level below
+//	wraps. Inserting and removing entries is O(1)
+//	regardless of how many there are. A bitmap of
+//	occupied slots per level locates the next slot
+//	which is due or must be moved down without
+//	visiting empty slots, so a wheel whose entries
+//	are far off only needs attention once per level
+//	they pass through. Deadlines beyond the span of
+//	the wheel are parked in the top level until they
+//	come within range.
+class timer_wheel {
+public:
+	using clock = std::chrono::steady_clock;
+	explicit timer_wheel (clock::duration resolution = std::chrono::milliseconds(1), clock::time_point origin = clock::now()) noexcept;
+	timer_wheel (const timer_wheel &) = delete;
+	timer_wheel & operator = (const timer_wheel &) = delete;
+	//	The entry must not be linked, deadlines which
+	//	have already passed expire upon the next tick
+	void insert (timer_wheel_entry & e, clock::time_point deadline) noexcept;
+	//	The entry must be linked
+	void remove (timer_wheel_entry & e) noexcept;
+	//	Removes and returns an entry whose deadline
+	//	is at or before now, or returns null if there
+	//	are none (expire is not invoked). Entries are
+	//	removed one at a time so that expiring one may
+	//	remove or insert others.
+	timer_wheel_entry * pop (clock::time_point now) noexcept;
+	//	The earliest time at which pop may return
+	//	an entry or need to move entries between levels,
+	//	the maximum time point if the wheel is empty
+	clock::time_point next_expiry () const noexcept;
+	std::size_t size () const noexcept;
+	bool empty () const noexcept;
+private:
+	static constexpr std::size_t bits = 6;
+	static constexpr std::size_t slots = std::size_t(1) << bits;
+	static constexpr std::size_t levels = 4;
+	using level_type = std::array<timer_wheel_entry *, slots>;
+	std::uint64_t to_tick (clock::time_point, bool) const noexcept;
+	std::uint64_t next_tick () const noexcept;
+	void place (timer_wheel_entry &) noexcept;
+	void unlink (timer_wheel_entry &) noexcept;
+	void cascade (std::size_t level) noexcept;
+	clock::duration                   resolution_;
+	clock::time_point                 origin_;
+	std::uint64_t                     current_;
+	std::size_t                       size_;
+	std::array<level_type, levels>    levels_;
+	std::array<std::uint64_t, levels> occupied_;
+};
+
+}
+}
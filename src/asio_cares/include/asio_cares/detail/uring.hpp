@@ -0,0 +1,199 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../memory_resource.hpp"
+#include <ares.h>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef ASIO_CARES_IO_URING
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
+namespace asio_cares {
+namespace detail {
+
+//	An operation submitted to a uring, complete is
+//	invoked with the result of the operation (a
+//	negated errno value on failure) once it has been
+//	reaped from the completion queue
+class uring_operation {
+public:
+	uring_operation () = default;
+	uring_operation (const uring_operation &) = delete;
+	uring_operation & operator = (const uring_operation &) = delete;
+	virtual void complete (int result) noexcept = 0;
+protected:
+	~uring_operation () = default;
+};
+
+//	An io_uring instance driven through the raw
+//	system calls (so liburing is not required).
+//
+//	Operations are prepared in the submission queue
+//	and submitted all at once by submit, completions
+//	are reaped from the completion queue (which is
+//	shared with the kernel and therefore requires no
+//	system call) by complete. The descriptor of the
+//	ring becomes readable whenever completions are
+//	posted so the reactor waits thereupon alongside
+//	everything else.
+//
+//	Datagrams which are sent are copied into buffers
+//	of at most send_size bytes owned by the ring so
+//	that the caller need not keep them alive.
+//
+//	Only available if ASIO_CARES_IO_URING is defined
+//	(elsewhere open always fails and nothing may be
+//	prepared).
+class uring {
+public:
+	static constexpr unsigned entries = 256;
+	static constexpr unsigned completions = 4096;
+	static constexpr std::size_t send_size = 512;
+	uring (boost::asio::io_service & ios, memory_resource & r) noexcept;
+	uring (const uring &) = delete;
+	uring & operator = (const uring &) = delete;
+	//	Waits for every outstanding operation to
+	//	complete since the kernel may otherwise still
+	//	access memory which is about to be released
+	~uring () noexcept;
+	bool open (boost::system::error_code & ec) noexcept;
+	bool is_open () const noexcept;
+	//	Each of these prepares an operation and returns
+	//	false if the submission queue is full (in which
+	//	case it must be submitted before retrying)
+	bool receive (int fd, struct msghdr & msg, uring_operation & op) noexcept;
+	bool cancel (uring_operation & op) noexcept;
+	//	Also returns false if the datagram is too large
+	//	or no buffer could be allocated
+	bool send (int fd, const struct iovec * data, int len) noexcept;
+	//	The number of operations prepared but not yet
+	//	submitted
+	std::size_t pending () const noexcept;
+	//	The number of operations submitted which have
+	//	not yet completed
+	std::size_t outstanding () const noexcept;
+	//	Submits every prepared operation and returns
+	//	the number of system calls made
+	std::size_t submit () noexcept;
+	//	Completes every operation in the completion
+	//	queue and returns the number completed
+	std::size_t complete () noexcept;
+	//	Waits for the completion queue to become non
+	//	empty (see boost::asio::posix::stream_descriptor::async_read_some
+	//	with null_buffers)
+	template <typename Handler>
+	void async_wait (Handler && h) {
+		#ifdef ASIO_CARES_IO_URING
+		descriptor_.async_read_some(boost::asio::null_buffers(), static_cast<Handler &&>(h));
+		#else
+		(void)h;
+		#endif
+	}
+	void cancel_wait () noexcept;
+	//	Whether io_uring is available on this platform
+	//	and supports everything required thereof
+	static bool supported () noexcept;
+private:
+	class send_buffer;
+	void close () noexcept;
+	void * prepare () noexcept;
+	memory_resource * r_;
+	#ifdef ASIO_CARES_IO_URING
+	boost::asio::posix::stream_descriptor descriptor_;
+	#endif
+	int               fd_;
+	void *            sq_;
+	std::size_t       sq_size_;
+	void *            cq_;
+	std::size_t       cq_size_;
+	void *            sqes_;
+	std::size_t       sqes_size_;
+	unsigned *        sq_head_;
+	unsigned *        sq_tail_;
+	unsigned *        sq_flags_;
+	unsigned *        sq_array_;
+	unsigned          sq_mask_;
+	unsigned          sq_entries_;
+	unsigned *        cq_head_;
+	unsigned *        cq_tail_;
+	unsigned          cq_mask_;
+	void *            cqes_;
+	//	The tail of the submission queue including
+	//	operations not yet submitted
+	unsigned          tail_;
+	std::size_t       outstanding_;
+	//	Buffers of sends which have completed
+	send_buffer *     free_;
+};
+
+//	The receive operations of a UDP socket whose
+//	datagrams are received through a uring.
+//
+//	Once started depth receives are kept outstanding
+//	(each into a buffer of receive_size bytes with
+//	datagrams truncated beyond that and marked as such,
+//	see datagram_batch::truncate) and the datagrams
+//	they receive are queued in the order their operations
+//	complete to be consumed one at a time, each datagram
+//	consumed causes another receive to be prepared.
+//	The callback is invoked whenever the queue ceases
+//	to be empty.
+//
+//	Storage is allocated when the receiver is started
+//	and is released once the receiver has been stopped
+//	and every operation thereupon has completed (which
+//	may be after the receiver has been destroyed).
+//
+//	The count of dropped datagrams the kernel attaches
+//	to each datagram when SO_RXQ_OVFL is set is noted
+//	as datagrams are received.
+class uring_receiver {
+public:
+	static constexpr std::size_t depth = 8;
+	static constexpr std::size_t receive_size = 4096;
+	using callback_type = void (*) (void *, int);
+	explicit uring_receiver (memory_resource & r) noexcept;
+	uring_receiver (const uring_receiver &) = delete;
+	uring_receiver & operator = (const uring_receiver &) = delete;
+	~uring_receiver () noexcept;
+	//	Prepares the receives, false if storage could
+	//	not be allocated, syscalls is incremented by the
+	//	number of system calls made
+	bool start (uring & ring, int fd, callback_type callback, void * data, std::size_t & syscalls) noexcept;
+	bool started () const noexcept;
+	//	Behaves as ::recvfrom with no flags (returning -1
+	//	and setting errno on failure) except that datagrams
+	//	come from the queue and if it is empty fails with
+	//	EAGAIN, syscalls is incremented by the number of
+	//	system calls made
+	ares_ssize_t receive (void * buffer,
+	                      std::size_t len,
+	                      struct sockaddr * addr,
+	                      ares_socklen_t * addr_len,
+	                      std::size_t & syscalls) noexcept;
+	//	The number of datagrams in the queue
+	std::size_t received () const noexcept;
+	//	The highest count of dropped datagrams attached
+	//	to any datagram received, zero if none was
+	std::uint32_t dropped () const noexcept;
+	//	Cancels the receives and submits the cancellations
+	//	at once so that no datagram which arrives later
+	//	is received, returns the number of system calls
+	//	made
+	std::size_t stop () noexcept;
+private:
+	class state;
+	memory_resource * r_;
+	state *           state_;
+};
+
+}
+}
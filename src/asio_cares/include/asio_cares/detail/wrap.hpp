@@ -0,0 +1,29 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../channel.hpp"
+#include <exception>
+#include <utility>
+
+namespace asio_cares {
+namespace detail {
+
+template <typename Function>
+void async_wrap (channel & c, Function && function) noexcept {
+	try {
+		function();
+	} catch (...) {
+		//	If this throws we're just done, it
+		//	goes into noexcept and the process
+		//	dies
+		c.get_io_service().post([ex = std::current_exception()] () mutable {
+			std::rethrow_exception(std::move(ex));
+		});
+	}
+}
+
+}
+}
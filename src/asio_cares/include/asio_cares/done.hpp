@@ -5,6 +5,7 @@
 #pragma once
 
 #include <ares.h>
+#include <asio_cares/channel.hpp>
 
 namespace asio_cares {
 
@@ -12,10 +13,39 @@ namespace asio_cares {
  *	Determines if there are any queries
  *	active on an `ares_channel`.
  *
+ *	This is determined by calling `ares_fds`
+ *	which is linear in `FD_SETSIZE` and which
+ *	does not account for sockets whose descriptors
+ *	exceed `FD_SETSIZE`. Prefer the overload which
+ *	accepts a \ref channel where possible.
+ *
  *	\return
  *		\em true if there are no active
  *		queries, \em false otherwise.
  */
 bool done (ares_channel channel) noexcept;
 
+/**
+ *	Determines if there are any queries
+ *	outstanding on a \ref channel.
+ *
+ *	Queries submitted directly through libcares
+ *	are considered as well as those counted by
+ *	\ref channel::outstanding (see \ref channel::active).
+ *	While any query counted thereby is outstanding
+ *	this requires only a single load.
+ *
+ *	Since libcares may be consulted this function
+ *	must be invoked on the `strand` of \em c (use
+ *	\ref channel::outstanding from other threads).
+ *
+ *	\param [in] c
+ *		The \ref channel.
+ *
+ *	\return
+ *		\em true if there are no outstanding
+ *		queries, \em false otherwise.
+ */
+bool done (const channel & c) noexcept;
+
 }
@@ -0,0 +1,284 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/allocate.hpp>
+#include <asio_cares/detail/wrap.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <beast/core/async_result.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if ARES_VERSION >= 0x011000
+
+namespace asio_cares {
+
+/**
+ *	A single result of \ref async_getaddrinfo.
+ */
+class address_info {
+public:
+	address_info () = default;
+	address_info (const address_info &) = default;
+	address_info (address_info &&) = default;
+	address_info & operator = (const address_info &) = default;
+	address_info & operator = (address_info &&) = default;
+	/**
+	 *	Creates an address_info.
+	 *
+	 *	\param [in] endpoint
+	 *		The endpoint.
+	 *	\param [in] ttl
+	 *		The time to live in seconds.
+	 */
+	address_info (boost::asio::ip::tcp::endpoint endpoint, int ttl) noexcept
+		:	endpoint(endpoint),
+			ttl     (ttl)
+	{}
+	/**
+	 *	The endpoint which may be connected to.
+	 */
+	boost::asio::ip::tcp::endpoint endpoint;
+	/**
+	 *	The time to live of the record from which
+	 *	the address was obtained in seconds.
+	 */
+	int                            ttl;
+};
+
+/**
+ *	A contiguous collection of \ref address_info
+ *	objects. Allocated from the \ref memory_resource
+ *	of the \ref channel if it has one.
+ */
+using address_info_collection = std::vector<address_info, polymorphic_allocator<address_info>>;
+
+namespace detail {
+
+using async_getaddrinfo_signature = void (boost::system::error_code, address_info_collection);
+
+//	Appends one address_info per IPv4 or IPv6
+//	node of the list, allocates at most once
+void to_address_info (const ares_addrinfo *, unsigned short, address_info_collection &);
+
+template <typename Handler>
+class async_getaddrinfo_completion {
+public:
+	async_getaddrinfo_completion () = delete;
+	async_getaddrinfo_completion (const async_getaddrinfo_completion &) = default;
+	async_getaddrinfo_completion (async_getaddrinfo_completion &&) = default;
+	async_getaddrinfo_completion & operator = (const async_getaddrinfo_completion &) = delete;
+	async_getaddrinfo_completion & operator = (async_getaddrinfo_completion &&) = delete;
+	async_getaddrinfo_completion (Handler h, boost::system::error_code ec, address_info_collection results) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_      (std::move(h)),
+			ec_     (ec),
+			results_(std::move(results))
+	{}
+	void operator () () {
+		h_(ec_, std::move(results_));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_getaddrinfo_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->h_));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_getaddrinfo_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
+	}
+	template <typename Function>
+	friend void asio_handler_invoke (Function && function, async_getaddrinfo_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(function, std::addressof(self->h_));
+	}
+	friend bool asio_handler_is_continuation (async_getaddrinfo_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->h_));
+	}
+private:
+	Handler                   h_;
+	boost::system::error_code ec_;
+	address_info_collection   results_;
+};
+
+template <typename Handler>
+class async_getaddrinfo_state {
+private:
+	using completion_type = async_getaddrinfo_completion<Handler>;
+public:
+	async_getaddrinfo_state () = delete;
+	async_getaddrinfo_state (const async_getaddrinfo_state &) = delete;
+	async_getaddrinfo_state (async_getaddrinfo_state &&) = delete;
+	async_getaddrinfo_state & operator = (const async_getaddrinfo_state &) = delete;
+	async_getaddrinfo_state & operator = (async_getaddrinfo_state &&) = delete;
+	static async_getaddrinfo_state * create (Handler h, asio_cares::channel & c, unsigned short port) {
+		auto retr = allocate_state<async_getaddrinfo_state>(c, h);
+		try {
+			new (retr) async_getaddrinfo_state(std::move(h), c, port);
+		} catch (...) {
+			deallocate_state(c, h, retr);
+			throw;
+		}
+		return retr;
+	}
+	//	Even if this throws this object is
+	//	still destroyed
+	void complete (int status, ares_addrinfo * res) {
+		bool in = in_;
+		if (in && completed_) *completed_ = true;
+		auto && c = c_;
+		auto && strand = c.get_strand();
+		auto port = port_;
+		auto h = free();
+		auto ec = make_error_code(status);
+		auto r = c.get_memory_resource();
+		address_info_collection results(r ? *r : new_delete_resource());
+		if (res) {
+			try {
+				to_address_info(res, port, results);
+			} catch (...) {
+				ares_freeaddrinfo(res);
+				throw;
+			}
+			ares_freeaddrinfo(res);
+		}
+		completion_type completion(std::move(h), ec, std::move(results));
+		if (in) {
+			strand.post(std::move(completion));
+		} else if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	void destroy () noexcept {
+		free();
+	}
+	void detach () noexcept {
+		assert(in_);
+		in_ = false;
+	}
+	void watch (bool & completed) noexcept {
+		completed_ = &completed;
+	}
+	asio_cares::channel & channel () noexcept {
+		return c_;
+	}
+private:
+	async_getaddrinfo_state (Handler h, asio_cares::channel & c, unsigned short port) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_        (std::move(h)),
+			c_        (c),
+			port_     (port),
+			completed_(nullptr),
+			in_       (true)
+	{}
+	~async_getaddrinfo_state () = default;
+	Handler free () noexcept {
+		Handler retr(std::move(h_));
+		auto && c = c_;
+		this->~async_getaddrinfo_state();
+		deallocate_state(c, retr, this);
+		return retr;
+	}
+	Handler               h_;
+	asio_cares::channel & c_;
+	unsigned short        port_;
+	bool *                completed_;
+	bool                  in_;
+};
+
+}
+
+/**
+ *	Invokes `ares_getaddrinfo` to resolve both the
+ *	IPv4 and IPv6 addresses of a host and adapts the
+ *	result into a contiguous collection of endpoints.
+ *
+ *	The A and AAAA queries are issued together and
+ *	the results are converted directly from the list
+ *	libcares provides (which is then freed) into a
+ *	single allocation.
+ *
+ *	The guarantees made by \ref async_send with respect
+ *	to the invocation of the completion handler apply.
+ *	In particular the completion handler shall not be
+ *	invoked until \ref async_process (or \ref async_process_one)
+ *	drives the \ref channel. Requires libcares 1.16.0+.
+ *
+ *	\tparam CompletionToken
+ *		A type which represents the action to take
+ *		upon the completion of the asynchronous
+ *		operation and which determines the return
+ *		value (if any) of this initiating function.
+ *
+ *	\param [in] c
+ *		The \ref channel on which the queries shall be
+ *		sent. This reference must remain valid for the
+ *		lifetime of the asynchronous operation or
+ *		the behavior is undefined.
+ *	\param [in] name
+ *		The name to resolve.
+ *	\param [in] port
+ *		The port to use for each endpoint.
+ *	\param [in] token
+ *		The token which encapsulates the action to
+ *		take upon completion of the asynchronous
+ *		operation. The completion of this asynchronous
+ *		operation generates a `boost::system::error_code`
+ *		and an \ref address_info_collection (which is
+ *		empty on error) in the order in which libcares
+ *		sorted the addresses.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_getaddrinfo (channel & c, const char * name, unsigned short port, CompletionToken && token) {
+	beast::async_completion<CompletionToken, detail::async_getaddrinfo_signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, detail::async_getaddrinfo_signature>;
+	using state_type = detail::async_getaddrinfo_state<handler_type>;
+	auto state = state_type::create(std::move(init.completion_handler), c, port);
+	ares_addrinfo_hints hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	//	libcares completes immediately (and therefore
+	//	destroys the state) for numeric addresses
+	bool completed = false;
+	state->watch(completed);
+	c.begin_query();
+	ares_getaddrinfo(c, name, nullptr, &hints, [] (void * arg, int status, int timeouts, ares_addrinfo * res) {
+		auto state = static_cast<state_type *>(arg);
+		state->channel().end_query(status, timeouts);
+		detail::async_wrap(state->channel(), [&] () {
+			state->complete(status, res);
+		});
+	}, state);
+	if (!completed) state->detach();
+	return init.result.get();
+}
+
+}
+
+#endif
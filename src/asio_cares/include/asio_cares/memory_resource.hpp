@@ -0,0 +1,202 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace asio_cares {
+
+/**
+ *	An abstract source of memory modeled on
+ *	`std::pmr::memory_resource` (which is not
+ *	available in C++14).
+ */
+class memory_resource {
+public:
+	/**
+	 *	The alignment used when none is specified.
+	 */
+	static constexpr std::size_t max_align = alignof(std::max_align_t);
+	memory_resource () = default;
+	memory_resource (const memory_resource &) = default;
+	memory_resource & operator = (const memory_resource &) = default;
+	virtual ~memory_resource () noexcept;
+	/**
+	 *	Allocates memory.
+	 *
+	 *	\param [in] bytes
+	 *		The number of bytes to allocate.
+	 *	\param [in] alignment
+	 *		The required alignment. Defaults to
+	 *		\ref max_align.
+	 *
+	 *	\return
+	 *		A pointer to the allocated memory.
+	 */
+	void * allocate (std::size_t bytes, std::size_t alignment = max_align);
+	/**
+	 *	Deallocates memory previously obtained from
+	 *	\ref allocate on this object (or an object
+	 *	which compares equal thereto).
+	 *
+	 *	\param [in] ptr
+	 *		The pointer returned by \ref allocate.
+	 *	\param [in] bytes
+	 *		The number of bytes passed to \ref allocate.
+	 *	\param [in] alignment
+	 *		The alignment passed to \ref allocate.
+	 */
+	void deallocate (void * ptr, std::size_t bytes, std::size_t alignment = max_align) noexcept;
+	/**
+	 *	Determines whether memory allocated from one
+	 *	resource may be deallocated by another.
+	 *
+	 *	\param [in] other
+	 *		The other resource.
+	 *
+	 *	\return
+	 *		\em true if the resources are interchangeable,
+	 *		\em false otherwise.
+	 */
+	bool is_equal (const memory_resource & other) const noexcept;
+private:
+	virtual void * do_allocate (std::size_t, std::size_t) = 0;
+	virtual void do_deallocate (void *, std::size_t, std::size_t) noexcept = 0;
+	virtual bool do_is_equal (const memory_resource &) const noexcept = 0;
+};
+
+/**
+ *	Retrieves a \ref memory_resource which
+ *	allocates using the global `operator new`
+ *	and deallocates using the global `operator delete`.
+ *
+ *	\return
+ *		A reference to a \ref memory_resource
+ *		with static storage duration.
+ */
+memory_resource & new_delete_resource () noexcept;
+
+/**
+ *	A \ref memory_resource which recycles blocks
+ *	of a small number of fixed sizes.
+ *
+ *	Requests are rounded up to the nearest size
+ *	class (powers of two from 16 to 4096 bytes) and
+ *	satisfied from a free list for that class if
+ *	possible, otherwise from an upstream resource.
+ *	Deallocated blocks are retained (up to a bound
+ *	per size class) rather than being returned to the
+ *	upstream resource. Larger requests and requests
+ *	with extended alignment are forwarded to the
+ *	upstream resource.
+ *
+ *	In steady state the operations performed on
+ *	a \ref channel allocate from a handful of size
+ *	classes, accordingly once the free lists are
+ *	warm they do not allocate from the upstream
+ *	resource at all.
+ *
+ *	Instances are thread safe.
+ */
+class slab_resource : public memory_resource {
+public:
+	slab_resource (const slab_resource &) = delete;
+	slab_resource (slab_resource &&) = delete;
+	slab_resource & operator = (const slab_resource &) = delete;
+	slab_resource & operator = (slab_resource &&) = delete;
+	/**
+	 *	Creates a slab_resource.
+	 *
+	 *	\param [in] upstream
+	 *		The \ref memory_resource from which blocks
+	 *		shall be obtained. Defaults to \ref new_delete_resource.
+	 *		This reference must remain valid for the
+	 *		lifetime of the object.
+	 *	\param [in] max
+	 *		The maximum number of blocks to retain per
+	 *		size class. Defaults to 256.
+	 */
+	explicit slab_resource (memory_resource & upstream = new_delete_resource(), std::size_t max = 256);
+	/**
+	 *	Returns all retained blocks to the upstream
+	 *	resource.
+	 */
+	~slab_resource () noexcept;
+	/**
+	 *	Retrieves the upstream resource.
+	 *
+	 *	\return
+	 *		A reference to a \ref memory_resource.
+	 */
+	memory_resource & upstream () const noexcept;
+	/**
+	 *	Returns all retained blocks to the upstream
+	 *	resource.
+	 */
+	void release () noexcept;
+private:
+	static constexpr std::size_t min_size = 16;
+	static constexpr std::size_t classes = 9;
+	class block {
+	public:
+		block * next;
+	};
+	static std::size_t size_class (std::size_t) noexcept;
+	virtual void * do_allocate (std::size_t, std::size_t) override;
+	virtual void do_deallocate (void *, std::size_t, std::size_t) noexcept override;
+	virtual bool do_is_equal (const memory_resource &) const noexcept override;
+	memory_resource & upstream_;
+	std::size_t       max_;
+	std::mutex        m_;
+	block *           free_ [classes];
+	std::size_t       cached_ [classes];
+};
+
+/**
+ *	An allocator which obtains memory from a
+ *	\ref memory_resource. Modeled on
+ *	`std::pmr::polymorphic_allocator`.
+ *
+ *	\tparam T
+ *		The type to allocate.
+ */
+template <typename T>
+class polymorphic_allocator {
+public:
+	using value_type = T;
+	polymorphic_allocator () noexcept
+		:	r_(&new_delete_resource())
+	{}
+	polymorphic_allocator (memory_resource & r) noexcept
+		:	r_(&r)
+	{}
+	template <typename U>
+	polymorphic_allocator (const polymorphic_allocator<U> & other) noexcept
+		:	r_(other.resource())
+	{}
+	T * allocate (std::size_t n) {
+		return static_cast<T *>(r_->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate (T * ptr, std::size_t n) noexcept {
+		r_->deallocate(ptr, n * sizeof(T), alignof(T));
+	}
+	memory_resource * resource () const noexcept {
+		return r_;
+	}
+	template <typename U>
+	bool operator == (const polymorphic_allocator<U> & rhs) const noexcept {
+		return (r_ == rhs.resource()) || r_->is_equal(*rhs.resource());
+	}
+	template <typename U>
+	bool operator != (const polymorphic_allocator<U> & rhs) const noexcept {
+		return !(*this == rhs);
+	}
+private:
+	memory_resource * r_;
+};
+
+}
@@ -0,0 +1,464 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace asio_cares {
+
+/**
+ *	A histogram of durations whose buckets widen
+ *	with their magnitude (in the manner of HdrHistogram):
+ *	Every power of two microseconds is divided into
+ *	\ref sub_buckets buckets of equal width, so each
+ *	recorded duration is represented with a relative
+ *	error of at most 1 / \ref sub_buckets no matter
+ *	how large it is. Durations which exceed the range
+ *	of the histogram are recorded in the last bucket.
+ *
+ *	Only one thread of execution may record durations
+ *	at a time but the histogram may be read concurrently
+ *	therewith (each bucket is read atomically but
+ *	the buckets are not read as a consistent whole).
+ */
+class latency_histogram {
+public:
+	/**
+	 *	The number of buckets into which each power
+	 *	of two is divided.
+	 */
+	static constexpr std::size_t sub_buckets = 16;
+	/**
+	 *	The number of powers of two spanned by the
+	 *	histogram. Durations of 2 to the power of this
+	 *	many microseconds or more are recorded in the
+	 *	last bucket.
+	 */
+	static constexpr std::size_t magnitudes = 36;
+	/**
+	 *	The number of buckets.
+	 */
+	static constexpr std::size_t buckets = sub_buckets + ((magnitudes - 4) * sub_buckets);
+	/**
+	 *	Creates an empty histogram.
+	 */
+	latency_histogram () noexcept;
+	latency_histogram (const latency_histogram &) = delete;
+	latency_histogram & operator = (const latency_histogram &) = delete;
+	/**
+	 *	Records a duration.
+	 *
+	 *	\param [in] d
+	 *		The duration. Negative durations are
+	 *		recorded as zero.
+	 */
+	void record (std::chrono::steady_clock::duration d) noexcept;
+	/**
+	 *	Retrieves the number of durations recorded
+	 *	in a certain bucket.
+	 *
+	 *	\param [in] i
+	 *		The index of the bucket. Must be less than
+	 *		\ref buckets.
+	 *
+	 *	\return
+	 *		The number of durations.
+	 */
+	std::uint64_t count (std::size_t i) const noexcept;
+	/**
+	 *	Retrieves the number of durations recorded.
+	 *
+	 *	\return
+	 *		The number of durations.
+	 */
+	std::uint64_t count () const noexcept;
+	/**
+	 *	Retrieves an upper bound on a certain percentile
+	 *	of the recorded durations.
+	 *
+	 *	\param [in] p
+	 *		The percentile as a value between zero and
+	 *		one inclusive.
+	 *
+	 *	\return
+	 *		The upper bound of the bucket which contains
+	 *		the percentile, zero if no durations have been
+	 *		recorded.
+	 */
+	std::chrono::microseconds percentile (double p) const noexcept;
+	/**
+	 *	Retrieves the least duration recorded in
+	 *	a certain bucket.
+	 *
+	 *	\param [in] i
+	 *		The index of the bucket.
+	 *
+	 *	\return
+	 *		The duration.
+	 */
+	static std::chrono::microseconds lower_bound (std::size_t i) noexcept;
+	/**
+	 *	Retrieves the least duration greater than
+	 *	every duration recorded in a certain bucket
+	 *	(except for the last bucket).
+	 *
+	 *	\param [in] i
+	 *		The index of the bucket.
+	 *
+	 *	\return
+	 *		The duration.
+	 */
+	static std::chrono::microseconds upper_bound (std::size_t i) noexcept;
+	/**
+	 *	Determines the bucket in which a certain
+	 *	duration is recorded.
+	 *
+	 *	\param [in] us
+	 *		The duration in microseconds.
+	 *
+	 *	\return
+	 *		The index of the bucket.
+	 */
+	static std::size_t index (std::uint64_t us) noexcept;
+private:
+	std::array<std::atomic<std::uint64_t>, buckets> buckets_;
+};
+
+/**
+ *	Counters, gauges, and a latency histogram which
+ *	describe the activity of a \ref channel.
+ *
+ *	Metrics are only ever updated by the thread of
+ *	execution which currently owns the channel (i.e.
+ *	on its `strand`) and therefore updating a metric
+ *	is merely a relaxed load and a relaxed store of
+ *	an atomic. Metrics may be read at any time from
+ *	any thread without synchronizing with the channel,
+ *	each metric is read atomically but distinct metrics
+ *	are not read as a consistent whole.
+ *
+ *	If `ASIO_CARES_NO_METRICS` is defined nothing is
+ *	collected, recording a metric does nothing, and
+ *	every metric reads as zero.
+ */
+class metrics {
+public:
+	/**
+	 *	\em true if metrics are collected, \em false
+	 *	if `ASIO_CARES_NO_METRICS` is defined.
+	 */
+	#ifdef ASIO_CARES_NO_METRICS
+	static constexpr bool enabled = false;
+	#else
+	static constexpr bool enabled = true;
+	#endif
+	/**
+	 *	The number of libcares status codes which are
+	 *	counted separately by \ref failed, status codes
+	 *	which are greater are counted together with the
+	 *	greatest.
+	 */
+	static constexpr std::size_t statuses = 32;
+	/**
+	 *	The type of the value returned by \ref begin
+	 *	which must be passed to \ref end.
+	 */
+	#ifdef ASIO_CARES_NO_METRICS
+	class timestamp {};
+	#else
+	using timestamp = std::chrono::steady_clock::time_point;
+	#endif
+	/**
+	 *	Creates a metrics object in which every metric
+	 *	is zero.
+	 */
+	metrics () noexcept;
+	metrics (const metrics &) = delete;
+	metrics & operator = (const metrics &) = delete;
+	/**
+	 *	Records that a query was submitted.
+	 *
+	 *	\return
+	 *		The time at which the query was submitted.
+	 */
+	timestamp begin () noexcept;
+	/**
+	 *	Records that a query completed.
+	 *
+	 *	\param [in] status
+	 *		The libcares status with which the query
+	 *		completed.
+	 *	\param [in] timeouts
+	 *		The number of times the query timed out as
+	 *		reported by libcares.
+	 *	\param [in] start
+	 *		The value returned by \ref begin when the
+	 *		query was submitted, or a value initialized
+	 *		\ref timestamp if the latency of the query
+	 *		is not to be recorded.
+	 */
+	void end (int status, int timeouts, timestamp start) noexcept;
+	/**
+	 *	Records that a socket was opened.
+	 */
+	void open () noexcept;
+	/**
+	 *	Records that a socket was closed.
+	 */
+	void close () noexcept;
+	/**
+	 *	Records that the reactor was woken by a socket
+	 *	becoming ready or the timer expiring.
+	 */
+	void wakeup () noexcept;
+	/**
+	 *	Records that system calls were made to receive
+	 *	or send data on a socket.
+	 *
+	 *	\param [in] n
+	 *		The number of system calls.
+	 */
+	void syscall (std::size_t n = 1) noexcept;
+	/**
+	 *	Records that a socket was opened by reusing
+	 *	a pooled socket.
+	 */
+	void reuse () noexcept;
+	/**
+	 *	Records that the kernel dropped datagrams
+	 *	destined for a socket because its receive
+	 *	buffer was full.
+	 *
+	 *	\param [in] n
+	 *		The number of datagrams.
+	 */
+	void drop (std::size_t n) noexcept;
+	/**
+	 *	Retrieves the number of queries submitted.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::uint64_t submitted () const noexcept;
+	/**
+	 *	Retrieves the number of queries which completed
+	 *	(successfully or otherwise).
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::uint64_t completed () const noexcept;
+	/**
+	 *	Retrieves the number of queries which completed
+	 *	unsuccessfully.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::uint64_t failed () const noexcept;
+	/**
+	 *	Retrieves the number of queries which completed
+	 *	with a certain libcares status.
+	 *
+	 *	\param [in] status
+	 *		The status.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::uint64_t failed (int status) const noexcept;
+	/**
+	 *	Retrieves the sum of the number of timeouts
+	 *	libcares reported for each completed query.
+	 *
+	 *	\return
+	 *		The number of timeouts.
+	 */
+	std::uint64_t timeouts () const noexcept;
+	/**
+	 *	Retrieves the number of times a query which
+	 *	timed out was sent again. This is the number
+	 *	of timeouts except those which caused a query
+	 *	to fail with `ARES_ETIMEOUT`.
+	 *
+	 *	\return
+	 *		The number of retries.
+	 */
+	std::uint64_t retries () const noexcept;
+	/**
+	 *	Retrieves the number of queries which have
+	 *	been submitted but have not yet completed.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::uint64_t in_flight () const noexcept;
+	/**
+	 *	Retrieves the number of sockets which are
+	 *	open.
+	 *
+	 *	\return
+	 *		The number of sockets.
+	 */
+	std::uint64_t sockets () const noexcept;
+	/**
+	 *	Retrieves the number of times the reactor
+	 *	was woken by a socket becoming ready or the
+	 *	timer expiring.
+	 *
+	 *	\return
+	 *		The number of wakeups.
+	 */
+	std::uint64_t wakeups () const noexcept;
+	/**
+	 *	Retrieves the ratio of \ref wakeups to
+	 *	\ref completed.
+	 *
+	 *	\return
+	 *		The ratio, zero if no queries have completed.
+	 */
+	double wakeups_per_answer () const noexcept;
+	/**
+	 *	Retrieves the number of system calls made to
+	 *	receive or send data on behalf of libcares.
+	 *
+	 *	\return
+	 *		The number of system calls.
+	 */
+	std::uint64_t syscalls () const noexcept;
+	/**
+	 *	Retrieves the ratio of \ref syscalls to
+	 *	\ref completed.
+	 *
+	 *	\return
+	 *		The ratio, zero if no queries have completed.
+	 */
+	double syscalls_per_answer () const noexcept;
+	/**
+	 *	Retrieves the number of sockets opened by
+	 *	reusing a pooled socket rather than opening
+	 *	a new one.
+	 *
+	 *	\return
+	 *		The number of sockets.
+	 */
+	std::uint64_t reused () const noexcept;
+	/**
+	 *	Retrieves the number of datagrams the kernel
+	 *	dropped because the receive buffer of a socket
+	 *	was full. Only counted if
+	 *	`socket_options::track_drops` is set.
+	 *
+	 *	\return
+	 *		The number of datagrams.
+	 */
+	std::uint64_t drops () const noexcept;
+	/**
+	 *	Retrieves the histogram of the time between
+	 *	the submission and completion of each query
+	 *	whose latency was recorded.
+	 *
+	 *	\return
+	 *		A reference to a \ref latency_histogram.
+	 */
+	const latency_histogram & latency () const noexcept;
+private:
+	using counter_type = std::atomic<std::uint64_t>;
+	//	There is only ever one writer
+	static void add (counter_type & c, std::uint64_t n = 1) noexcept {
+		c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+	#ifndef ASIO_CARES_NO_METRICS
+	counter_type                          submitted_;
+	counter_type                          completed_;
+	std::array<counter_type, statuses>    failed_;
+	counter_type                          timeouts_;
+	counter_type                          retries_;
+	counter_type                          sockets_;
+	counter_type                          wakeups_;
+	counter_type                          syscalls_;
+	counter_type                          reused_;
+	counter_type                          drops_;
+	latency_histogram                     latency_;
+	#endif
+};
+
+inline void latency_histogram::record (std::chrono::steady_clock::duration d) noexcept {
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+	auto && bucket = buckets_[index((us < 0) ? 0 : std::uint64_t(us))];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+#ifdef ASIO_CARES_NO_METRICS
+
+inline metrics::timestamp metrics::begin () noexcept {
+	return timestamp();
+}
+
+inline void metrics::end (int, int, timestamp) noexcept {}
+
+inline void metrics::open () noexcept {}
+
+inline void metrics::close () noexcept {}
+
+inline void metrics::wakeup () noexcept {}
+
+inline void metrics::syscall (std::size_t) noexcept {}
+
+inline void metrics::reuse () noexcept {}
+
+inline void metrics::drop (std::size_t) noexcept {}
+
+#else
+
+inline metrics::timestamp metrics::begin () noexcept {
+	add(submitted_);
+	return std::chrono::steady_clock::now();
+}
+
+inline void metrics::end (int status, int timeouts, timestamp start) noexcept {
+	add(completed_);
+	if (status != 0) add(failed_[((status < 0) || (std::size_t(status) >= statuses)) ? (statuses - 1) : std::size_t(status)]);
+	if (timeouts > 0) {
+		add(timeouts_, std::uint64_t(timeouts));
+		//	The last timeout of a query which timed
+		//	out was not followed by a retry
+		add(retries_, std::uint64_t(timeouts) - ((status == ARES_ETIMEOUT) ? 1 : 0));
+	}
+	if (start != timestamp()) latency_.record(std::chrono::steady_clock::now() - start);
+}
+
+inline void metrics::open () noexcept {
+	add(sockets_);
+}
+
+inline void metrics::close () noexcept {
+	sockets_.store(sockets_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+inline void metrics::wakeup () noexcept {
+	add(wakeups_);
+}
+
+inline void metrics::syscall (std::size_t n) noexcept {
+	add(syscalls_, n);
+}
+
+inline void metrics::reuse () noexcept {
+	add(reused_);
+}
+
+inline void metrics::drop (std::size_t n) noexcept {
+	add(drops_, n);
+}
+
+#endif
+
+}
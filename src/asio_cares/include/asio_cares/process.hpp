@@ -5,7 +5,8 @@
 #pragma once
 
 #include <asio_cares/channel.hpp>
-#include <asio_cares/process_one.hpp>
+#include <asio_cares/detail/allocate.hpp>
+#include <asio_cares/detail/wrap.hpp>
 #include <beast/core/async_result.hpp>
 #include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/handler_continuation_hook.hpp>
@@ -14,6 +15,8 @@
 #include <cassert>
 #include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 namespace asio_cares {
@@ -23,61 +26,135 @@ namespace detail {
 using async_process_signature = void (boost::system::error_code);
 
 template <typename Handler>
-class async_process_op {
+class async_process_completion {
 public:
-	async_process_op () = delete;
-	async_process_op (const async_process_op &) = default;
-	async_process_op (async_process_op &&) = default;
-	async_process_op & operator = (const async_process_op &) = default;
-	async_process_op & operator = (async_process_op &&) = default;
-	template <typename DeducedHandler>
-	explicit async_process_op (DeducedHandler && h, channel & c)
-		:	inner_  (std::forward<DeducedHandler>(h)),
-			channel_(c)
+	async_process_completion () = delete;
+	async_process_completion (const async_process_completion &) = default;
+	async_process_completion (async_process_completion &&) = default;
+	async_process_completion & operator = (const async_process_completion &) = delete;
+	async_process_completion & operator = (async_process_completion &&) = delete;
+	async_process_completion (Handler h, boost::system::error_code ec) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_ (std::move(h)),
+			ec_(ec)
 	{}
-	void operator () (boost::system::error_code ec, bool done) {
-		if (ec || done) inner_(ec);
-		else begin();
+	void operator () () {
+		h_(ec_);
 	}
-	void begin () {
-		auto & c = channel_;
-		async_process_one(c, c.get_strand().wrap(std::move(*this)));
-	}
-	friend void * asio_handler_allocate (std::size_t num, async_process_op * self) {
+	friend void * asio_handler_allocate (std::size_t num, async_process_completion * self) {
 		assert(self);
 		using boost::asio::asio_handler_allocate;
-		return asio_handler_allocate(num, std::addressof(self->inner_));
+		return asio_handler_allocate(num, std::addressof(self->h_));
 	}
-	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_process_op * self) {
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_process_completion * self) {
 		assert(self);
 		using boost::asio::asio_handler_deallocate;
-		asio_handler_deallocate(ptr, num, std::addressof(self->inner_));
+		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
 	}
 	template <typename Function>
-	friend void asio_handler_invoke (Function function, async_process_op * self) {
+	friend void asio_handler_invoke (Function function, async_process_completion * self) {
 		assert(self);
 		using boost::asio::asio_handler_invoke;
-		asio_handler_invoke(std::move(function), std::addressof(self->inner_));
+		asio_handler_invoke(std::move(function), std::addressof(self->h_));
 	}
-	friend bool asio_handler_is_continuation (async_process_op * self) {
+	friend bool asio_handler_is_continuation (async_process_completion * self) {
 		assert(self);
-		if (!done(self->channel_)) return true;
 		using boost::asio::asio_handler_is_continuation;
-		return asio_handler_is_continuation(std::addressof(self->inner_));
+		return asio_handler_is_continuation(std::addressof(self->h_));
+	}
+private:
+	Handler                   h_;
+	boost::system::error_code ec_;
+};
+
+template <typename Handler>
+class async_process_state {
+private:
+	using completion_type = async_process_completion<Handler>;
+public:
+	async_process_state () = delete;
+	async_process_state (const async_process_state &) = delete;
+	async_process_state (async_process_state &&) = delete;
+	async_process_state & operator = (const async_process_state &) = delete;
+	async_process_state & operator = (async_process_state &&) = delete;
+	static async_process_state * create (Handler h, asio_cares::channel & c) {
+		auto retr = allocate_state<async_process_state>(c, h);
+		try {
+			new (retr) async_process_state(std::move(h), c);
+		} catch (...) {
+			deallocate_state(c, h, retr);
+			throw;
+		}
+		return retr;
+	}
+	//	Even if this throws this object is
+	//	still destroyed
+	void complete (boost::system::error_code ec) {
+		bool in = in_;
+		if (in && completed_) *completed_ = true;
+		auto && strand = c_.get_strand();
+		completion_type completion(free(), ec);
+		if (in) strand.post(std::move(completion));
+		else strand.dispatch(std::move(completion));
+	}
+	void destroy () noexcept {
+		free();
+	}
+	void detach () noexcept {
+		assert(in_);
+		in_ = false;
+	}
+	void watch (bool & completed) noexcept {
+		completed_ = &completed;
+	}
+	asio_cares::channel & channel () noexcept {
+		return c_;
 	}
 private:
-	Handler   inner_;
-	channel & channel_;
+	async_process_state (Handler h, asio_cares::channel & c) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_        (std::move(h)),
+			c_        (c),
+			completed_(nullptr),
+			in_       (true)
+	{}
+	~async_process_state () = default;
+	Handler free () noexcept {
+		Handler retr(std::move(h_));
+		auto && c = c_;
+		this->~async_process_state();
+		deallocate_state(c, retr, this);
+		return retr;
+	}
+	Handler               h_;
+	asio_cares::channel & c_;
+	bool *                completed_;
+	bool                  in_;
 };
 
 }
 
 /**
- *	Asynchronously calls `ares_process` or
- *	`ares_process_fd` (which is actually called
- *	is an implementation detail) until
+ *	Asynchronously processes a \ref channel until
  *	\ref done returns `true`.
  *
+ *	Queries submitted directly through libcares
+ *	(for example with `ares_send`) are processed
+ *	as well as those submitted with \ref async_send
+ *	(see \ref channel::active).
+ *
+ *	Processing is driven by the persistent reactor
+ *	of the \ref channel (see \ref channel::process)
+ *	which keeps one wait outstanding per socket and
+ *	direction rather than waiting on and cancelling
+ *	every socket for each packet received. This
+ *	function may be invoked while another invocation
+ *	thereof is outstanding on the same \ref channel,
+ *	in which case both operations complete when the
+ *	\ref channel has no outstanding queries. It must
+ *	not be invoked concurrently with
+ *	\ref async_process_one.
+ *
  *	It is perfectly safe to invoke this function
  *	on a \ref channel with no outstanding queries.
  *	The completion handler will simply be dispatched
@@ -108,10 +185,26 @@ private:
 template <typename CompletionToken>
 auto async_process (channel & c, CompletionToken && token) {
 	beast::async_completion<CompletionToken, detail::async_process_signature> init(token);
-	detail::async_process_op<beast::handler_type<CompletionToken,
-	                                             detail::async_process_signature>> op(std::move(init.completion_handler),
-	                                                                                  c);
-	op.begin();
+	using handler_type = beast::handler_type<CompletionToken, detail::async_process_signature>;
+	using state_type = detail::async_process_state<handler_type>;
+	auto state = state_type::create(std::move(init.completion_handler), c);
+	//	The reactor stops (and therefore destroys the
+	//	state) immediately if there are no outstanding
+	//	queries
+	bool completed = false;
+	state->watch(completed);
+	try {
+		c.process([] (void * arg, boost::system::error_code ec) noexcept {
+			auto state = static_cast<state_type *>(arg);
+			detail::async_wrap(state->channel(), [&] () {
+				state->complete(ec);
+			});
+		}, state);
+	} catch (...) {
+		state->destroy();
+		throw;
+	}
+	if (!completed) state->detach();
 	return init.result.get();
 }
 
@@ -0,0 +1,73 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <cstddef>
+
+namespace asio_cares {
+
+/**
+ *	Describes the readiness of a single socket
+ *	belonging to an `ares_channel`.
+ */
+class socket_events {
+public:
+	socket_events () = default;
+	socket_events (const socket_events &) = default;
+	socket_events (socket_events &&) = default;
+	socket_events & operator = (const socket_events &) = default;
+	socket_events & operator = (socket_events &&) = default;
+	/**
+	 *	Creates a new socket_events object.
+	 *
+	 *	\param [in] socket
+	 *		The socket.
+	 *	\param [in] readable
+	 *		\em true if \em socket is readable,
+	 *		\em false otherwise.
+	 *	\param [in] writable
+	 *		\em true if \em socket is writable,
+	 *		\em false otherwise.
+	 */
+	socket_events (ares_socket_t socket, bool readable, bool writable) noexcept;
+	/**
+	 *	The socket.
+	 */
+	ares_socket_t socket;
+	/**
+	 *	Whether \ref socket is readable.
+	 */
+	bool readable;
+	/**
+	 *	Whether \ref socket is writable.
+	 */
+	bool writable;
+};
+
+/**
+ *	Processes a batch of ready sockets on an
+ *	`ares_channel` at once.
+ *
+ *	When libcares provides `ares_process_fds`
+ *	(1.34.0 and later) the entire batch is handed
+ *	to libcares in a single call, otherwise
+ *	`ares_process_fd` is invoked once for each
+ *	element of the batch. In either case timeouts
+ *	are processed even if the batch is empty.
+ *
+ *	\param [in] channel
+ *		The `ares_channel`.
+ *	\param [in] events
+ *		A pointer to the first element of an array
+ *		of \ref socket_events objects. May be null
+ *		if \em num is zero.
+ *	\param [in] num
+ *		The number of elements in the array pointed
+ *		to by \em events.
+ */
+void process_fds (ares_channel channel, const socket_events * events, std::size_t num);
+
+}
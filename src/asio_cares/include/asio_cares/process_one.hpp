@@ -8,6 +8,7 @@
 #include <asio_cares/channel.hpp>
 #include <asio_cares/detail/select.hpp>
 #include <asio_cares/done.hpp>
+#include <asio_cares/process_fds.hpp>
 #include <beast/core/async_result.hpp>
 #include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/handler_continuation_hook.hpp>
@@ -17,6 +18,7 @@
 #include <cstddef>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace asio_cares {
 
@@ -37,8 +39,8 @@ public:
 		:	inner_  (std::forward<DeducedHandler>(h)),
 			channel_(c)
 	{}
-	void operator () (boost::system::error_code ec, ares_socket_t readable, ares_socket_t writable) {
-		if (!ec) ares_process_fd(channel_, readable, writable);
+	void operator () (boost::system::error_code ec, select_result_type ready) {
+		if (!ec) process_fds(channel_, ready.data(), ready.size());
 		inner_(ec, done(channel_));
 	}
 	void operator () () {
@@ -73,9 +75,15 @@ private:
 }
 
 /**
- *	Asynchronously calls `ares_process` or
- *	`ares_process_fd` (which is actually called is
- *	an implementation detail) once.
+ *	Asynchronously waits for the sockets of a
+ *	\ref channel to become ready and then processes
+ *	every socket which became ready (see
+ *	\ref process_fds) once.
+ *
+ *	Queries submitted directly through libcares
+ *	(for example with `ares_send`) are processed
+ *	as well as those submitted with \ref async_send
+ *	(see \ref channel::active).
  *
  *	It is perfectly safe to invoke this function
  *	on a \ref channel with no outstanding queries.
@@ -83,6 +91,10 @@ private:
  *	immediately, without error, and with its second
  *	argument set to `true`.
  *
+ *	This function must not be invoked while an
+ *	operation initiated by \ref async_process is
+ *	outstanding on the same \ref channel.
+ *
  *	\tparam CompletionToken
  *		A type which represents the action to take
  *		upon the completion of the asynchronous
@@ -102,8 +114,7 @@ private:
  *		of type `boost::system::error_code` and
  *		represents the result of the operation. The
  *		second is the result of calling \ref done
- *		on \em c after `ares_process` or `ares_process_fd`
- *		was invoked.
+ *		on \em c after the ready sockets were processed.
  *
  *	\return
  *		Whatever is appropriate given \em CompletionToken.
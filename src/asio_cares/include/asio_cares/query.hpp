@@ -0,0 +1,342 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <asio_cares/arena.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/send.hpp>
+#include <beast/core/async_result.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace asio_cares {
+
+/**
+ *	Contains the record types which may be
+ *	queried with \ref async_query.
+ *
+ *	Each record type is a flat structure which
+ *	additionally carries the TTL of the record.
+ *	Names and text are views into the \ref arena
+ *	from which the records were allocated.
+ */
+namespace records {
+
+/**
+ *	An A record.
+ */
+class a {
+public:
+	static constexpr int type = 1;
+	boost::asio::ip::address_v4 address;
+	int                         ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, a &) noexcept;
+};
+
+/**
+ *	An AAAA record.
+ */
+class aaaa {
+public:
+	static constexpr int type = 28;
+	boost::asio::ip::address_v6 address;
+	int                         ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, aaaa &) noexcept;
+};
+
+/**
+ *	An SRV record.
+ */
+class srv {
+public:
+	static constexpr int type = 33;
+	unsigned short    priority;
+	unsigned short    weight;
+	unsigned short    port;
+	boost::string_ref target;
+	int               ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, srv &);
+};
+
+/**
+ *	A TXT record. The character strings of the
+ *	record are concatenated.
+ */
+class txt {
+public:
+	static constexpr int type = 16;
+	boost::string_ref text;
+	int               ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, txt &);
+};
+
+/**
+ *	An MX record.
+ */
+class mx {
+public:
+	static constexpr int type = 15;
+	unsigned short    preference;
+	boost::string_ref exchange;
+	int               ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, mx &);
+};
+
+/**
+ *	A PTR record.
+ */
+class ptr {
+public:
+	static constexpr int type = 12;
+	boost::string_ref name;
+	int               ttl;
+	static int parse (const unsigned char *, std::size_t, const detail::resource_record &, arena &, ptr &);
+};
+
+}
+
+/**
+ *	A contiguous sequence of records obtained from
+ *	a response.
+ *
+ *	Does not own the records, they remain valid
+ *	so long as the \ref arena from which they were
+ *	allocated is neither reset nor destroyed.
+ *
+ *	\tparam Record
+ *		One of the types in \ref records.
+ */
+template <typename Record>
+class query_result {
+public:
+	using value_type = Record;
+	using const_iterator = const Record *;
+	query_result () noexcept
+		:	begin_(nullptr),
+			size_ (0)
+	{}
+	query_result (const Record * begin, std::size_t size) noexcept
+		:	begin_(begin),
+			size_ (size)
+	{}
+	const_iterator begin () const noexcept {
+		return begin_;
+	}
+	const_iterator end () const noexcept {
+		return begin_ + size_;
+	}
+	std::size_t size () const noexcept {
+		return size_;
+	}
+	bool empty () const noexcept {
+		return size_ == 0;
+	}
+	const Record & operator [] (std::size_t i) const noexcept {
+		assert(i < size_);
+		return begin_[i];
+	}
+private:
+	const Record * begin_;
+	std::size_t    size_;
+};
+
+/**
+ *	Parses the answer section of a DNS response
+ *	into records of a certain type without any
+ *	allocation other than from an \ref arena.
+ *
+ *	Records of other types (for example CNAME
+ *	records) are skipped.
+ *
+ *	\tparam Record
+ *		One of the types in \ref records.
+ *
+ *	\param [in] abuf
+ *		The response.
+ *	\param [in] alen
+ *		The length of the response.
+ *	\param [in] a
+ *		The \ref arena from which records, names,
+ *		and text shall be allocated.
+ *	\param [out] result
+ *		A \ref query_result which shall be set to
+ *		the records on success.
+ *
+ *	\return
+ *		A libcares status code. The RCODE of the
+ *		response is mapped in the same manner as
+ *		`ares_query` and `ARES_ENODATA` is returned
+ *		if no record of the requested type is present.
+ */
+template <typename Record>
+int parse (const unsigned char * abuf, std::size_t alen, arena & a, query_result<Record> & result) {
+	static_assert(std::is_trivially_destructible<Record>::value, "Records are never destroyed");
+	std::size_t offset;
+	std::size_t count;
+	int status = detail::begin_answers(abuf, alen, offset, count);
+	if (status != ARES_SUCCESS) return status;
+	//	The answer count bounds the number of records
+	//	so they may be allocated contiguously up front,
+	//	every record occupies at least 11 bytes which
+	//	bounds the answer count
+	if (count > ((alen - offset) / 11)) return ARES_EBADRESP;
+	auto records = static_cast<Record *>(a.allocate(sizeof(Record) * count, alignof(Record)));
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		detail::resource_record rr;
+		status = detail::next_record(abuf, alen, offset, rr);
+		if (status != ARES_SUCCESS) return status;
+		if ((rr.type != Record::type) || (rr.dns_class != 1)) continue;
+		auto record = new (records + n) Record;
+		record->ttl = rr.ttl;
+		status = Record::parse(abuf, alen, rr, a, *record);
+		if (status != ARES_SUCCESS) return status;
+		++n;
+	}
+	if (n == 0) return ARES_ENODATA;
+	result = query_result<Record>(records, n);
+	return ARES_SUCCESS;
+}
+
+namespace detail {
+
+template <typename Record>
+using async_query_signature = void (boost::system::error_code, query_result<Record>);
+
+template <typename Record, typename Handler>
+class async_query_op {
+public:
+	async_query_op () = delete;
+	async_query_op (const async_query_op &) = default;
+	async_query_op (async_query_op &&) = default;
+	async_query_op & operator = (const async_query_op &) = default;
+	async_query_op & operator = (async_query_op &&) = default;
+	template <typename DeducedHandler>
+	async_query_op (DeducedHandler && h, arena & a, int status)
+		:	h_     (std::forward<DeducedHandler>(h)),
+			arena_ (&a),
+			status_(status)
+	{}
+	void operator () (boost::system::error_code ec, int, unsigned char * abuf, int alen) {
+		query_result<Record> result;
+		if (status_ != ARES_SUCCESS) {
+			ec = make_error_code(status_);
+		} else if (!ec) {
+			int status;
+			try {
+				status = parse(abuf, std::size_t(alen), *arena_, result);
+			} catch (const std::bad_alloc &) {
+				status = ARES_ENOMEM;
+			}
+			ec = make_error_code(status);
+			if (ec) result = query_result<Record>();
+		}
+		h_(ec, result);
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->h_));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
+	}
+	template <typename Function>
+	friend void asio_handler_invoke (Function && function, async_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(function, std::addressof(self->h_));
+	}
+	friend bool asio_handler_is_continuation (async_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->h_));
+	}
+private:
+	Handler h_;
+	arena * arena_;
+	int     status_;
+};
+
+}
+
+/**
+ *	Queries a name for records of a certain type
+ *	and parses the answer directly into a flat,
+ *	contiguous sequence of records allocated from
+ *	an \ref arena.
+ *
+ *	The query is encoded without allocation and sent
+ *	with \ref async_send, accordingly all guarantees
+ *	made thereby apply. When \ref async_send invokes
+ *	the completion in place the answer is parsed
+ *	without being copied. Once the \ref arena is warm
+ *	(or if it begins with a caller provided buffer of
+ *	sufficient size) no memory is allocated to parse
+ *	the answer.
+ *
+ *	\tparam Record
+ *		One of the types in \ref records.
+ *	\tparam CompletionToken
+ *		A type which represents the action to take
+ *		upon the completion of the asynchronous
+ *		operation and which determines the return
+ *		value (if any) of this initiating function.
+ *
+ *	\param [in] c
+ *		The \ref channel on which the query shall be
+ *		sent. This reference must remain valid for the
+ *		lifetime of the asynchronous operation or
+ *		the behavior is undefined.
+ *	\param [in] name
+ *		The name to query. If the name is not valid
+ *		the operation completes with `ARES_EBADNAME`.
+ *	\param [in] a
+ *		The \ref arena into which the records shall
+ *		be parsed. This reference must remain valid
+ *		for the lifetime of the asynchronous operation.
+ *	\param [in] token
+ *		The token which encapsulates the action to
+ *		take upon completion of the asynchronous
+ *		operation. The completion of this asynchronous
+ *		operation generates a `boost::system::error_code`
+ *		and a \ref query_result (which is empty on error).
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Record, typename CompletionToken>
+auto async_query (channel & c, const char * name, arena & a, CompletionToken && token) {
+	using signature = detail::async_query_signature<Record>;
+	beast::async_completion<CompletionToken, signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, signature>;
+	using op_type = detail::async_query_op<Record, handler_type>;
+	unsigned char qbuf [detail::max_query_size];
+	std::size_t qlen = 0;
+	int status = detail::create_query(name, Record::type, qbuf, qlen);
+	//	If the name is bad an empty query is sent
+	//	so the failure is reported asynchronously
+	//	like any other
+	async_send(c, qbuf, int(qlen), op_type(std::move(init.completion_handler), a, status));
+	return init.result.get();
+}
+
+}
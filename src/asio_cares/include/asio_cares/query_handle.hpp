@@ -0,0 +1,100 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+namespace asio_cares {
+
+namespace detail {
+
+//	An operation which may be cancelled through
+//	a query_handle
+class cancellable {
+public:
+	cancellable () = default;
+	cancellable (const cancellable &) = delete;
+	cancellable & operator = (const cancellable &) = delete;
+	//	Completes the operation with ARES_ECANCELLED,
+	//	by which time the handle has been detached
+	virtual void cancel () = 0;
+	//	The handle is being destroyed
+	virtual void release () noexcept = 0;
+protected:
+	~cancellable () = default;
+};
+
+}
+
+/**
+ *	Allows an individual query sent with \ref async_send
+ *	to be abandoned without affecting any other query
+ *	on the same \ref channel (unlike \ref cancel).
+ *
+ *	A handle is associated with at most one operation
+ *	at a time and is disassociated when that operation
+ *	completes. A handle may be reused once it is no
+ *	longer associated with an operation.
+ *
+ *	Handles are not thread safe and must only be used
+ *	on the `strand` of the \ref channel on which the
+ *	associated operation was initiated.
+ */
+class query_handle {
+public:
+	query_handle (const query_handle &) = delete;
+	query_handle (query_handle &&) = delete;
+	query_handle & operator = (const query_handle &) = delete;
+	query_handle & operator = (query_handle &&) = delete;
+	/**
+	 *	Creates a handle which is not associated with
+	 *	an operation.
+	 */
+	query_handle () noexcept;
+	/**
+	 *	Disassociates the handle from its operation
+	 *	(if any). The operation is not cancelled.
+	 */
+	~query_handle () noexcept;
+	/**
+	 *	Cancels the associated operation (if any).
+	 *
+	 *	The completion handler of the operation is
+	 *	posted with `ARES_ECANCELLED` and no answer.
+	 *	The query itself cannot be withdrawn from
+	 *	libcares so it remains outstanding on the
+	 *	\ref channel until it completes, at which point
+	 *	its answer is discarded (though it is still
+	 *	offered to the \ref cache and delivered to other
+	 *	queries coalesced with it).
+	 */
+	void cancel ();
+	/**
+	 *	Determines whether the handle is associated
+	 *	with an operation.
+	 *
+	 *	\return
+	 *		\em true if the handle is associated with an
+	 *		operation which has not yet completed, \em false
+	 *		otherwise.
+	 */
+	bool active () const noexcept;
+	/**
+	 *	Associates the handle with an operation. This
+	 *	is a low level interface, see \ref async_send.
+	 *
+	 *	\param [in] op
+	 *		The operation. The handle must not already be
+	 *		associated with an operation.
+	 */
+	void attach (detail::cancellable & op) noexcept;
+	/**
+	 *	Disassociates the handle from its operation.
+	 *	This is a low level interface, see \ref async_send.
+	 */
+	void detach () noexcept;
+private:
+	detail::cancellable * op_;
+};
+
+}
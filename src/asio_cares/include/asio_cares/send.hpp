@@ -4,19 +4,29 @@
 
 #pragma once
 
+#include <asio_cares/buffer_pool.hpp>
 #include <asio_cares/channel.hpp>
+#include <asio_cares/detail/allocate.hpp>
+#include <asio_cares/detail/inflight.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/detail/probe.hpp>
+#include <asio_cares/detail/refresh.hpp>
+#include <asio_cares/detail/submission.hpp>
+#include <asio_cares/detail/timer_wheel.hpp>
+#include <asio_cares/detail/wrap.hpp>
 #include <asio_cares/error.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/query_handle.hpp>
 #include <beast/core/async_result.hpp>
-#include <beast/core/handler_alloc.hpp>
 #include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/handler_continuation_hook.hpp>
 #include <boost/asio/handler_invoke_hook.hpp>
 #include <boost/system/error_code.hpp>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
-#include <cstdlib>
 #include <cstring>
-#include <exception>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -28,6 +38,12 @@ namespace detail {
 
 using async_send_signature = void (boost::system::error_code, int, unsigned char *, int);
 
+//	While the completion handler is invoked in
+//	place the answer is borrowed from libcares,
+//	if the completion must be transported to
+//	another context (i.e. it is copied or moved)
+//	the answer is copied into a pooled buffer
+//	which copies thereafter share
 template <typename Handler>
 class async_send_completion {
 public:
@@ -38,30 +54,47 @@ public:
 		:	h_       (other.h_),
 			ec_      (other.ec_),
 			timeouts_(other.timeouts_),
-			abuf_    (copy(other.abuf_, other.alen_)),
-			alen_    (other.alen_)
+			pool_    (other.pool_),
+			buffer_  (other.own()),
+			abuf_    (buffer_.data()),
+			alen_    (other.alen_),
+			id_      (other.id_)
 	{}
-	async_send_completion (async_send_completion && other) noexcept
+	async_send_completion (async_send_completion && other)
 		:	h_       (std::move(other.h_)),
 			ec_      (other.ec_),
 			timeouts_(other.timeouts_),
-			abuf_    (other.abuf_),
-			alen_    (other.alen_)
+			pool_    (other.pool_),
+			buffer_  (other.buffer_ ? std::move(other.buffer_) : other.own()),
+			abuf_    (buffer_.data()),
+			alen_    (other.alen_),
+			id_      (other.id_)
 	{
 		other.abuf_ = nullptr;
 	}
-	async_send_completion (Handler h, int status, int timeouts, const unsigned char * abuf, int alen) noexcept(
+	async_send_completion (Handler h, int status, int timeouts, buffer answer, probe_id id) noexcept(
 		std::is_nothrow_move_constructible<Handler>::value
 	)	:	h_       (std::move(h)),
 			ec_      (make_error_code(status)),
 			timeouts_(timeouts),
-			abuf_    (copy(abuf, alen)),
-			alen_    (alen)
+			pool_    (nullptr),
+			buffer_  (std::move(answer)),
+			abuf_    (buffer_.data()),
+			alen_    (int(buffer_.size())),
+			id_      (id)
+	{}
+	async_send_completion (Handler h, int status, int timeouts, unsigned char * abuf, int alen, buffer_pool & pool, probe_id id) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_       (std::move(h)),
+			ec_      (make_error_code(status)),
+			timeouts_(timeouts),
+			pool_    (&pool),
+			abuf_    ((alen == 0) ? nullptr : abuf),
+			alen_    (alen),
+			id_      (id)
 	{}
-	~async_send_completion () noexcept {
-		if (abuf_) std::free(abuf_);
-	}
 	void operator () () {
+		ASIO_CARES_PROBE2(send__handler, id_.ptr, ec_.value());
 		h_(ec_, timeouts_, abuf_, alen_);
 	}
 	friend void * asio_handler_allocate (std::size_t num, async_send_completion * self) {
@@ -74,11 +107,15 @@ public:
 		using boost::asio::asio_handler_deallocate;
 		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
 	}
+	//	The function is forwarded as an lvalue
+	//	so that the default hook invokes it in
+	//	place rather than invoking a copy (which
+	//	would copy a borrowed answer)
 	template <typename Function>
-	friend void asio_handler_invoke (Function function, async_send_completion * self) {
+	friend void asio_handler_invoke (Function && function, async_send_completion * self) {
 		assert(self);
 		using boost::asio::asio_handler_invoke;
-		asio_handler_invoke(std::move(function), std::addressof(self->h_));
+		asio_handler_invoke(function, std::addressof(self->h_));
 	}
 	friend bool asio_handler_is_continuation (async_send_completion * self) {
 		assert(self);
@@ -86,25 +123,29 @@ public:
 		return asio_handler_is_continuation(std::addressof(self->h_));
 	}
 private:
-	static unsigned char * copy (const unsigned char * abuf, int alen) {
-		if (alen == 0) return nullptr;
-		auto retr = static_cast<unsigned char *>(std::malloc(alen));
-		if (!retr) throw std::bad_alloc{};
-		std::memcpy(retr, abuf, alen);
-		return retr;
+	buffer own () const {
+		if (buffer_ || !abuf_) return buffer_;
+		return pool_->acquire(abuf_, std::size_t(alen_));
 	}
 	Handler                   h_;
 	boost::system::error_code ec_;
 	int                       timeouts_;
+	//	Only used while borrowing, at which point
+	//	the channel (and therefore the pool) is
+	//	guaranteed to be alive
+	buffer_pool *             pool_;
+	buffer                    buffer_;
 	unsigned char *           abuf_;
 	int                       alen_;
+	probe_id                  id_;
 };
 
+template <typename State>
+void send (State & state, const unsigned char * qbuf, int qlen);
+
 template <typename Handler>
-class async_send_state {
+class async_send_state final : public send_waiter, public submission {
 private:
-	using allocator = beast::handler_alloc<async_send_state, Handler>;
-	using allocator_traits = std::allocator_traits<allocator>;
 	using completion_type = async_send_completion<Handler>;
 public:
 	async_send_state () = delete;
@@ -113,8 +154,7 @@ public:
 	async_send_state & operator = (const async_send_state &) = delete;
 	async_send_state & operator = (async_send_state &&) = delete;
 	static async_send_state * create (Handler h, asio_cares::channel & c) {
-		allocator alloc(h);
-		async_send_state * retr = allocator_traits::allocate(alloc, 1);
+		auto retr = allocate_state<async_send_state>(c, h);
 		try {
 			new (retr) async_send_state(std::move(h), c);
 		} catch (...) {
@@ -125,60 +165,410 @@ public:
 			//	Handler throws, in which case Handler
 			//	wasn't moved so the allocator is still
 			//	valid
-			allocator_traits::deallocate(alloc, retr, 1);
+			deallocate_state(c, h, retr);
 			throw;
 		}
 		return retr;
 	}
+	//	The query is copied to follow the state so
+	//	that it may be sent later from another thread
+	static async_send_state * create (Handler h, asio_cares::channel & c, const unsigned char * qbuf, int qlen) {
+		std::size_t extra = (qlen > 0) ? std::size_t(qlen) : 0;
+		auto retr = allocate_state<async_send_state>(c, h, extra);
+		try {
+			new (retr) async_send_state(std::move(h), c);
+		} catch (...) {
+			deallocate_state(c, h, retr, extra);
+			throw;
+		}
+		retr->qlen_ = int(extra);
+		if (extra) std::memcpy(retr->query(), qbuf, extra);
+		return retr;
+	}
 	//	Even if this throws this object is
 	//	still destroyed
-	void complete (int status, int timeouts, const unsigned char * abuf, int alen) {
+	void complete (int status, int timeouts, unsigned char * abuf, int alen) {
 		bool in = in_;
-		auto && strand = c_.get_strand();
+		//	Completion from within the initiating
+		//	function means it must not detach
+		if (in && completed_) *completed_ = true;
+		auto && c = c_;
+		auto && strand = c.get_strand();
+		probe_id id(this);
 		auto h = free();
-		completion_type completion(std::move(h), status, timeouts, abuf, alen);
-		if (in) strand.post(std::move(completion));
-		else strand.dispatch(std::move(completion));
+		completion_type completion(std::move(h), status, timeouts, abuf, alen, c.get_buffer_pool(), id);
+		if (in) {
+			strand.post(std::move(completion));
+		} else if (strand.running_in_this_thread()) {
+			//	Equivalent to dispatch except the
+			//	completion is neither copied nor moved
+			//	and therefore the answer is not copied
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	//	Completes with a response from the cache,
+	//	always from within the initiating function
+	void complete (buffer answer) {
+		assert(in_);
+		auto && strand = c_.get_strand();
+		probe_id id(this);
+		completion_type completion(free(), ARES_SUCCESS, 0, std::move(answer), id);
+		strand.post(std::move(completion));
+	}
+	//	Completes an operation which joined another,
+	//	never from within the initiating function
+	virtual void complete (int status, int timeouts, const buffer & answer) override {
+		assert(!in_);
+		auto && strand = c_.get_strand();
+		probe_id id(this);
+		completion_type completion(free(), status, timeouts, answer, id);
+		if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	void inflight (detail::inflight * ptr) noexcept {
+		inflight_ = ptr;
+	}
+	detail::inflight * inflight () const noexcept {
+		return inflight_;
+	}
+	void destroy () noexcept {
+		free();
 	}
 	void detach () noexcept {
 		assert(in_);
 		in_ = false;
 	}
+	void watch (bool & completed) noexcept {
+		completed_ = &completed;
+	}
+	void start (metrics::timestamp t) noexcept {
+		start_ = t;
+	}
+	metrics::timestamp start () const noexcept {
+		return start_;
+	}
 	asio_cares::channel & channel () noexcept {
 		return c_;
 	}
+	//	Runs on the strand, completions are still
+	//	posted since the submitting thread may be
+	//	anywhere
+	virtual void run () noexcept override {
+		auto && c = c_;
+		detail::async_wrap(c, [&] () {
+			send(*this, query(), qlen_);
+		});
+	}
 private:
 	async_send_state (Handler h, asio_cares::channel & c) noexcept(
 		std::is_nothrow_move_constructible<Handler>::value
-	)	:	h_ (std::move(h)),
-			c_ (c),
-			in_(true)
+	)	:	h_        (std::move(h)),
+			c_        (c),
+			inflight_ (nullptr),
+			completed_(nullptr),
+			start_    (),
+			qlen_     (0),
+			in_       (true)
 	{}
 	~async_send_state () = default;
+	unsigned char * query () noexcept {
+		return reinterpret_cast<unsigned char *>(this + 1);
+	}
 	Handler free () noexcept {
 		Handler retr(std::move(h_));
-		allocator alloc(retr);
+		auto && c = c_;
+		std::size_t extra(qlen_);
 		this->~async_send_state();
-		allocator_traits::deallocate(alloc, this, 1);
+		deallocate_state(c, retr, this, extra);
 		return retr;
 	}
 	Handler               h_;
 	asio_cares::channel & c_;
+	detail::inflight *    inflight_;
+	bool *                completed_;
+	metrics::timestamp    start_;
+	int                   qlen_;
 	bool                  in_;
 };
 
-template <typename Function>
-void async_send_wrap (channel & c, Function && function) noexcept {
-	try {
-		function();
-	} catch (...) {
-		//	If this throws we're just done, it
-		//	goes into noexcept and the process
-		//	dies
-		c.get_io_service().post([ex = std::current_exception()] () mutable {
-			std::rethrow_exception(std::move(ex));
+//	Consults the cache, joins a query in flight,
+//	or sends the query, the state is consumed
+template <typename State>
+void send (State & state, const unsigned char * qbuf, int qlen) {
+	ASIO_CARES_PROBE1(send__start, &state);
+	auto && c = state.channel();
+	auto cache = c.get_cache();
+	if (cache && (qlen > 0)) {
+		//	Failing to consult the cache is not a
+		//	failure of the operation
+		buffer answer;
+		bool refresh = false;
+		try {
+			answer = cache->lookup(qbuf, std::size_t(qlen), c.get_buffer_pool(), refresh);
+		} catch (...) {}
+		if (answer) {
+			if (refresh) detail::refresh(c, qbuf, qlen);
+			state.complete(std::move(answer));
+			return;
+		}
+	}
+	if (c.get_coalescing() && (qlen > 0)) {
+		detail::question_key key;
+		if (detail::make_query_key(qbuf, std::size_t(qlen), key)) {
+			if (c.coalesce(key, state)) {
+				state.detach();
+				return;
+			}
+			state.inflight(c.begin_inflight(key));
+		}
+	}
+	bool completed = false;
+	state.watch(completed);
+	state.start(c.begin_query());
+	ASIO_CARES_PROBE1(query__send, &state);
+	ares_send(c, qbuf, qlen, [] (void * arg, int status, int timeouts, unsigned char * abuf, int alen) {
+		auto state = static_cast<State *>(arg);
+		ASIO_CARES_PROBE3(query__done, state, status, timeouts);
+		auto && c = state->channel();
+		c.end_query(status, timeouts, state->start());
+		auto waiter = c.end_inflight(state->inflight());
+		auto cache = c.get_cache();
+		if (cache && (status == ARES_SUCCESS)) {
+			//	Failing to cache the response is not
+			//	a failure of the operation
+			try {
+				cache->insert(abuf, std::size_t(alen));
+			} catch (...) {}
+		}
+		detail::complete_waiters(c, waiter, status, timeouts, abuf, alen);
+		detail::async_wrap(c, [&] () {
+			state->complete(status, timeouts, abuf, alen);
 		});
+	}, &state);
+	//	libcares may have invoked the callback (and
+	//	therefore destroyed the state) already
+	if (!completed) state.detach();
+}
+
+
+//	The state of an operation which may complete
+//	before its query (because it was cancelled or
+//	its deadline passed) and which must therefore
+//	outlive its completion handler so that libcares
+//	(or the query it joined) still has something to
+//	complete. Accordingly it is allocated from the
+//	memory resource of the channel or the heap rather
+//	than through the completion handler.
+template <typename Handler>
+class async_send_cancellable_state final : public send_waiter, public timer_wheel_entry, public cancellable {
+private:
+	using completion_type = async_send_completion<Handler>;
+public:
+	async_send_cancellable_state () = delete;
+	async_send_cancellable_state (const async_send_cancellable_state &) = delete;
+	async_send_cancellable_state (async_send_cancellable_state &&) = delete;
+	async_send_cancellable_state & operator = (const async_send_cancellable_state &) = delete;
+	async_send_cancellable_state & operator = (async_send_cancellable_state &&) = delete;
+	static async_send_cancellable_state * create (Handler h, asio_cares::channel & c) {
+		auto && r = resource(c);
+		auto ptr = r.allocate(sizeof(async_send_cancellable_state), alignof(async_send_cancellable_state));
+		try {
+			return new (ptr) async_send_cancellable_state(std::move(h), c);
+		} catch (...) {
+			r.deallocate(ptr, sizeof(async_send_cancellable_state), alignof(async_send_cancellable_state));
+			throw;
+		}
+	}
+	void complete (int status, int timeouts, unsigned char * abuf, int alen) {
+		bool in = in_;
+		if (in && completed_) *completed_ = true;
+		if (!live_) {
+			destroy();
+			return;
+		}
+		auto && c = c_;
+		auto && strand = c.get_strand();
+		probe_id id(this);
+		completion_type completion(free(), status, timeouts, abuf, alen, c.get_buffer_pool(), id);
+		if (in) {
+			strand.post(std::move(completion));
+		} else if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	void complete (buffer answer) {
+		assert(in_);
+		assert(live_);
+		auto && strand = c_.get_strand();
+		probe_id id(this);
+		completion_type completion(free(), ARES_SUCCESS, 0, std::move(answer), id);
+		strand.post(std::move(completion));
+	}
+	virtual void complete (int status, int timeouts, const buffer & answer) override {
+		assert(!in_);
+		if (!live_) {
+			destroy();
+			return;
+		}
+		auto && strand = c_.get_strand();
+		probe_id id(this);
+		completion_type completion(free(), status, timeouts, answer, id);
+		if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	//	Invoked through the query_handle, the
+	//	caller may be anywhere on the strand so the
+	//	completion is posted
+	virtual void cancel () override {
+		assert(!in_);
+		handle_ = nullptr;
+		probe_id id(this);
+		completion_type completion(abandon(), ARES_ECANCELLED, 0, buffer(), id);
+		c_.get_strand().post(std::move(completion));
+	}
+	virtual void release () noexcept override {
+		handle_ = nullptr;
+	}
+	//	Invoked by the channel from a handler on
+	//	the strand
+	virtual void expire () override {
+		assert(!in_);
+		if (!live_) return;
+		auto && strand = c_.get_strand();
+		probe_id id(this);
+		completion_type completion(abandon(), ARES_ETIMEOUT, 0, buffer(), id);
+		if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	void attach (query_handle & handle) noexcept {
+		handle_ = &handle;
+		handle.attach(*this);
+	}
+	void inflight (detail::inflight * ptr) noexcept {
+		inflight_ = ptr;
+	}
+	detail::inflight * inflight () const noexcept {
+		return inflight_;
+	}
+	void destroy () noexcept {
+		if (live_) {
+			free();
+			return;
+		}
+		auto && r = resource(c_);
+		this->~async_send_cancellable_state();
+		r.deallocate(this, sizeof(async_send_cancellable_state), alignof(async_send_cancellable_state));
+	}
+	void detach () noexcept {
+		assert(in_);
+		in_ = false;
 	}
+	void watch (bool & completed) noexcept {
+		completed_ = &completed;
+	}
+	void start (metrics::timestamp t) noexcept {
+		start_ = t;
+	}
+	metrics::timestamp start () const noexcept {
+		return start_;
+	}
+	asio_cares::channel & channel () noexcept {
+		return c_;
+	}
+private:
+	async_send_cancellable_state (Handler h, asio_cares::channel & c) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	c_        (c),
+			inflight_ (nullptr),
+			completed_(nullptr),
+			handle_   (nullptr),
+			start_    (),
+			live_     (true),
+			in_       (true)
+	{
+		new (&storage_) Handler(std::move(h));
+	}
+	~async_send_cancellable_state () {
+		if (live_) handler().~Handler();
+	}
+	static memory_resource & resource (asio_cares::channel & c) noexcept {
+		auto r = c.get_memory_resource();
+		return r ? *r : new_delete_resource();
+	}
+	Handler & handler () noexcept {
+		return *reinterpret_cast<Handler *>(&storage_);
+	}
+	//	Takes the completion handler leaving the
+	//	state to be destroyed when its query completes
+	Handler abandon () {
+		assert(live_);
+		if (linked) c_.cancel_deadline(*this);
+		if (handle_) handle_->detach();
+		handle_ = nullptr;
+		Handler retr(std::move(handler()));
+		handler().~Handler();
+		live_ = false;
+		return retr;
+	}
+	Handler free () {
+		Handler retr(abandon());
+		destroy();
+		return retr;
+	}
+	using storage_type = std::aligned_storage_t<sizeof(Handler), alignof(Handler)>;
+	storage_type          storage_;
+	asio_cares::channel & c_;
+	detail::inflight *    inflight_;
+	bool *                completed_;
+	query_handle *        handle_;
+	metrics::timestamp    start_;
+	bool                  live_;
+	bool                  in_;
+};
+
+template <typename CompletionToken>
+auto async_send (channel & c,
+                 const unsigned char * qbuf,
+                 int qlen,
+                 query_handle * handle,
+                 const std::chrono::steady_clock::duration * timeout,
+                 CompletionToken && token)
+{
+	beast::async_completion<CompletionToken, async_send_signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, async_send_signature>;
+	using state_type = async_send_cancellable_state<handler_type>;
+	auto state = state_type::create(std::move(init.completion_handler), c);
+	//	The deadline and handle are removed if the
+	//	operation completes within send
+	if (timeout) {
+		try {
+			c.schedule_deadline(*state, std::chrono::steady_clock::now() + *timeout);
+		} catch (...) {
+			state->destroy();
+			throw;
+		}
+	}
+	if (handle) state->attach(*handle);
+	send(*state, qbuf, qlen);
+	return init.result.get();
 }
 
 }
@@ -224,6 +614,25 @@ void async_send_wrap (channel & c, Function && function) noexcept {
  *	function and the invocation of \ref async_process
  *	or \ref async_process_one is technically unnecessary).
  *
+ *	If coalescing is enabled on the \ref channel (see
+ *	\ref channel::set_coalescing) and an identical
+ *	query is in flight the query is not sent, rather
+ *	the operation completes when that query completes.
+ *	In this case \em abuf is a copy of the answer
+ *	shared by all such operations (and its ID is that
+ *	of the query which was sent) which the completion
+ *	handler must not modify.
+ *
+ *	If a \ref cache has been placed in front of the
+ *	\ref channel (see \ref channel::set_cache) and it
+ *	contains a response to the query the query is not
+ *	sent and the completion handler is posted from
+ *	within this function with that response. If
+ *	the \ref cache deems the response due for a refresh
+ *	(see \ref cache::prefetch_policy) the query is sent
+ *	in the background and its response replaces the
+ *	retained response.
+ *
  *	\tparam CompletionToken
  *		A type which represents the action to take
  *		upon the completion of the asynchronous
@@ -253,7 +662,12 @@ void async_send_wrap (channel & c, Function && function) noexcept {
  *		three arguments are passed through as-is (with
  *		the exception of the fact that \em abuf shall
  *		be copied as necessary to transport the completion
- *		invocation to an appropriate context).
+ *		invocation to an appropriate context). When the
+ *		completion handler is invoked directly from the
+ *		context in which libcares provides the answer
+ *		\em abuf is not copied. In either case \em abuf
+ *		is only valid until the completion handler
+ *		returns.
  *
  *	\return
  *		Whatever is appropriate given \em CompletionToken.
@@ -264,14 +678,114 @@ auto async_send (channel & c, const unsigned char * qbuf, int qlen, CompletionTo
 	using handler_type = beast::handler_type<CompletionToken, detail::async_send_signature>;
 	using state_type = detail::async_send_state<handler_type>;
 	auto state = state_type::create(std::move(init.completion_handler), c);
-	ares_send(c, qbuf, qlen, [] (void * arg, int status, int timeouts, unsigned char * abuf, int alen) {
-		auto state = static_cast<state_type *>(arg);
-		detail::async_send_wrap(state->channel(), [&] () {
-			state->complete(status, timeouts, abuf, alen);
-		});
-	}, state);
-	state->detach();
+	detail::send(*state, qbuf, qlen);
 	return init.result.get();
 }
 
+/**
+ *	Sends a query as \ref async_send does and
+ *	associates the operation with a \ref query_handle
+ *	through which it may be cancelled individually.
+ *
+ *	The state of the operation is not allocated
+ *	through the completion handler since it must
+ *	outlive the completion handler if the operation
+ *	is cancelled before its query completes.
+ *
+ *	\param [in] c
+ *		See \ref async_send.
+ *	\param [in] qbuf
+ *		See \ref async_send.
+ *	\param [in] qlen
+ *		See \ref async_send.
+ *	\param [in] handle
+ *		The \ref query_handle. Must not be associated
+ *		with an operation.
+ *	\param [in] token
+ *		See \ref async_send. If the operation is
+ *		cancelled it completes with `ARES_ECANCELLED`
+ *		and no answer.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_send (channel & c, const unsigned char * qbuf, int qlen, query_handle & handle, CompletionToken && token) {
+	return detail::async_send(c, qbuf, qlen, &handle, nullptr, std::forward<CompletionToken>(token));
+}
+
+/**
+ *	Sends a query as \ref async_send does but
+ *	completes the operation with `ARES_ETIMEOUT`
+ *	(and no answer) if the query has not completed
+ *	within a certain length of time.
+ *
+ *	Deadlines are kept in a timer wheel owned by the
+ *	\ref channel (see \ref channel::schedule_deadline)
+ *	so outstanding deadlines do not each need a timer.
+ *	When the deadline passes the query itself remains
+ *	outstanding in libcares until its own timeout (see
+ *	\ref query_handle::cancel) and other queries on
+ *	the \ref channel are unaffected.
+ *
+ *	\param [in] c
+ *		See \ref async_send.
+ *	\param [in] qbuf
+ *		See \ref async_send.
+ *	\param [in] qlen
+ *		See \ref async_send.
+ *	\param [in] timeout
+ *		The length of time after which the operation
+ *		shall complete regardless. The resolution is
+ *		one millisecond.
+ *	\param [in] token
+ *		See \ref async_send.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_send (channel & c,
+                 const unsigned char * qbuf,
+                 int qlen,
+                 std::chrono::steady_clock::duration timeout,
+                 CompletionToken && token)
+{
+	return detail::async_send(c, qbuf, qlen, nullptr, &timeout, std::forward<CompletionToken>(token));
+}
+
+/**
+ *	Sends a query as \ref async_send does with both
+ *	a \ref query_handle and a deadline (see the
+ *	overloads which accept either).
+ *
+ *	\param [in] c
+ *		See \ref async_send.
+ *	\param [in] qbuf
+ *		See \ref async_send.
+ *	\param [in] qlen
+ *		See \ref async_send.
+ *	\param [in] handle
+ *		The \ref query_handle. Must not be associated
+ *		with an operation.
+ *	\param [in] timeout
+ *		The length of time after which the operation
+ *		shall complete with `ARES_ETIMEOUT` regardless.
+ *	\param [in] token
+ *		See \ref async_send.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_send (channel & c,
+                 const unsigned char * qbuf,
+                 int qlen,
+                 query_handle & handle,
+                 std::chrono::steady_clock::duration timeout,
+                 CompletionToken && token)
+{
+	return detail::async_send(c, qbuf, qlen, &handle, &timeout, std::forward<CompletionToken>(token));
+}
+
 }
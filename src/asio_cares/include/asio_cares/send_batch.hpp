@@ -0,0 +1,367 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <ares.h>
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/allocate.hpp>
+#include <asio_cares/detail/inflight.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/send.hpp>
+#include <beast/core/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/system/error_code.hpp>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace asio_cares {
+
+/**
+ *	The result of one query sent by
+ *	\ref async_send_batch.
+ */
+class send_result {
+public:
+	/**
+	 *	The result of the query.
+	 */
+	boost::system::error_code ec;
+	/**
+	 *	The number of timeouts which occurred (see
+	 *	`ares_callback`).
+	 */
+	int                       timeouts;
+	/**
+	 *	The answer, empty if there was none.
+	 */
+	buffer                    answer;
+};
+
+/**
+ *	A collection of \ref send_result objects.
+ */
+using send_results = std::vector<send_result, polymorphic_allocator<send_result>>;
+
+namespace detail {
+
+using async_send_batch_signature = void (boost::system::error_code);
+
+template <typename Handler>
+class async_send_batch_completion {
+public:
+	async_send_batch_completion () = delete;
+	async_send_batch_completion (const async_send_batch_completion &) = default;
+	async_send_batch_completion (async_send_batch_completion &&) = default;
+	async_send_batch_completion & operator = (const async_send_batch_completion &) = delete;
+	async_send_batch_completion & operator = (async_send_batch_completion &&) = delete;
+	async_send_batch_completion (Handler h, boost::system::error_code ec) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_ (std::move(h)),
+			ec_(ec)
+	{}
+	void operator () () {
+		h_(ec_);
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_send_batch_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->h_));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_send_batch_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
+	}
+	template <typename Function>
+	friend void asio_handler_invoke (Function && function, async_send_batch_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(function, std::addressof(self->h_));
+	}
+	friend bool asio_handler_is_continuation (async_send_batch_completion * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->h_));
+	}
+private:
+	Handler                   h_;
+	boost::system::error_code ec_;
+};
+
+template <typename Handler>
+class async_send_batch_state;
+
+//	One query of a batch, these follow the state
+//	of the batch in the same allocation and provide
+//	the interface detail::send expects of a state
+template <typename Handler>
+class async_send_batch_slot final : public send_waiter {
+public:
+	async_send_batch_slot () = delete;
+	async_send_batch_slot (const async_send_batch_slot &) = delete;
+	async_send_batch_slot (async_send_batch_slot &&) = delete;
+	async_send_batch_slot & operator = (const async_send_batch_slot &) = delete;
+	async_send_batch_slot & operator = (async_send_batch_slot &&) = delete;
+	async_send_batch_slot (async_send_batch_state<Handler> & state, send_result & result) noexcept
+		:	state_    (&state),
+			result_   (&result),
+			inflight_ (nullptr),
+			completed_(nullptr),
+			start_    (),
+			in_       (true)
+	{}
+	~async_send_batch_slot () = default;
+	void complete (int status, int timeouts, unsigned char * abuf, int alen) {
+		if (in_ && completed_) *completed_ = true;
+		result_->ec = make_error_code(status);
+		result_->timeouts = timeouts;
+		if (abuf && (alen > 0)) {
+			try {
+				result_->answer = channel().get_buffer_pool().acquire(abuf, std::size_t(alen));
+			} catch (...) {
+				result_->ec = make_error_code(ARES_ENOMEM);
+			}
+		}
+		state_->complete_one();
+	}
+	void complete (buffer answer) {
+		result_->ec = make_error_code(ARES_SUCCESS);
+		result_->timeouts = 0;
+		result_->answer = std::move(answer);
+		state_->complete_one();
+	}
+	virtual void complete (int status, int timeouts, const buffer & answer) override {
+		result_->ec = make_error_code(status);
+		result_->timeouts = timeouts;
+		result_->answer = answer;
+		state_->complete_one();
+	}
+	void inflight (detail::inflight * ptr) noexcept {
+		inflight_ = ptr;
+	}
+	detail::inflight * inflight () const noexcept {
+		return inflight_;
+	}
+	void detach () noexcept {
+		in_ = false;
+	}
+	void watch (bool & completed) noexcept {
+		completed_ = &completed;
+	}
+	void start (metrics::timestamp t) noexcept {
+		start_ = t;
+	}
+	metrics::timestamp start () const noexcept {
+		return start_;
+	}
+	asio_cares::channel & channel () noexcept {
+		return state_->channel();
+	}
+private:
+	async_send_batch_state<Handler> * state_;
+	send_result *                     result_;
+	detail::inflight *                inflight_;
+	bool *                            completed_;
+	metrics::timestamp                start_;
+	bool                              in_;
+};
+
+template <typename Handler>
+class async_send_batch_state {
+private:
+	using completion_type = async_send_batch_completion<Handler>;
+	using slot_type = async_send_batch_slot<Handler>;
+	static_assert(alignof(slot_type) <= alignof(std::max_align_t), "Slots must not be over aligned");
+public:
+	async_send_batch_state () = delete;
+	async_send_batch_state (const async_send_batch_state &) = delete;
+	async_send_batch_state (async_send_batch_state &&) = delete;
+	async_send_batch_state & operator = (const async_send_batch_state &) = delete;
+	async_send_batch_state & operator = (async_send_batch_state &&) = delete;
+	//	The state and every slot are allocated as
+	//	one block
+	static async_send_batch_state * create (Handler h, asio_cares::channel & c, send_results & results) {
+		auto extra = extra_size(results.size());
+		auto retr = allocate_state<async_send_batch_state>(c, h, extra);
+		try {
+			new (retr) async_send_batch_state(std::move(h), c, results);
+		} catch (...) {
+			deallocate_state(c, h, retr, extra);
+			throw;
+		}
+		for (std::size_t i = 0; i < results.size(); ++i) new (std::addressof(retr->slot(i))) slot_type(*retr, results[i]);
+		return retr;
+	}
+	slot_type & slot (std::size_t i) noexcept {
+		assert(i < results_.size());
+		auto base = reinterpret_cast<unsigned char *>(this + 1) + padding();
+		return reinterpret_cast<slot_type *>(base)[i];
+	}
+	//	Invoked once by the initiating function after
+	//	every query has been sent, the batch cannot
+	//	complete before then
+	void release () {
+		assert(in_);
+		assert(remaining_);
+		if (--remaining_ == 0) {
+			complete();
+			return;
+		}
+		in_ = false;
+	}
+	void complete_one () {
+		assert(remaining_);
+		if (--remaining_ == 0) complete();
+	}
+	asio_cares::channel & channel () noexcept {
+		return c_;
+	}
+private:
+	async_send_batch_state (Handler h, asio_cares::channel & c, send_results & results) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_        (std::move(h)),
+			c_        (c),
+			results_  (results),
+			remaining_(results.size() + 1),
+			in_       (true)
+	{}
+	~async_send_batch_state () = default;
+	static constexpr std::size_t padding () noexcept {
+		return (alignof(slot_type) - (sizeof(async_send_batch_state) % alignof(slot_type))) % alignof(slot_type);
+	}
+	static std::size_t extra_size (std::size_t num) noexcept {
+		return padding() + (num * sizeof(slot_type));
+	}
+	//	Even if this throws this object is
+	//	still destroyed
+	void complete () {
+		//	The operation fails with the error of the
+		//	first query which failed (if any)
+		boost::system::error_code ec;
+		for (auto && result : results_) if (result.ec) {
+			ec = result.ec;
+			break;
+		}
+		bool in = in_;
+		auto && strand = c_.get_strand();
+		completion_type completion(free(), ec);
+		if (in) {
+			strand.post(std::move(completion));
+		} else if (strand.running_in_this_thread()) {
+			using boost::asio::asio_handler_invoke;
+			asio_handler_invoke(completion, std::addressof(completion));
+		} else {
+			strand.post(std::move(completion));
+		}
+	}
+	Handler free () noexcept {
+		Handler retr(std::move(h_));
+		auto && c = c_;
+		auto num = results_.size();
+		for (std::size_t i = 0; i < num; ++i) slot(i).~slot_type();
+		this->~async_send_batch_state();
+		deallocate_state(c, retr, this, extra_size(num));
+		return retr;
+	}
+	Handler               h_;
+	asio_cares::channel & c_;
+	send_results &        results_;
+	std::size_t           remaining_;
+	bool                  in_;
+};
+
+}
+
+/**
+ *	Sends a range of queries in the manner of
+ *	\ref async_send and completes once every query
+ *	has completed.
+ *
+ *	The state of every query is held in a single
+ *	allocation and every query is sent (or answered
+ *	from the \ref cache, or joined to a query in
+ *	flight) from within this function, so a batch
+ *	costs one initiation rather than one per query.
+ *
+ *	The completion handler is invoked with the same
+ *	guarantees as those given by \ref async_send: It
+ *	is never invoked from within this function, is
+ *	invoked on the `strand` associated with the
+ *	\ref channel, and is invoked in a manner consistent
+ *	with `asio_handler_invoke`. This function must be
+ *	invoked on that `strand`.
+ *
+ *	\tparam Range
+ *		A range of queries. Each element must be
+ *		acceptable to `boost::asio::buffer`.
+ *	\tparam CompletionToken
+ *		A type which represents the action to take
+ *		upon the completion of the asynchronous
+ *		operation and which determines the return
+ *		value (if any) of this initiating function.
+ *
+ *	\param [in] c
+ *		The \ref channel on which the queries shall be
+ *		sent. This reference must remain valid for the
+ *		lifetime of the asynchronous operation or
+ *		the behavior is undefined.
+ *	\param [in] queries
+ *		The queries. Need only remain valid until this
+ *		function returns.
+ *	\param [out] results
+ *		A collection which shall be resized to the
+ *		number of queries and into which the result
+ *		of each query shall be placed in the same order
+ *		as \em queries. This reference must remain valid
+ *		for the lifetime of the asynchronous operation
+ *		and the collection must not be accessed until
+ *		it completes.
+ *	\param [in] token
+ *		The token which encapsulates the action to
+ *		take upon completion of the asynchronous
+ *		operation. The completion of this asynchronous
+ *		operation generates one value of type
+ *		`boost::system::error_code` which is the error
+ *		of the first query (in the order of \em queries)
+ *		which failed, if any.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Range, typename CompletionToken>
+auto async_send_batch (channel & c, const Range & queries, send_results & results, CompletionToken && token) {
+	beast::async_completion<CompletionToken, detail::async_send_batch_signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, detail::async_send_batch_signature>;
+	using state_type = detail::async_send_batch_state<handler_type>;
+	using std::begin;
+	using std::end;
+	results.clear();
+	results.resize(std::size_t(std::distance(begin(queries), end(queries))));
+	auto state = state_type::create(std::move(init.completion_handler), c, results);
+	std::size_t i = 0;
+	for (auto && query : queries) {
+		boost::asio::const_buffer b(boost::asio::buffer(query));
+		auto qbuf = boost::asio::buffer_cast<const unsigned char *>(b);
+		auto qlen = int(boost::asio::buffer_size(b));
+		detail::send(state->slot(i), qbuf, qlen);
+		++i;
+	}
+	state->release();
+	return init.result.get();
+}
+
+}
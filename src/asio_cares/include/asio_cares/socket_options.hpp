@@ -0,0 +1,97 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/asio/ip/udp.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace asio_cares {
+
+/**
+ *	Options which an \ref channel applies to each
+ *	UDP socket it opens on behalf of libcares.
+ *
+ *	Options which are zero or \em false are left
+ *	as the operating system sets them. Options which
+ *	are marked as Linux only have no effect elsewhere.
+ *	If an option cannot be set the socket is not
+ *	opened and libcares sees the error.
+ */
+class socket_options {
+public:
+	/**
+	 *	The type of callback which may be set as
+	 *	\ref callback.
+	 *
+	 *	The first argument is the newly opened socket,
+	 *	the second is an error code which the callback
+	 *	may set to prevent the socket being used, and
+	 *	the third is \ref callback_data. Callbacks of
+	 *	this type must not throw.
+	 */
+	using callback_type = void (*) (boost::asio::ip::udp::socket &, boost::system::error_code &, void *);
+	/**
+	 *	Creates a socket_options object which leaves
+	 *	every option as the operating system sets it.
+	 */
+	socket_options () noexcept;
+	/**
+	 *	The size of the receive buffer in bytes
+	 *	(`SO_RCVBUF`).
+	 */
+	int receive_buffer_size;
+	/**
+	 *	The size of the send buffer in bytes
+	 *	(`SO_SNDBUF`).
+	 */
+	int send_buffer_size;
+	/**
+	 *	The number of microseconds to busy poll the
+	 *	device queue when receiving would block
+	 *	(`SO_BUSY_POLL`, Linux only). Exceeding the
+	 *	`net.core.busy_read` sysctl requires
+	 *	`CAP_NET_ADMIN`.
+	 */
+	int busy_poll;
+	/**
+	 *	Whether every ICMP error is reported against
+	 *	the socket rather than only those the operating
+	 *	system deems fatal (`IP_RECVERR` or `IPV6_RECVERR`,
+	 *	Linux only). This allows libcares to move to
+	 *	another server as soon as one becomes unreachable
+	 *	rather than once queries thereto time out.
+	 */
+	bool receive_errors;
+	/**
+	 *	Whether the number of datagrams the kernel drops
+	 *	because the receive buffer is full is tracked
+	 *	(`SO_RXQ_OVFL`, Linux only). Drops are reported
+	 *	by \ref channel::for_each_drop_count and counted
+	 *	by \ref metrics::drops.
+	 */
+	bool track_drops;
+	/**
+	 *	The size in bytes up to which the receive buffer
+	 *	of a socket is doubled each time drops are
+	 *	observed thereupon. Zero disables this. Only
+	 *	effective if \ref track_drops is set. Sizes beyond
+	 *	the `net.core.rmem_max` sysctl are capped thereto,
+	 *	once the buffer of a socket stops growing it is
+	 *	not grown again.
+	 */
+	int max_receive_buffer_size;
+	/**
+	 *	A callback invoked after the other options have
+	 *	been applied which may set options of its own,
+	 *	or a null pointer.
+	 */
+	callback_type callback;
+	/**
+	 *	The pointer passed to \ref callback.
+	 */
+	void * callback_data;
+};
+
+}
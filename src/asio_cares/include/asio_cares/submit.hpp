@@ -0,0 +1,73 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/probe.hpp>
+#include <asio_cares/send.hpp>
+#include <beast/core/async_result.hpp>
+
+namespace asio_cares {
+
+/**
+ *	Submits a query in the manner of \ref async_send
+ *	except that this function may be invoked from any
+ *	thread without first entering the `strand` of the
+ *	\ref channel.
+ *
+ *	The query is copied and handed to the \ref channel
+ *	through a lock free queue (see \ref channel::submit).
+ *	Queries submitted in a burst are sent by a single
+ *	handler on the `strand` rather than each requiring
+ *	its own handler.
+ *
+ *	The completion handler is invoked on the `strand`
+ *	of the \ref channel and never from within this
+ *	function. As with \ref async_send it may be invoked
+ *	directly from the context in which libcares
+ *	provides the answer (in which case \em abuf is
+ *	not copied), otherwise it is posted. In all other
+ *	respects the semantics are those of \ref async_send.
+ *	The query counts as outstanding (see \ref done)
+ *	from the time this function returns.
+ *
+ *	If the \ref channel allocates from a \ref memory_resource
+ *	that resource must be safe to use from every
+ *	thread which invokes this function.
+ *
+ *	\tparam CompletionToken
+ *		A type which represents the action to take
+ *		upon the completion of the asynchronous
+ *		operation and which determines the return
+ *		value (if any) of this initiating function.
+ *
+ *	\param [in] c
+ *		The \ref channel on which the query shall be
+ *		sent. This reference must remain valid for the
+ *		lifetime of the asynchronous operation or
+ *		the behavior is undefined.
+ *	\param [in] qbuf
+ *		The query. Need only remain valid until this
+ *		function returns.
+ *	\param [in] qlen
+ *		The length of the query.
+ *	\param [in] token
+ *		See \ref async_send.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_submit (channel & c, const unsigned char * qbuf, int qlen, CompletionToken && token) {
+	beast::async_completion<CompletionToken, detail::async_send_signature> init(token);
+	using handler_type = beast::handler_type<CompletionToken, detail::async_send_signature>;
+	using state_type = detail::async_send_state<handler_type>;
+	auto state = state_type::create(std::move(init.completion_handler), c, qbuf, qlen);
+	ASIO_CARES_PROBE1(send__submit, state);
+	c.submit(*state);
+	return init.result.get();
+}
+
+}
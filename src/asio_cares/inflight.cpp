@@ -0,0 +1,32 @@
+#include <asio_cares/detail/inflight.hpp>
+
+#include <ares.h>
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/wrap.hpp>
+#include <cstddef>
+
+namespace asio_cares {
+namespace detail {
+
+void complete_waiters (channel & c, send_waiter * waiter, int status, int timeouts, const unsigned char * abuf, int alen) noexcept {
+	if (!waiter) return;
+	//	One copy of the answer is shared by
+	//	every operation which joined the query
+	buffer answer;
+	try {
+		if (abuf) answer = c.get_buffer_pool().acquire(abuf, std::size_t(alen));
+	} catch (...) {
+		status = ARES_ENOMEM;
+	}
+	while (waiter) {
+		auto next = waiter->next;
+		async_wrap(c, [&] () {
+			waiter->complete(status, timeouts, answer);
+		});
+		waiter = next;
+	}
+}
+
+}
+}
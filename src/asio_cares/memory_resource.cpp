@@ -0,0 +1,127 @@
+#include <asio_cares/memory_resource.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace asio_cares {
+
+constexpr std::size_t memory_resource::max_align;
+
+memory_resource::~memory_resource () noexcept {}
+
+void * memory_resource::allocate (std::size_t bytes, std::size_t alignment) {
+	return do_allocate(bytes, alignment);
+}
+
+void memory_resource::deallocate (void * ptr, std::size_t bytes, std::size_t alignment) noexcept {
+	do_deallocate(ptr, bytes, alignment);
+}
+
+bool memory_resource::is_equal (const memory_resource & other) const noexcept {
+	return do_is_equal(other);
+}
+
+namespace {
+
+class new_delete_resource_impl : public memory_resource {
+private:
+	virtual void * do_allocate (std::size_t bytes, std::size_t alignment) override {
+		if (alignment > max_align) throw std::bad_alloc{};
+		return ::operator new(bytes);
+	}
+	virtual void do_deallocate (void * ptr, std::size_t, std::size_t) noexcept override {
+		::operator delete(ptr);
+	}
+	virtual bool do_is_equal (const memory_resource & other) const noexcept override {
+		return this == &other;
+	}
+};
+
+}
+
+memory_resource & new_delete_resource () noexcept {
+	static new_delete_resource_impl retr;
+	return retr;
+}
+
+constexpr std::size_t slab_resource::min_size;
+constexpr std::size_t slab_resource::classes;
+
+slab_resource::slab_resource (memory_resource & upstream, std::size_t max)
+	:	upstream_(upstream),
+		max_     (max)
+{
+	for (std::size_t i = 0; i < classes; ++i) {
+		free_[i] = nullptr;
+		cached_[i] = 0;
+	}
+}
+
+slab_resource::~slab_resource () noexcept {
+	release();
+}
+
+memory_resource & slab_resource::upstream () const noexcept {
+	return upstream_;
+}
+
+void slab_resource::release () noexcept {
+	std::lock_guard<std::mutex> l(m_);
+	for (std::size_t i = 0; i < classes; ++i) {
+		while (free_[i]) {
+			auto next = free_[i]->next;
+			upstream_.deallocate(free_[i], min_size << i);
+			free_[i] = next;
+		}
+		cached_[i] = 0;
+	}
+}
+
+std::size_t slab_resource::size_class (std::size_t bytes) noexcept {
+	std::size_t retr = 0;
+	for (std::size_t size = min_size; size < bytes; size <<= 1) ++retr;
+	return retr;
+}
+
+void * slab_resource::do_allocate (std::size_t bytes, std::size_t alignment) {
+	auto c = size_class(bytes);
+	if ((c >= classes) || (alignment > max_align)) return upstream_.allocate(bytes, alignment);
+	{
+		std::lock_guard<std::mutex> l(m_);
+		if (free_[c]) {
+			auto retr = free_[c];
+			free_[c] = retr->next;
+			--cached_[c];
+			return retr;
+		}
+	}
+	return upstream_.allocate(min_size << c);
+}
+
+void slab_resource::do_deallocate (void * ptr, std::size_t bytes, std::size_t alignment) noexcept {
+	assert(ptr);
+	auto c = size_class(bytes);
+	if ((c >= classes) || (alignment > max_align)) {
+		upstream_.deallocate(ptr, bytes, alignment);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l(m_);
+		if (cached_[c] < max_) {
+			auto b = new (ptr) block;
+			b->next = free_[c];
+			free_[c] = b;
+			++cached_[c];
+			return;
+		}
+	}
+	upstream_.deallocate(ptr, min_size << c);
+}
+
+bool slab_resource::do_is_equal (const memory_resource & other) const noexcept {
+	return this == &other;
+}
+
+}
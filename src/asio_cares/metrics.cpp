@@ -0,0 +1,234 @@
+#include <asio_cares/metrics.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace asio_cares {
+
+constexpr std::size_t latency_histogram::sub_buckets;
+constexpr std::size_t latency_histogram::magnitudes;
+constexpr std::size_t latency_histogram::buckets;
+
+latency_histogram::latency_histogram () noexcept {
+	for (auto && bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t latency_histogram::count (std::size_t i) const noexcept {
+	return buckets_[i].load(std::memory_order_relaxed);
+}
+
+std::uint64_t latency_histogram::count () const noexcept {
+	std::uint64_t retr = 0;
+	for (auto && bucket : buckets_) retr += bucket.load(std::memory_order_relaxed);
+	return retr;
+}
+
+std::chrono::microseconds latency_histogram::percentile (double p) const noexcept {
+	std::array<std::uint64_t, buckets> counts;
+	std::uint64_t total = 0;
+	for (std::size_t i = 0; i < buckets; ++i) {
+		counts[i] = count(i);
+		total += counts[i];
+	}
+	if (total == 0) return std::chrono::microseconds::zero();
+	if (p < 0) p = 0;
+	if (p > 1) p = 1;
+	//	The rank of the percentile counting from one
+	std::uint64_t rank = std::uint64_t(p * double(total - 1)) + 1;
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < buckets; ++i) {
+		seen += counts[i];
+		if (seen >= rank) return upper_bound(i);
+	}
+	return upper_bound(buckets - 1);
+}
+
+std::chrono::microseconds latency_histogram::lower_bound (std::size_t i) noexcept {
+	if (i < sub_buckets) return std::chrono::microseconds(i);
+	std::size_t shift = (i - sub_buckets) / sub_buckets;
+	std::size_t sub = (i - sub_buckets) % sub_buckets;
+	return std::chrono::microseconds(std::uint64_t(sub_buckets + sub) << shift);
+}
+
+std::chrono::microseconds latency_histogram::upper_bound (std::size_t i) noexcept {
+	if (i < sub_buckets) return std::chrono::microseconds(i + 1);
+	std::size_t shift = (i - sub_buckets) / sub_buckets;
+	std::size_t sub = (i - sub_buckets) % sub_buckets;
+	return std::chrono::microseconds(std::uint64_t(sub_buckets + sub + 1) << shift);
+}
+
+std::size_t latency_histogram::index (std::uint64_t us) noexcept {
+	if (us < sub_buckets) return std::size_t(us);
+	//	Finds the most significant bit by binary
+	//	search
+	unsigned msb = 0;
+	for (unsigned step = 32; step != 0; step /= 2) {
+		if (us >> (msb + step)) msb += step;
+	}
+	if (msb >= magnitudes) return buckets - 1;
+	//	Four is the most significant bit of sub_buckets
+	unsigned shift = msb - 4;
+	return sub_buckets + (shift * sub_buckets) + std::size_t((us >> shift) - sub_buckets);
+}
+
+constexpr bool metrics::enabled;
+constexpr std::size_t metrics::statuses;
+
+metrics::metrics () noexcept {
+	#ifndef ASIO_CARES_NO_METRICS
+	submitted_.store(0, std::memory_order_relaxed);
+	completed_.store(0, std::memory_order_relaxed);
+	for (auto && c : failed_) c.store(0, std::memory_order_relaxed);
+	timeouts_.store(0, std::memory_order_relaxed);
+	retries_.store(0, std::memory_order_relaxed);
+	sockets_.store(0, std::memory_order_relaxed);
+	wakeups_.store(0, std::memory_order_relaxed);
+	syscalls_.store(0, std::memory_order_relaxed);
+	reused_.store(0, std::memory_order_relaxed);
+	drops_.store(0, std::memory_order_relaxed);
+	#endif
+}
+
+#ifdef ASIO_CARES_NO_METRICS
+
+std::uint64_t metrics::submitted () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::completed () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::failed () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::failed (int) const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::timeouts () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::retries () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::in_flight () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::sockets () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::wakeups () const noexcept {
+	return 0;
+}
+
+double metrics::wakeups_per_answer () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::syscalls () const noexcept {
+	return 0;
+}
+
+double metrics::syscalls_per_answer () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::reused () const noexcept {
+	return 0;
+}
+
+std::uint64_t metrics::drops () const noexcept {
+	return 0;
+}
+
+const latency_histogram & metrics::latency () const noexcept {
+	static const latency_histogram empty;
+	return empty;
+}
+
+#else
+
+std::uint64_t metrics::submitted () const noexcept {
+	return submitted_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::completed () const noexcept {
+	return completed_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::failed () const noexcept {
+	std::uint64_t retr = 0;
+	for (auto && c : failed_) retr += c.load(std::memory_order_relaxed);
+	return retr;
+}
+
+std::uint64_t metrics::failed (int status) const noexcept {
+	if (status == 0) return 0;
+	if ((status < 0) || (std::size_t(status) >= statuses)) status = int(statuses - 1);
+	return failed_[std::size_t(status)].load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::timeouts () const noexcept {
+	return timeouts_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::retries () const noexcept {
+	return retries_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::in_flight () const noexcept {
+	//	Completions are read first so that a query
+	//	which completes in between is not counted
+	//	as completed but not submitted
+	auto completed = completed_.load(std::memory_order_relaxed);
+	auto submitted = submitted_.load(std::memory_order_relaxed);
+	return (submitted > completed) ? (submitted - completed) : 0;
+}
+
+std::uint64_t metrics::sockets () const noexcept {
+	return sockets_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::wakeups () const noexcept {
+	return wakeups_.load(std::memory_order_relaxed);
+}
+
+double metrics::wakeups_per_answer () const noexcept {
+	auto answers = completed();
+	if (answers == 0) return 0;
+	return double(wakeups()) / double(answers);
+}
+
+std::uint64_t metrics::syscalls () const noexcept {
+	return syscalls_.load(std::memory_order_relaxed);
+}
+
+double metrics::syscalls_per_answer () const noexcept {
+	auto answers = completed();
+	if (answers == 0) return 0;
+	return double(syscalls()) / double(answers);
+}
+
+std::uint64_t metrics::reused () const noexcept {
+	return reused_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t metrics::drops () const noexcept {
+	return drops_.load(std::memory_order_relaxed);
+}
+
+const latency_histogram & metrics::latency () const noexcept {
+	return latency_;
+}
+
+#endif
+
+}
@@ -0,0 +1,268 @@
+#include <asio_cares/detail/parse.hpp>
+
+#include <ares.h>
+#include <asio_cares/arena.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace asio_cares {
+namespace detail {
+
+unsigned short read_16 (const unsigned char * ptr) noexcept {
+	return static_cast<unsigned short>((ptr[0] << 8) | ptr[1]);
+}
+
+unsigned long read_32 (const unsigned char * ptr) noexcept {
+	return (static_cast<unsigned long>(ptr[0]) << 24) |
+	       (static_cast<unsigned long>(ptr[1]) << 16) |
+	       (static_cast<unsigned long>(ptr[2]) << 8) |
+	       static_cast<unsigned long>(ptr[3]);
+}
+
+constexpr std::size_t question_key::max_size;
+
+bool question_key::operator == (const question_key & rhs) const noexcept {
+	return (hash == rhs.hash) && (size == rhs.size) && (std::memcmp(data, rhs.data, size) == 0);
+}
+
+//	FNV-1a
+static std::size_t hash (const question_key & k) noexcept {
+	std::uint64_t h = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < k.size; ++i) {
+		h ^= k.data[i];
+		h *= 1099511628211ULL;
+	}
+	return std::size_t(h);
+}
+
+bool make_question_key (const unsigned char * msg, std::size_t len, question_key & k) noexcept {
+	if ((len < 12) || (read_16(msg + 4) != 1)) return false;
+	//	OPCODE other than QUERY
+	if (msg[2] & 0x78) return false;
+	std::size_t pos = 12;
+	k.size = 0;
+	for (;;) {
+		if (pos >= len) return false;
+		std::size_t n = msg[pos];
+		if (n > 63) return false;
+		if (((pos + 1 + n) > len) || ((k.size + 1 + n) > 255)) return false;
+		k.data[k.size++] = static_cast<unsigned char>(n);
+		++pos;
+		for (std::size_t i = 0; i < n; ++i) {
+			unsigned char c = msg[pos++];
+			if ((c >= 'A') && (c <= 'Z')) c = static_cast<unsigned char>(c - 'A' + 'a');
+			k.data[k.size++] = c;
+		}
+		if (n == 0) break;
+	}
+	if ((pos + 4) > len) return false;
+	std::memcpy(k.data + k.size, msg + pos, 4);
+	k.size += 4;
+	k.end = pos + 4;
+	//	RD and CD are copied from a query to its
+	//	response, as is DO (which is found in the OPT
+	//	record in the additional section, if any)
+	unsigned char flags = 0;
+	if (msg[2] & 0x01) flags |= 0x01;
+	if (msg[3] & 0x10) flags |= 0x02;
+	std::size_t count = std::size_t(read_16(msg + 6)) + read_16(msg + 8) + read_16(msg + 10);
+	std::size_t offset = k.end;
+	for (std::size_t i = 0; i < count; ++i) {
+		resource_record rr;
+		if (next_record(msg, len, offset, rr) != ARES_SUCCESS) return false;
+		//	The TTL field of OPT holds the flags
+		if ((rr.type == 41) && (msg[rr.rdata - 4] & 0x80)) flags |= 0x04;
+	}
+	k.data[k.size++] = flags;
+	k.hash = hash(k);
+	return true;
+}
+
+bool make_query_key (const unsigned char * msg, std::size_t len, question_key & k) noexcept {
+	if (!make_question_key(msg, len, k)) return false;
+	//	Only an OPT record may follow the question
+	if (read_16(msg + 6) || read_16(msg + 8) || (read_16(msg + 10) > 1)) return false;
+	//	The header less the ID and the counts
+	k.data[k.size++] = msg[2];
+	k.data[k.size++] = msg[3];
+	if (!read_16(msg + 10)) {
+		k.hash = hash(k);
+		return true;
+	}
+	std::size_t offset = k.end;
+	resource_record rr;
+	if ((next_record(msg, len, offset, rr) != ARES_SUCCESS) || (rr.type != 41)) return false;
+	//	Everything after the owner name: the UDP
+	//	payload size, the flags, and the options
+	std::size_t n = offset - (rr.rdata - 8);
+	if ((k.size + n) > question_key::max_size) return false;
+	std::memcpy(k.data + k.size, msg + rr.rdata - 8, n);
+	k.size += n;
+	k.hash = hash(k);
+	return true;
+}
+
+static bool escaped (unsigned char c) noexcept {
+	return (c == '.') || (c == '\\');
+}
+
+//	Invokes the function for each label of the name
+//	at offset, following compression pointers, and
+//	advances offset past the name as it appears at
+//	offset
+template <typename Function>
+static int walk_name (const unsigned char * msg, std::size_t len, std::size_t & offset, Function function) {
+	std::size_t pos = offset;
+	std::size_t end = 0;
+	bool jumped = false;
+	//	Every jump must be to an earlier position
+	//	which bounds the number of jumps
+	std::size_t limit = pos;
+	for (;;) {
+		if (pos >= len) return ARES_EBADRESP;
+		unsigned char c = msg[pos];
+		if ((c & 0xC0) == 0xC0) {
+			if ((pos + 1) >= len) return ARES_EBADRESP;
+			std::size_t target = (std::size_t(c & 0x3F) << 8) | msg[pos + 1];
+			if (!jumped) end = pos + 2;
+			if (target >= limit) return ARES_EBADRESP;
+			limit = target;
+			pos = target;
+			jumped = true;
+			continue;
+		}
+		if (c & 0xC0) return ARES_EBADRESP;
+		++pos;
+		if (c == 0) break;
+		if ((pos + c) > len) return ARES_EBADRESP;
+		function(msg + pos, std::size_t(c));
+		pos += c;
+	}
+	offset = jumped ? end : pos;
+	return ARES_SUCCESS;
+}
+
+int skip_name (const unsigned char * msg, std::size_t len, std::size_t & offset) noexcept {
+	return walk_name(msg, len, offset, [] (const unsigned char *, std::size_t) noexcept {});
+}
+
+int read_name (const unsigned char * msg, std::size_t len, std::size_t & offset, arena & a, boost::string_ref & name) {
+	std::size_t size = 0;
+	std::size_t labels = 0;
+	std::size_t o = offset;
+	int status = walk_name(msg, len, o, [&] (const unsigned char * label, std::size_t n) noexcept {
+		size += n;
+		for (std::size_t i = 0; i < n; ++i) if (escaped(label[i])) ++size;
+		++labels;
+	});
+	if (status != ARES_SUCCESS) return status;
+	if (labels) size += labels - 1;
+	char * out = size ? static_cast<char *>(a.allocate(size, 1)) : nullptr;
+	char * ptr = out;
+	walk_name(msg, len, offset, [&] (const unsigned char * label, std::size_t n) noexcept {
+		if (ptr != out) *(ptr++) = '.';
+		for (std::size_t i = 0; i < n; ++i) {
+			if (escaped(label[i])) *(ptr++) = '\\';
+			*(ptr++) = char(label[i]);
+		}
+	});
+	name = boost::string_ref(out, size);
+	return ARES_SUCCESS;
+}
+
+int begin_answers (const unsigned char * msg, std::size_t len, std::size_t & offset, std::size_t & count) noexcept {
+	if (len < 12) return ARES_EBADRESP;
+	switch (msg[3] & 0x0F) {
+	case 0:
+		break;
+	case 1:
+		return ARES_EFORMERR;
+	case 2:
+		return ARES_ESERVFAIL;
+	case 3:
+		return ARES_ENOTFOUND;
+	case 4:
+		return ARES_ENOTIMP;
+	case 5:
+		return ARES_EREFUSED;
+	default:
+		return ARES_EBADRESP;
+	}
+	std::size_t qdcount = read_16(msg + 4);
+	count = read_16(msg + 6);
+	if (count == 0) return ARES_ENODATA;
+	offset = 12;
+	for (std::size_t i = 0; i < qdcount; ++i) {
+		int status = skip_name(msg, len, offset);
+		if (status != ARES_SUCCESS) return status;
+		offset += 4;
+		if (offset > len) return ARES_EBADRESP;
+	}
+	return ARES_SUCCESS;
+}
+
+int next_record (const unsigned char * msg, std::size_t len, std::size_t & offset, resource_record & rr) noexcept {
+	int status = skip_name(msg, len, offset);
+	if (status != ARES_SUCCESS) return status;
+	if ((offset + 10) > len) return ARES_EBADRESP;
+	auto ptr = msg + offset;
+	rr.type = read_16(ptr);
+	rr.dns_class = read_16(ptr + 2);
+	//	TTLs with the most significant bit set are
+	//	treated as zero (RFC 2181 section 8)
+	auto ttl = read_32(ptr + 4);
+	rr.ttl = (ttl & 0x80000000UL) ? 0 : int(ttl);
+	rr.rdlength = read_16(ptr + 8);
+	rr.rdata = offset + 10;
+	offset = rr.rdata + rr.rdlength;
+	if (offset > len) return ARES_EBADRESP;
+	return ARES_SUCCESS;
+}
+
+int create_query (const char * name, int type, unsigned char * buf, std::size_t & len) noexcept {
+	std::memset(buf, 0, 12);
+	//	ares_send assigns the ID
+	buf[2] = 0x01;	//	RD
+	buf[5] = 1;	//	QDCOUNT
+	std::size_t pos = 12;
+	std::size_t end = 12 + 255;
+	//	The root is written as a lone dot
+	if ((name[0] == '.') && (name[1] == '\0')) ++name;
+	while (*name) {
+		std::size_t length = pos++;
+		std::size_t n = 0;
+		for (; *name && (*name != '.'); ++name) {
+			unsigned char c = *name;
+			if (c == '\\') {
+				if (!*(++name)) return ARES_EBADNAME;
+				c = *name;
+				if ((c >= '0') && (c <= '9')) {
+					if (!(name[1] >= '0' && name[1] <= '9' && name[2] >= '0' && name[2] <= '9')) return ARES_EBADNAME;
+					int v = (c - '0') * 100 + (name[1] - '0') * 10 + (name[2] - '0');
+					if (v > 255) return ARES_EBADNAME;
+					c = static_cast<unsigned char>(v);
+					name += 2;
+				}
+			}
+			if (pos >= end) return ARES_EBADNAME;
+			buf[pos++] = c;
+			++n;
+		}
+		if ((n == 0) || (n > 63)) return ARES_EBADNAME;
+		buf[length] = static_cast<unsigned char>(n);
+		if (*name == '.') ++name;
+	}
+	if (pos >= end) return ARES_EBADNAME;
+	buf[pos++] = 0;
+	buf[pos++] = static_cast<unsigned char>(type >> 8);
+	buf[pos++] = static_cast<unsigned char>(type);
+	buf[pos++] = 0;
+	buf[pos++] = 1;	//	IN
+	len = pos;
+	return ARES_SUCCESS;
+}
+
+}
+}
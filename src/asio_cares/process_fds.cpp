@@ -0,0 +1,57 @@
+#include <asio_cares/process_fds.hpp>
+
+#include <ares.h>
+#include <ares_version.h>
+#include <asio_cares/detail/probe.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace asio_cares {
+
+socket_events::socket_events (ares_socket_t socket, bool readable, bool writable) noexcept
+	:	socket  (socket),
+		readable(readable),
+		writable(writable)
+{}
+
+#if ARES_VERSION >= 0x012200
+
+void process_fds (ares_channel channel, const socket_events * events, std::size_t num) {
+	//	Small batches are by far the most common so
+	//	avoid going to the heap for them
+	static constexpr std::size_t stack_size = 16;
+	ares_fd_events_t stack [stack_size];
+	std::vector<ares_fd_events_t> heap;
+	ares_fd_events_t * ptr = stack;
+	if (num > stack_size) {
+		heap.resize(num);
+		ptr = heap.data();
+	}
+	for (std::size_t i = 0; i < num; ++i) {
+		ptr[i].fd = events[i].socket;
+		ptr[i].events = ARES_FD_EVENT_NONE;
+		if (events[i].readable) ptr[i].events |= ARES_FD_EVENT_READ;
+		if (events[i].writable) ptr[i].events |= ARES_FD_EVENT_WRITE;
+	}
+	ASIO_CARES_PROBE1(process__entry, num);
+	ares_process_fds(channel, ptr, num, ARES_PROCESS_FLAG_NONE);
+	ASIO_CARES_PROBE1(process__return, num);
+}
+
+#else
+
+void process_fds (ares_channel channel, const socket_events * events, std::size_t num) {
+	ASIO_CARES_PROBE1(process__entry, num);
+	if (num == 0) ares_process_fd(channel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+	for (std::size_t i = 0; i < num; ++i) {
+		auto && e = events[i];
+		ares_process_fd(channel,
+		                e.readable ? e.socket : ARES_SOCKET_BAD,
+		                e.writable ? e.socket : ARES_SOCKET_BAD);
+	}
+	ASIO_CARES_PROBE1(process__return, num);
+}
+
+#endif
+
+}
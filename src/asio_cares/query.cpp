@@ -0,0 +1,82 @@
+#include <asio_cares/query.hpp>
+
+#include <ares.h>
+#include <asio_cares/arena.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstring>
+
+namespace asio_cares {
+namespace records {
+
+constexpr int a::type;
+constexpr int aaaa::type;
+constexpr int srv::type;
+constexpr int txt::type;
+constexpr int mx::type;
+constexpr int ptr::type;
+
+int a::parse (const unsigned char * msg, std::size_t, const detail::resource_record & rr, arena &, a & record) noexcept {
+	if (rr.rdlength != 4) return ARES_EBADRESP;
+	record.address = boost::asio::ip::address_v4(detail::read_32(msg + rr.rdata));
+	return ARES_SUCCESS;
+}
+
+int aaaa::parse (const unsigned char * msg, std::size_t, const detail::resource_record & rr, arena &, aaaa & record) noexcept {
+	boost::asio::ip::address_v6::bytes_type bytes;
+	if (rr.rdlength != bytes.size()) return ARES_EBADRESP;
+	std::memcpy(bytes.data(), msg + rr.rdata, bytes.size());
+	record.address = boost::asio::ip::address_v6(bytes);
+	return ARES_SUCCESS;
+}
+
+//	Names in RDATA must not extend beyond it
+static int read_name (const unsigned char * msg, std::size_t len, const detail::resource_record & rr, std::size_t offset, arena & a, boost::string_ref & name) {
+	int status = detail::read_name(msg, len, offset, a, name);
+	if (status != ARES_SUCCESS) return status;
+	if (offset != (rr.rdata + rr.rdlength)) return ARES_EBADRESP;
+	return ARES_SUCCESS;
+}
+
+int srv::parse (const unsigned char * msg, std::size_t len, const detail::resource_record & rr, arena & a, srv & record) {
+	if (rr.rdlength < 7) return ARES_EBADRESP;
+	auto ptr = msg + rr.rdata;
+	record.priority = detail::read_16(ptr);
+	record.weight = detail::read_16(ptr + 2);
+	record.port = detail::read_16(ptr + 4);
+	return read_name(msg, len, rr, rr.rdata + 6, a, record.target);
+}
+
+int txt::parse (const unsigned char * msg, std::size_t, const detail::resource_record & rr, arena & a, txt & record) {
+	//	The concatenation is never longer than
+	//	the RDATA
+	auto text = rr.rdlength ? static_cast<char *>(a.allocate(rr.rdlength, 1)) : nullptr;
+	std::size_t size = 0;
+	auto ptr = msg + rr.rdata;
+	auto end = ptr + rr.rdlength;
+	while (ptr != end) {
+		std::size_t n = *(ptr++);
+		if (std::size_t(end - ptr) < n) return ARES_EBADRESP;
+		std::memcpy(text + size, ptr, n);
+		size += n;
+		ptr += n;
+	}
+	record.text = boost::string_ref(text, size);
+	return ARES_SUCCESS;
+}
+
+int mx::parse (const unsigned char * msg, std::size_t len, const detail::resource_record & rr, arena & a, mx & record) {
+	if (rr.rdlength < 3) return ARES_EBADRESP;
+	record.preference = detail::read_16(msg + rr.rdata);
+	return read_name(msg, len, rr, rr.rdata + 2, a, record.exchange);
+}
+
+int ptr::parse (const unsigned char * msg, std::size_t len, const detail::resource_record & rr, arena & a, ptr & record) {
+	return read_name(msg, len, rr, rr.rdata, a, record.name);
+}
+
+}
+}
@@ -0,0 +1,35 @@
+#include <asio_cares/query_handle.hpp>
+
+#include <cassert>
+
+namespace asio_cares {
+
+query_handle::query_handle () noexcept
+	:	op_(nullptr)
+{}
+
+query_handle::~query_handle () noexcept {
+	if (op_) op_->release();
+}
+
+void query_handle::cancel () {
+	if (!op_) return;
+	auto op = op_;
+	op_ = nullptr;
+	op->cancel();
+}
+
+bool query_handle::active () const noexcept {
+	return op_ != nullptr;
+}
+
+void query_handle::attach (detail::cancellable & op) noexcept {
+	assert(!op_);
+	op_ = &op;
+}
+
+void query_handle::detach () noexcept {
+	op_ = nullptr;
+}
+
+}
@@ -0,0 +1,84 @@
+#include <asio_cares/detail/refresh.hpp>
+
+#include <ares.h>
+#include <asio_cares/cache.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/inflight.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+#include <new>
+
+namespace asio_cares {
+namespace detail {
+
+namespace {
+
+//	Joins a query in flight as a waiter (in which
+//	case that query refreshes the cache) or leads
+//	one which others may join
+class refresh_state final : public send_waiter {
+public:
+	explicit refresh_state (channel & c) noexcept
+		:	c       (c),
+			inflight(nullptr)
+	{}
+	static refresh_state * create (channel & c) noexcept {
+		auto r = c.get_memory_resource();
+		auto && resource = r ? *r : new_delete_resource();
+		void * ptr;
+		try {
+			ptr = resource.allocate(sizeof(refresh_state), alignof(refresh_state));
+		} catch (...) {
+			return nullptr;
+		}
+		return new (ptr) refresh_state(c);
+	}
+	void destroy () noexcept {
+		auto r = c.get_memory_resource();
+		auto && resource = r ? *r : new_delete_resource();
+		this->~refresh_state();
+		resource.deallocate(this, sizeof(refresh_state), alignof(refresh_state));
+	}
+	virtual void complete (int, int, const buffer &) override {
+		destroy();
+	}
+	channel &          c;
+	detail::inflight * inflight;
+};
+
+}
+
+void refresh (channel & c, const unsigned char * qbuf, int qlen) noexcept {
+	auto state = refresh_state::create(c);
+	//	Failures are ignored
+	if (!state) return;
+	if (c.get_coalescing() && (qlen > 0)) {
+		question_key key;
+		if (make_query_key(qbuf, std::size_t(qlen), key)) {
+			if (c.coalesce(key, *state)) return;
+			state->inflight = c.begin_inflight(key);
+		}
+	}
+	//	Counted as outstanding so that the reactor
+	//	runs until the response arrives even if every
+	//	other query was answered from the cache
+	c.begin_query();
+	ares_send(c, qbuf, qlen, [] (void * arg, int status, int timeouts, unsigned char * abuf, int alen) {
+		auto state = static_cast<refresh_state *>(arg);
+		auto && c = state->c;
+		c.end_query(status, timeouts);
+		auto waiter = c.end_inflight(state->inflight);
+		auto cache = c.get_cache();
+		if (cache && (status == ARES_SUCCESS)) {
+			try {
+				cache->insert(abuf, std::size_t(alen));
+			} catch (...) {}
+		}
+		complete_waiters(c, waiter, status, timeouts, abuf, alen);
+		state->destroy();
+	}, state);
+}
+
+}
+}
@@ -0,0 +1,16 @@
+#include <asio_cares/socket_options.hpp>
+
+namespace asio_cares {
+
+socket_options::socket_options () noexcept
+	:	receive_buffer_size    (0),
+		send_buffer_size       (0),
+		busy_poll              (0),
+		receive_errors         (false),
+		track_drops            (false),
+		max_receive_buffer_size(0),
+		callback               (nullptr),
+		callback_data          (nullptr)
+{}
+
+}
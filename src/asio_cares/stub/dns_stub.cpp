@@ -0,0 +1,114 @@
+#include "dns_stub.hpp"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/system/error_code.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace stub {
+
+std::size_t answer (const unsigned char * query, std::size_t len, unsigned char * out) noexcept {
+	//	Header followed by at least the root
+	//	label, QTYPE, and QCLASS
+	if (len < (HFIXEDSZ + 1 + QFIXEDSZ)) return 0;
+	std::size_t end = HFIXEDSZ;
+	while ((end < len) && query[end]) end += query[end] + 1;
+	end += 1 + QFIXEDSZ;
+	if (end > len) return 0;
+	unsigned qtype = (unsigned(query[end - 4]) << 8) | query[end - 3];
+	std::memcpy(out, query, end);
+	out[2] = 0x84 | (query[2] & 0x01);	//	QR, AA, copy RD
+	out[3] = 0x80;	//	RA, NOERROR
+	out[4] = 0;
+	out[5] = 1;	//	QDCOUNT
+	std::memset(out + 6, 0, 6);
+	std::size_t size;
+	unsigned char rdata [16];
+	if (qtype == ns_t_a) {
+		const unsigned char loopback [] = {127, 0, 0, 1};
+		std::memcpy(rdata, loopback, sizeof(loopback));
+		size = sizeof(loopback);
+	} else if (qtype == ns_t_aaaa) {
+		std::memset(rdata, 0, sizeof(rdata));
+		rdata[15] = 1;
+		size = sizeof(rdata);
+	} else {
+		return end;
+	}
+	out[7] = 1;	//	ANCOUNT
+	unsigned char * ptr = out + end;
+	*(ptr++) = 0xc0;	//	Pointer to the name in the question
+	*(ptr++) = HFIXEDSZ;
+	*(ptr++) = (qtype >> 8) & 0xff;
+	*(ptr++) = qtype & 0xff;
+	*(ptr++) = 0;
+	*(ptr++) = ns_c_in;
+	const unsigned char ttl [] = {0, 0, 1, 44};	//	300 seconds
+	std::memcpy(ptr, ttl, sizeof(ttl));
+	ptr += sizeof(ttl);
+	*(ptr++) = 0;
+	*(ptr++) = static_cast<unsigned char>(size);
+	std::memcpy(ptr, rdata, size);
+	ptr += size;
+	return std::size_t(ptr - out);
+}
+
+connection::connection (boost::asio::io_service & ios, boost::asio::ip::tcp::socket socket, on_query f)
+	:	ios_   (ios),
+		socket_(std::move(socket)),
+		f_     (std::move(f))
+{}
+
+void connection::read () {
+	auto self = shared_from_this();
+	boost::asio::async_read(socket_, boost::asio::buffer(in_.data(), 2), [self] (auto ec, auto) {
+		if (ec) return;
+		std::size_t len = (std::size_t(self->in_[0]) << 8) | self->in_[1];
+		if ((len == 0) || (len > (self->in_.size() - 2))) return;
+		boost::asio::async_read(self->socket_, boost::asio::buffer(self->in_.data() + 2, len), [self] (auto ec, auto len) {
+			if (ec) return;
+			self->respond(len);
+			self->read();
+		});
+	});
+}
+
+void connection::respond (std::size_t len) {
+	auto d = f_();
+	auto out = std::make_shared<std::array<unsigned char, 512 + 64 + 2>>();
+	auto size = answer(in_.data() + 2, len, out->data() + 2);
+	if (!size) return;
+	(*out)[0] = static_cast<unsigned char>(size >> 8);
+	(*out)[1] = static_cast<unsigned char>(size);
+	//	Responses are small and written synchronously
+	//	so that writes never interleave
+	if (d.count() == 0) {
+		boost::system::error_code ignored;
+		boost::asio::write(socket_, boost::asio::buffer(out->data(), size + 2), ignored);
+		return;
+	}
+	auto self = shared_from_this();
+	auto timer = std::make_shared<boost::asio::steady_timer>(ios_, d);
+	timer->async_wait([self, timer, out, size] (auto ec) {
+		if (ec) return;
+		boost::system::error_code ignored;
+		boost::asio::write(self->socket_, boost::asio::buffer(out->data(), size + 2), ignored);
+	});
+}
+
+}
+}
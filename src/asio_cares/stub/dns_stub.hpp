@@ -0,0 +1,77 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace asio_cares {
+namespace stub {
+
+/**
+ *	Forms a response to a query in the manner of
+ *	a minimal DNS server: A queries are answered with
+ *	127.0.0.1, AAAA queries with ::1, and all other
+ *	queries with an empty answer section.
+ *
+ *	\param [in] query
+ *		The query.
+ *	\param [in] len
+ *		The length of the query.
+ *	\param [out] out
+ *		A buffer of at least \em len plus 64 bytes
+ *		into which the response shall be written.
+ *
+ *	\return
+ *		The length of the response or zero if the
+ *		query is malformed.
+ */
+std::size_t answer (const unsigned char * query, std::size_t len, unsigned char * out) noexcept;
+
+/**
+ *	Reads length prefixed queries from a TCP
+ *	connection and writes length prefixed responses
+ *	(see \ref answer) until the peer closes the
+ *	connection. Queries are read while earlier
+ *	responses are delayed.
+ */
+class connection : public std::enable_shared_from_this<connection> {
+public:
+	/**
+	 *	Invoked as each query is received, returns
+	 *	the delay before the response is sent.
+	 */
+	using on_query = std::function<std::chrono::microseconds ()>;
+	connection (const connection &) = delete;
+	connection (connection &&) = delete;
+	connection & operator = (const connection &) = delete;
+	connection & operator = (connection &&) = delete;
+	/**
+	 *	Creates a connection.
+	 *
+	 *	\param [in] ios
+	 *		The `io_service` which runs the connection.
+	 *	\param [in] socket
+	 *		The accepted socket.
+	 *	\param [in] f
+	 *		See \ref on_query.
+	 */
+	connection (boost::asio::io_service & ios, boost::asio::ip::tcp::socket socket, on_query f);
+	/**
+	 *	Begins reading queries. The connection keeps
+	 *	itself alive until the peer closes it.
+	 */
+	void read ();
+private:
+	void respond (std::size_t len);
+	boost::asio::io_service &      ios_;
+	boost::asio::ip::tcp::socket   socket_;
+	on_query                       f_;
+	std::array<unsigned char, 514> in_;
+};
+
+}
+}
@@ -0,0 +1,67 @@
+#include <asio_cares/detail/submission.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace asio_cares {
+namespace detail {
+
+submission_queue::submission_queue () noexcept
+	:	pending_(0),
+		head_   (&stub_),
+		tail_   (&stub_)
+{}
+
+//	The count is incremented before the submission
+//	is linked so that it never underflows, the
+//	consumer tolerates observing a count for which
+//	there is not yet a linked submission
+
+bool submission_queue::push (submission & s) noexcept {
+	bool idle = pending_.fetch_add(1, std::memory_order_acq_rel) == 0;
+	s.next.store(nullptr, std::memory_order_relaxed);
+	auto prev = head_.exchange(&s, std::memory_order_acq_rel);
+	prev->next.store(&s, std::memory_order_release);
+	return idle;
+}
+
+submission * submission_queue::pop () noexcept {
+	auto tail = tail_;
+	auto next = tail->next.load(std::memory_order_acquire);
+	if (tail == &stub_) {
+		if (!next) return nullptr;
+		tail_ = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next) {
+		tail_ = next;
+		return tail;
+	}
+	//	Either a producer is between its exchange and
+	//	its store or this is the last submission, in the
+	//	latter case the stub is requeued behind it so
+	//	that it may be detached
+	if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+	stub_.next.store(nullptr, std::memory_order_relaxed);
+	auto prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+	prev->next.store(&stub_, std::memory_order_release);
+	next = tail->next.load(std::memory_order_acquire);
+	if (!next) return nullptr;
+	tail_ = next;
+	return tail;
+}
+
+bool submission_queue::consume (std::size_t num) noexcept {
+	auto prev = pending_.fetch_sub(num, std::memory_order_acq_rel);
+	assert(prev >= num);
+	return prev != num;
+}
+
+std::size_t submission_queue::size () const noexcept {
+	return pending_.load(std::memory_order_relaxed);
+}
+
+}
+}
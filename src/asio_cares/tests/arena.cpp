@@ -0,0 +1,58 @@
+#include <asio_cares/arena.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include "counting_resource.hpp"
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::arena allocates monotonically and may be reused", "[asio_cares][arena]") {
+	GIVEN("An asio_cares::arena with a caller provided buffer") {
+		counting_resource upstream;
+		alignas(std::max_align_t) unsigned char buffer [64];
+		arena a(buffer, sizeof(buffer), upstream);
+		WHEN("Allocations fit in the buffer") {
+			void * x = a.allocate(1, 1);
+			void * y = a.allocate(8, 8);
+			THEN("The buffer is used") {
+				CHECK(x == buffer);
+				CHECK(y == buffer + 8);
+				CHECK(upstream.allocations == 0);
+			}
+		}
+		WHEN("Allocations exceed the buffer") {
+			a.allocate(48);
+			void * x = a.allocate(48);
+			THEN("A chunk is obtained from upstream") {
+				CHECK(upstream.allocations == 1);
+				CHECK((reinterpret_cast<std::uintptr_t>(x) % alignof(std::max_align_t)) == 0);
+			}
+			AND_WHEN("The arena is reset and used again") {
+				a.reset();
+				a.allocate(48);
+				a.allocate(48);
+				THEN("The retained chunk is reused") {
+					CHECK(upstream.allocations == 1);
+					CHECK(upstream.deallocations == 0);
+				}
+			}
+		}
+		WHEN("The arena is destroyed") {
+			{
+				arena other(upstream);
+				other.allocate(16);
+			}
+			THEN("Chunks are returned upstream") {
+				CHECK(upstream.allocations == 1);
+				CHECK(upstream.deallocations == 1);
+			}
+		}
+	}
+}
+
+}
+}
+}
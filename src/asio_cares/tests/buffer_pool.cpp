@@ -0,0 +1,73 @@
+#include <asio_cares/buffer_pool.hpp>
+
+#include <cstring>
+#include <utility>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::buffer_pool provides shared copies of bytes and recycles their memory", "[asio_cares][buffer_pool]") {
+	GIVEN("An asio_cares::buffer_pool") {
+		buffer_pool pool;
+		const unsigned char bytes [] = {1, 2, 3, 4};
+		WHEN("A buffer is acquired") {
+			auto b = pool.acquire(bytes, sizeof(bytes));
+			THEN("It holds a copy of the bytes") {
+				REQUIRE(b);
+				REQUIRE(b.size() == sizeof(bytes));
+				CHECK(b.data() != bytes);
+				CHECK(std::memcmp(b.data(), bytes, sizeof(bytes)) == 0);
+			}
+			AND_WHEN("It is copied") {
+				auto c = b;
+				THEN("The copies share the bytes") {
+					CHECK(c.data() == b.data());
+					CHECK(c.size() == b.size());
+				}
+			}
+			AND_WHEN("It is moved") {
+				auto ptr = b.data();
+				auto c = std::move(b);
+				THEN("The bytes are transferred") {
+					CHECK(c.data() == ptr);
+					CHECK_FALSE(b);
+				}
+			}
+			AND_WHEN("It is released and another buffer is acquired") {
+				auto ptr = b.data();
+				b = buffer();
+				auto c = pool.acquire(bytes, 2);
+				THEN("The memory is reused") {
+					CHECK(c.data() == ptr);
+					CHECK(c.size() == 2);
+				}
+			}
+		}
+		WHEN("An empty buffer is acquired") {
+			auto b = pool.acquire(nullptr, 0);
+			THEN("It is empty") {
+				CHECK_FALSE(b);
+				CHECK(b.data() == nullptr);
+				CHECK(b.size() == 0);
+			}
+		}
+	}
+	GIVEN("A buffer which outlives the asio_cares::buffer_pool from which it was acquired") {
+		const unsigned char bytes [] = {5, 6, 7};
+		buffer b;
+		{
+			buffer_pool pool;
+			b = pool.acquire(bytes, sizeof(bytes));
+		}
+		THEN("It remains valid") {
+			REQUIRE(b.size() == sizeof(bytes));
+			CHECK(std::memcmp(b.data(), bytes, sizeof(bytes)) == 0);
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,374 @@
+#include <asio_cares/cache.hpp>
+
+#include <ares.h>
+#include <asio_cares/arena.hpp>
+#include <asio_cares/buffer_pool.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/detail/parse.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/query.hpp>
+#include <asio_cares/send.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include "packet.hpp"
+#include "server.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+std::vector<unsigned char> make_query (const char * name, int type, unsigned id = 0) {
+	unsigned char buf [detail::max_query_size];
+	std::size_t len;
+	REQUIRE(detail::create_query(name, type, buf, len) == ARES_SUCCESS);
+	buf[0] = static_cast<unsigned char>(id >> 8);
+	buf[1] = static_cast<unsigned char>(id);
+	return std::vector<unsigned char>(buf, buf + len);
+}
+
+//	A response with one A record for name
+packet make_response (const char * name, unsigned long ttl) {
+	auto q = make_query(name, records::a::type);
+	packet p(1);
+	p.bytes.resize(12);
+	p.bytes.insert(p.bytes.end(), q.begin() + 12, q.end());
+	p.record(records::a::type, ttl, 4).u32(0x7F000001UL);
+	return p;
+}
+
+SCENARIO("asio_cares::cache retains responses until their TTL expires", "[asio_cares][cache]") {
+	GIVEN("An asio_cares::cache") {
+		cache c;
+		buffer_pool pool;
+		auto now = cache::clock::now();
+		WHEN("A response with answers is inserted") {
+			auto p = make_response("example.com", 60);
+			c.insert(p.data(), p.size(), now);
+			REQUIRE(c.size() == 1);
+			AND_WHEN("A matching query differing only in case and ID is looked up before the TTL expires") {
+				auto q = make_query("EXAMPLE.com", records::a::type, 0x1234);
+				auto b = c.lookup(q.data(), q.size(), pool, now + std::chrono::seconds(10));
+				THEN("The response is found with the ID of the query and reduced TTLs") {
+					REQUIRE(b);
+					REQUIRE(b.size() == p.size());
+					CHECK(b.data()[0] == 0x12);
+					CHECK(b.data()[1] == 0x34);
+					arena a;
+					query_result<records::a> r;
+					REQUIRE(parse(b.data(), b.size(), a, r) == ARES_SUCCESS);
+					REQUIRE(r.size() == 1);
+					CHECK(r[0].ttl == 50);
+				}
+			}
+			AND_WHEN("A query for another type is looked up") {
+				auto q = make_query("example.com", records::aaaa::type);
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now));
+				}
+			}
+			AND_WHEN("A matching query which is not recursive is looked up") {
+				auto q = make_query("example.com", records::a::type);
+				q[2] &= ~0x01;
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now));
+				}
+			}
+			AND_WHEN("A matching query with the CD bit set is looked up") {
+				auto q = make_query("example.com", records::a::type);
+				q[3] |= 0x10;
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now));
+				}
+			}
+			AND_WHEN("A matching query with an OPT record with the DO bit set is looked up") {
+				auto q = make_query("example.com", records::a::type);
+				q[11] = 1;	//	ARCOUNT
+				const unsigned char opt [] = {0, 0, 41, 0x10, 0, 0, 0, 0x80, 0, 0, 0};
+				q.insert(q.end(), opt, opt + sizeof(opt));
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now));
+				}
+				AND_WHEN("The DO bit is cleared") {
+					q[q.size() - 4] = 0;
+					THEN("The response is found") {
+						CHECK(c.lookup(q.data(), q.size(), pool, now));
+					}
+				}
+			}
+			AND_WHEN("A matching NOTIFY is looked up") {
+				auto q = make_query("example.com", records::a::type);
+				q[2] |= 4 << 3;
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now));
+				}
+			}
+			AND_WHEN("A matching query is looked up once the TTL expires") {
+				auto q = make_query("example.com", records::a::type);
+				THEN("No response is found") {
+					CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now + std::chrono::seconds(60)));
+				}
+			}
+			AND_WHEN("The cache is cleared") {
+				c.clear();
+				THEN("It is empty") {
+					CHECK(c.size() == 0);
+				}
+			}
+		}
+		WHEN("An NXDOMAIN response with an SOA record in the authority section is inserted") {
+			packet p(0, 3, 1);
+			p.question(records::a::type);
+			p.record(6, 300, 24).pointer(22).pointer(22).u32(1).u32(2).u32(3).u32(4).u32(30);
+			c.insert(p.data(), p.size(), now);
+			auto q = make_query("_sip._tcp.example.com", records::a::type);
+			THEN("It is retained for the SOA MINIMUM") {
+				CHECK(c.lookup(q.data(), q.size(), pool, now + std::chrono::seconds(29)));
+				CHECK_FALSE(c.lookup(q.data(), q.size(), pool, now + std::chrono::seconds(30)));
+			}
+		}
+		WHEN("An NXDOMAIN response without an SOA record is inserted") {
+			packet p(0, 3);
+			p.question(records::a::type);
+			c.insert(p.data(), p.size(), now);
+			THEN("It is not retained") {
+				CHECK(c.size() == 0);
+			}
+		}
+		WHEN("A truncated response is inserted") {
+			auto p = make_response("example.com", 60);
+			p.bytes[2] |= 0x02;
+			c.insert(p.data(), p.size(), now);
+			THEN("It is not retained") {
+				CHECK(c.size() == 0);
+			}
+		}
+	}
+	GIVEN("An asio_cares::cache with one shard and a capacity of two") {
+		cache c(2, 1);
+		buffer_pool pool;
+		auto now = cache::clock::now();
+		auto a = make_response("a.example.com", 60);
+		auto b = make_response("b.example.com", 60);
+		auto d = make_response("d.example.com", 60);
+		c.insert(a.data(), a.size(), now);
+		c.insert(b.data(), b.size(), now);
+		WHEN("One entry is referenced and a third is inserted") {
+			auto q = make_query("a.example.com", records::a::type);
+			REQUIRE(c.lookup(q.data(), q.size(), pool, now));
+			c.insert(d.data(), d.size(), now);
+			THEN("The unreferenced entry is evicted") {
+				CHECK(c.size() == 2);
+				CHECK(c.lookup(q.data(), q.size(), pool, now));
+				auto qb = make_query("b.example.com", records::a::type);
+				CHECK_FALSE(c.lookup(qb.data(), qb.size(), pool, now));
+				auto qd = make_query("d.example.com", records::a::type);
+				CHECK(c.lookup(qd.data(), qd.size(), pool, now));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::cache may refresh hot responses before they expire", "[asio_cares][cache]") {
+	GIVEN("An asio_cares::cache which refreshes responses looked up twice once half their TTL has elapsed") {
+		cache::prefetch_policy policy;
+		policy.hits = 2;
+		policy.fraction = 0.5;
+		policy.rate = 1;
+		policy.burst = 1;
+		cache c(4096, 16, std::chrono::hours(24), policy);
+		buffer_pool pool;
+		auto now = cache::clock::now();
+		auto p = make_response("example.com", 60);
+		c.insert(p.data(), p.size(), now);
+		auto q = make_query("example.com", records::a::type);
+		WHEN("The response is looked up twice before half its TTL has elapsed") {
+			bool first = true;
+			bool second = true;
+			REQUIRE(c.lookup(q.data(), q.size(), pool, first, now + std::chrono::seconds(10)));
+			REQUIRE(c.lookup(q.data(), q.size(), pool, second, now + std::chrono::seconds(20)));
+			THEN("No refresh is requested") {
+				CHECK_FALSE(first);
+				CHECK_FALSE(second);
+			}
+			AND_WHEN("It is looked up after half its TTL has elapsed") {
+				bool refresh = false;
+				REQUIRE(c.lookup(q.data(), q.size(), pool, refresh, now + std::chrono::seconds(31)));
+				THEN("A refresh is requested") {
+					CHECK(refresh);
+				}
+				AND_WHEN("It is looked up again") {
+					bool again = true;
+					REQUIRE(c.lookup(q.data(), q.size(), pool, again, now + std::chrono::seconds(32)));
+					THEN("A refresh is not requested again") {
+						CHECK_FALSE(again);
+					}
+				}
+				AND_WHEN("A new response is inserted") {
+					c.insert(p.data(), p.size(), now + std::chrono::seconds(32));
+					THEN("The response is no longer hot") {
+						bool again = true;
+						REQUIRE(c.lookup(q.data(), q.size(), pool, again, now + std::chrono::seconds(63)));
+						CHECK_FALSE(again);
+					}
+				}
+			}
+		}
+		WHEN("Several hot responses become due at once") {
+			auto p2 = make_response("example.org", 60);
+			c.insert(p2.data(), p2.size(), now);
+			auto q2 = make_query("example.org", records::a::type);
+			for (auto && query : {&q, &q2}) for (int i = 0; i < 2; ++i) {
+				bool refresh;
+				REQUIRE(c.lookup(query->data(), query->size(), pool, refresh, now));
+			}
+			bool first = false;
+			bool second = true;
+			REQUIRE(c.lookup(q.data(), q.size(), pool, first, now + std::chrono::seconds(31)));
+			REQUIRE(c.lookup(q2.data(), q2.size(), pool, second, now + std::chrono::seconds(31)));
+			THEN("Refreshes are rate limited") {
+				CHECK(first);
+				CHECK_FALSE(second);
+				AND_WHEN("Time passes") {
+					REQUIRE(c.lookup(q2.data(), q2.size(), pool, second, now + std::chrono::seconds(33)));
+					THEN("The refresh is permitted") {
+						CHECK(second);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::cache may be placed in front of an asio_cares::channel", "[asio_cares][cache]") {
+	GIVEN("An asio_cares::channel with an asio_cares::cache") {
+		library l;
+		boost::asio::io_service ios;
+		channel ch(ios);
+		server s;
+		s.apply(ch);
+		cache c;
+		ch.set_cache(&c);
+		REQUIRE(ch.get_cache() == &c);
+		auto q = make_query("example.com", records::a::type);
+		WHEN("A query is sent and processed") {
+			boost::system::error_code ec;
+			async_send(ch, q.data(), int(q.size()), [&] (auto e, auto, auto, auto) {
+				ec = e;
+			});
+			REQUIRE_FALSE(done(ch));
+			async_process(ch, [] (auto) noexcept {});
+			ios.run();
+			ios.reset();
+			REQUIRE_FALSE(ec);
+			THEN("The response is retained") {
+				CHECK(c.size() == 1);
+			}
+			AND_WHEN("The query is sent again") {
+				bool invoked = false;
+				int status = ARES_ENODATA;
+				async_send(ch, q.data(), int(q.size()), [&] (auto e, auto, auto buf, auto len) {
+					invoked = true;
+					ec = e;
+					arena a;
+					query_result<records::a> r;
+					status = parse(buf, std::size_t(len), a, r);
+				});
+				THEN("The query is not sent") {
+					CHECK(done(ch));
+					CHECK_FALSE(invoked);
+					AND_WHEN("The io_service is run") {
+						ios.run();
+						THEN("The completion handler receives the retained response") {
+							REQUIRE(invoked);
+							CHECK_FALSE(ec);
+							CHECK(status == ARES_SUCCESS);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+SCENARIO("asio_cares::async_send refreshes hot responses in the background", "[asio_cares][cache]") {
+	GIVEN("An asio_cares::channel with an asio_cares::cache which refreshes responses looked up twice") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options options;
+		std::memset(&options, 0, sizeof(options));
+		int optmask = 0;
+		#if ARES_VERSION >= 0x011700
+		//	Otherwise libcares answers the refresh from
+		//	its own cache
+		optmask |= ARES_OPT_QUERY_CACHE;
+		#endif
+		channel ch(options, optmask, ios);
+		server s;
+		s.apply(ch);
+		cache::prefetch_policy policy;
+		policy.hits = 2;
+		policy.fraction = 0;
+		cache c(4096, 16, std::chrono::hours(24), policy);
+		ch.set_cache(&c);
+		auto q = make_query("example.com", records::a::type);
+		async_send(ch, q.data(), int(q.size()), [] (auto, auto, auto, auto) noexcept {});
+		async_process(ch, [] (auto) noexcept {});
+		ios.run();
+		ios.reset();
+		REQUIRE(s.received() == 1);
+		WHEN("The query is sent twice more") {
+			std::size_t succeeded = 0;
+			for (int i = 0; i < 2; ++i) async_send(ch, q.data(), int(q.size()), [&] (auto ec, auto, auto, auto) noexcept {
+				if (!ec) ++succeeded;
+			});
+			THEN("Only the second causes a query to be sent") {
+				CHECK(ch.outstanding() == 1);
+				AND_WHEN("The channel is processed") {
+					async_process(ch, [] (auto) noexcept {});
+					ios.run();
+					THEN("Both operations complete from the cache and the response is refreshed") {
+						CHECK(succeeded == 2);
+						CHECK(s.received() == 2);
+						CHECK(done(ch));
+						CHECK(c.size() == 1);
+					}
+				}
+			}
+		}
+		WHEN("Coalescing is enabled, the query is sent twice more, the cache is cleared, and the query is sent again") {
+			ch.set_coalescing(true);
+			std::size_t succeeded = 0;
+			auto h = [&] (auto ec, auto, auto, auto) noexcept {
+				if (!ec) ++succeeded;
+			};
+			for (int i = 0; i < 2; ++i) async_send(ch, q.data(), int(q.size()), h);
+			c.clear();
+			async_send(ch, q.data(), int(q.size()), h);
+			THEN("The last operation joins the refresh") {
+				CHECK(ch.outstanding() == 1);
+				AND_WHEN("The channel is processed") {
+					async_process(ch, [] (auto) noexcept {});
+					ios.run();
+					THEN("All operations complete and only the refresh was sent") {
+						CHECK(succeeded == 3);
+						CHECK(s.received() == 2);
+						CHECK(done(ch));
+						CHECK(c.size() == 1);
+					}
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
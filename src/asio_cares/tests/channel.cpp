@@ -0,0 +1,286 @@
+#include <asio_cares/channel.hpp>
+
+#include <ares.h>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include "counting_resource.hpp"
+#include "server.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::channel objects may use more than ARES_GETSOCK_MAXNUM sockets", "[asio_cares][channel][stress]") {
+	GIVEN("An asio_cares::channel which rotates between many local servers") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options opts;
+		std::memset(&opts, 0, sizeof(opts));
+		channel c(opts, ARES_OPT_ROTATE, ios);
+		server s(ARES_GETSOCK_MAXNUM * 8);
+		s.apply(c);
+		WHEN("Many queries are sent thereupon") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("example.com",
+				                           ns_c_in,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string g(ptr);
+			std::size_t queries = s.size() * 16;
+			std::size_t succeeded = 0;
+			std::size_t completed = 0;
+			for (std::size_t i = 0; i < queries; ++i) {
+				async_send(c, ptr, buflen, [&] (auto ec, auto, auto, auto) noexcept {
+					++completed;
+					if (!ec) ++succeeded;
+				});
+			}
+			std::size_t sockets = 0;
+			c.for_each_socket([&] (auto &) noexcept {	++sockets;	});
+			std::size_t interest = 0;
+			c.for_each_interest([&] (auto, auto, auto) noexcept {	++interest;	});
+			THEN("More than ARES_GETSOCK_MAXNUM sockets are in use") {
+				CHECK(sockets > ARES_GETSOCK_MAXNUM);
+				CHECK(interest > ARES_GETSOCK_MAXNUM);
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				boost::system::error_code ec;
+				bool invoked = false;
+				async_process(c, [&] (auto e) noexcept {
+					ec = e;
+					invoked = true;
+				});
+				ios.run();
+				THEN("The operation completes successfully") {
+					REQUIRE(invoked);
+					INFO(ec.message());
+					CHECK_FALSE(ec);
+				}
+				THEN("Every query completes successfully") {
+					CHECK(completed == queries);
+					CHECK(succeeded == queries);
+					CHECK(done(c));
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects may allocate from a memory resource", "[asio_cares][channel][memory_resource]") {
+	GIVEN("An asio_cares::channel which allocates from an asio_cares::slab_resource") {
+		library l;
+		boost::asio::io_service ios;
+		counting_resource upstream;
+		slab_resource slab(upstream);
+		channel c(ios, slab);
+		CHECK(c.get_memory_resource() == &slab);
+		server s;
+		s.apply(c);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		std::size_t succeeded = 0;
+		auto round = [&] () {
+			for (std::size_t i = 0; i < 8; ++i) {
+				async_send(c, ptr, buflen, [&] (auto ec, auto, auto, auto) noexcept {
+					if (!ec) ++succeeded;
+				});
+			}
+			async_process(c, [&] (auto) noexcept {});
+			ios.run();
+			ios.reset();
+		};
+		WHEN("Queries are processed repeatedly") {
+			round();
+			round();
+			auto allocations = upstream.allocations;
+			round();
+			THEN("The memory resource is used") {
+				CHECK(allocations > 0);
+			}
+			THEN("Every query completes successfully") {
+				CHECK(succeeded == 24);
+			}
+			THEN("Once warm no memory is obtained from upstream") {
+				CHECK(upstream.allocations == allocations);
+			}
+		}
+	}
+}
+
+
+SCENARIO("asio_cares::channel objects track timeouts with a steady timer", "[asio_cares][channel][timer]") {
+	static_assert(std::is_same<decltype(std::declval<channel &>().get_timer()), boost::asio::steady_timer &>::value,
+	              "Timeouts must not be affected by changes to the system clock");
+	GIVEN("An asio_cares::channel with a short timeout whose server never answers") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options options;
+		std::memset(&options, 0, sizeof(options));
+		options.timeout = 50;
+		options.tries = 1;
+		channel c(options, ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		boost::asio::ip::udp::socket silent(ios, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+		ares_addr_port_node node;
+		std::memset(&node, 0, sizeof(node));
+		node.family = AF_INET;
+		auto bytes = silent.local_endpoint().address().to_v4().to_bytes();
+		std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+		node.udp_port = silent.local_endpoint().port();
+		node.tcp_port = node.udp_port;
+		raise(ares_set_servers_ports(c, &node));
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		WHEN("Several queries are sent and processed") {
+			std::size_t timeouts = 0;
+			for (std::size_t i = 0; i < 4; ++i) async_send(c, ptr, buflen, [&] (auto ec, auto, auto, auto) noexcept {
+				if (ec == make_error_code(ARES_ETIMEOUT)) ++timeouts;
+			});
+			auto start = std::chrono::steady_clock::now();
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			THEN("They time out promptly") {
+				CHECK(timeouts == 4);
+				CHECK(elapsed < std::chrono::seconds(5));
+				CHECK(done(c));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects may reuse UDP sockets", "[asio_cares][channel][pool]") {
+	GIVEN("An asio_cares::channel which pools UDP sockets and a server") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options opts;
+		std::memset(&opts, 0, sizeof(opts));
+		#if ARES_VERSION >= 0x011700
+		//	Otherwise libcares answers the second query
+		//	from its own cache
+		channel c(opts, ARES_OPT_QUERY_CACHE, ios);
+		#else
+		channel c(opts, 0, ios);
+		#endif
+		c.set_socket_pool_size(4);
+		CHECK(c.get_socket_pool_size() == 4);
+		server s;
+		s.apply(c);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		class usage {
+		public:
+			bool           succeeded;
+			int            fd;
+			unsigned short port;
+		};
+		//	libcares closes its sockets once no queries
+		//	remain
+		auto round = [&] () {
+			usage retr;
+			retr.succeeded = false;
+			async_send(c, ptr, buflen, [&] (auto ec, auto, auto, auto) noexcept {
+				retr.succeeded = !ec;
+			});
+			retr.fd = -1;
+			retr.port = 0;
+			c.for_each_socket([&] (auto & socket) noexcept {
+				boost::system::error_code ec;
+				retr.fd = int(socket.native_handle());
+				retr.port = socket.local_endpoint(ec).port();
+			});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			ios.reset();
+			return retr;
+		};
+		WHEN("Queries are sent and processed one after another") {
+			auto first = round();
+			auto second = round();
+			THEN("They succeed") {
+				CHECK(first.succeeded);
+				CHECK(second.succeeded);
+				CHECK(done(c));
+			}
+			#ifndef _WIN32
+			THEN("The socket is reused but bound to a fresh port") {
+				if (metrics::enabled) CHECK(c.get_metrics().reused() == 1);
+				CHECK(first.fd == second.fd);
+				CHECK(first.port != 0);
+				CHECK(second.port != 0);
+				CHECK(first.port != second.port);
+			}
+			#endif
+		}
+		WHEN("The pool is disabled and queries are sent and processed one after another") {
+			c.set_socket_pool_size(0);
+			round();
+			round();
+			THEN("No socket is reused") {
+				CHECK(c.get_metrics().reused() == 0);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,160 @@
+#include <asio_cares/channel_pool.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstddef>
+#include <set>
+#include <string>
+#include <vector>
+#include "server.hpp"
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::channel_pool routes queries by question", "[asio_cares][channel_pool]") {
+	GIVEN("An asio_cares::channel_pool") {
+		library l;
+		boost::asio::io_service ios;
+		channel_pool pool(ios, 4);
+		REQUIRE(pool.size() == 4);
+		server s;
+		for (std::size_t i = 0; i < pool.size(); ++i) s.apply(pool[i]);
+		THEN("It is done") {
+			CHECK(done(pool));
+		}
+		WHEN("The same question is routed several times") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("example.com",
+				                           ns_c_in,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string g(ptr);
+			auto && a = pool.route(ptr, buflen);
+			ptr[0] ^= 0xFF;
+			auto && b = pool.route(ptr, buflen);
+			THEN("The same channel is chosen regardless of the query ID") {
+				CHECK(&a == &b);
+			}
+		}
+		WHEN("A malformed query is routed") {
+			unsigned char garbage [] = {0, 1, 2};
+			THEN("The channel for the calling thread is chosen") {
+				CHECK(&pool.route(garbage, sizeof(garbage)) == &pool.for_this_thread());
+			}
+		}
+		WHEN("Several distinct queries are sent") {
+			std::vector<string> queries;
+			std::set<const channel *> used;
+			std::size_t succeeded = 0;
+			for (std::size_t i = 0; i < 32; ++i) {
+				unsigned char * ptr;
+				int buflen;
+				std::string name("host");
+				name += std::to_string(i);
+				name += ".example.com";
+				int result = ares_create_query(name.c_str(),
+					                           ns_c_in,
+					                           ns_t_a,
+					                           0,
+					                           1,
+					                           &ptr,
+					                           &buflen,
+					                           0);
+				raise(result);
+				queries.emplace_back(ptr);
+				used.insert(&pool.route(ptr, buflen));
+				async_send(pool, ptr, buflen, [&] (auto ec, auto, auto, auto) noexcept {
+					if (!ec) ++succeeded;
+				});
+			}
+			THEN("They are spread across channels") {
+				CHECK(used.size() > 1);
+				CHECK_FALSE(done(pool));
+			}
+			AND_WHEN("asio_cares::async_process is invoked on the pool") {
+				bool invoked = false;
+				boost::system::error_code ec;
+				async_process(pool, [&] (auto e) noexcept {
+					ec = e;
+					invoked = true;
+				});
+				ios.run();
+				THEN("Every query completes and the operation completes once") {
+					REQUIRE(invoked);
+					INFO(ec.message());
+					CHECK_FALSE(ec);
+					CHECK(succeeded == 32);
+					CHECK(done(pool));
+				}
+			}
+			AND_WHEN("asio_cares::cancel is invoked on the pool") {
+				bool invoked = false;
+				async_process(pool, [&] (auto) noexcept {	invoked = true;	});
+				cancel(pool);
+				ios.run();
+				THEN("Every channel is done") {
+					CHECK(invoked);
+					CHECK(done(pool));
+				}
+			}
+		}
+		WHEN("asio_cares::async_process is invoked on an idle pool") {
+			bool invoked = false;
+			boost::system::error_code ec;
+			async_process(pool, [&] (auto e) noexcept {
+				ec = e;
+				invoked = true;
+			});
+			ios.run();
+			THEN("It completes without error") {
+				REQUIRE(invoked);
+				CHECK_FALSE(ec);
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel_pool may have one channel per io_service", "[asio_cares][channel_pool]") {
+	GIVEN("Several boost::asio::io_service objects") {
+		library l;
+		boost::asio::io_service a;
+		boost::asio::io_service b;
+		std::vector<boost::asio::io_service *> services{&a, &b};
+		WHEN("An asio_cares::channel_pool is created therefrom") {
+			channel_pool pool(services);
+			THEN("Each channel uses the corresponding io_service") {
+				REQUIRE(pool.size() == 2);
+				CHECK(&pool[0].get_io_service() == &a);
+				CHECK(&pool[1].get_io_service() == &b);
+			}
+			THEN("The channel for the calling thread is stable") {
+				CHECK(&pool.for_this_thread() == &pool.for_this_thread());
+			}
+		}
+	}
+}
+
+}
+}
+}
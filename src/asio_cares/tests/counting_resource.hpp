@@ -0,0 +1,37 @@
+#pragma once
+
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+
+namespace asio_cares {
+namespace tests {
+
+/**
+ *	A \ref memory_resource which allocates using
+ *	\ref new_delete_resource and counts allocations
+ *	and deallocations.
+ */
+class counting_resource : public memory_resource {
+public:
+	counting_resource () noexcept
+		:	allocations  (0),
+			deallocations(0)
+	{}
+	std::size_t allocations;
+	std::size_t deallocations;
+private:
+	virtual void * do_allocate (std::size_t bytes, std::size_t alignment) override {
+		++allocations;
+		return new_delete_resource().allocate(bytes, alignment);
+	}
+	virtual void do_deallocate (void * ptr, std::size_t bytes, std::size_t alignment) noexcept override {
+		++deallocations;
+		new_delete_resource().deallocate(ptr, bytes, alignment);
+	}
+	virtual bool do_is_equal (const memory_resource & other) const noexcept override {
+		return this == &other;
+	}
+};
+
+}
+}
@@ -0,0 +1,137 @@
+#include <asio_cares/detail/datagram_batch.hpp>
+
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <catch.hpp>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace asio_cares {
+namespace detail {
+namespace tests {
+namespace {
+
+#ifdef __linux__
+
+class socket_pair {
+public:
+	socket_pair () {
+		if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) != 0) throw std::runtime_error("socketpair failed");
+	}
+	~socket_pair () noexcept {
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+	int fds [2];
+};
+
+SCENARIO("asio_cares::detail::datagram_batch objects receive several datagrams per system call", "[asio_cares][detail][datagram_batch]") {
+	GIVEN("An asio_cares::detail::datagram_batch and a pair of connected datagram sockets") {
+		datagram_batch b(new_delete_resource());
+		socket_pair p;
+		WHEN("More datagrams than fit in a batch are waiting") {
+			const std::size_t n = datagram_batch::size + 4;
+			for (std::size_t i = 0; i < n; ++i) {
+				unsigned char c [2] = {static_cast<unsigned char>(i), static_cast<unsigned char>(i)};
+				REQUIRE(::send(p.fds[1], c, (i % 2) + 1, 0) == ares_ssize_t((i % 2) + 1));
+			}
+			THEN("They are received in order with one system call per batch") {
+				std::size_t syscalls = 0;
+				for (std::size_t i = 0; i < n; ++i) {
+					INFO(i);
+					unsigned char buffer [16];
+					auto result = b.receive(p.fds[0], buffer, sizeof(buffer), nullptr, nullptr, syscalls);
+					REQUIRE(result == ares_ssize_t((i % 2) + 1));
+					CHECK(buffer[0] == i);
+				}
+				CHECK(syscalls == 2);
+				CHECK(b.received() == 0);
+				unsigned char buffer [16];
+				CHECK(b.receive(p.fds[0], buffer, sizeof(buffer), nullptr, nullptr, syscalls) == -1);
+				CHECK(errno == EAGAIN);
+				CHECK(syscalls == 3);
+			}
+			THEN("Datagrams in the ring are truncated to the caller's buffer") {
+				std::size_t syscalls = 0;
+				unsigned char buffer [2];
+				REQUIRE(b.receive(p.fds[0], buffer, 1, nullptr, nullptr, syscalls) == 1);
+				REQUIRE(b.receive(p.fds[0], buffer, 1, nullptr, nullptr, syscalls) == 1);
+				CHECK(buffer[0] == 1);
+				CHECK(b.received() == (datagram_batch::size - 2));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::detail::datagram_batch objects send several datagrams per system call", "[asio_cares][detail][datagram_batch]") {
+	GIVEN("An asio_cares::detail::datagram_batch and a pair of connected datagram sockets") {
+		datagram_batch b(new_delete_resource());
+		socket_pair p;
+		WHEN("Datagrams are queued") {
+			for (std::size_t i = 0; i < 3; ++i) {
+				unsigned char head = static_cast<unsigned char>(i);
+				unsigned char tail [] = {0xAA, 0xBB};
+				struct iovec data [2];
+				data[0].iov_base = &head;
+				data[0].iov_len = 1;
+				data[1].iov_base = tail;
+				data[1].iov_len = sizeof(tail);
+				REQUIRE(b.queue(data, 2));
+			}
+			THEN("Nothing is sent") {
+				CHECK(b.queued() == 3);
+				unsigned char buffer [16];
+				CHECK(::recv(p.fds[0], buffer, sizeof(buffer), 0) == -1);
+			}
+			AND_WHEN("They are sent") {
+				auto syscalls = b.send(p.fds[1]);
+				THEN("They are sent in order with one system call") {
+					CHECK(syscalls == 1);
+					CHECK(b.queued() == 0);
+					for (std::size_t i = 0; i < 3; ++i) {
+						INFO(i);
+						unsigned char buffer [16];
+						REQUIRE(::recv(p.fds[0], buffer, sizeof(buffer), 0) == 3);
+						CHECK(buffer[0] == i);
+						CHECK(buffer[1] == 0xAA);
+						CHECK(buffer[2] == 0xBB);
+					}
+				}
+			}
+		}
+		WHEN("A datagram too large to queue is queued") {
+			unsigned char large [datagram_batch::send_size + 1] = {};
+			struct iovec data;
+			data.iov_base = large;
+			data.iov_len = sizeof(large);
+			THEN("It is refused") {
+				CHECK_FALSE(b.queue(&data, 1));
+				CHECK(b.queued() == 0);
+			}
+		}
+		WHEN("The queue is filled") {
+			unsigned char c = 0;
+			struct iovec data;
+			data.iov_base = &c;
+			data.iov_len = 1;
+			for (std::size_t i = 0; i < datagram_batch::size; ++i) REQUIRE(b.queue(&data, 1));
+			THEN("Further datagrams are refused") {
+				CHECK_FALSE(b.queue(&data, 1));
+			}
+		}
+	}
+}
+
+#endif
+
+}
+}
+}
+}
@@ -5,9 +5,12 @@
 #include <asio_cares/channel.hpp>
 #include <asio_cares/error.hpp>
 #include <asio_cares/library.hpp>
+#include <asio_cares/process_fds.hpp>
 #include <asio_cares/string.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/system/error_code.hpp>
+#include <utility>
+#include <vector>
 #include <catch.hpp>
 
 #ifdef _WIN32
@@ -48,13 +51,11 @@ SCENARIO("asio_cares::detail::async_select may be used to wait for readability o
 			REQUIRE_FALSE(invoked);
 			AND_WHEN("asio_cares::detail::async_select is invoked") {
 				bool invoked = false;
-				ares_socket_t read = ARES_SOCKET_BAD;
-				ares_socket_t write = ARES_SOCKET_BAD;
+				detail::select_result_type ready;
 				boost::system::error_code ec;
-				detail::async_select(c, [&] (auto e, auto r, auto w) noexcept {
+				detail::async_select(c, [&] (auto e, auto r) noexcept {
 					ec = e;
-					read = r;
-					write = w;
+					ready = std::move(r);
 					invoked = true;
 				});
 				AND_WHEN("boost::asio::io_service::run is invoked") {
@@ -65,10 +66,12 @@ SCENARIO("asio_cares::detail::async_select may be used to wait for readability o
 							INFO(ec.message());
 							REQUIRE_FALSE(ec);
 							AND_THEN("At least one of the sockets is ready") {
-								bool readable = read != ARES_SOCKET_BAD;
-								bool writable = write != ARES_SOCKET_BAD;
-								bool ready = readable || writable;
-								CHECK(ready);
+								REQUIRE_FALSE(ready.empty());
+								for (auto && e : ready) {
+									CHECK(e.socket != ARES_SOCKET_BAD);
+									bool readable_or_writable = e.readable || e.writable;
+									CHECK(readable_or_writable);
+								}
 							}
 						}
 					}
@@ -0,0 +1,123 @@
+#include <asio_cares/detail/socket_table.hpp>
+
+#include <asio_cares/memory_resource.hpp>
+#include <cstddef>
+#include <set>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace detail {
+namespace tests {
+namespace {
+
+class value {
+public:
+	value (int v, std::size_t & live) noexcept
+		:	v    (v),
+			live_(&live)
+	{
+		++*live_;
+	}
+	value (const value &) = delete;
+	value & operator = (const value &) = delete;
+	~value () noexcept {
+		--*live_;
+	}
+	int v;
+private:
+	std::size_t * live_;
+};
+
+SCENARIO("asio_cares::detail::socket_table maps socket descriptors to values", "[asio_cares][detail][socket_table]") {
+	GIVEN("An empty asio_cares::detail::socket_table") {
+		std::size_t live = 0;
+		socket_table<value> t(new_delete_resource());
+		THEN("It is empty") {
+			CHECK(t.empty());
+			CHECK(t.size() == 0);
+			CHECK(t.begin() == t.end());
+			CHECK_FALSE(t.find(0));
+			CHECK_FALSE(t.find(1000));
+		}
+		WHEN("Values are inserted for sparse descriptors") {
+			auto && a = t.emplace(3, 3, live);
+			auto && b = t.emplace(64, 64, live);
+			auto && c = t.emplace(1000, 1000, live);
+			THEN("They are found by descriptor") {
+				CHECK(t.size() == 3);
+				CHECK(t.find(3) == &a);
+				CHECK(t.find(64) == &b);
+				CHECK(t.find(1000) == &c);
+				CHECK_FALSE(t.find(4));
+				CHECK_FALSE(t.find(999));
+				CHECK_FALSE(t.find(100000));
+			}
+			THEN("Iterating visits each exactly once") {
+				std::multiset<int> seen;
+				for (auto && v : t) seen.insert(v.v);
+				CHECK(seen == std::multiset<int>{3, 64, 1000});
+			}
+			AND_WHEN("Values are inserted for many more descriptors") {
+				for (int i = 0; i < 500; ++i) if ((i != 3) && (i != 64)) t.emplace(std::size_t(i), i, live);
+				THEN("The addresses of the existing values do not change") {
+					CHECK(t.find(3) == &a);
+					CHECK(t.find(64) == &b);
+					CHECK(t.find(1000) == &c);
+					CHECK(a.v == 3);
+					CHECK(b.v == 64);
+					CHECK(c.v == 1000);
+				}
+			}
+			AND_WHEN("One is erased") {
+				t.erase(3);
+				THEN("It is destroyed and is no longer found") {
+					CHECK(live == 2);
+					CHECK(t.size() == 2);
+					CHECK_FALSE(t.find(3));
+				}
+				THEN("The others are still found and iterated") {
+					CHECK(t.find(64) == &b);
+					CHECK(t.find(1000) == &c);
+					std::multiset<int> seen;
+					for (auto && v : t) seen.insert(v.v);
+					CHECK(seen == std::multiset<int>{64, 1000});
+				}
+				AND_WHEN("A value is inserted for the same descriptor") {
+					auto && d = t.emplace(3, 4, live);
+					THEN("It is found") {
+						CHECK(t.find(3) == &d);
+						CHECK(d.v == 4);
+						CHECK(t.size() == 3);
+					}
+				}
+			}
+			AND_WHEN("Every value is erased") {
+				t.erase(1000);
+				t.erase(3);
+				t.erase(64);
+				THEN("It is empty") {
+					CHECK(live == 0);
+					CHECK(t.empty());
+					CHECK(t.begin() == t.end());
+				}
+			}
+		}
+	}
+	GIVEN("An asio_cares::detail::socket_table which contains values") {
+		std::size_t live = 0;
+		{
+			socket_table<value> t(new_delete_resource());
+			t.emplace(1, 1, live);
+			t.emplace(200, 200, live);
+			REQUIRE(live == 2);
+		}
+		THEN("Destroying it destroys them") {
+			CHECK(live == 0);
+		}
+	}
+}
+
+}
+}
+}
+}
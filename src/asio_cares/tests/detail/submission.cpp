@@ -0,0 +1,126 @@
+#include <asio_cares/detail/submission.hpp>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace detail {
+namespace tests {
+namespace {
+
+class counter final : public submission {
+public:
+	counter () noexcept
+		:	producer(0),
+			sequence(0),
+			runs    (0)
+	{}
+	virtual void run () noexcept override {
+		++runs;
+	}
+	std::size_t producer;
+	std::size_t sequence;
+	std::size_t runs;
+};
+
+SCENARIO("asio_cares::detail::submission_queue is a multiple producer single consumer queue", "[asio_cares][detail][submission_queue]") {
+	GIVEN("An empty asio_cares::detail::submission_queue") {
+		submission_queue q;
+		THEN("It is empty") {
+			CHECK(q.size() == 0);
+			CHECK(q.pop() == nullptr);
+		}
+		WHEN("Submissions are pushed") {
+			counter a;
+			counter b;
+			counter c;
+			bool first = q.push(a);
+			bool second = q.push(b);
+			bool third = q.push(c);
+			THEN("Only the first reports that the queue was idle") {
+				CHECK(first);
+				CHECK_FALSE(second);
+				CHECK_FALSE(third);
+				CHECK(q.size() == 3);
+			}
+			THEN("They are popped in order") {
+				CHECK(q.pop() == &a);
+				CHECK(q.pop() == &b);
+				CHECK(q.pop() == &c);
+				CHECK(q.pop() == nullptr);
+				AND_WHEN("They are consumed") {
+					bool more = q.consume(3);
+					THEN("The queue is idle") {
+						CHECK_FALSE(more);
+						CHECK(q.size() == 0);
+					}
+					AND_WHEN("Another submission is pushed") {
+						THEN("It reports that the queue was idle") {
+							CHECK(q.push(a));
+							CHECK(q.pop() == &a);
+							CHECK_FALSE(q.consume(1));
+						}
+					}
+				}
+				AND_WHEN("Another submission is pushed before they are consumed") {
+					counter d;
+					bool idle = q.push(d);
+					THEN("It does not report that the queue was idle and consumption reports more") {
+						CHECK_FALSE(idle);
+						CHECK(q.consume(3));
+						CHECK(q.pop() == &d);
+						CHECK_FALSE(q.consume(1));
+					}
+				}
+			}
+		}
+	}
+	GIVEN("Several threads pushing concurrently") {
+		submission_queue q;
+		const std::size_t producers = 4;
+		const std::size_t per = 10000;
+		std::vector<counter> counters(producers * per);
+		for (std::size_t i = 0; i < producers; ++i) for (std::size_t j = 0; j < per; ++j) {
+			auto && c = counters[(i * per) + j];
+			c.producer = i;
+			c.sequence = j;
+		}
+		std::vector<std::thread> threads;
+		for (std::size_t i = 0; i < producers; ++i) threads.emplace_back([&, i] () {
+			for (std::size_t j = 0; j < per; ++j) q.push(counters[(i * per) + j]);
+		});
+		WHEN("The consumer pops concurrently") {
+			std::size_t popped = 0;
+			std::vector<std::size_t> last(producers, 0);
+			bool ordered = true;
+			while (popped != counters.size()) {
+				auto s = q.pop();
+				if (!s) {
+					std::this_thread::yield();
+					continue;
+				}
+				auto && c = static_cast<counter &>(*s);
+				if (c.sequence && (last[c.producer] != c.sequence)) ordered = false;
+				last[c.producer] = c.sequence + 1;
+				s->run();
+				++popped;
+			}
+			for (auto && t : threads) t.join();
+			THEN("Every submission is popped exactly once and in the order each producer pushed them") {
+				CHECK(ordered);
+				bool once = true;
+				for (auto && c : counters) if (c.runs != 1) once = false;
+				CHECK(once);
+				CHECK(q.pop() == nullptr);
+				CHECK_FALSE(q.consume(popped));
+			}
+		}
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,164 @@
+#include <asio_cares/detail/timer_wheel.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace detail {
+namespace tests {
+namespace {
+
+class deadline final : public timer_wheel_entry {
+public:
+	deadline () noexcept
+		:	expired(false)
+	{}
+	virtual void expire () override {
+		expired = true;
+	}
+	bool expired;
+};
+
+class remover final : public timer_wheel_entry {
+public:
+	remover (timer_wheel & w, timer_wheel_entry & other) noexcept
+		:	wheel_(w),
+			other_(other)
+	{}
+	virtual void expire () override {
+		if (other_.linked) wheel_.remove(other_);
+	}
+private:
+	timer_wheel &       wheel_;
+	timer_wheel_entry & other_;
+};
+
+std::size_t expire (timer_wheel & w, timer_wheel::clock::time_point now) {
+	std::size_t retr = 0;
+	while (auto e = w.pop(now)) {
+		e->expire();
+		++retr;
+	}
+	return retr;
+}
+
+SCENARIO("asio_cares::detail::timer_wheel expires entries once their deadlines pass", "[asio_cares][detail][timer_wheel]") {
+	GIVEN("An empty asio_cares::detail::timer_wheel") {
+		auto origin = timer_wheel::clock::now();
+		timer_wheel w(std::chrono::milliseconds(1), origin);
+		THEN("It is empty") {
+			CHECK(w.empty());
+			CHECK(w.size() == 0);
+			CHECK(w.next_expiry() == timer_wheel::clock::time_point::max());
+			CHECK(w.pop(origin + std::chrono::hours(1)) == nullptr);
+		}
+		WHEN("Entries are inserted with deadlines at every level of the wheel") {
+			std::vector<std::chrono::milliseconds> offsets{
+				std::chrono::milliseconds(3),
+				std::chrono::milliseconds(63),
+				std::chrono::milliseconds(64),
+				std::chrono::milliseconds(1000),
+				std::chrono::milliseconds(4096),
+				std::chrono::milliseconds(300000),
+				std::chrono::hours(10)
+			};
+			std::vector<deadline> entries(offsets.size());
+			for (std::size_t i = 0; i < offsets.size(); ++i) w.insert(entries[i], origin + offsets[i]);
+			CHECK(w.size() == offsets.size());
+			THEN("Each expires only once its deadline passes") {
+				for (std::size_t i = 0; i < offsets.size(); ++i) {
+					CHECK(expire(w, origin + offsets[i] - std::chrono::milliseconds(1)) == 0);
+					CHECK_FALSE(entries[i].expired);
+					CHECK(expire(w, origin + offsets[i]) == 1);
+					CHECK(entries[i].expired);
+					CHECK_FALSE(entries[i].linked);
+				}
+				CHECK(w.empty());
+			}
+			THEN("The next expiry is never later than the earliest deadline") {
+				CHECK(w.next_expiry() <= (origin + offsets.front()));
+			}
+			AND_WHEN("Some are removed") {
+				w.remove(entries[1]);
+				w.remove(entries[5]);
+				THEN("They never expire") {
+					CHECK(w.size() == (offsets.size() - 2));
+					CHECK(expire(w, origin + std::chrono::hours(11)) == (offsets.size() - 2));
+					CHECK_FALSE(entries[1].expired);
+					CHECK_FALSE(entries[5].expired);
+					CHECK(w.empty());
+				}
+			}
+		}
+		WHEN("An entry is inserted with a deadline which has already passed") {
+			CHECK(w.pop(origin + std::chrono::milliseconds(10)) == nullptr);
+			deadline e;
+			w.insert(e, origin);
+			THEN("It expires upon the next tick") {
+				CHECK(expire(w, origin + std::chrono::milliseconds(10)) == 0);
+				CHECK(expire(w, origin + std::chrono::milliseconds(11)) == 1);
+			}
+		}
+		WHEN("An entry is inserted with a deadline far in the future") {
+			deadline e;
+			auto when = origin + std::chrono::seconds(30);
+			w.insert(e, when);
+			THEN("Waiting until each next expiry reaches the deadline in only a few steps") {
+				std::size_t wakeups = 0;
+				bool late = false;
+				while (!e.expired && (wakeups < 100)) {
+					auto next = w.next_expiry();
+					if (next > when) late = true;
+					++wakeups;
+					expire(w, next);
+				}
+				CHECK(e.expired);
+				CHECK_FALSE(late);
+				CHECK(wakeups <= 4);
+			}
+		}
+		WHEN("Two entries with the same deadline are inserted, the first of which removes the second when it expires") {
+			deadline second;
+			remover first(w, second);
+			w.insert(second, origin + std::chrono::milliseconds(5));
+			w.insert(first, origin + std::chrono::milliseconds(5));
+			THEN("Only the first expires") {
+				CHECK(w.pop(origin + std::chrono::milliseconds(5)) == &first);
+				first.expire();
+				CHECK(w.pop(origin + std::chrono::milliseconds(5)) == nullptr);
+				CHECK_FALSE(second.expired);
+				CHECK(w.empty());
+			}
+		}
+		WHEN("Many entries are inserted and the wheel is advanced in small steps") {
+			std::vector<deadline> entries(100000);
+			for (std::size_t i = 0; i < entries.size(); ++i) {
+				w.insert(entries[i], origin + std::chrono::milliseconds(1 + ((i * 7919) % 20000)));
+			}
+			std::size_t expired = 0;
+			bool early = false;
+			for (std::size_t ms = 1; ms <= 20000; ms += 13) {
+				auto now = origin + std::chrono::milliseconds(ms);
+				while (auto e = w.pop(now)) {
+					auto && d = static_cast<deadline &>(*e);
+					std::size_t i = std::size_t(&d - entries.data());
+					if ((origin + std::chrono::milliseconds(1 + ((i * 7919) % 20000))) > now) early = true;
+					++expired;
+				}
+			}
+			expired += expire(w, origin + std::chrono::milliseconds(20001));
+			THEN("Every entry expires exactly once and none expire early") {
+				CHECK(expired == entries.size());
+				CHECK_FALSE(early);
+				CHECK(w.empty());
+			}
+		}
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,232 @@
+#include <asio_cares/detail/uring.hpp>
+
+#include <asio_cares/memory_resource.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include "../counting_resource.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <catch.hpp>
+
+#ifdef ASIO_CARES_IO_URING
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace asio_cares {
+namespace detail {
+namespace tests {
+namespace {
+
+#ifdef ASIO_CARES_IO_URING
+
+class socket_pair {
+public:
+	socket_pair () {
+		if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) != 0) throw std::runtime_error("socketpair failed");
+	}
+	~socket_pair () noexcept {
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+	int fds [2];
+};
+
+class notifications {
+public:
+	notifications ()
+		:	count(0),
+			fd   (-1)
+	{}
+	std::size_t count;
+	int         fd;
+};
+
+void notify (void * data, int fd) {
+	auto && n = *static_cast<notifications *>(data);
+	++n.count;
+	n.fd = fd;
+}
+
+//	Waits for completions and completes them
+std::size_t complete (boost::asio::io_service & ios, uring & ring) {
+	bool ready = false;
+	ring.async_wait([&] (auto, auto) noexcept {
+		ready = true;
+	});
+	ios.reset();
+	while (!ready) ios.run_one();
+	return ring.complete();
+}
+
+SCENARIO("asio_cares::detail::uring_receiver objects receive datagrams through a ring", "[asio_cares][detail][uring]") {
+	if (!uring::supported()) return;
+	GIVEN("An asio_cares::detail::uring, an asio_cares::detail::uring_receiver, and a pair of connected datagram sockets") {
+		boost::asio::io_service ios;
+		uring ring(ios, new_delete_resource());
+		boost::system::error_code ec;
+		REQUIRE(ring.open(ec));
+		uring_receiver r(new_delete_resource());
+		socket_pair p;
+		notifications n;
+		std::size_t syscalls = 0;
+		REQUIRE(r.start(ring, p.fds[0], &notify, &n, syscalls));
+		CHECK(ring.pending() == uring_receiver::depth);
+		CHECK(ring.submit() == 1);
+		CHECK(ring.pending() == 0);
+		WHEN("Nothing has arrived") {
+			THEN("Nothing is received") {
+				CHECK(ring.complete() == 0);
+				unsigned char buffer [16];
+				CHECK(r.receive(buffer, sizeof(buffer), nullptr, nullptr, syscalls) == -1);
+				CHECK(errno == EAGAIN);
+				CHECK(n.count == 0);
+			}
+		}
+		WHEN("Datagrams arrive") {
+			const std::size_t num = 3;
+			for (std::size_t i = 0; i < num; ++i) {
+				unsigned char c [2] = {static_cast<unsigned char>(i), static_cast<unsigned char>(i)};
+				REQUIRE(::send(p.fds[1], c, (i % 2) + 1, 0) == ares_ssize_t((i % 2) + 1));
+			}
+			std::size_t completed = 0;
+			while (completed < num) completed += complete(ios, ring);
+			THEN("The callback is invoked once") {
+				CHECK(n.count == 1);
+				CHECK(n.fd == p.fds[0]);
+				CHECK(r.received() == num);
+			}
+			THEN("They are received in order without system calls and receives are prepared to replace them") {
+				for (std::size_t i = 0; i < num; ++i) {
+					INFO(i);
+					unsigned char buffer [16];
+					auto result = r.receive(buffer, sizeof(buffer), nullptr, nullptr, syscalls);
+					REQUIRE(result == ares_ssize_t((i % 2) + 1));
+					CHECK(buffer[0] == i);
+				}
+				CHECK(syscalls == 0);
+				CHECK(r.received() == 0);
+				CHECK(ring.pending() == num);
+				unsigned char buffer [16];
+				CHECK(r.receive(buffer, sizeof(buffer), nullptr, nullptr, syscalls) == -1);
+				CHECK(errno == EAGAIN);
+			}
+			THEN("Datagrams are truncated to the caller's buffer") {
+				unsigned char buffer [1];
+				REQUIRE(r.receive(buffer, sizeof(buffer), nullptr, nullptr, syscalls) == 1);
+				REQUIRE(r.receive(buffer, sizeof(buffer), nullptr, nullptr, syscalls) == 1);
+				CHECK(buffer[0] == 1);
+			}
+			AND_WHEN("The receiver is stopped") {
+				CHECK(r.stop() != 0);
+				THEN("The datagrams are discarded") {
+					CHECK(r.received() == 0);
+				}
+			}
+		}
+		WHEN("The receiver is stopped") {
+			CHECK(r.stop() != 0);
+			while (ring.outstanding()) complete(ios, ring);
+			AND_WHEN("A datagram arrives") {
+				unsigned char c = 0;
+				REQUIRE(::send(p.fds[1], &c, 1, 0) == 1);
+				THEN("It is not received by the ring") {
+					CHECK(ring.complete() == 0);
+					CHECK(n.count == 0);
+					CHECK(::recv(p.fds[0], &c, 1, 0) == 1);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::detail::uring_receiver objects release their storage once their receives complete", "[asio_cares][detail][uring]") {
+	if (!uring::supported()) return;
+	GIVEN("An asio_cares::detail::uring and an asio_cares::detail::uring_receiver which allocate from a resource and a datagram socket") {
+		asio_cares::tests::counting_resource resource;
+		socket_pair p;
+		{
+			boost::asio::io_service ios;
+			uring ring(ios, resource);
+			boost::system::error_code ec;
+			REQUIRE(ring.open(ec));
+			notifications n;
+			std::size_t syscalls = 0;
+			{
+				uring_receiver r(resource);
+				REQUIRE(r.start(ring, p.fds[0], &notify, &n, syscalls));
+				ring.submit();
+			}
+			THEN("Its storage outlives it while its receives are outstanding") {
+				CHECK(resource.allocations != resource.deallocations);
+			}
+		}
+		THEN("Its storage is released once the ring is destroyed") {
+			CHECK(resource.allocations == resource.deallocations);
+		}
+	}
+}
+
+SCENARIO("asio_cares::detail::uring objects send several datagrams per system call", "[asio_cares][detail][uring]") {
+	if (!uring::supported()) return;
+	GIVEN("An asio_cares::detail::uring and a pair of connected datagram sockets") {
+		boost::asio::io_service ios;
+		uring ring(ios, new_delete_resource());
+		boost::system::error_code ec;
+		REQUIRE(ring.open(ec));
+		socket_pair p;
+		WHEN("Datagrams are sent") {
+			for (std::size_t i = 0; i < 3; ++i) {
+				unsigned char head = static_cast<unsigned char>(i);
+				unsigned char tail [] = {0xAA, 0xBB};
+				struct iovec data [2];
+				data[0].iov_base = &head;
+				data[0].iov_len = 1;
+				data[1].iov_base = tail;
+				data[1].iov_len = sizeof(tail);
+				REQUIRE(ring.send(p.fds[1], data, 2));
+			}
+			THEN("Nothing is sent until they are submitted") {
+				CHECK(ring.pending() == 3);
+				unsigned char buffer [16];
+				CHECK(::recv(p.fds[0], buffer, sizeof(buffer), 0) == -1);
+			}
+			AND_WHEN("They are submitted") {
+				auto syscalls = ring.submit();
+				std::size_t completed = 0;
+				while (completed < 3) completed += complete(ios, ring);
+				THEN("They are sent in order with one system call") {
+					CHECK(syscalls == 1);
+					CHECK(ring.outstanding() == 0);
+					for (std::size_t i = 0; i < 3; ++i) {
+						INFO(i);
+						unsigned char buffer [16];
+						REQUIRE(::recv(p.fds[0], buffer, sizeof(buffer), 0) == 3);
+						CHECK(buffer[0] == i);
+						CHECK(buffer[1] == 0xAA);
+						CHECK(buffer[2] == 0xBB);
+					}
+				}
+			}
+		}
+		WHEN("A datagram too large to copy is sent") {
+			unsigned char large [uring::send_size + 1] = {};
+			struct iovec data;
+			data.iov_base = large;
+			data.iov_len = sizeof(large);
+			THEN("It is refused") {
+				CHECK_FALSE(ring.send(p.fds[1], &data, 1));
+				CHECK(ring.pending() == 0);
+			}
+		}
+	}
+}
+
+#endif
+
+}
+}
+}
+}
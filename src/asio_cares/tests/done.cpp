@@ -3,6 +3,8 @@
 #include <asio_cares/channel.hpp>
 #include <asio_cares/error.hpp>
 #include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
 #include <asio_cares/string.hpp>
 #include <boost/asio/io_service.hpp>
 #include "setup.hpp"
@@ -47,7 +49,79 @@ SCENARIO("asio_cares::done correctly determines whether there are outstanding qu
 			ares_send(c, ptr, buflen, f, &invoked);
 			REQUIRE_FALSE(invoked);
 			THEN("asio_cares::done reports that there are outstanding queries") {
+				CHECK_FALSE(done(static_cast<ares_channel>(c)));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::done correctly determines whether there are outstanding queries on an asio_cares::channel", "[asio_cares][done]") {
+	GIVEN("An asio_cares::channel") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		setup(c);
+		THEN("asio_cares::done reports there are no outstanding queries") {
+			CHECK(done(c));
+			CHECK(c.outstanding() == 0);
+		}
+		WHEN("A query is sent thereupon with asio_cares::async_send") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("google.com",
+				                           ns_c_any,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string s(ptr);
+			bool invoked = false;
+			async_send(c, ptr, buflen, [&] (auto, auto, auto, auto) noexcept {
+				invoked = true;
+			});
+			REQUIRE_FALSE(invoked);
+			THEN("asio_cares::done reports that there are outstanding queries") {
+				CHECK_FALSE(done(c));
+				CHECK(c.outstanding() == 1);
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [] (auto) noexcept {});
+				ios.run();
+				THEN("asio_cares::done reports there are no outstanding queries") {
+					REQUIRE(invoked);
+					CHECK(done(c));
+					CHECK(c.outstanding() == 0);
+				}
+			}
+		}
+		WHEN("A query is sent thereupon directly through libcares") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("google.com",
+				                           ns_c_any,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string s(ptr);
+			ares_send(c, ptr, buflen, [] (void *, int, int, unsigned char *, int) noexcept {}, nullptr);
+			THEN("asio_cares::done reports that there are outstanding queries even though they are not counted") {
 				CHECK_FALSE(done(c));
+				CHECK(c.active());
+				CHECK(c.outstanding() == 0);
+			}
+		}
+		WHEN("A malformed query is sent thereupon with asio_cares::async_send") {
+			async_send(c, nullptr, 0, [] (auto, auto, auto, auto) noexcept {});
+			THEN("asio_cares::done reports there are no outstanding queries") {
+				CHECK(done(c));
+				CHECK(c.outstanding() == 0);
 			}
 		}
 	}
@@ -0,0 +1,117 @@
+#include <asio_cares/getaddrinfo.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/system/error_code.hpp>
+#include "server.hpp"
+#include <catch.hpp>
+
+#if ARES_VERSION >= 0x011000
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::async_getaddrinfo resolves a name to endpoints", "[asio_cares][getaddrinfo]") {
+	GIVEN("An asio_cares::channel") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		server s;
+		s.apply(c);
+		WHEN("asio_cares::async_getaddrinfo is invoked") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			address_info_collection results;
+			async_getaddrinfo(c, "example.com", 80, [&] (auto e, auto r) {
+				ec = e;
+				results = std::move(r);
+				invoked = true;
+			});
+			REQUIRE_FALSE(invoked);
+			REQUIRE_FALSE(done(c));
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [&] (auto) noexcept {});
+				ios.run();
+				THEN("The operation completes successfully") {
+					REQUIRE(invoked);
+					INFO(ec.message());
+					REQUIRE_FALSE(ec);
+					CHECK(done(c));
+					AND_THEN("Both the IPv4 and IPv6 addresses are provided with the port") {
+						REQUIRE(results.size() == 2);
+						bool v4 = false;
+						bool v6 = false;
+						for (auto && r : results) {
+							CHECK(r.endpoint.port() == 80);
+							CHECK(r.ttl > 0);
+							if (r.endpoint.address() == boost::asio::ip::address::from_string("127.0.0.1")) v4 = true;
+							if (r.endpoint.address() == boost::asio::ip::address::from_string("::1")) v6 = true;
+						}
+						CHECK(v4);
+						CHECK(v6);
+					}
+				}
+			}
+		}
+		WHEN("asio_cares::async_getaddrinfo is invoked with a numeric address") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			address_info_collection results;
+			async_getaddrinfo(c, "127.0.0.1", 80, [&] (auto e, auto r) {
+				ec = e;
+				results = std::move(r);
+				invoked = true;
+			});
+			THEN("The completion handler is not invoked from within the initiating function") {
+				CHECK_FALSE(invoked);
+				AND_WHEN("asio_cares::async_process is invoked") {
+					async_process(c, [&] (auto) noexcept {});
+					ios.run();
+					THEN("The operation completes successfully with the address") {
+						REQUIRE(invoked);
+						INFO(ec.message());
+						REQUIRE_FALSE(ec);
+						bool found = false;
+						for (auto && r : results) {
+							CHECK(r.endpoint.port() == 80);
+							if (r.endpoint.address() == boost::asio::ip::address::from_string("127.0.0.1")) found = true;
+						}
+						CHECK(found);
+						CHECK(done(c));
+					}
+				}
+			}
+		}
+		WHEN("asio_cares::async_getaddrinfo is invoked and the channel is destroyed") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			{
+				channel other(ios);
+				s.apply(other);
+				async_getaddrinfo(other, "example.com", 80, [&] (auto e, auto r) {
+					ec = e;
+					invoked = true;
+					CHECK(r.empty());
+				});
+			}
+			ios.run();
+			THEN("The operation completes with ARES_EDESTRUCTION") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(ARES_EDESTRUCTION));
+			}
+		}
+	}
+}
+
+}
+}
+}
+
+#endif
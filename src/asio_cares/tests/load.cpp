@@ -0,0 +1,441 @@
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/process_one.hpp>
+#include <asio_cares/send.hpp>
+#include <asio_cares/string.hpp>
+#include <ares.h>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include "counting_resource.hpp"
+#include "server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+class load_result {
+public:
+	load_result ()
+		:	failed (0),
+			elapsed(clock::duration::zero())
+	{}
+	double throughput () const noexcept {
+		return double(latencies.size()) / std::chrono::duration<double>(elapsed).count();
+	}
+	clock::duration percentile (double p) const noexcept {
+		if (latencies.empty()) return clock::duration::zero();
+		return latencies[std::size_t(p * double(latencies.size() - 1))];
+	}
+	std::size_t                  failed;
+	clock::duration              elapsed;
+	//	Sorted
+	std::vector<clock::duration> latencies;
+};
+
+//	Keeps a certain number of queries in flight
+//	until a certain number have completed, the
+//	channel is processed by async_process_one if
+//	one is true and by async_process otherwise
+load_result run_load (channel & c, std::size_t n, std::size_t concurrency, bool one = false) {
+	unsigned char * ptr;
+	int buflen;
+	int result = ares_create_query("example.com",
+		                           ns_c_in,
+		                           ns_t_a,
+		                           0,
+		                           1,
+		                           &ptr,
+		                           &buflen,
+		                           0);
+	raise(result);
+	string g(ptr);
+	load_result retr;
+	retr.latencies.reserve(n);
+	std::size_t sent = 0;
+	std::function<void ()> send = [&] () {
+		++sent;
+		auto start = clock::now();
+		async_send(c, ptr, buflen, [&, start] (auto ec, auto, auto, auto) {
+			retr.latencies.push_back(clock::now() - start);
+			if (ec) ++retr.failed;
+			if (sent < n) send();
+		});
+	};
+	auto start = clock::now();
+	while ((sent < n) && (sent < concurrency)) send();
+	boost::system::error_code ec;
+	auto && ios = c.get_io_service();
+	if (one) {
+		//	Completions may be posted so whether the
+		//	channel is done is not enough
+		while (!ec && (retr.latencies.size() < n)) {
+			async_process_one(c, [&] (auto e, auto) noexcept {
+				ec = e;
+			});
+			ios.run();
+			ios.reset();
+		}
+	} else {
+		async_process(c, [&] (auto e) noexcept {
+			ec = e;
+		});
+		ios.run();
+	}
+	retr.elapsed = clock::now() - start;
+	if (ec) throw boost::system::system_error(ec);
+	std::sort(retr.latencies.begin(), retr.latencies.end());
+	return retr;
+}
+
+ares_options load_options () noexcept {
+	ares_options retr;
+	std::memset(&retr, 0, sizeof(retr));
+	retr.timeout = 50;
+	retr.tries = 4;
+	return retr;
+}
+
+#if ARES_VERSION >= 0x011700
+//	Otherwise libcares answers every query after
+//	the first from its own cache
+constexpr int load_optmask = ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES | ARES_OPT_QUERY_CACHE;
+#else
+constexpr int load_optmask = ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES;
+#endif
+constexpr std::size_t queries = 400;
+constexpr std::size_t concurrency = 32;
+//	Versions of libcares before 1.23 only move the
+//	first of several truncated responses processed
+//	together to TCP, the remainder are retried over
+//	UDP and are truncated again until they time out
+#if ARES_VERSION >= 0x011700
+constexpr std::size_t truncated_concurrency = concurrency;
+#else
+constexpr std::size_t truncated_concurrency = 1;
+#endif
+
+//	A channel and a server which injects certain
+//	faults, the channel is configured by a function
+//	before the server is applied to it
+class load_fixture {
+public:
+	explicit load_fixture (const std::function<void (channel &)> & configure = nullptr,
+	                       const server::faults & f = server::faults(),
+	                       const ares_options & options = load_options(),
+	                       int optmask = load_optmask,
+	                       memory_resource * resource = nullptr)
+		:	ptr(resource ? std::make_unique<channel>(options, optmask, ios, *resource) : std::make_unique<channel>(options, optmask, ios)),
+			c  (*ptr),
+			s  (1, f)
+	{
+		if (configure) configure(c);
+		s.apply(c);
+	}
+	library                  l;
+	boost::asio::io_service  ios;
+	std::unique_ptr<channel> ptr;
+	channel &                c;
+	server                   s;
+};
+
+void use_batching (channel & c) {
+	c.set_batching(true);
+}
+
+void use_io_uring (channel & c) {
+	c.set_io_uring(true);
+}
+
+server::faults truncate_all () {
+	server::faults retr;
+	retr.truncate = 1;
+	return retr;
+}
+
+server::faults oversize_all () {
+	server::faults retr;
+	retr.oversize = 1;
+	return retr;
+}
+
+#if ARES_VERSION >= 0x011400
+void use_pool (channel & c) {
+	c.set_socket_pool_size(8);
+}
+
+//	libcares makes UDP sockets be closed often
+//	which exercises pooling
+ares_options pool_options () noexcept {
+	auto retr = load_options();
+	retr.udp_max_queries = 4;
+	return retr;
+}
+#endif
+
+//	Every query succeeded within 100ms at the 99th
+//	percentile and the channel is done
+void check_quick (const load_result & r, channel & c, std::size_t n = queries) {
+	CHECK(r.failed == 0);
+	CHECK(r.latencies.size() == n);
+	CHECK(r.percentile(0.99) < std::chrono::milliseconds(100));
+	CHECK(done(c));
+}
+
+//	Every query fell back to TCP and succeeded
+void check_tcp (const load_result & r, load_fixture & x) {
+	CHECK(r.failed == 0);
+	CHECK(x.s.received_tcp() >= queries);
+	CHECK(done(x.c));
+}
+
+SCENARIO("asio_cares::channel objects sustain load when the server injects no faults", "[asio_cares][load]") {
+	GIVEN("An asio_cares::channel and a server") {
+		load_fixture x;
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+				CHECK(r.throughput() > 500);
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects sustain load when responses are delayed", "[asio_cares][load]") {
+	GIVEN("An asio_cares::channel and a server which delays responses with a long tail") {
+		server::faults f;
+		f.latency = std::chrono::milliseconds(2);
+		f.jitter = std::chrono::milliseconds(3);
+		f.tail = 0.02;
+		f.tail_latency = std::chrono::milliseconds(30);
+		load_fixture x(nullptr, f);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds and latency reflects the delay but is bounded") {
+				CHECK(r.failed == 0);
+				CHECK(r.percentile(0.5) >= std::chrono::milliseconds(2));
+				CHECK(r.percentile(0.99) < std::chrono::milliseconds(200));
+				CHECK(r.throughput() > 200);
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects sustain load when queries are lost", "[asio_cares][load]") {
+	GIVEN("An asio_cares::channel and a server which ignores a tenth of queries") {
+		server::faults f;
+		f.loss = 0.1;
+		load_fixture x(nullptr, f);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Lost queries are retried") {
+				CHECK(x.s.received() > queries);
+				CHECK(r.failed <= 2);
+				CHECK(r.percentile(0.5) < std::chrono::milliseconds(50));
+				CHECK(r.percentile(0.99) < std::chrono::seconds(2));
+				CHECK(r.throughput() > 100);
+				CHECK(done(x.c));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects sustain load when responses are truncated", "[asio_cares][load]") {
+	GIVEN("An asio_cares::channel and a server which truncates every UDP response") {
+		load_fixture x(nullptr, truncate_all());
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every query falls back to TCP and succeeds") {
+				check_tcp(r, x);
+				CHECK(r.percentile(0.99) < std::chrono::milliseconds(500));
+				CHECK(r.throughput() > 200);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel and a server which truncates every UDP response and is slow over TCP") {
+		auto f = truncate_all();
+		f.tcp_latency = std::chrono::milliseconds(20);
+		load_fixture x(nullptr, f);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every query succeeds after the TCP delay") {
+				CHECK(r.failed == 0);
+				CHECK(r.percentile(0.5) >= std::chrono::milliseconds(20));
+				CHECK(r.percentile(0.99) < std::chrono::seconds(1));
+				CHECK(done(x.c));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects sustain load when responses are duplicated", "[asio_cares][load]") {
+	GIVEN("An asio_cares::channel and a server which sends half of its responses twice") {
+		server::faults f;
+		f.duplicate = 0.5;
+		load_fixture x(nullptr, f);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Duplicates are ignored") {
+				check_quick(r, x.c);
+				CHECK(r.throughput() > 500);
+			}
+		}
+	}
+}
+
+
+SCENARIO("asio_cares::channel objects sustain load when datagrams are batched", "[asio_cares][load][batching]") {
+	GIVEN("An asio_cares::channel which batches datagrams and a server") {
+		load_fixture x(use_batching);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+				CHECK(r.throughput() > 500);
+			}
+			THEN("Fewer than two system calls are made per answer") {
+				if (metrics::enabled && x.c.get_batching()) CHECK(x.c.get_metrics().syscalls_per_answer() < 2);
+			}
+		}
+		WHEN("Queries are sent under load while the channel is processed by asio_cares::async_process_one") {
+			auto r = run_load(x.c, queries, concurrency, true);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which batches datagrams and a server whose UDP responses are too large to be received whole") {
+		load_fixture x(use_batching, oversize_all());
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every truncated response is noticed and every query falls back to TCP and succeeds") {
+				check_tcp(r, x);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which batches datagrams and a server which truncates every UDP response") {
+		load_fixture x(use_batching, truncate_all());
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every query falls back to TCP and succeeds") {
+				check_tcp(r, x);
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects sustain load when datagrams are handed to the kernel through io_uring", "[asio_cares][load][io_uring]") {
+	GIVEN("An asio_cares::channel which uses io_uring and a server") {
+		load_fixture x(use_io_uring);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+				CHECK(r.throughput() > 500);
+			}
+			THEN("Fewer than two system calls are made per answer") {
+				if (metrics::enabled && x.c.get_io_uring()) CHECK(x.c.get_metrics().syscalls_per_answer() < 2);
+			}
+		}
+		WHEN("Queries are sent under load while the channel is processed by asio_cares::async_process and then by asio_cares::async_process_one") {
+			auto first = run_load(x.c, queries, concurrency);
+			x.ios.reset();
+			auto second = run_load(x.c, queries, concurrency, true);
+			THEN("Every query succeeds quickly") {
+				CHECK(first.failed == 0);
+				check_quick(second, x.c);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which uses io_uring, allocates from a memory resource, and is processed by asio_cares::async_process_one and a server") {
+		counting_resource upstream;
+		load_fixture x(use_io_uring, server::faults(), load_options(), load_optmask, &upstream);
+		WHEN("More queries are sent under load than fit in the completion queue of the ring") {
+			auto r = run_load(x.c, detail::uring::completions + queries, concurrency, true);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c, detail::uring::completions + queries);
+			}
+			THEN("The buffers of sends are reused") {
+				CHECK((upstream.allocations - upstream.deallocations) < queries);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which uses io_uring and a server whose UDP responses are too large to be received whole") {
+		load_fixture x(use_io_uring, oversize_all());
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every truncated response is noticed and every query falls back to TCP and succeeds") {
+				check_tcp(r, x);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which uses io_uring and a server which truncates every UDP response") {
+		load_fixture x(use_io_uring, truncate_all());
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, truncated_concurrency);
+			THEN("Every query falls back to TCP and succeeds") {
+				check_tcp(r, x);
+			}
+		}
+	}
+	#if ARES_VERSION >= 0x011400
+	GIVEN("An asio_cares::channel which uses io_uring and pools UDP sockets which libcares makes close them often and a server") {
+		load_fixture x([] (channel & c) {
+			use_io_uring(c);
+			use_pool(c);
+		}, server::faults(), pool_options(), load_optmask | ARES_OPT_UDP_MAX_QUERIES);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+			}
+		}
+	}
+	#endif
+}
+
+#if ARES_VERSION >= 0x011400
+SCENARIO("asio_cares::channel objects sustain load when UDP sockets are pooled", "[asio_cares][load][pool]") {
+	GIVEN("An asio_cares::channel which pools UDP sockets and which libcares makes close them often and a server") {
+		load_fixture x(use_pool, server::faults(), pool_options(), load_optmask | ARES_OPT_UDP_MAX_QUERIES);
+		WHEN("Queries are sent under load") {
+			auto r = run_load(x.c, queries, concurrency);
+			THEN("Every query succeeds quickly") {
+				check_quick(r, x.c);
+				CHECK(r.throughput() > 500);
+			}
+			#ifndef _WIN32
+			THEN("Sockets are reused") {
+				if (metrics::enabled) CHECK(x.c.get_metrics().reused() > 0);
+			}
+			#endif
+		}
+	}
+}
+#endif
+
+}
+}
+}
@@ -0,0 +1,79 @@
+#include <asio_cares/memory_resource.hpp>
+
+#include <cstddef>
+#include <vector>
+#include "counting_resource.hpp"
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::slab_resource recycles blocks", "[asio_cares][memory_resource]") {
+	GIVEN("An asio_cares::slab_resource") {
+		counting_resource upstream;
+		slab_resource slab(upstream, 2);
+		WHEN("Memory is allocated and deallocated") {
+			void * ptr = slab.allocate(24);
+			slab.deallocate(ptr, 24);
+			REQUIRE(upstream.allocations == 1);
+			REQUIRE(upstream.deallocations == 0);
+			AND_WHEN("Memory of a size in the same class is allocated") {
+				void * other = slab.allocate(32);
+				THEN("The block is reused") {
+					CHECK(other == ptr);
+					CHECK(upstream.allocations == 1);
+				}
+				slab.deallocate(other, 32);
+			}
+			AND_WHEN("Memory of a size in a different class is allocated") {
+				void * other = slab.allocate(100);
+				THEN("The upstream resource is used") {
+					CHECK(upstream.allocations == 2);
+				}
+				slab.deallocate(other, 100);
+			}
+			AND_WHEN("The retained blocks are released") {
+				slab.release();
+				THEN("They are returned to the upstream resource") {
+					CHECK(upstream.deallocations == 1);
+				}
+			}
+		}
+		WHEN("More blocks are deallocated than may be retained") {
+			void * a = slab.allocate(16);
+			void * b = slab.allocate(16);
+			void * c = slab.allocate(16);
+			slab.deallocate(a, 16);
+			slab.deallocate(b, 16);
+			slab.deallocate(c, 16);
+			THEN("The excess is returned to the upstream resource") {
+				CHECK(upstream.allocations == 3);
+				CHECK(upstream.deallocations == 1);
+			}
+		}
+		WHEN("A large block is allocated and deallocated") {
+			void * ptr = slab.allocate(1 << 16);
+			slab.deallocate(ptr, 1 << 16);
+			THEN("The upstream resource is used directly") {
+				CHECK(upstream.allocations == 1);
+				CHECK(upstream.deallocations == 1);
+			}
+		}
+	}
+	GIVEN("A std::vector using an asio_cares::polymorphic_allocator") {
+		counting_resource r;
+		std::vector<int, polymorphic_allocator<int>> v(r);
+		WHEN("Elements are added") {
+			v.push_back(1);
+			v.push_back(2);
+			THEN("The memory resource is used") {
+				CHECK(r.allocations > 0);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,195 @@
+#include <asio_cares/metrics.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include "server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::latency_histogram objects record durations with bounded relative error", "[asio_cares][metrics]") {
+	GIVEN("An empty asio_cares::latency_histogram") {
+		latency_histogram h;
+		THEN("It is empty") {
+			CHECK(h.count() == 0);
+			CHECK(h.percentile(0.5) == std::chrono::microseconds::zero());
+		}
+		THEN("Every duration is recorded in a bucket whose bounds contain it and whose width is within the relative error") {
+			for (std::uint64_t us : {0, 1, 15, 16, 17, 31, 32, 33, 1000, 65535, 65536, 1000000, 123456789}) {
+				INFO(us);
+				auto i = latency_histogram::index(us);
+				REQUIRE(i < latency_histogram::buckets);
+				CHECK(std::uint64_t(latency_histogram::lower_bound(i).count()) <= us);
+				CHECK(std::uint64_t(latency_histogram::upper_bound(i).count()) > us);
+				auto width = latency_histogram::upper_bound(i) - latency_histogram::lower_bound(i);
+				CHECK((width.count() * std::int64_t(latency_histogram::sub_buckets)) <= std::max(latency_histogram::lower_bound(i).count(), std::int64_t(latency_histogram::sub_buckets)));
+			}
+		}
+		THEN("Adjacent buckets are contiguous") {
+			for (std::size_t i = 1; i < latency_histogram::buckets; ++i) {
+				INFO(i);
+				REQUIRE(latency_histogram::upper_bound(i - 1) == latency_histogram::lower_bound(i));
+			}
+		}
+		THEN("Durations beyond the range of the histogram are recorded in the last bucket") {
+			CHECK(latency_histogram::index(~std::uint64_t(0)) == (latency_histogram::buckets - 1));
+		}
+		WHEN("Durations are recorded") {
+			for (int i = 1; i <= 100; ++i) h.record(std::chrono::milliseconds(i));
+			h.record(std::chrono::seconds(-1));
+			THEN("They are counted") {
+				CHECK(h.count() == 101);
+				CHECK(h.count(0) == 1);
+			}
+			THEN("Percentiles are reported within the relative error") {
+				auto p50 = h.percentile(0.5);
+				CHECK(p50 >= std::chrono::milliseconds(50));
+				CHECK(p50 <= std::chrono::microseconds(50000 + (50000 / 16) + 1));
+				auto p100 = h.percentile(1);
+				CHECK(p100 > std::chrono::milliseconds(100));
+				CHECK(p100 <= std::chrono::microseconds(100000 + (100000 / 16) + 1));
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects collect metrics", "[asio_cares][metrics]") {
+	GIVEN("An asio_cares::channel and a server") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options options;
+		std::memset(&options, 0, sizeof(options));
+		options.timeout = 50;
+		options.tries = 3;
+		int optmask = ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES;
+		#if ARES_VERSION >= 0x011700
+		optmask |= ARES_OPT_QUERY_CACHE;
+		#endif
+		channel c(options, optmask, ios);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		auto && m = c.get_metrics();
+		THEN("Every metric is zero") {
+			CHECK(m.submitted() == 0);
+			CHECK(m.completed() == 0);
+			CHECK(m.failed() == 0);
+			CHECK(m.timeouts() == 0);
+			CHECK(m.retries() == 0);
+			CHECK(m.in_flight() == 0);
+			CHECK(m.sockets() == 0);
+			CHECK(m.wakeups() == 0);
+			CHECK(m.wakeups_per_answer() == 0);
+			CHECK(m.syscalls() == 0);
+			CHECK(m.reused() == 0);
+			CHECK(m.drops() == 0);
+			CHECK(m.latency().count() == 0);
+		}
+		WHEN("Queries are sent and answered") {
+			server s;
+			s.apply(c);
+			std::size_t failed = 0;
+			//	libcares may close its sockets once there
+			//	are no queries
+			std::uint64_t sockets = 0;
+			for (std::size_t i = 0; i < 10; ++i) async_send(c, ptr, buflen, [&] (auto ec, auto, auto, auto) {
+				if (ec) ++failed;
+				sockets = std::max(sockets, m.sockets());
+			});
+			std::uint64_t in_flight = m.in_flight();
+			boost::system::error_code ec;
+			async_process(c, [&] (auto e) noexcept {
+				ec = e;
+			});
+			ios.run();
+			REQUIRE_FALSE(ec);
+			REQUIRE(failed == 0);
+			REQUIRE(done(c));
+			THEN("They are counted") {
+				if (metrics::enabled) {
+					CHECK(in_flight == 10);
+					CHECK(m.submitted() == 10);
+					CHECK(m.completed() == 10);
+					CHECK(m.failed() == 0);
+					CHECK(m.in_flight() == 0);
+					CHECK(m.timeouts() == 0);
+					CHECK(m.retries() == 0);
+					CHECK(m.latency().count() == 10);
+					CHECK(sockets != 0);
+					CHECK(m.wakeups() != 0);
+					CHECK(m.wakeups_per_answer() > 0);
+				} else {
+					CHECK(m.submitted() == 0);
+					CHECK(m.latency().count() == 0);
+				}
+			}
+		}
+		WHEN("A query is sent and every attempt is lost") {
+			server::faults f;
+			f.loss = 1;
+			server s(1, f);
+			s.apply(c);
+			boost::system::error_code ec;
+			int timeouts = 0;
+			async_send(c, ptr, buflen, [&] (auto e, auto t, auto, auto) {
+				ec = e;
+				timeouts = t;
+			});
+			boost::system::error_code process_error;
+			async_process(c, [&] (auto e) noexcept {
+				process_error = e;
+			});
+			ios.run();
+			REQUIRE_FALSE(process_error);
+			REQUIRE(ec);
+			REQUIRE(timeouts > 0);
+			THEN("The failure, timeouts, and retries are counted") {
+				if (metrics::enabled) {
+					CHECK(m.completed() == 1);
+					CHECK(m.failed() == 1);
+					CHECK(m.failed(ARES_ETIMEOUT) == 1);
+					CHECK(m.failed(ARES_ENOTFOUND) == 0);
+					CHECK(m.timeouts() == std::uint64_t(timeouts));
+					CHECK(m.retries() == std::uint64_t(timeouts - 1));
+					CHECK(m.in_flight() == 0);
+				} else {
+					CHECK(m.failed() == 0);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
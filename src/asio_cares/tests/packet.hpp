@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace asio_cares {
+namespace tests {
+
+/**
+ *	Builds DNS responses for tests.
+ */
+class packet {
+public:
+	explicit packet (std::size_t answers, int rcode = 0, std::size_t authority = 0) {
+		u16(0);
+		u16(0x8180 | rcode);
+		u16(1);
+		u16(answers);
+		u16(authority);
+		u16(0);
+	}
+	packet & u8 (unsigned v) {
+		bytes.push_back(static_cast<unsigned char>(v));
+		return *this;
+	}
+	packet & u16 (unsigned v) {
+		return u8(v >> 8).u8(v & 0xFF);
+	}
+	packet & u32 (unsigned long v) {
+		return u16(v >> 16).u16(v & 0xFFFF);
+	}
+	packet & label (const std::string & s) {
+		u8(s.size());
+		bytes.insert(bytes.end(), s.begin(), s.end());
+		return *this;
+	}
+	packet & pointer (std::size_t offset) {
+		return u16(0xC000 | offset);
+	}
+	//	Writes a question for _sip._tcp.example.com,
+	//	"example" begins at offset 22
+	packet & question (int type) {
+		label("_sip").label("_tcp").label("example").label("com").u8(0);
+		return u16(type).u16(1);
+	}
+	//	Writes the fixed part of a record whose owner
+	//	is the question name
+	packet & record (int type, unsigned long ttl, std::size_t rdlength) {
+		return pointer(12).u16(type).u16(1).u32(ttl).u16(rdlength);
+	}
+	const unsigned char * data () const noexcept {
+		return bytes.data();
+	}
+	std::size_t size () const noexcept {
+		return bytes.size();
+	}
+	std::vector<unsigned char> bytes;
+};
+
+}
+}
@@ -73,6 +73,33 @@ SCENARIO("asio_cares::async_process may be used to asynchronously complete a DNS
 				THEN("There are no pending queries on the channel") {
 					CHECK(done(c));
 				}
+			}			AND_WHEN("asio_cares::async_process is invoked twice") {
+				boost::system::error_code a;
+				bool a_invoked = false;
+				async_process(c, [&] (auto e) noexcept {
+					a = e;
+					a_invoked = true;
+				});
+				boost::system::error_code b;
+				bool b_invoked = false;
+				async_process(c, [&] (auto e) noexcept {
+					b = e;
+					b_invoked = true;
+				});
+				ios.run();
+				THEN("Both operations complete successfully") {
+					REQUIRE(a_invoked);
+					INFO(a.message());
+					CHECK_FALSE(a);
+					REQUIRE(b_invoked);
+					INFO(b.message());
+					CHECK_FALSE(b);
+				}
+				THEN("The query completes successfully") {
+					REQUIRE(s.invoked);
+					INFO(s.error_code.message());
+					CHECK_FALSE(s.error_code);
+				}
 			}
 		}
 		WHEN("asio_cares::async_process is invoked thereupon") {
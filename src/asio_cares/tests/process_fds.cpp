@@ -0,0 +1,86 @@
+#include <asio_cares/process_fds.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::process_fds processes timeouts even when no sockets are ready", "[asio_cares][process_fds]") {
+	GIVEN("An asio_cares::channel with a short timeout whose server never answers") {
+		library l;
+		boost::asio::io_service ios;
+		boost::asio::ip::udp::socket server(ios, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+		ares_options opts;
+		std::memset(&opts, 0, sizeof(opts));
+		opts.timeout = 1;
+		opts.tries = 1;
+		channel c(opts, ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		ares_addr_port_node node;
+		std::memset(&node, 0, sizeof(node));
+		node.family = AF_INET;
+		auto bytes = boost::asio::ip::address_v4::loopback().to_bytes();
+		std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+		node.udp_port = server.local_endpoint().port();
+		node.tcp_port = node.udp_port;
+		raise(ares_set_servers_ports(c, &node));
+		WHEN("A query is sent thereupon") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("google.com",
+				                           ns_c_any,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string g(ptr);
+			int status = ARES_SUCCESS;
+			bool invoked = false;
+			auto f = [&] (int s) noexcept {
+				status = s;
+				invoked = true;
+			};
+			using f_type = decltype(f);
+			ares_send(c, ptr, buflen, [] (void * data, int s, int, unsigned char *, int) noexcept {
+				(*static_cast<f_type *>(data))(s);
+			}, &f);
+			REQUIRE_FALSE(invoked);
+			AND_WHEN("asio_cares::process_fds is invoked with an empty batch after the timeout elapses") {
+				//	libcares may clamp the timeout so ask it
+				//	how long to wait
+				timeval tv;
+				REQUIRE(ares_timeout(c, nullptr, &tv));
+				std::this_thread::sleep_for(std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec) + std::chrono::milliseconds(10));
+				process_fds(c, nullptr, 0);
+				THEN("The query times out") {
+					REQUIRE(invoked);
+					CHECK(status == ARES_ETIMEOUT);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,231 @@
+#include <asio_cares/query.hpp>
+
+#include <ares.h>
+#include <asio_cares/arena.hpp>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+#include <boost/system/error_code.hpp>
+#include "counting_resource.hpp"
+#include "packet.hpp"
+#include "server.hpp"
+#include <cstddef>
+#include <catch.hpp>
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+SCENARIO("asio_cares::parse parses answers into flat records", "[asio_cares][query]") {
+	GIVEN("An asio_cares::arena") {
+		counting_resource upstream;
+		arena a(upstream);
+		WHEN("A response with a CNAME and compressed SRV records is parsed") {
+			packet p(3);
+			p.question(records::srv::type);
+			p.record(5, 60, 2).pointer(22);
+			p.record(records::srv::type, 60, 12).u16(10).u16(5).u16(5060).label("sip").pointer(22);
+			p.record(records::srv::type, 30, 7).u16(20).u16(0).u16(5061).u8(0);
+			query_result<records::srv> r;
+			int status = parse(p.data(), p.size(), a, r);
+			THEN("The SRV records are provided and the CNAME skipped") {
+				INFO(make_error_code(status).message());
+				REQUIRE(status == ARES_SUCCESS);
+				REQUIRE(r.size() == 2);
+				CHECK(r[0].priority == 10);
+				CHECK(r[0].weight == 5);
+				CHECK(r[0].port == 5060);
+				CHECK(r[0].target == "sip.example.com");
+				CHECK(r[0].ttl == 60);
+				CHECK(r[1].port == 5061);
+				CHECK(r[1].target.empty());
+				CHECK(r[1].ttl == 30);
+			}
+		}
+		WHEN("A response with TXT records is parsed") {
+			packet p(1);
+			p.question(records::txt::type);
+			p.record(records::txt::type, 10, 9).label("abc").label("defg");
+			query_result<records::txt> r;
+			int status = parse(p.data(), p.size(), a, r);
+			THEN("The character strings are concatenated") {
+				REQUIRE(status == ARES_SUCCESS);
+				REQUIRE(r.size() == 1);
+				CHECK(r[0].text == "abcdefg");
+			}
+		}
+		WHEN("A response with MX records is parsed") {
+			packet p(1);
+			p.question(records::mx::type);
+			p.record(records::mx::type, 10, 2 + 7).u16(5).label("mail").pointer(22);
+			query_result<records::mx> r;
+			int status = parse(p.data(), p.size(), a, r);
+			THEN("The MX record is provided") {
+				REQUIRE(status == ARES_SUCCESS);
+				REQUIRE(r.size() == 1);
+				CHECK(r[0].preference == 5);
+				CHECK(r[0].exchange == "mail.example.com");
+			}
+		}
+		WHEN("A response with PTR records is parsed") {
+			packet p(1);
+			p.question(records::ptr::type);
+			p.record(records::ptr::type, 10, 2).pointer(12);
+			query_result<records::ptr> r;
+			int status = parse(p.data(), p.size(), a, r);
+			THEN("The PTR record is provided") {
+				REQUIRE(status == ARES_SUCCESS);
+				REQUIRE(r.size() == 1);
+				CHECK(r[0].name == "_sip._tcp.example.com");
+			}
+		}
+		WHEN("A response with A and AAAA records is parsed") {
+			packet p(2);
+			p.question(records::a::type);
+			p.record(records::a::type, 10, 4).u32(0x01020304UL);
+			p.record(records::aaaa::type, 10, 16).u32(0).u32(0).u32(0).u32(1);
+			query_result<records::a> a4;
+			query_result<records::aaaa> a6;
+			REQUIRE(parse(p.data(), p.size(), a, a4) == ARES_SUCCESS);
+			REQUIRE(parse(p.data(), p.size(), a, a6) == ARES_SUCCESS);
+			THEN("The records of each type are provided") {
+				REQUIRE(a4.size() == 1);
+				CHECK(a4[0].address == boost::asio::ip::address_v4::from_string("1.2.3.4"));
+				REQUIRE(a6.size() == 1);
+				CHECK(a6[0].address == boost::asio::ip::address_v6::loopback());
+			}
+		}
+		WHEN("A response with no records of the requested type is parsed") {
+			packet p(1);
+			p.question(records::a::type);
+			p.record(5, 60, 2).pointer(22);
+			query_result<records::a> r;
+			THEN("ARES_ENODATA results") {
+				CHECK(parse(p.data(), p.size(), a, r) == ARES_ENODATA);
+				CHECK(r.empty());
+			}
+		}
+		WHEN("A response with an RCODE of NXDOMAIN is parsed") {
+			packet p(0, 3);
+			p.question(records::a::type);
+			query_result<records::a> r;
+			THEN("ARES_ENOTFOUND results") {
+				CHECK(parse(p.data(), p.size(), a, r) == ARES_ENOTFOUND);
+			}
+		}
+		WHEN("A truncated response is parsed") {
+			packet p(1);
+			p.question(records::a::type);
+			p.record(records::a::type, 10, 4).u16(0);
+			query_result<records::a> r;
+			THEN("ARES_EBADRESP results") {
+				CHECK(parse(p.data(), p.size(), a, r) == ARES_EBADRESP);
+			}
+		}
+		WHEN("A response with a compression loop is parsed") {
+			packet p(1);
+			p.question(records::ptr::type);
+			std::size_t self = p.size() + 12;
+			p.record(records::ptr::type, 10, 2).pointer(self);
+			query_result<records::ptr> r;
+			THEN("ARES_EBADRESP results") {
+				CHECK(parse(p.data(), p.size(), a, r) == ARES_EBADRESP);
+			}
+		}
+		WHEN("Responses are parsed repeatedly and the arena reset between them") {
+			packet p(1);
+			p.question(records::srv::type);
+			p.record(records::srv::type, 60, 12).u16(10).u16(5).u16(5060).label("sip").pointer(22);
+			query_result<records::srv> r;
+			REQUIRE(parse(p.data(), p.size(), a, r) == ARES_SUCCESS);
+			a.reset();
+			auto allocations = upstream.allocations;
+			for (int i = 0; i < 16; ++i) {
+				REQUIRE(parse(p.data(), p.size(), a, r) == ARES_SUCCESS);
+				a.reset();
+			}
+			THEN("No memory is obtained from upstream once warm") {
+				CHECK(upstream.allocations == allocations);
+			}
+		}
+	}
+}
+
+SCENARIO("asio_cares::async_query queries records of a certain type", "[asio_cares][query]") {
+	GIVEN("An asio_cares::channel and an asio_cares::arena") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		server s;
+		s.apply(c);
+		arena a;
+		WHEN("asio_cares::async_query is invoked for A and AAAA records") {
+			boost::system::error_code ec4;
+			boost::system::error_code ec6;
+			std::size_t invoked = 0;
+			boost::asio::ip::address_v4 v4;
+			boost::asio::ip::address_v6 v6;
+			async_query<records::a>(c, "example.com", a, [&] (auto ec, auto r) {
+				++invoked;
+				ec4 = ec;
+				if (!r.empty()) v4 = r[0].address;
+			});
+			async_query<records::aaaa>(c, "example.com", a, [&] (auto ec, auto r) {
+				++invoked;
+				ec6 = ec;
+				if (!r.empty()) v6 = r[0].address;
+			});
+			async_process(c, [&] (auto) noexcept {});
+			ios.run();
+			THEN("Both complete successfully") {
+				REQUIRE(invoked == 2);
+				INFO(ec4.message());
+				INFO(ec6.message());
+				CHECK_FALSE(ec4);
+				CHECK_FALSE(ec6);
+				CHECK(v4 == boost::asio::ip::address_v4::loopback());
+				CHECK(v6 == boost::asio::ip::address_v6::loopback());
+				CHECK(done(c));
+			}
+		}
+		WHEN("asio_cares::async_query is invoked for a type of record the server does not provide") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_query<records::mx>(c, "example.com", a, [&] (auto e, auto r) {
+				invoked = true;
+				ec = e;
+				CHECK(r.empty());
+			});
+			async_process(c, [&] (auto) noexcept {});
+			ios.run();
+			THEN("The operation completes with ARES_ENODATA") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(ARES_ENODATA));
+			}
+		}
+		WHEN("asio_cares::async_query is invoked with an invalid name") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_query<records::a>(c, "example..com", a, [&] (auto e, auto) {
+				invoked = true;
+				ec = e;
+			});
+			REQUIRE_FALSE(invoked);
+			async_process(c, [&] (auto) noexcept {});
+			ios.run();
+			THEN("The operation completes with ARES_EBADNAME") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(ARES_EBADNAME));
+			}
+		}
+	}
+}
+
+}
+}
+}
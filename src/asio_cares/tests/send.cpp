@@ -6,11 +6,21 @@
 #include <asio_cares/error.hpp>
 #include <asio_cares/library.hpp>
 #include <asio_cares/process.hpp>
+#include <asio_cares/query_handle.hpp>
 #include <asio_cares/string.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/system/error_code.hpp>
+#include "server.hpp"
 #include "setup.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <set>
 #include <stdexcept>
+#include <vector>
 #include <catch.hpp>
 
 #ifdef _WIN32
@@ -75,6 +85,41 @@ SCENARIO("asio_cares::async_send may be used to submit a DNS query for asynchron
 				}
 			}
 		}
+		WHEN("A query is sent with asio_cares::async_send the completion handler for which must be transported to another strand") {
+			unsigned char * ptr;
+			int buflen;
+			int result = ares_create_query("google.com",
+				                           ns_c_any,
+				                           ns_t_a,
+				                           0,
+				                           1,
+				                           &ptr,
+				                           &buflen,
+				                           0);
+			raise(result);
+			string g(ptr);
+			boost::asio::strand other(ios);
+			boost::system::error_code ec;
+			bool invoked = false;
+			int parsed = ARES_ENODATA;
+			async_send(c, ptr, buflen, other.wrap([&] (auto e, auto, auto buf, auto len) {
+				ec = e;
+				invoked = true;
+				ares_addrttl addrttls [16];
+				int naddrttls = 16;
+				parsed = ares_parse_a_reply(buf, len, nullptr, addrttls, &naddrttls);
+			}));
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [&] (auto) noexcept {});
+				ios.run();
+				THEN("The answer remains valid when the completion handler is invoked") {
+					REQUIRE(invoked);
+					INFO(ec.message());
+					REQUIRE_FALSE(ec);
+					CHECK(parsed == ARES_SUCCESS);
+				}
+			}
+		}
 		WHEN("A malformed query is sent with asio_cares::async_send") {
 			boost::system::error_code ec;
 			bool invoked = false;
@@ -141,6 +186,291 @@ SCENARIO("asio_cares::async_send may be used to submit a DNS query for asynchron
 	}
 }
 
+SCENARIO("asio_cares::async_send coalesces identical queries", "[asio_cares][send]") {
+	GIVEN("An asio_cares::channel with coalescing enabled") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		server s;
+		s.apply(c);
+		c.set_coalescing(true);
+		REQUIRE(c.get_coalescing());
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		WHEN("The same query is sent several times") {
+			std::size_t succeeded = 0;
+			std::size_t parsed = 0;
+			std::set<const unsigned char *> answers;
+			for (std::size_t i = 0; i < 8; ++i) {
+				async_send(c, ptr, buflen, [&] (auto ec, auto, auto buf, auto len) {
+					if (!ec) ++succeeded;
+					answers.insert(buf);
+					ares_addrttl addrttls [4];
+					int naddrttls = 4;
+					if (ares_parse_a_reply(buf, len, nullptr, addrttls, &naddrttls) == ARES_SUCCESS) ++parsed;
+				});
+			}
+			THEN("Only one query is in flight") {
+				CHECK(c.outstanding() == 1);
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [] (auto) noexcept {});
+				ios.run();
+				THEN("Every operation completes successfully") {
+					CHECK(succeeded == 8);
+					CHECK(parsed == 8);
+					CHECK(done(c));
+				}
+				THEN("The operations which joined the first share one copy of the answer") {
+					CHECK(answers.size() == 2);
+				}
+			}
+		}
+		WHEN("Queries with the same question but different header flags or OPT records are sent") {
+			std::vector<unsigned char> q(ptr, ptr + buflen);
+			auto norecurse = q;
+			norecurse[2] &= ~0x01;
+			auto edns = q;
+			edns[11] = 1;	//	ARCOUNT
+			const unsigned char opt [] = {0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0};
+			edns.insert(edns.end(), opt, opt + sizeof(opt));
+			auto dnssec = edns;
+			dnssec[dnssec.size() - 4] = 0x80;	//	DO
+			std::size_t succeeded = 0;
+			auto h = [&] (auto ec, auto, auto, auto) noexcept {
+				if (!ec) ++succeeded;
+			};
+			for (auto && query : {q, norecurse, edns, dnssec}) async_send(c, query.data(), int(query.size()), h);
+			async_send(c, dnssec.data(), int(dnssec.size()), h);
+			THEN("Only identical queries are coalesced") {
+				CHECK(c.outstanding() == 4);
+			}
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			CHECK(succeeded == 5);
+		}
+		WHEN("Coalescing is disabled and the same query is sent several times") {
+			c.set_coalescing(false);
+			for (std::size_t i = 0; i < 8; ++i) async_send(c, ptr, buflen, [] (auto, auto, auto, auto) noexcept {});
+			THEN("Each query is in flight") {
+				CHECK(c.outstanding() == 8);
+			}
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+		}
+	}
+}
+
+
+SCENARIO("asio_cares::async_send may abandon individual queries", "[asio_cares][send][query_handle]") {
+	GIVEN("An asio_cares::channel") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		server s;
+		s.apply(c);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		WHEN("Two queries are sent and one is cancelled through an asio_cares::query_handle") {
+			query_handle h;
+			boost::system::error_code cancelled;
+			bool cancelled_answer = true;
+			boost::system::error_code other;
+			bool other_answer = false;
+			async_send(c, ptr, buflen, h, [&] (auto ec, auto, auto buf, auto) noexcept {
+				cancelled = ec;
+				cancelled_answer = buf != nullptr;
+			});
+			async_send(c, ptr, buflen, [&] (auto ec, auto, auto buf, auto) noexcept {
+				other = ec;
+				other_answer = buf != nullptr;
+			});
+			REQUIRE(h.active());
+			h.cancel();
+			THEN("The handle is no longer active") {
+				CHECK_FALSE(h.active());
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [] (auto) noexcept {});
+				ios.run();
+				THEN("The cancelled operation completes with ARES_ECANCELLED and no answer") {
+					INFO(cancelled.message());
+					CHECK(cancelled == make_error_code(ARES_ECANCELLED));
+					CHECK_FALSE(cancelled_answer);
+				}
+				THEN("The other operation completes successfully") {
+					INFO(other.message());
+					CHECK_FALSE(other);
+					CHECK(other_answer);
+				}
+				THEN("There are no pending queries on the channel") {
+					CHECK(done(c));
+				}
+			}
+		}
+		WHEN("A query is sent with an asio_cares::query_handle and allowed to complete") {
+			query_handle h;
+			boost::system::error_code ec;
+			async_send(c, ptr, buflen, h, std::chrono::seconds(5), [&] (auto e, auto, auto, auto) noexcept {
+				ec = e;
+			});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("It completes successfully and the handle is no longer active") {
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK_FALSE(h.active());
+			}
+			THEN("The io_service does not wait for the deadline") {
+				CHECK(done(c));
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel with a long timeout whose server never answers") {
+		library l;
+		boost::asio::io_service ios;
+		ares_options options;
+		std::memset(&options, 0, sizeof(options));
+		options.timeout = 2000;
+		options.tries = 1;
+		channel c(options, ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		boost::asio::ip::udp::socket silent(ios, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+		ares_addr_port_node node;
+		std::memset(&node, 0, sizeof(node));
+		node.family = AF_INET;
+		auto bytes = silent.local_endpoint().address().to_v4().to_bytes();
+		std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+		node.udp_port = silent.local_endpoint().port();
+		node.tcp_port = node.udp_port;
+		raise(ares_set_servers_ports(c, &node));
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		WHEN("Queries are sent with short deadlines and a query is sent without one") {
+			auto start = std::chrono::steady_clock::now();
+			std::size_t expired = 0;
+			auto elapsed = std::chrono::steady_clock::duration::zero();
+			bool other = false;
+			bool other_expired = true;
+			std::size_t outstanding = 0;
+			for (std::size_t i = 0; i < 3; ++i) {
+				async_send(c, ptr, buflen, std::chrono::milliseconds(50), [&] (auto ec, auto, auto buf, auto) noexcept {
+					if ((ec == make_error_code(ARES_ETIMEOUT)) && !buf) ++expired;
+					elapsed = std::max(elapsed, std::chrono::steady_clock::now() - start);
+					other_expired = other;
+					outstanding = c.outstanding();
+				});
+			}
+			async_send(c, ptr, buflen, [&] (auto, auto, auto, auto) noexcept {
+				other = true;
+			});
+			boost::system::error_code process_error;
+			async_process(c, [&] (auto e) noexcept {
+				process_error = e;
+			});
+			ios.run();
+			THEN("The operations with deadlines complete with ARES_ETIMEOUT well before the libcares timeout") {
+				CHECK(expired == 3);
+				CHECK(elapsed < std::chrono::milliseconds(1000));
+			}
+			THEN("The other query is unaffected by the deadlines") {
+				CHECK_FALSE(other_expired);
+				CHECK(outstanding == 4);
+				CHECK(other);
+			}
+			THEN("Every query completes") {
+				INFO(process_error.message());
+				CHECK_FALSE(process_error);
+				CHECK(done(c));
+			}
+		}
+		WHEN("Two queries are sent with the same deadline and the first to expire cancels the other through its asio_cares::query_handle") {
+			query_handle handles [2];
+			std::size_t timed_out = 0;
+			std::size_t cancelled = 0;
+			for (std::size_t i = 0; i < 2; ++i) {
+				async_send(c, ptr, buflen, handles[i], std::chrono::milliseconds(50), [&, i] (auto ec, auto, auto, auto) {
+					if (ec == make_error_code(ARES_ETIMEOUT)) ++timed_out;
+					if (ec == make_error_code(ARES_ECANCELLED)) ++cancelled;
+					auto && other = handles[1 - i];
+					if (other.active()) other.cancel();
+				});
+			}
+			boost::system::error_code process_error;
+			async_process(c, [&] (auto e) noexcept {
+				process_error = e;
+			});
+			ios.run();
+			THEN("One operation times out and the other is cancelled") {
+				CHECK(timed_out == 1);
+				CHECK(cancelled == 1);
+			}
+			THEN("Every query completes") {
+				INFO(process_error.message());
+				CHECK_FALSE(process_error);
+				CHECK(done(c));
+			}
+		}
+		WHEN("Two queries are sent with the same deadline and the first to expire cancels every query on the channel") {
+			std::size_t timed_out = 0;
+			std::size_t cancelled = 0;
+			for (std::size_t i = 0; i < 2; ++i) {
+				async_send(c, ptr, buflen, std::chrono::milliseconds(50), [&] (auto ec, auto, auto, auto) {
+					if (ec == make_error_code(ARES_ECANCELLED)) {
+						++cancelled;
+						return;
+					}
+					if (ec == make_error_code(ARES_ETIMEOUT)) ++timed_out;
+					ares_cancel(c);
+				});
+			}
+			boost::system::error_code process_error;
+			async_process(c, [&] (auto e) noexcept {
+				process_error = e;
+			});
+			ios.run();
+			THEN("One operation times out and the other is cancelled") {
+				CHECK(timed_out == 1);
+				CHECK(cancelled == 1);
+			}
+			THEN("Every query completes") {
+				INFO(process_error.message());
+				CHECK_FALSE(process_error);
+				CHECK(done(c));
+			}
+		}
+	}
+}
+
 }
 }
 }
@@ -0,0 +1,148 @@
+#include <asio_cares/send_batch.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include "counting_resource.hpp"
+#include "server.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+std::vector<unsigned char> create_query (const std::string & name) {
+	unsigned char * ptr;
+	int buflen;
+	int result = ares_create_query(name.c_str(),
+	                               ns_c_in,
+	                               ns_t_a,
+	                               0,
+	                               1,
+	                               &ptr,
+	                               &buflen,
+	                               0);
+	raise(result);
+	string g(ptr);
+	return std::vector<unsigned char>(ptr, ptr + buflen);
+}
+
+SCENARIO("asio_cares::async_send_batch may be used to send many DNS queries at once", "[asio_cares][send_batch]") {
+	GIVEN("An asio_cares::channel") {
+		library l;
+		boost::asio::io_service ios;
+		counting_resource resource;
+		//	Queries left outstanding write their results
+		//	as the channel is destroyed
+		send_results results(resource);
+		channel c(ios, resource);
+		server s;
+		s.apply(c);
+		WHEN("A batch of distinct queries is sent") {
+			std::vector<std::vector<unsigned char>> queries;
+			for (std::size_t i = 0; i < 16; ++i) queries.push_back(create_query("host" + std::to_string(i) + ".example.com"));
+			bool invoked = false;
+			std::size_t invocations = 0;
+			boost::system::error_code ec;
+			async_send_batch(c, queries, results, [&] (auto e) noexcept {
+				ec = e;
+				invoked = true;
+				++invocations;
+			});
+			THEN("Every query is outstanding and the operation has not completed") {
+				CHECK_FALSE(invoked);
+				CHECK(c.outstanding() == 16);
+				CHECK(results.size() == 16);
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [] (auto) noexcept {});
+				ios.run();
+				THEN("The operation completes once with every result and releases all memory") {
+					CHECK(invocations == 1);
+					INFO(ec.message());
+					CHECK_FALSE(ec);
+					std::size_t parsed = 0;
+					for (auto && result : results) {
+						if (result.ec || !result.answer) continue;
+						ares_addrttl addrttls [4];
+						int naddrttls = 4;
+						if (ares_parse_a_reply(result.answer.data(), int(result.answer.size()), nullptr, addrttls, &naddrttls) == ARES_SUCCESS) ++parsed;
+					}
+					CHECK(parsed == 16);
+					CHECK(done(c));
+					results.clear();
+					results.shrink_to_fit();
+					CHECK(resource.allocations != 0);
+
+				}
+			}
+		}
+		WHEN("A batch containing a malformed query is sent") {
+			std::vector<std::vector<unsigned char>> queries;
+			queries.push_back(create_query("example.com"));
+			queries.push_back(std::vector<unsigned char>{0, 1, 2});
+			boost::system::error_code ec;
+			async_send_batch(c, queries, results, [&] (auto e) noexcept {	ec = e;	});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("The operation fails with the error of the malformed query and the other query succeeds") {
+				REQUIRE(results.size() == 2);
+				CHECK_FALSE(results[0].ec);
+				CHECK(results[1].ec);
+				CHECK(ec == results[1].ec);
+			}
+		}
+		WHEN("A batch of identical queries is sent with coalescing enabled") {
+			c.set_coalescing(true);
+			std::vector<std::vector<unsigned char>> queries(8, create_query("example.com"));
+			boost::system::error_code ec;
+			async_send_batch(c, queries, results, [&] (auto e) noexcept {	ec = e;	});
+			THEN("Only one query is in flight") {
+				CHECK(c.outstanding() == 1);
+			}
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("Every query succeeds") {
+				CHECK_FALSE(ec);
+				for (auto && result : results) {
+					CHECK_FALSE(result.ec);
+					CHECK(result.answer);
+				}
+			}
+		}
+		WHEN("An empty batch is sent") {
+			std::vector<std::vector<unsigned char>> queries;
+			bool invoked = false;
+			async_send_batch(c, queries, results, [&] (auto) noexcept {	invoked = true;	});
+			THEN("The operation does not complete from within the initiating function") {
+				CHECK_FALSE(invoked);
+				AND_WHEN("The io_service is run") {
+					ios.run();
+					THEN("The operation completes") {
+						CHECK(invoked);
+						CHECK(results.empty());
+					}
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,218 @@
+#include "server.hpp"
+
+#include <ares.h>
+#include <asio_cares/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include "dns_stub.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <nameser.h>
+#include <WinSock2.h>
+#else
+#include <arpa/nameser.h>
+#include <sys/socket.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+
+class server::port {
+public:
+	//	The port chosen for UDP may still be held by a
+	//	TCP client socket in TIME_WAIT (c-ares does not
+	//	set SO_REUSEADDR) so other ports are tried until
+	//	both bind
+	explicit port (boost::asio::io_service & ios)
+		:	socket  (ios),
+			acceptor(ios),
+			pending (ios)
+	{
+		for (std::size_t i = 0;; ++i) {
+			socket.open(boost::asio::ip::udp::v4());
+			socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+			boost::asio::ip::tcp::endpoint ep(boost::asio::ip::address_v4::loopback(), socket.local_endpoint().port());
+			acceptor.open(ep.protocol());
+			acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+			boost::system::error_code ec;
+			acceptor.bind(ep, ec);
+			if (!ec) break;
+			if ((ec != boost::asio::error::address_in_use) || (i == 16)) throw boost::system::system_error(ec, "bind");
+			acceptor.close();
+			socket.close();
+		}
+		acceptor.listen();
+	}
+	boost::asio::ip::udp::socket   socket;
+	boost::asio::ip::udp::endpoint remote;
+	std::array<unsigned char, 512> buffer;
+	boost::asio::ip::tcp::acceptor acceptor;
+	boost::asio::ip::tcp::socket   pending;
+};
+
+//	Large enough that the response exceeds the 4096
+//	bytes libcares and the channel receive into
+constexpr std::size_t padding = 8192;
+
+//	The question ends where the answer section of
+//	a response begins
+static std::size_t question_end (const unsigned char * response) noexcept {
+	std::size_t end = HFIXEDSZ;
+	while (response[end]) end += response[end] + 1;
+	return end + 1 + QFIXEDSZ;
+}
+
+server::faults::faults () noexcept
+	:	latency     (0),
+		jitter      (0),
+		tail        (0),
+		tail_latency(0),
+		loss        (0),
+		truncate    (0),
+		oversize    (0),
+		duplicate   (0),
+		tcp_latency (0)
+{}
+
+server::server (std::size_t ports, const faults & f)
+	:	faults_      (f),
+		work_        (new boost::asio::io_service::work(ios_)),
+		received_    (0),
+		received_tcp_(0)
+{
+	for (std::size_t i = 0; i < ports; ++i) {
+		ports_.push_back(std::make_unique<port>(ios_));
+		receive(*ports_.back());
+		accept(*ports_.back());
+	}
+	thread_ = std::thread([this] () {	ios_.run();	});
+}
+
+server::~server () noexcept {
+	work_.reset();
+	ios_.stop();
+	thread_.join();
+}
+
+void server::apply (channel & c) const {
+	std::vector<ares_addr_port_node> nodes(ports_.size());
+	for (std::size_t i = 0; i < nodes.size(); ++i) {
+		auto && node = nodes[i];
+		std::memset(&node, 0, sizeof(node));
+		node.family = AF_INET;
+		auto endpoint = ports_[i]->socket.local_endpoint();
+		auto bytes = endpoint.address().to_v4().to_bytes();
+		std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+		node.udp_port = endpoint.port();
+		node.tcp_port = endpoint.port();
+		if ((i + 1) != nodes.size()) node.next = &nodes[i + 1];
+	}
+	int result = ares_set_servers_ports(c, nodes.empty() ? nullptr : nodes.data());
+	raise(result);
+}
+
+std::size_t server::size () const noexcept {
+	return ports_.size();
+}
+
+std::size_t server::received () const noexcept {
+	return received_.load();
+}
+
+std::size_t server::received_tcp () const noexcept {
+	return received_tcp_.load();
+}
+
+bool server::roll (double probability) {
+	if (probability <= 0) return false;
+	return std::uniform_real_distribution<double>(0, 1)(rng_) < probability;
+}
+
+std::chrono::microseconds server::delay () {
+	if (roll(faults_.tail)) return faults_.tail_latency;
+	auto retr = faults_.latency;
+	if (faults_.jitter.count() > 0) {
+		std::uniform_int_distribution<std::chrono::microseconds::rep> dist(0, faults_.jitter.count());
+		retr += std::chrono::microseconds(dist(rng_));
+	}
+	return retr;
+}
+
+void server::receive (port & p) {
+	p.socket.async_receive_from(boost::asio::buffer(p.buffer), p.remote, [this, &p] (auto ec, auto len) {
+		if (ec) return;
+		++received_;
+		if (!this->roll(faults_.loss)) this->respond(p, len);
+		this->receive(p);
+	});
+}
+
+void server::respond (port & p, std::size_t len) {
+	auto out = std::make_shared<std::vector<unsigned char>>(512 + 64);
+	auto size = stub::answer(p.buffer.data(), len, out->data());
+	if (!size) return;
+	if (roll(faults_.truncate)) {
+		(*out)[2] |= 0x02;	//	TC
+		std::memset(out->data() + 6, 0, 6);
+		size = question_end(out->data());
+	} else if (roll(faults_.oversize)) {
+		//	A NULL record owned by the root in the
+		//	additional section
+		out->resize(size + 11 + padding);
+		(*out)[11] = 1;	//	ARCOUNT
+		unsigned char * ptr = out->data() + size;
+		*(ptr++) = 0;
+		*(ptr++) = 0;
+		*(ptr++) = ns_t_null;
+		*(ptr++) = 0;
+		*(ptr++) = ns_c_in;
+		std::memset(ptr, 0, 4);	//	TTL
+		ptr += 4;
+		*(ptr++) = static_cast<unsigned char>(padding >> 8);
+		*(ptr++) = static_cast<unsigned char>(padding);
+		std::memset(ptr, 0, padding);
+		size = out->size();
+	}
+	std::size_t copies = roll(faults_.duplicate) ? 2 : 1;
+	auto remote = p.remote;
+	auto d = delay();
+	if (d.count() == 0) {
+		boost::system::error_code ignored;
+		for (std::size_t i = 0; i < copies; ++i) p.socket.send_to(boost::asio::buffer(out->data(), size), remote, 0, ignored);
+		return;
+	}
+	auto timer = std::make_shared<boost::asio::steady_timer>(ios_, d);
+	timer->async_wait([timer, out, size, copies, remote, &p] (auto ec) {
+		if (ec) return;
+		boost::system::error_code ignored;
+		for (std::size_t i = 0; i < copies; ++i) p.socket.send_to(boost::asio::buffer(out->data(), size), remote, 0, ignored);
+	});
+}
+
+void server::accept (port & p) {
+	p.acceptor.async_accept(p.pending, [this, &p] (auto ec) {
+		if (ec) return;
+		std::make_shared<stub::connection>(ios_, std::move(p.pending), [this] () {
+			++received_;
+			++received_tcp_;
+			return faults_.tcp_latency;
+		})->read();
+		p.pending = boost::asio::ip::tcp::socket(ios_);
+		this->accept(p);
+	});
+}
+
+}
+}
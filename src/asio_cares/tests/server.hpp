@@ -0,0 +1,158 @@
+#pragma once
+
+#include <asio_cares/channel.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace asio_cares {
+namespace tests {
+
+/**
+ *	A DNS server which listens on one or more ports
+ *	(for both UDP and TCP) on the loopback interface
+ *	and runs on its own thread.
+ *
+ *	Queries are answered by `stub::answer`.
+ *
+ *	Faults may be injected (see \ref faults) in order
+ *	to observe the behavior of a \ref channel under
+ *	adverse conditions. Faults are chosen by a pseudo
+ *	random number generator with a fixed seed.
+ */
+class server {
+public:
+	/**
+	 *	Determines which faults are injected.
+	 */
+	class faults {
+	public:
+		/**
+		 *	Creates an object which injects no faults.
+		 */
+		faults () noexcept;
+		/**
+		 *	The delay before each UDP response is sent.
+		 */
+		std::chrono::microseconds latency;
+		/**
+		 *	The maximum additional delay before each UDP
+		 *	response is sent (the actual additional delay
+		 *	is uniformly distributed).
+		 */
+		std::chrono::microseconds jitter;
+		/**
+		 *	The probability that a UDP response is delayed
+		 *	by \ref tail_latency rather than \ref latency and
+		 *	\ref jitter.
+		 */
+		double                    tail;
+		/**
+		 *	See \ref tail.
+		 */
+		std::chrono::microseconds tail_latency;
+		/**
+		 *	The probability that a UDP query is ignored.
+		 */
+		double                    loss;
+		/**
+		 *	The probability that a UDP response is
+		 *	truncated (i.e. has the TC bit set and no
+		 *	answers) which forces the query to be retried
+		 *	over TCP.
+		 */
+		double                    truncate;
+		/**
+		 *	The probability that a UDP response is padded
+		 *	with an additional record so that it is larger
+		 *	than any buffer into which a \ref channel
+		 *	receives datagrams.
+		 */
+		double                    oversize;
+		/**
+		 *	The probability that a UDP response is sent
+		 *	twice.
+		 */
+		double                    duplicate;
+		/**
+		 *	The delay before each TCP response is sent.
+		 */
+		std::chrono::microseconds tcp_latency;
+	};
+	server (const server &) = delete;
+	server (server &&) = delete;
+	server & operator = (const server &) = delete;
+	server & operator = (server &&) = delete;
+	/**
+	 *	Starts a server.
+	 *
+	 *	\param [in] ports
+	 *		The number of ports on which to listen.
+	 *		Defaults to one.
+	 *	\param [in] f
+	 *		The faults to inject. Defaults to none.
+	 */
+	explicit server (std::size_t ports = 1, const faults & f = faults());
+	/**
+	 *	Stops the server.
+	 */
+	~server () noexcept;
+	/**
+	 *	Configures a \ref channel to use every port
+	 *	on which this server listens as a separate
+	 *	server.
+	 *
+	 *	\param [in] c
+	 *		The \ref channel.
+	 */
+	void apply (channel & c) const;
+	/**
+	 *	Retrieves the number of ports on which
+	 *	this server listens.
+	 *
+	 *	\return
+	 *		The number of ports.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Retrieves the number of queries this server
+	 *	has received over either transport.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::size_t received () const noexcept;
+	/**
+	 *	Retrieves the number of queries this server
+	 *	has received over TCP.
+	 *
+	 *	\return
+	 *		The number of queries.
+	 */
+	std::size_t received_tcp () const noexcept;
+private:
+	class port;
+	void receive (port &);
+	void accept (port &);
+	void respond (port &, std::size_t);
+	bool roll (double);
+	std::chrono::microseconds delay ();
+	faults                                         faults_;
+	boost::asio::io_service                        ios_;
+	std::unique_ptr<boost::asio::io_service::work> work_;
+	std::vector<std::unique_ptr<port>>             ports_;
+	std::minstd_rand                               rng_;
+	std::thread                                    thread_;
+	std::atomic<std::size_t>                       received_;
+	std::atomic<std::size_t>                       received_tcp_;
+};
+
+}
+}
@@ -5,6 +5,14 @@
 namespace asio_cares {
 namespace tests {
 
+/**
+ *	Configures a \ref channel to use a \ref server
+ *	(without faults) which is shared by every test
+ *	and which runs until the process exits.
+ *
+ *	\param [in] c
+ *		The \ref channel.
+ */
 void setup (channel & c);
 
 }
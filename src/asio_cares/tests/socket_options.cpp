@@ -0,0 +1,326 @@
+#include <asio_cares/socket_options.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/metrics.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/send.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include "server.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+class configured {
+public:
+	configured ()
+		:	invocations(0),
+			fail       (false)
+	{}
+	std::size_t invocations;
+	bool        fail;
+};
+
+void configure (boost::asio::ip::udp::socket &, boost::system::error_code & ec, void * data) noexcept {
+	auto && c = *static_cast<configured *>(data);
+	++c.invocations;
+	if (c.fail) ec = make_error_code(boost::system::errc::permission_denied);
+}
+
+SCENARIO("asio_cares::socket_options objects leave every option as the operating system sets it by default", "[asio_cares][socket_options]") {
+	GIVEN("A default constructed asio_cares::socket_options") {
+		socket_options o;
+		THEN("Every option is zero or false") {
+			CHECK(o.receive_buffer_size == 0);
+			CHECK(o.send_buffer_size == 0);
+			CHECK(o.busy_poll == 0);
+			CHECK_FALSE(o.receive_errors);
+			CHECK_FALSE(o.track_drops);
+			CHECK(o.max_receive_buffer_size == 0);
+			CHECK_FALSE(o.callback);
+			CHECK_FALSE(o.callback_data);
+		}
+	}
+}
+
+SCENARIO("asio_cares::channel objects apply socket options to the UDP sockets they open", "[asio_cares][socket_options][channel]") {
+	GIVEN("An asio_cares::channel with socket options and a server") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		configured data;
+		socket_options o;
+		o.receive_buffer_size = 1 << 17;
+		o.send_buffer_size = 1 << 16;
+		o.receive_errors = true;
+		o.track_drops = true;
+		o.callback = &configure;
+		o.callback_data = &data;
+		c.set_socket_options(o);
+		CHECK(c.get_socket_options().receive_buffer_size == o.receive_buffer_size);
+		server s;
+		s.apply(c);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		bool invoked = false;
+		boost::system::error_code ec;
+		async_send(c, ptr, buflen, [&] (auto e, auto, auto, auto) noexcept {
+			invoked = true;
+			ec = e;
+		});
+		WHEN("A query is sent") {
+			int receive_buffer_size = 0;
+			c.for_each_socket([&] (auto & socket) noexcept {
+				boost::asio::socket_base::receive_buffer_size size;
+				boost::system::error_code ec;
+				socket.get_option(size, ec);
+				if (!ec) receive_buffer_size = size.value();
+			});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("The options are applied to the socket") {
+				CHECK(data.invocations == 1);
+				CHECK(receive_buffer_size >= o.receive_buffer_size);
+			}
+			THEN("The query succeeds") {
+				REQUIRE(invoked);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel with socket options whose callback fails and a server") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		configured data;
+		data.fail = true;
+		socket_options o;
+		o.callback = &configure;
+		o.callback_data = &data;
+		c.set_socket_options(o);
+		server s;
+		s.apply(c);
+		unsigned char * ptr;
+		int buflen;
+		int result = ares_create_query("example.com",
+			                           ns_c_in,
+			                           ns_t_a,
+			                           0,
+			                           1,
+			                           &ptr,
+			                           &buflen,
+			                           0);
+		raise(result);
+		string g(ptr);
+		WHEN("A query is sent") {
+			bool invoked = false;
+			boost::system::error_code ec;
+			async_send(c, ptr, buflen, [&] (auto e, auto, auto, auto) noexcept {
+				invoked = true;
+				ec = e;
+			});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("No socket is opened and the query fails") {
+				CHECK(data.invocations != 0);
+				REQUIRE(invoked);
+				CHECK(ec);
+				CHECK(c.get_metrics().sockets() == 0);
+			}
+		}
+	}
+}
+
+#ifdef __linux__
+
+class drops_result {
+public:
+	drops_result ()
+		:	drops  (0),
+			initial(0),
+			grown  (0)
+	{}
+	std::uint32_t drops;
+	int           initial;
+	int           grown;
+};
+
+//	Sends a query to a server which never answers
+//	and floods the socket with more responses to some
+//	other query than fit in its receive buffer
+drops_result flood (channel & c) {
+	boost::asio::io_service & ios = c.get_io_service();
+	boost::asio::ip::udp::socket silent(ios, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+	ares_addr_port_node node;
+	std::memset(&node, 0, sizeof(node));
+	node.family = AF_INET;
+	auto bytes = silent.local_endpoint().address().to_v4().to_bytes();
+	std::memcpy(&node.addr.addr4, bytes.data(), bytes.size());
+	node.udp_port = silent.local_endpoint().port();
+	node.tcp_port = node.udp_port;
+	raise(ares_set_servers_ports(c, &node));
+	unsigned char * ptr;
+	int buflen;
+	int result = ares_create_query("example.com",
+		                           ns_c_in,
+		                           ns_t_a,
+		                           0,
+		                           1,
+		                           &ptr,
+		                           &buflen,
+		                           0);
+	raise(result);
+	string g(ptr);
+	drops_result retr;
+	async_send(c, ptr, buflen, [] (auto, auto, auto, auto) noexcept {});
+	boost::asio::ip::udp::endpoint client;
+	c.for_each_socket([&] (auto & socket) noexcept {
+		boost::system::error_code ec;
+		auto local = socket.local_endpoint(ec);
+		client = boost::asio::ip::udp::endpoint(local.address(), local.port());
+		boost::asio::socket_base::receive_buffer_size size;
+		socket.get_option(size, ec);
+		retr.initial = size.value();
+	});
+	REQUIRE(client.port() != 0);
+	//	A response to the same question but with an
+	//	ID which matches no query (libcares ignores
+	//	such responses)
+	std::vector<unsigned char> response(ptr, ptr + buflen);
+	response[0] = 0xFF;
+	response[1] = 0xFF;
+	response[2] |= 0x80;
+	for (std::size_t i = 0; i < 256; ++i) silent.send_to(boost::asio::buffer(response), client);
+	//	Counts are attached to datagrams which arrive
+	//	after the drops so another must arrive once
+	//	libcares has made room
+	boost::asio::steady_timer late(ios);
+	late.expires_from_now(std::chrono::milliseconds(50));
+	late.async_wait([&] (auto) {
+		silent.send_to(boost::asio::buffer(response), client);
+	});
+	boost::asio::steady_timer check(ios);
+	check.expires_from_now(std::chrono::milliseconds(150));
+	check.async_wait([&] (auto) {
+		c.for_each_drop_count([&] (auto, auto count) noexcept {
+			retr.drops = count;
+		});
+		c.for_each_socket([&] (auto & socket) noexcept {
+			boost::system::error_code ec;
+			boost::asio::socket_base::receive_buffer_size size;
+			socket.get_option(size, ec);
+			retr.grown = size.value();
+		});
+	});
+	async_process(c, [] (auto) noexcept {});
+	ios.run();
+	return retr;
+}
+
+ares_options flood_options () noexcept {
+	ares_options retr;
+	std::memset(&retr, 0, sizeof(retr));
+	retr.timeout = 500;
+	retr.tries = 1;
+	return retr;
+}
+
+socket_options drop_options () noexcept {
+	socket_options retr;
+	retr.receive_buffer_size = 1;
+	retr.track_drops = true;
+	retr.max_receive_buffer_size = 1 << 16;
+	return retr;
+}
+
+SCENARIO("asio_cares::channel objects detect datagrams dropped by the kernel", "[asio_cares][socket_options][channel]") {
+	GIVEN("An asio_cares::channel which tracks drops and grows small receive buffers") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(flood_options(), ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		c.set_socket_options(drop_options());
+		WHEN("More datagrams arrive than fit in the receive buffer") {
+			auto r = flood(c);
+			THEN("The drops are reported") {
+				CHECK(r.drops != 0);
+				if (metrics::enabled) CHECK(c.get_metrics().drops() == r.drops);
+			}
+			THEN("The receive buffer grows") {
+				CHECK(r.grown > r.initial);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which tracks drops, grows small receive buffers, and batches datagrams") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(flood_options(), ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		c.set_socket_options(drop_options());
+		c.set_batching(true);
+		WHEN("More datagrams arrive than fit in the receive buffer") {
+			auto r = flood(c);
+			THEN("The drops are reported") {
+				CHECK(r.drops != 0);
+				if (metrics::enabled) CHECK(c.get_metrics().drops() == r.drops);
+			}
+			THEN("The receive buffer grows") {
+				CHECK(r.grown > r.initial);
+			}
+		}
+	}
+	GIVEN("An asio_cares::channel which tracks drops, grows small receive buffers, and uses io_uring") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(flood_options(), ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES, ios);
+		c.set_socket_options(drop_options());
+		c.set_io_uring(true);
+		WHEN("More datagrams arrive than fit in the receive buffer") {
+			auto r = flood(c);
+			THEN("The drops are reported") {
+				CHECK(r.drops != 0);
+				if (metrics::enabled) CHECK(c.get_metrics().drops() == r.drops);
+			}
+			THEN("The receive buffer grows") {
+				CHECK(r.grown > r.initial);
+			}
+		}
+	}
+}
+
+#endif
+
+}
+}
+}
@@ -0,0 +1,143 @@
+#include <asio_cares/submit.hpp>
+
+#include <ares.h>
+#include <asio_cares/channel.hpp>
+#include <asio_cares/done.hpp>
+#include <asio_cares/error.hpp>
+#include <asio_cares/library.hpp>
+#include <asio_cares/process.hpp>
+#include <asio_cares/string.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include "server.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+
+#ifdef _WIN32
+#include <nameser.h>
+#else
+#include <arpa/nameser.h>
+#endif
+
+namespace asio_cares {
+namespace tests {
+namespace {
+
+std::vector<unsigned char> create_query (const std::string & name) {
+	unsigned char * ptr;
+	int buflen;
+	int result = ares_create_query(name.c_str(),
+	                               ns_c_in,
+	                               ns_t_a,
+	                               0,
+	                               1,
+	                               &ptr,
+	                               &buflen,
+	                               0);
+	raise(result);
+	string g(ptr);
+	return std::vector<unsigned char>(ptr, ptr + buflen);
+}
+
+SCENARIO("asio_cares::async_submit may be used to submit a DNS query without entering the strand", "[asio_cares][submit]") {
+	GIVEN("An asio_cares::channel") {
+		library l;
+		boost::asio::io_service ios;
+		channel c(ios);
+		server s;
+		s.apply(c);
+		WHEN("A query is submitted and its buffer is overwritten") {
+			auto query = create_query("example.com");
+			bool invoked = false;
+			bool on_strand = false;
+			boost::system::error_code ec;
+			int naddrttls = 0;
+			async_submit(c, query.data(), int(query.size()), [&] (auto e, auto, auto buf, auto len) {
+				ec = e;
+				invoked = true;
+				on_strand = c.get_strand().running_in_this_thread();
+				ares_addrttl addrttls [4];
+				naddrttls = 4;
+				if (ares_parse_a_reply(buf, len, nullptr, addrttls, &naddrttls) != ARES_SUCCESS) naddrttls = 0;
+			});
+			std::memset(query.data(), 0, query.size());
+			THEN("It is outstanding") {
+				CHECK_FALSE(invoked);
+				CHECK(c.outstanding() == 1);
+				CHECK_FALSE(done(c));
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				bool process_invoked = false;
+				async_process(c, [&] (auto) noexcept {	process_invoked = true;	});
+				ios.run();
+				THEN("The query completes successfully on the strand") {
+					CHECK(process_invoked);
+					REQUIRE(invoked);
+					INFO(ec.message());
+					CHECK_FALSE(ec);
+					CHECK(on_strand);
+					CHECK(naddrttls != 0);
+					CHECK(done(c));
+				}
+			}
+		}
+		WHEN("A malformed query is submitted") {
+			unsigned char garbage [] = {0, 1, 2};
+			boost::system::error_code ec;
+			async_submit(c, garbage, sizeof(garbage), [&] (auto e, auto, auto, auto) noexcept {	ec = e;	});
+			async_process(c, [] (auto) noexcept {});
+			ios.run();
+			THEN("The operation fails") {
+				CHECK(ec);
+				CHECK(done(c));
+			}
+		}
+		WHEN("Queries are submitted concurrently from several threads") {
+			const std::size_t threads = 4;
+			const std::size_t per = 16;
+			std::atomic<std::size_t> submitted(0);
+			std::size_t succeeded = 0;
+			std::size_t completed = 0;
+			std::vector<std::thread> producers;
+			for (std::size_t i = 0; i < threads; ++i) producers.emplace_back([&, i] () {
+				for (std::size_t j = 0; j < per; ++j) {
+					std::string name("host");
+					name += std::to_string((i * per) + j);
+					name += ".example.com";
+					auto query = create_query(name);
+					//	The completion handler is always invoked
+					//	on the strand so the counts need not be
+					//	atomic
+					async_submit(c, query.data(), int(query.size()), [&] (auto ec, auto, auto, auto) noexcept {
+						++completed;
+						if (!ec) ++succeeded;
+					});
+					++submitted;
+				}
+			});
+			for (auto && t : producers) t.join();
+			THEN("Every query is outstanding") {
+				CHECK(submitted == threads * per);
+				CHECK(c.outstanding() == threads * per);
+			}
+			AND_WHEN("asio_cares::async_process is invoked") {
+				async_process(c, [] (auto) noexcept {});
+				ios.run();
+				THEN("Every query completes successfully") {
+					CHECK(completed == threads * per);
+					CHECK(succeeded == threads * per);
+					CHECK(done(c));
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,170 @@
+#include <asio_cares/detail/timer_wheel.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace asio_cares {
+namespace detail {
+
+static unsigned lowest_bit (std::uint64_t v) noexcept {
+	assert(v);
+	unsigned retr = 0;
+	while (!(v & 1)) {
+		v >>= 1;
+		++retr;
+	}
+	return retr;
+}
+
+//	Rotates the bitmap of a level such that the
+//	slot at index first is the lowest bit
+static std::uint64_t rotate (std::uint64_t v, std::size_t first) noexcept {
+	if (!first) return v;
+	return (v >> first) | (v << (64 - first));
+}
+
+timer_wheel::timer_wheel (clock::duration resolution, clock::time_point origin) noexcept
+	:	resolution_(resolution),
+		origin_    (origin),
+		current_   (0),
+		size_      (0)
+{
+	for (auto && level : levels_) level.fill(nullptr);
+	occupied_.fill(0);
+}
+
+std::uint64_t timer_wheel::to_tick (clock::time_point t, bool up) const noexcept {
+	if (t <= origin_) return 0;
+	auto d = t - origin_;
+	auto retr = std::uint64_t(d / resolution_);
+	if (up && ((d % resolution_) != clock::duration::zero())) ++retr;
+	return retr;
+}
+
+void timer_wheel::place (timer_wheel_entry & e) noexcept {
+	assert(e.tick >= current_);
+	//	Deadlines beyond the span of the wheel wait
+	//	in the top level and are placed anew each time
+	//	it wraps
+	const std::uint64_t span = std::uint64_t(1) << (bits * levels);
+	auto tick = std::min(e.tick, current_ + span - 1);
+	auto delta = tick - current_;
+	std::size_t level = 0;
+	while ((level + 1) < levels && (delta >= (std::uint64_t(1) << (bits * (level + 1))))) ++level;
+	std::size_t slot = std::size_t(tick >> (bits * level)) & (slots - 1);
+	auto && head = levels_[level][slot];
+	e.prev = nullptr;
+	e.next = head;
+	if (head) head->prev = &e;
+	head = &e;
+	e.level = static_cast<unsigned char>(level);
+	e.slot = static_cast<unsigned char>(slot);
+	e.linked = true;
+	occupied_[level] |= std::uint64_t(1) << slot;
+}
+
+void timer_wheel::unlink (timer_wheel_entry & e) noexcept {
+	assert(e.linked);
+	if (e.prev) e.prev->next = e.next;
+	else levels_[e.level][e.slot] = e.next;
+	if (e.next) e.next->prev = e.prev;
+	if (!levels_[e.level][e.slot]) occupied_[e.level] &= ~(std::uint64_t(1) << e.slot);
+	e.prev = nullptr;
+	e.next = nullptr;
+	e.linked = false;
+}
+
+void timer_wheel::insert (timer_wheel_entry & e, clock::time_point deadline) noexcept {
+	assert(!e.linked);
+	e.tick = std::max(to_tick(deadline, true), current_ + 1);
+	place(e);
+	++size_;
+}
+
+void timer_wheel::remove (timer_wheel_entry & e) noexcept {
+	unlink(e);
+	assert(size_);
+	--size_;
+}
+
+void timer_wheel::cascade (std::size_t level) noexcept {
+	std::size_t slot = std::size_t(current_ >> (bits * level)) & (slots - 1);
+	auto e = levels_[level][slot];
+	levels_[level][slot] = nullptr;
+	occupied_[level] &= ~(std::uint64_t(1) << slot);
+	while (e) {
+		auto next = e->next;
+		e->linked = false;
+		place(*e);
+		e = next;
+	}
+}
+
+std::uint64_t timer_wheel::next_tick () const noexcept {
+	assert(size_);
+	auto retr = std::numeric_limits<std::uint64_t>::max();
+	//	Entries in the lowest level are due within
+	//	one rotation (slots before the current slot
+	//	belong to the next rotation)
+	if (occupied_[0]) {
+		auto first = (std::size_t(current_) + 1) & (slots - 1);
+		retr = current_ + 1 + lowest_bit(rotate(occupied_[0], first));
+	}
+	//	Entries in higher levels are moved down when
+	//	the slot in which they wait is reached, which
+	//	is also no later than their deadlines
+	for (std::size_t level = 1; level < levels; ++level) {
+		if (!occupied_[level]) continue;
+		auto next = (current_ >> (bits * level)) + 1;
+		auto first = std::size_t(next) & (slots - 1);
+		auto tick = (next + lowest_bit(rotate(occupied_[level], first))) << (bits * level);
+		retr = std::min(retr, tick);
+	}
+	return retr;
+}
+
+timer_wheel_entry * timer_wheel::pop (clock::time_point now) noexcept {
+	auto target = to_tick(now, false);
+	for (;;) {
+		//	Entries are never inserted into the slot of
+		//	the current tick so everything therein is due
+		if (auto e = levels_[0][std::size_t(current_) & (slots - 1)]) {
+			assert(e->tick == current_);
+			remove(*e);
+			return e;
+		}
+		if (current_ >= target) return nullptr;
+		auto next = size_ ? next_tick() : target;
+		if (next > target) {
+			current_ = target;
+			return nullptr;
+		}
+		current_ = next;
+		//	Higher levels first so that entries they
+		//	move down are themselves moved down if
+		//	their new slot is also due
+		for (std::size_t level = levels - 1; level > 0; --level) {
+			if ((current_ & ((std::uint64_t(1) << (bits * level)) - 1)) == 0) cascade(level);
+		}
+	}
+}
+
+timer_wheel::clock::time_point timer_wheel::next_expiry () const noexcept {
+	if (!size_) return clock::time_point::max();
+	return origin_ + (resolution_ * next_tick());
+}
+
+std::size_t timer_wheel::size () const noexcept {
+	return size_;
+}
+
+bool timer_wheel::empty () const noexcept {
+	return size_ == 0;
+}
+
+}
+}
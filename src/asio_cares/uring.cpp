@@ -0,0 +1,659 @@
+#include <asio_cares/detail/uring.hpp>
+
+#include <ares.h>
+#include <asio_cares/detail/datagram_batch.hpp>
+#include <asio_cares/memory_resource.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <errno.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#ifdef ASIO_CARES_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace asio_cares {
+namespace detail {
+
+constexpr unsigned uring::entries;
+constexpr unsigned uring::completions;
+constexpr std::size_t uring::send_size;
+constexpr std::size_t uring_receiver::depth;
+constexpr std::size_t uring_receiver::receive_size;
+
+template <typename T>
+static T * create (memory_resource & r) noexcept {
+	void * ptr;
+	try {
+		ptr = r.allocate(sizeof(T), alignof(T));
+	} catch (...) {
+		return nullptr;
+	}
+	return new (ptr) T();
+}
+
+template <typename T>
+static void destroy (memory_resource & r, T * ptr) noexcept {
+	if (!ptr) return;
+	ptr->~T();
+	r.deallocate(ptr, sizeof(T), alignof(T));
+}
+
+#ifdef ASIO_CARES_IO_URING
+
+class uring::send_buffer final : public uring_operation {
+public:
+	virtual void complete (int) noexcept override {
+		//	Failures are treated as though the datagram
+		//	were lost in transit
+		next = owner->free_;
+		owner->free_ = this;
+	}
+	uring *       owner;
+	send_buffer * next;
+	unsigned char data [send_size];
+};
+
+class uring_receiver::state {
+public:
+	class slot final : public uring_operation {
+	public:
+		virtual void complete (int result) noexcept override {
+			owner->complete(*this, result);
+		}
+		state *                 owner;
+		slot *                  next;
+		int                     result;
+		struct msghdr           msg;
+		struct iovec            iov;
+		struct sockaddr_storage name;
+		alignas(struct cmsghdr)
+		unsigned char           control [CMSG_SPACE(sizeof(std::uint32_t))];
+		unsigned char           data [receive_size];
+	};
+	state () noexcept
+		:	r          (nullptr),
+			ring       (nullptr),
+			fd         (-1),
+			callback   (nullptr),
+			data       (nullptr),
+			outstanding(0),
+			received   (0),
+			head       (nullptr),
+			tail       (nullptr),
+			dropped    (0),
+			stopped    (false),
+			orphaned   (false)
+	{
+		for (auto && s : slots) {
+			s.owner = this;
+			s.next = nullptr;
+			s.result = 0;
+			std::memset(&s.msg, 0, sizeof(s.msg));
+			s.iov.iov_base = s.data;
+			s.iov.iov_len = receive_size;
+			s.msg.msg_name = &s.name;
+			s.msg.msg_iov = &s.iov;
+			s.msg.msg_iovlen = 1;
+			s.msg.msg_control = s.control;
+		}
+	}
+	bool post (slot & s, std::size_t & syscalls) noexcept {
+		s.msg.msg_namelen = sizeof(s.name);
+		s.msg.msg_controllen = sizeof(s.control);
+		if (!ring->receive(fd, s.msg, s)) {
+			syscalls += ring->submit();
+			if (!ring->receive(fd, s.msg, s)) return false;
+		}
+		++outstanding;
+		return true;
+	}
+	void complete (slot & s, int result) noexcept {
+		assert(outstanding);
+		--outstanding;
+		if (stopped) {
+			if (orphaned && !outstanding) destroy(*r, this);
+			return;
+		}
+		s.result = result;
+		if (result >= 0) dropped = std::max(dropped, datagram_batch::drop_count(s.msg));
+		s.next = nullptr;
+		if (tail) tail->next = &s;
+		else head = &s;
+		tail = &s;
+		if (received++ == 0) callback(data, fd);
+	}
+	memory_resource * r;
+	uring *           ring;
+	int               fd;
+	callback_type     callback;
+	void *            data;
+	std::size_t       outstanding;
+	std::size_t       received;
+	//	Slots whose datagrams have been received but
+	//	not consumed in the order they completed
+	slot *            head;
+	slot *            tail;
+	std::uint32_t     dropped;
+	bool              stopped;
+	//	Set once the receiver has been destroyed, the
+	//	state then destroys itself once the last of its
+	//	operations completes
+	bool              orphaned;
+	slot              slots [depth];
+};
+
+static int setup (unsigned entries, struct io_uring_params & p) noexcept {
+	return int(::syscall(__NR_io_uring_setup, entries, &p));
+}
+
+static int enter (int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+	return int(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+//	Everything which is required: Completions are
+//	never dropped when the completion queue is full
+//	and operations on sockets which would block wait
+//	for readiness within the kernel rather than on a
+//	worker thread (Linux 5.7 and later)
+static constexpr unsigned required_features = IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL;
+
+static void * map (int fd, std::size_t size, off_t offset) noexcept {
+	void * retr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	return (retr == MAP_FAILED) ? nullptr : retr;
+}
+
+uring::uring (boost::asio::io_service & ios, memory_resource & r) noexcept
+	:	r_          (&r),
+		descriptor_ (ios),
+		fd_         (-1),
+		sq_         (nullptr),
+		sq_size_    (0),
+		cq_         (nullptr),
+		cq_size_    (0),
+		sqes_       (nullptr),
+		sqes_size_  (0),
+		sq_head_    (nullptr),
+		sq_tail_    (nullptr),
+		sq_flags_   (nullptr),
+		sq_array_   (nullptr),
+		sq_mask_    (0),
+		sq_entries_ (0),
+		cq_head_    (nullptr),
+		cq_tail_    (nullptr),
+		cq_mask_    (0),
+		cqes_       (nullptr),
+		tail_       (0),
+		outstanding_(0),
+		free_       (nullptr)
+{}
+
+uring::~uring () noexcept {
+	if (fd_ < 0) return;
+	//	Operations which have been prepared reference
+	//	memory which is only released once they complete
+	//	so they must be submitted, and everything which
+	//	remains is cancelled (cancelling any operation
+	//	requires Linux 5.19, on earlier versions the
+	//	cancellation fails and the operations are left
+	//	to complete)
+	if (auto sqe = static_cast<struct io_uring_sqe *>(prepare())) {
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		#ifdef IORING_ASYNC_CANCEL_ANY
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		#endif
+	}
+	while (pending()) if (!submit()) break;
+	while (outstanding_) {
+		complete();
+		if (!outstanding_) break;
+		if ((enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) && (errno != EINTR)) break;
+	}
+	while (free_) {
+		auto next = free_->next;
+		destroy(*r_, free_);
+		free_ = next;
+	}
+	close();
+}
+
+bool uring::open (boost::system::error_code & ec) noexcept {
+	ec.clear();
+	if (fd_ >= 0) return true;
+	struct io_uring_params p;
+	std::memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = completions;
+	fd_ = setup(entries, p);
+	if (fd_ < 0) {
+		ec = boost::system::error_code(errno, boost::system::system_category());
+		return false;
+	}
+	if ((p.features & required_features) != required_features) {
+		ec = make_error_code(boost::system::errc::operation_not_supported);
+		close();
+		return false;
+	}
+	sq_size_ = p.sq_off.array + (p.sq_entries * sizeof(unsigned));
+	cq_size_ = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+	//	The queues may share a single mapping in which
+	//	case it must be large enough for both
+	bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+	sq_ = map(fd_, sq_size_, IORING_OFF_SQ_RING);
+	if (sq_) cq_ = single ? sq_ : map(fd_, cq_size_, IORING_OFF_CQ_RING);
+	sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+	if (cq_) sqes_ = map(fd_, sqes_size_, IORING_OFF_SQES);
+	if (!sqes_) {
+		ec = boost::system::error_code(errno, boost::system::system_category());
+		close();
+		return false;
+	}
+	auto sq = static_cast<unsigned char *>(sq_);
+	sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+	sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+	sq_flags_ = reinterpret_cast<unsigned *>(sq + p.sq_off.flags);
+	sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+	sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+	sq_entries_ = p.sq_entries;
+	auto cq = static_cast<unsigned char *>(cq_);
+	cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+	cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+	cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+	cqes_ = cq + p.cq_off.cqes;
+	tail_ = *sq_tail_;
+	descriptor_.assign(fd_, ec);
+	if (ec) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void uring::close () noexcept {
+	if (sqes_) ::munmap(sqes_, sqes_size_);
+	if (cq_ && (cq_ != sq_)) ::munmap(cq_, cq_size_);
+	if (sq_) ::munmap(sq_, sq_size_);
+	sqes_ = cq_ = sq_ = nullptr;
+	//	Once assigned the descriptor belongs to the
+	//	stream_descriptor
+	boost::system::error_code ec;
+	if (descriptor_.is_open()) descriptor_.close(ec);
+	else ::close(fd_);
+	fd_ = -1;
+}
+
+void * uring::prepare () noexcept {
+	auto head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+	if ((tail_ - head) >= sq_entries_) return nullptr;
+	auto index = tail_ & sq_mask_;
+	auto retr = static_cast<struct io_uring_sqe *>(sqes_) + index;
+	std::memset(retr, 0, sizeof(*retr));
+	sq_array_[index] = index;
+	++tail_;
+	return retr;
+}
+
+bool uring::receive (int fd, struct msghdr & msg, uring_operation & op) noexcept {
+	auto sqe = static_cast<struct io_uring_sqe *>(prepare());
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(&msg);
+	sqe->len = 1;
+	sqe->user_data = reinterpret_cast<std::uintptr_t>(&op);
+	return true;
+}
+
+bool uring::cancel (uring_operation & op) noexcept {
+	auto sqe = static_cast<struct io_uring_sqe *>(prepare());
+	if (!sqe) return false;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(&op);
+	return true;
+}
+
+bool uring::send (int fd, const struct iovec * data, int len) noexcept {
+	std::size_t total = 0;
+	for (int i = 0; i < len; ++i) total += data[i].iov_len;
+	if (total > send_size) return false;
+	auto buffer = free_;
+	if (!buffer) {
+		buffer = create<send_buffer>(*r_);
+		if (!buffer) return false;
+		buffer->owner = this;
+	} else {
+		free_ = buffer->next;
+	}
+	auto sqe = static_cast<struct io_uring_sqe *>(prepare());
+	if (!sqe) {
+		buffer->next = free_;
+		free_ = buffer;
+		return false;
+	}
+	auto ptr = buffer->data;
+	for (int i = 0; i < len; ++i) {
+		std::memcpy(ptr, data[i].iov_base, data[i].iov_len);
+		ptr += data[i].iov_len;
+	}
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(buffer->data);
+	sqe->len = unsigned(total);
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = reinterpret_cast<std::uintptr_t>(static_cast<uring_operation *>(buffer));
+	return true;
+}
+
+std::size_t uring::pending () const noexcept {
+	if (fd_ < 0) return 0;
+	return tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+std::size_t uring::outstanding () const noexcept {
+	return outstanding_;
+}
+
+std::size_t uring::submit () noexcept {
+	std::size_t retr = 0;
+	auto n = unsigned(pending());
+	if (!n) return retr;
+	__atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+	while (n) {
+		++retr;
+		int result = enter(fd_, n, 0, 0);
+		if (result < 0) {
+			if (errno == EINTR) continue;
+			//	The kernel is short of resources (for
+			//	example because completions have overflowed),
+			//	whatever was not submitted remains in the
+			//	queue to be submitted next time
+			break;
+		}
+		if (result == 0) break;
+		outstanding_ += std::size_t(result);
+		n -= unsigned(result);
+	}
+	return retr;
+}
+
+std::size_t uring::complete () noexcept {
+	std::size_t retr = 0;
+	if (fd_ < 0) return retr;
+	bool flushed = false;
+	for (;;) {
+		auto head = *cq_head_;
+		auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			//	Completions which did not fit in the queue
+			//	are held by the kernel until it is entered
+			if (flushed || !(__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) break;
+			enter(fd_, 0, 0, IORING_ENTER_GETEVENTS);
+			flushed = true;
+			continue;
+		}
+		while (head != tail) {
+			auto && cqe = static_cast<struct io_uring_cqe *>(cqes_)[head & cq_mask_];
+			auto op = reinterpret_cast<uring_operation *>(std::uintptr_t(cqe.user_data));
+			int result = cqe.res;
+			__atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+			assert(outstanding_);
+			--outstanding_;
+			++retr;
+			//	Cancellations carry no operation
+			if (op) op->complete(result);
+		}
+	}
+	return retr;
+}
+
+void uring::cancel_wait () noexcept {
+	boost::system::error_code ec;
+	descriptor_.cancel(ec);
+}
+
+bool uring::is_open () const noexcept {
+	return fd_ >= 0;
+}
+
+uring_receiver::uring_receiver (memory_resource & r) noexcept
+	:	r_    (&r),
+		state_(nullptr)
+{}
+
+uring_receiver::~uring_receiver () noexcept {
+	if (!state_) return;
+	stop();
+	if (state_->outstanding) state_->orphaned = true;
+	else destroy(*r_, state_);
+}
+
+bool uring_receiver::start (uring & ring, int fd, callback_type callback, void * data, std::size_t & syscalls) noexcept {
+	assert(!state_);
+	state_ = create<state>(*r_);
+	if (!state_) return false;
+	auto && s = *state_;
+	s.r = r_;
+	s.ring = &ring;
+	s.fd = fd;
+	s.callback = callback;
+	s.data = data;
+	for (auto && slot : s.slots) if (!s.post(slot, syscalls)) break;
+	if (s.outstanding) return true;
+	destroy(*r_, state_);
+	state_ = nullptr;
+	return false;
+}
+
+bool uring_receiver::started () const noexcept {
+	return state_ != nullptr;
+}
+
+ares_ssize_t uring_receiver::receive (void * buffer,
+                                      std::size_t len,
+                                      struct sockaddr * addr,
+                                      ares_socklen_t * addr_len,
+                                      std::size_t & syscalls) noexcept
+{
+	if (!(state_ && state_->head)) {
+		errno = EAGAIN;
+		return -1;
+	}
+	auto && s = *state_;
+	auto && slot = *s.head;
+	s.head = slot.next;
+	if (!s.head) s.tail = nullptr;
+	--s.received;
+	ares_ssize_t retr = -1;
+	int error = 0;
+	if (slot.result < 0) {
+		error = -slot.result;
+	} else {
+		retr = ares_ssize_t(std::min(std::size_t(slot.result), len));
+		std::memcpy(buffer, slot.data, std::size_t(retr));
+		if ((slot.msg.msg_flags & MSG_TRUNC) || (retr != slot.result)) datagram_batch::truncate(buffer, std::size_t(retr));
+		if (addr && addr_len) {
+			std::memcpy(addr, &slot.name, std::min(std::size_t(slot.msg.msg_namelen), std::size_t(*addr_len)));
+			*addr_len = ares_socklen_t(slot.msg.msg_namelen);
+		}
+	}
+	//	If the queue is full even once submitted
+	//	the receive is simply lost and one fewer is
+	//	kept outstanding
+	s.post(slot, syscalls);
+	errno = error;
+	return retr;
+}
+
+std::size_t uring_receiver::received () const noexcept {
+	return state_ ? state_->received : 0;
+}
+
+std::uint32_t uring_receiver::dropped () const noexcept {
+	return state_ ? state_->dropped : 0;
+}
+
+std::size_t uring_receiver::stop () noexcept {
+	if (!state_ || state_->stopped) return 0;
+	auto && s = *state_;
+	s.stopped = true;
+	s.head = s.tail = nullptr;
+	s.received = 0;
+	std::size_t retr = 0;
+	if (!s.outstanding) return retr;
+	//	Completed operations are not found and the
+	//	cancellation of those merely fails
+	for (auto && slot : s.slots) if (!s.ring->cancel(slot)) {
+		retr += s.ring->submit();
+		s.ring->cancel(slot);
+	}
+	retr += s.ring->submit();
+	return retr;
+}
+
+static bool probe () noexcept {
+	struct io_uring_params p;
+	std::memset(&p, 0, sizeof(p));
+	int fd = setup(1, p);
+	if (fd < 0) return false;
+	::close(fd);
+	return (p.features & required_features) == required_features;
+}
+
+bool uring::supported () noexcept {
+	static const bool retr = probe();
+	return retr;
+}
+
+#else
+
+uring::uring (boost::asio::io_service &, memory_resource & r) noexcept
+	:	r_          (&r),
+		fd_         (-1),
+		sq_         (nullptr),
+		sq_size_    (0),
+		cq_         (nullptr),
+		cq_size_    (0),
+		sqes_       (nullptr),
+		sqes_size_  (0),
+		sq_head_    (nullptr),
+		sq_tail_    (nullptr),
+		sq_flags_   (nullptr),
+		sq_array_   (nullptr),
+		sq_mask_    (0),
+		sq_entries_ (0),
+		cq_head_    (nullptr),
+		cq_tail_    (nullptr),
+		cq_mask_    (0),
+		cqes_       (nullptr),
+		tail_       (0),
+		outstanding_(0),
+		free_       (nullptr)
+{}
+
+uring::~uring () noexcept {}
+
+bool uring::open (boost::system::error_code & ec) noexcept {
+	ec = make_error_code(boost::system::errc::operation_not_supported);
+	return false;
+}
+
+void uring::close () noexcept {}
+
+void * uring::prepare () noexcept {
+	return nullptr;
+}
+
+bool uring::receive (int, struct msghdr &, uring_operation &) noexcept {
+	return false;
+}
+
+bool uring::cancel (uring_operation &) noexcept {
+	return false;
+}
+
+bool uring::send (int, const struct iovec *, int) noexcept {
+	return false;
+}
+
+std::size_t uring::pending () const noexcept {
+	return 0;
+}
+
+std::size_t uring::outstanding () const noexcept {
+	return 0;
+}
+
+std::size_t uring::submit () noexcept {
+	return 0;
+}
+
+std::size_t uring::complete () noexcept {
+	return 0;
+}
+
+void uring::cancel_wait () noexcept {}
+
+bool uring::is_open () const noexcept {
+	return false;
+}
+
+bool uring::supported () noexcept {
+	return false;
+}
+
+class uring_receiver::state {};
+
+uring_receiver::uring_receiver (memory_resource & r) noexcept
+	:	r_    (&r),
+		state_(nullptr)
+{}
+
+uring_receiver::~uring_receiver () noexcept {}
+
+bool uring_receiver::start (uring &, int, callback_type, void *, std::size_t &) noexcept {
+	return false;
+}
+
+bool uring_receiver::started () const noexcept {
+	return false;
+}
+
+ares_ssize_t uring_receiver::receive (void *,
+                                      std::size_t,
+                                      struct sockaddr *,
+                                      ares_socklen_t *,
+                                      std::size_t &) noexcept
+{
+	errno = EAGAIN;
+	return -1;
+}
+
+std::size_t uring_receiver::received () const noexcept {
+	return 0;
+}
+
+std::uint32_t uring_receiver::dropped () const noexcept {
+	return 0;
+}
+
+std::size_t uring_receiver::stop () noexcept {
+	return 0;
+}
+
+#endif
+
+}
+}